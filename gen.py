@@ -8,17 +8,19 @@ half_configs = [
     {
         "typeTag": "TYPE_TAG_I32",
         "disp": "int32",
+        "py_type": "int",
         "type": "int32_t",
         "zero": 0,
         "negative_one": -1,
         "from_func": "PyLong_FromLong",
-        "as_func": "PyLong_AsLong",
-        "format_spec": '"%ld"',
+        "as_func": "pyconv_as_int32",
+        "format_spec": '"%d"',
         "short_repr_size": 1,
     },
     {
         "typeTag": "TYPE_TAG_I64",
         "disp": "int64",
+        "py_type": "int",
         "type": "int64_t",
         "zero": 0,
         "negative_one": -1,
@@ -30,6 +32,7 @@ half_configs = [
     {
         "typeTag": "TYPE_TAG_F32",
         "disp": "float32",
+        "py_type": "float",
         "type": "float",
         "zero": "0.0f",
         "negative_one": "-1.0f",
@@ -43,6 +46,7 @@ half_configs = [
     {
         "typeTag": "TYPE_TAG_F64",
         "disp": "float64",
+        "py_type": "float",
         "type": "double",
         "zero": "0.0",
         "negative_one": "-1.0",
@@ -54,15 +58,89 @@ half_configs = [
     {
         "typeTag": "TYPE_TAG_STR",
         "disp": "str",
+        "py_type": "str",
         "type": "char*",
         "zero": "{ .ptr = EMPTY_STR, .len = 0 }",
         "short_repr_size": 2,
     },
+    {
+        "typeTag": "TYPE_TAG_BYTES",
+        "disp": "bytes",
+        "py_type": "bytes",
+        "type": "bytes",
+        "zero": "{ .ptr = EMPTY_STR, .len = 0 }",
+        "short_repr_size": 3,
+    },
+]
+
+# key-only types: fixed-width binary keys, e.g. MD5/SHA-1/SHA-256 digests
+digest_configs = [
+    {
+        "typeTag": "TYPE_TAG_FIXED",
+        "disp": f"bytes{width}",
+        "py_type": "bytes",
+        "type": "fixed",
+        "width": width,
+        "short_repr_size": 3 + width,
+    }
+    for width in (16, 20, 32)
 ]
 
+# key-only type: (int64, int64) tuples, e.g. graph edges
+pair_config = {
+    "typeTag": "TYPE_TAG_PAIR",
+    "disp": "int64_pair",
+    "py_type": "Tuple[int, int]",
+    "type": "pair",
+    "format_spec": '"(%lld, %lld)"',
+    "short_repr_size": 6,
+}
+
+# value-only type: references to arbitrary Python objects
+object_config = {
+    "typeTag": "TYPE_TAG_OBJECT",
+    "disp": "object",
+    "py_type": "Any",
+    "type": "object",
+    "zero": "Py_None",
+    "short_repr_size": 4,
+}
+
+# value-only type: int64 values stored at 1, 2, 4 or 8 bytes, widening on overflow
+compact_config = {
+    **half_configs[1],
+    "typeTag": "TYPE_TAG_COMPACT_I64",
+    "disp": "compact_int64",
+}
+
+# value-only type: fixed-size records of scalar fields, rendered from str_record_Py.c
+record_config = {
+    "typeTag": "TYPE_TAG_RECORD",
+    "disp": "record",
+    "py_type": "Tuple[float, ...]",
+}
+
+# value-only type: fixed-length arrays of one scalar type, rendered from str_vector_Py.c
+vector_config = {
+    "typeTag": "TYPE_TAG_VECTOR",
+    "disp": "vector",
+    "py_type": "Any",
+}
+
+# value-only type: growable int32/int64 arrays, e.g. posting lists, rendered from str_postings_Py.c
+postings_config = {
+    "typeTag": "TYPE_TAG_POSTINGS",
+    "disp": "postings",
+    "py_type": "Any",
+}
+
+# value-only type: dense int32 ids assigned in insertion order, rendered from str_vocab_Py.c
+vocab_config = {
+    **half_configs[0],
+    "disp": "vocab",
+}
+
 base_src_path = "pypocketmap"
-with open(f"{base_src_path}/str_int64_Py.c", "r", encoding="utf-8") as fp:
-    src_lines = [line.rstrip() for line in fp.readlines()]
 
 # base_test_path = "pocketmap/src/test/java/dev/dylanburati/pocketmap"
 # with open(
@@ -89,8 +167,34 @@ if (\(.[2]).ptr == NULL) {
 \(.[2]).len = \(.[2])_len;
 """.strip().replace('\n', r'\n')
 
+from_py_bytes = r"""
+if (!pyconv_bytes_view(\(.[1]), &\(.[2]))) {
+    return \(.[3]);
+}
+""".strip().replace('\n', r'\n')
+
+from_py_fixed = r"""
+if (!pyconv_fixed_view(\(.[1]), KEY_FIXED_WIDTH, &\(.[2]))) {
+    return \(.[3]);
+}
+""".strip().replace('\n', r'\n')
+
+from_py_object = r"""
+\(.[2]) = \(.[1]);
+""".strip().replace('\n', r'\n')
+
+from_py_pair = r"""
+if (!pyconv_pair(\(.[1]), &\(.[2]))) {
+    return \(.[3]);
+}
+""".strip().replace('\n', r'\n')
+
 partial_from_py_normal = r'\n'.join(from_py_normal.split(r'\n')[:2])
 partial_from_py_string = r'\n'.join(from_py_string.split(r'\n')[1:3])
+partial_from_py_bytes = r'\n'.join(from_py_bytes.split(r'\n')[:1])
+partial_from_py_fixed = r'\n'.join(from_py_fixed.split(r'\n')[:1])
+partial_from_py_pair = r'\n'.join(from_py_pair.split(r'\n')[:1])
+partial_from_py_object = from_py_object + r'\nif (\(.[2]) == NULL) {'
 
 repr_write_normal = r"""
 size_t \(.[1])_len = snprintf(\(.[1])_repr, 47, \(.[0].format_spec), \(.[1]));
@@ -100,6 +204,10 @@ if (_PyUnicodeWriter_WriteASCIIString(&writer, \(.[1])_repr, \(.[1])_len) < 0) {
 }
 """.strip().replace('\n', r'\n')
 
+repr_write_pair = repr_write_normal.replace(
+    r"\(.[0].format_spec), \(.[1])", r"\(.[0].format_spec), (long long) \(.[1]).a, (long long) \(.[1]).b"
+)
+
 repr_write_string = r"""
 \(.[1])_obj = PyUnicode_FromStringAndSize(\(.[1]).ptr, \(.[1]).len);
 if (\(.[1])_obj == NULL) {
@@ -120,6 +228,26 @@ if (_PyUnicodeWriter_WriteStr(&writer, \(.[1])_repr) < 0) {
 Py_CLEAR(\(.[1])_obj);
 """
 
+# holds a reference while the repr runs, since it can run any code
+repr_write_object = r"""
+Py_INCREF(\(.[1]));
+\(.[1])_repr = PyObject_Repr(\(.[1]));
+Py_DECREF(\(.[1]));
+if (\(.[1])_repr == NULL) {
+    _PyUnicodeWriter_Dealloc(&writer);
+    return NULL;
+}
+if (_PyUnicodeWriter_WriteStr(&writer, \(.[1])_repr) < 0) {
+    _PyUnicodeWriter_Dealloc(&writer);
+    Py_DECREF(\(.[1])_repr);
+    return NULL;
+}
+Py_DECREF(\(.[1])_repr);
+"""
+
+repr_write_bytes = repr_write_string.replace("PyUnicode_FromStringAndSize", "PyBytes_FromStringAndSize")
+repr_write_fixed = repr_write_bytes.replace(r"\(.[1]).ptr, \(.[1]).len", r"\(.[1]), KEY_FIXED_WIDTH")
+
 def fill_templates(configs, lines):
     result = [[] for _ in configs]
     i = 0
@@ -151,33 +279,56 @@ def fill_templates(configs, lines):
             jq_script = (
                 r'def to_py: if .[0].type == "char*" then '
                 r' "PyUnicode_DecodeUTF8(\(.[1]).ptr, \(.[1]).len, NULL)"'
+                r' elif .[0].type == "bytes" then '
+                r' "PyBytes_FromStringAndSize(\(.[1]).ptr, \(.[1]).len)"'
+                r' elif .[0].type == "fixed" then '
+                r' "PyBytes_FromStringAndSize(\(.[1]), KEY_FIXED_WIDTH)"'
+                r' elif .[0].type == "pair" then '
+                r' "Py_BuildValue(\"(LL)\", (long long) \(.[1]).a, (long long) \(.[1]).b)"'
+                r' elif .[0].type == "object" then '
+                r' "pyconv_new_ref(\(.[1]))"'
                 r' else "\(.[0].from_func)(\(.[0].cast_from//"")\(.[1]))" end;'
                 '\n'
             )
             jq_script += (
                 r'def from_py: if .[0].type == "char*" then "{}"'.format(from_py_string) +
+                r' elif .[0].type == "bytes" then "{}"'.format(from_py_bytes) +
+                r' elif .[0].type == "fixed" then "{}"'.format(from_py_fixed) +
+                r' elif .[0].type == "pair" then "{}"'.format(from_py_pair) +
+                r' elif .[0].type == "object" then "{}"'.format(from_py_object) +
                 r' else "{}" end;'.format(from_py_normal) +
                 '\n'
             )
             jq_script += (
                 r'def partial_from_py: if .[0].type == "char*" then "{}"'.format(partial_from_py_string) +
+                r' elif .[0].type == "bytes" then "{}"'.format(partial_from_py_bytes) +
+                r' elif .[0].type == "fixed" then "{}"'.format(partial_from_py_fixed) +
+                r' elif .[0].type == "pair" then "{}"'.format(partial_from_py_pair) +
+                r' elif .[0].type == "object" then "{}"'.format(partial_from_py_object) +
                 r' else "{}" end;'.format(partial_from_py_normal) +
                 '\n'
             )
             jq_script += (
                 r'def key_error: if .[0].type == "char*" then '
                 r' "PyErr_SetString(PyExc_KeyError, \(.[1]).ptr)"'
+                r' elif .[0].type == "bytes" or .[0].type == "fixed" or .[0].type == "pair" then '
+                r' "pyconv_key_error(\(.[1])_obj)"'
                 r' else "char msg[48];\nsnprintf(msg, 47, \(.[0].format_spec), \(.[1]));\nPyErr_SetString(PyExc_KeyError, msg);" end;'
                 '\n'
             )
             jq_script += (
-                r'def repr_declare: if .[0].type == "char*" then '
+                r'def repr_declare: if .[0].type == "char*" or .[0].type == "bytes" or .[0].type == "fixed" then '
                 r' "PyObject* \(.[1])_obj = NULL;\nPyObject* \(.[1])_repr;"'
+                r' elif .[0].type == "object" then "PyObject* \(.[1])_repr;"'
                 r' else "char \(.[1])_repr[48];" end;'
                 '\n'
             )
             jq_script += (
                 r'def repr_write: if .[0].type == "char*" then "{}"'.format(repr_write_string) +
+                r' elif .[0].type == "bytes" then "{}"'.format(repr_write_bytes) +
+                r' elif .[0].type == "fixed" then "{}"'.format(repr_write_fixed) +
+                r' elif .[0].type == "pair" then "{}"'.format(repr_write_pair) +
+                r' elif .[0].type == "object" then "{}"'.format(repr_write_object) +
                 r' else "{}" end;'.format(repr_write_normal) +
                 '\n'
             )
@@ -221,23 +372,49 @@ def fill_templates(configs, lines):
     return result
 
 
-src_configs = [{"key": c1, "val": c2} for c1 in half_configs[-1:] for c2 in half_configs]
-first_config = None
-for c in src_configs:
-    if c["key"]["disp"] == "str" and c["val"]["disp"] == "int64":
-        first_config = c
-        break
-else:
-    raise ValueError()
-first_config["keep"] = True
-src_configs = [c for c in src_configs if c != first_config]
-src_configs.append({"key": half_configs[1], "val": half_configs[1]})
-src_sanity, *src_outs = fill_templates([first_config, *src_configs], src_lines)
-if src_sanity != src_lines:
-    import pdb
-
-    pdb.set_trace()
-    sys.exit(1)
+key_configs = [
+    half_configs[4],  # str
+    half_configs[1],  # int64
+    half_configs[0],  # int32
+    half_configs[5],  # bytes
+    *digest_configs,
+    pair_config,
+]
+src_configs = [{"key": c1, "val": c2} for c1 in key_configs for c2 in [*half_configs, compact_config, object_config]]
+record_configs = [{"key": c1, "val": record_config} for c1 in key_configs]
+vector_configs = [{"key": c1, "val": vector_config} for c1 in key_configs]
+postings_configs = [{"key": c1, "val": postings_config} for c1 in key_configs]
+vocab_configs = [{"key": c1, "val": vocab_config} for c1 in key_configs if c1["disp"] in ("str", "bytes", "int64")]
+
+
+def render(template_path, configs):
+    """Renders `template_path` for each config. The config matching the template's own
+    `<key>_<val>_Py.c` name is used to check that the template round-trips."""
+    with open(template_path, "r", encoding="utf-8") as fp:
+        lines = [line.rstrip() for line in fp.readlines()]
+    first, *rest = sorted(
+        configs, key=lambda c: not template_path.endswith(f"/{c['key']['disp']}_{c['val']['disp']}_Py.c")
+    )
+    first["keep"] = True
+    sanity, *outs = fill_templates([first, *rest], lines)
+    if sanity != lines:
+        import pdb
+
+        pdb.set_trace()
+        sys.exit(1)
+    del first["keep"]
+    for lst, c in zip(outs, rest):
+        src_file = f"{c['key']['disp']}_{c['val']['disp']}_Py.c"
+        with open(f"{base_src_path}/{src_file}", "w", encoding="utf-8") as fp:
+            fp.write("\n".join(lst))
+            fp.write("\n")
+
+
+render(f"{base_src_path}/str_int64_Py.c", src_configs)
+render(f"{base_src_path}/str_record_Py.c", record_configs)
+render(f"{base_src_path}/str_vector_Py.c", vector_configs)
+render(f"{base_src_path}/str_postings_Py.c", postings_configs)
+render(f"{base_src_path}/str_vocab_Py.c", vocab_configs)
 # test_sanity, *test_outs = fill_templates([int_config, *configs, *test_only_configs], test_lines)
 # if test_sanity != test_lines:
 #     import pdb
@@ -245,11 +422,53 @@ if src_sanity != src_lines:
 #     pdb.set_trace()
 #     sys.exit(1)
 
-for lst, c in zip(src_outs, src_configs):
-    src_file = f"{c['key']['disp']}_{c['val']['disp']}_Py.c"
-    with open(f"{base_src_path}/{src_file}", "w", encoding="utf-8") as fp:
-        fp.write("\n".join(lst))
-        fp.write("\n")
+for c in src_configs:
+    stub_file = f"{c['key']['disp']}_{c['val']['disp']}.pyi"
+    with open(f"{base_src_path}/_pkt_c/{stub_file}", "w", encoding="utf-8") as fp:
+        typing_names = [t for t in ("Any", "Tuple") if t in c["key"]["py_type"] + c["val"]["py_type"]]
+        if typing_names:
+            fp.write(f"from typing import {', '.join(typing_names)}\n\n")
+        fp.write("from .. import _Map\n\n")
+        fp.write(f"def create(num_buckets: int = 32) -> _Map[{c['key']['py_type']}, {c['val']['py_type']}]:\n")
+        fp.write("    ...\n")
+for c in record_configs:
+    stub_file = f"{c['key']['disp']}_record.pyi"
+    with open(f"{base_src_path}/_pkt_c/{stub_file}", "w", encoding="utf-8") as fp:
+        fp.write("from typing import Sequence, Tuple\n\n")
+        fp.write("from .. import _RecordMap\n\n")
+        fp.write(
+            "def create(fields: Sequence[Tuple[str, str]], num_buckets: int = 32)"
+            f" -> _RecordMap[{c['key']['py_type']}]:\n"
+        )
+        fp.write("    ...\n")
+for c in vector_configs:
+    stub_file = f"{c['key']['disp']}_vector.pyi"
+    with open(f"{base_src_path}/_pkt_c/{stub_file}", "w", encoding="utf-8") as fp:
+        if "Tuple" in c["key"]["py_type"]:
+            fp.write("from typing import Tuple\n\n")
+        fp.write("from .. import _VectorMap\n\n")
+        fp.write(f"def create(format: str, dim: int, num_buckets: int = 32) -> _VectorMap[{c['key']['py_type']}]:\n")
+        fp.write("    ...\n")
+for c in postings_configs:
+    stub_file = f"{c['key']['disp']}_postings.pyi"
+    with open(f"{base_src_path}/_pkt_c/{stub_file}", "w", encoding="utf-8") as fp:
+        if "Tuple" in c["key"]["py_type"]:
+            fp.write("from typing import Tuple\n\n")
+        fp.write("from .. import _PostingsMap\n\n")
+        fp.write(f"def create(format: str = \"i8\", num_buckets: int = 32) -> _PostingsMap[{c['key']['py_type']}]:\n")
+        fp.write("    ...\n")
+for c in vocab_configs:
+    stub_file = f"{c['key']['disp']}_vocab.pyi"
+    with open(f"{base_src_path}/_pkt_c/{stub_file}", "w", encoding="utf-8") as fp:
+        fp.write("from typing import Any, Optional, Tuple\n\n")
+        fp.write("from .. import _Vocab\n\n")
+        fp.write(f"def create(num_buckets: int = 32) -> _Vocab[{c['key']['py_type']}]:\n")
+        fp.write("    ...\n")
+        fp.write(
+            "def factorize(keys: Any, size_hint: int = -1, codes: bool = True)"
+            f" -> Tuple[Optional[Any], _Vocab[{c['key']['py_type']}]]:\n"
+        )
+        fp.write("    ...\n")
 # for lst, c in zip(test_outs, configs + test_only_configs):
 #     test_file = f"{c['val']['disp']}PocketMapTest.java"
 #     with open(f"{base_test_path}/{test_file}", "w", encoding="utf-8") as fp:
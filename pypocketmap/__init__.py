@@ -1,5 +1,6 @@
 from enum import Enum
-from _pkt_c import int64_int64, str_float32, str_float64, str_int32, str_int64, str_str
+import importlib
+import re
 
 class dtype(Enum):
     int32 = 1
@@ -7,6 +8,17 @@ class dtype(Enum):
     float32 = 3
     float64 = 4
     string = 5
+    bytes = 6
+    # fixed-width binary keys, e.g. digests
+    bytes16 = 7
+    bytes20 = 8
+    bytes32 = 9
+    # (int64, int64) tuples, e.g. graph edges
+    int64_pair = 10
+    # int64 values stored at 1, 2, 4 or 8 bytes each, widening the first time one doesn't fit
+    compact_int64 = 11
+    # arbitrary Python objects
+    object = 12
 
 
 int32_ = dtype.int32
@@ -14,21 +26,255 @@ int64_ = dtype.int64
 float32_ = dtype.float32
 float64_ = dtype.float64
 string_ = dtype.string
+bytes_ = dtype.bytes
+bytes16_ = dtype.bytes16
+bytes20_ = dtype.bytes20
+bytes32_ = dtype.bytes32
+int64_pair_ = dtype.int64_pair
+compact_int64_ = dtype.compact_int64
+object_ = dtype.object
+
+_key_types = [string_, bytes_, int64_, int32_, bytes16_, bytes20_, bytes32_, int64_pair_]
+_value_types = [int32_, int64_, float32_, float64_, string_, bytes_, compact_int64_, object_]
+
+
+def _disp(t):
+    return "str" if t == string_ else t.name
+
+
+# `<key>_<value>` extension module for each generated combination, see gen.py
+_modules = {
+    (kt, vt): importlib.import_module(f"_pkt_c.{_disp(kt)}_{_disp(vt)}")
+    for kt in _key_types
+    for vt in _value_types
+}
+# `<key>_record` extension module for each key type, see str_record_Py.c
+_record_modules = {
+    kt: importlib.import_module(f"_pkt_c.{_disp(kt)}_record") for kt in _key_types
+}
+# `<key>_vector` extension module for each key type, see str_vector_Py.c
+_vector_modules = {
+    kt: importlib.import_module(f"_pkt_c.{_disp(kt)}_vector") for kt in _key_types
+}
+# `<key>_postings` extension module for each key type, see str_postings_Py.c
+_postings_modules = {
+    kt: importlib.import_module(f"_pkt_c.{_disp(kt)}_postings") for kt in _key_types
+}
+# `<key>_vocab` extension module for str, bytes and int64 keys, see str_vocab_Py.c
+_vocab_modules = {
+    kt: importlib.import_module(f"_pkt_c.{_disp(kt)}_vocab") for kt in (string_, bytes_, int64_)
+}
+
+
+def _as_dtype(t):
+    if t is str:
+        return string_
+    if t is int:
+        return int64_
+    if t is float:
+        return float64_
+    if t is bytes:
+        return bytes_
+    if t == (int, int):
+        return int64_pair_
+    if t is object:
+        return object_
+    return t
+
+
+_formats = {int: "i8", float: "f8", int32_: "i4", int64_: "i8", float32_: "f4", float64_: "f8"}
+
+
+def _format(fmt):
+    """Converts a scalar type to the numpy typestr that the record and vector maps take, e.g. "i8"."""
+    if not isinstance(fmt, str) and fmt in _formats:
+        return _formats[fmt]
+    if isinstance(fmt, str) and re.fullmatch(r"[<=|]?[iuf][1248]", fmt):
+        return fmt
+    import numpy
+
+    return numpy.dtype(fmt).str
+
+
+def _record_fields(value_type):
+    """Converts a numpy structured dtype or a list of (name, type) pairs to the (name, format)
+    pairs that the record maps take, e.g. [("count", "i8"), ("sum", "f8")]."""
+    names = getattr(value_type, "names", None)
+    if names is not None:
+        return [(name, value_type.fields[name][0].str) for name in names]
+    return [(name, _format(fmt)) for name, fmt in value_type]
+
+
+def _vector_spec(value_type):
+    """Returns the (format, dim) of a vector value type, given as a tuple like (np.float32, 64) or a
+    numpy subarray dtype, or None for other value types."""
+    subdtype = getattr(value_type, "subdtype", None)
+    if subdtype is not None and len(subdtype[1]) == 1:
+        return subdtype[0].str, subdtype[1][0]
+    if isinstance(value_type, tuple) and len(value_type) == 2 and isinstance(value_type[1], int):
+        return _format(value_type[0]), value_type[1]
+    return None
+
+
+def _postings_format(value_type):
+    """Returns the id format of a posting list value type, given as `list` (for int64 ids) or a
+    one-item list of the id type like [np.int32], or None for other value types."""
+    if value_type is list:
+        return "i8"
+    if isinstance(value_type, list) and len(value_type) == 1 and not isinstance(value_type[0], tuple):
+        return _format(value_type[0])
+    return None
 
 
 def create(key_type, value_type):
-    if key_type == string_ or key_type is str:
-        if value_type == int32_:
-            return str_int32.create()
-        if value_type == int64_ or value_type is int:
-            return str_int64.create()
-        if value_type == float32_:
-            return str_float32.create()
-        if value_type == float64_ or value_type is float:
-            return str_float64.create()
-        if value_type == string_ or value_type is str:
-            return str_str.create()
-    if key_type == int64_ or key_type is int:
-        if value_type == int64_ or value_type is int:
-            return int64_int64.create()
-    raise NotImplementedError()
+    postings_format = _postings_format(value_type)
+    if postings_format is not None:
+        module = _postings_modules.get(_as_dtype(key_type))
+        if module is None:
+            raise NotImplementedError()
+        return module.create(postings_format)
+    vector_spec = _vector_spec(value_type)
+    if vector_spec is not None:
+        module = _vector_modules.get(_as_dtype(key_type))
+        if module is None:
+            raise NotImplementedError()
+        return module.create(*vector_spec)
+    if isinstance(value_type, (list, tuple)) or getattr(value_type, "names", None) is not None:
+        module = _record_modules.get(_as_dtype(key_type))
+        if module is None:
+            raise NotImplementedError()
+        return module.create(_record_fields(value_type))
+    module = _modules.get((_as_dtype(key_type), _as_dtype(value_type)))
+    if module is None:
+        raise NotImplementedError()
+    return module.create()
+
+
+def vocab(key_type=str):
+    """Creates a vocabulary, which assigns the ids 0, 1, 2, ... to keys in the order they are added."""
+    module = _vocab_modules.get(_as_dtype(key_type))
+    if module is None:
+        raise NotImplementedError()
+    return module.create()
+
+
+def _factorize(values, size_hint, codes):
+    if isinstance(values, tuple):
+        # Arrow-style (offsets, data) strings
+        codes, v = _vocab_modules[string_].factorize(values, size_hint, codes)
+        return codes, v.to_arrow()
+
+    import numpy
+
+    if not isinstance(values, numpy.ndarray):
+        if not isinstance(values, (list, tuple)):
+            values = list(values)
+        if values and isinstance(values[0], (str, bytes)):
+            key_type = string_ if isinstance(values[0], str) else bytes_
+            codes, v = _vocab_modules[key_type].factorize(values, size_hint, codes)
+            return codes, numpy.array(list(v.keys()), dtype=object)
+        values = numpy.asarray(values)
+    kind = values.dtype.kind
+    if kind == "u" and values.dtype.itemsize == 8:
+        # reinterpreted rather than converted, so that values past the int64 range don't wrap
+        codes, v = _vocab_modules[int64_].factorize(values.view(numpy.int64), size_hint, codes)
+        return codes, v.to_numpy().view(values.dtype)
+    if kind in "iub":
+        codes, v = _vocab_modules[int64_].factorize(values.astype(numpy.int64, copy=False), size_hint, codes)
+        return codes, v.to_numpy().astype(values.dtype, copy=False)
+    if kind == "f":
+        codes, v = _vocab_modules[int64_].factorize(values.astype(numpy.float64, copy=False), size_hint, codes)
+        return codes, v.to_numpy().view(numpy.float64).astype(values.dtype, copy=False)
+    if kind in "UOS":
+        key_type = bytes_ if kind == "S" else string_
+        codes, v = _vocab_modules[key_type].factorize(values.tolist(), size_hint, codes)
+        return codes, numpy.array(list(v.keys()), dtype=object)
+    raise TypeError(f"can't factorize an array of {values.dtype}")
+
+
+def factorize(values, size_hint=None):
+    """Encodes `values` as int32 codes, which index the distinct values in order of appearance.
+    Returns (codes, uniques).
+
+    The values can be an int or float array, a sequence of str or bytes, or an Arrow-style
+    (offsets, data) pair of arrays, in which case the uniques are returned in the same form. Numeric
+    uniques have the dtype of `values`.
+    Like pandas.factorize, NaN gets the code -1 and isn't one of the uniques. `size_hint` is the
+    expected number of distinct values, by default the number of values."""
+    return _factorize(values, -1 if size_hint is None else size_hint, True)
+
+
+def unique(values, size_hint=None):
+    """Returns the distinct values of `values` in order of appearance, like factorize(values)[1]."""
+    return _factorize(values, -1 if size_hint is None else size_hint, False)[1]
+
+
+def _split_ranges(buf, parts, delimiters):
+    """Splits buf into at most `parts` (start, end) ranges of about the same size. Each one but the
+    last ends just after one of the delimiter bytes, so that no token or line is cut in two."""
+    pattern = re.compile(b"[" + re.escape(delimiters) + b"]")
+    bounds = [0]
+    for i in range(1, parts):
+        match = pattern.search(buf, max(len(buf) * i // parts, bounds[-1]))
+        if match is None:
+            break
+        if bounds[-1] < match.end() < len(buf):
+            bounds.append(match.end())
+    bounds.append(len(buf))
+    return list(zip(bounds, bounds[1:]))
+
+
+def ingest_file(path, mode="tokens", threads=None, key_type=str, value_type=int, sep="\t",
+                delimiters=b" \t\n", lowercase=False):
+    """Loads a text file into a new map using several threads, and returns the map.
+
+    With mode "tokens", the values are the counts of the tokens between `delimiters`, as with
+    count_tokens(). With mode "tsv", each line is "key<sep>value", and a key's last line wins. The
+    file is memory-mapped and split into `threads` parts (by default one per CPU), which are loaded
+    into separate maps in parallel and then merged into the largest one, all without the GIL. The
+    key type must be str or bytes, and the value type numeric (integer, for "tokens")."""
+    import mmap
+    import os
+    from concurrent.futures import ThreadPoolExecutor
+
+    module = _modules.get((_as_dtype(key_type), _as_dtype(value_type)))
+    if module is None or not hasattr(module, "_ingest"):
+        raise NotImplementedError()
+    if mode == "tokens":
+        separators = bytes(delimiters)
+        split_at = separators
+    elif mode == "tsv":
+        separators = sep.encode() if isinstance(sep, str) else bytes(sep)
+        split_at = b"\n"
+    else:
+        raise ValueError(f"unknown mode '{mode}', expected 'tokens' or 'tsv'")
+    if threads is None:
+        threads = os.cpu_count() or 1
+    if threads < 1:
+        raise ValueError("threads must be at least 1")
+
+    with open(path, "rb") as fp:
+        if os.fstat(fp.fileno()).st_size == 0:
+            return module._ingest(b"", 0, 0, mode, separators, lowercase)
+        with mmap.mmap(fp.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+            ranges = _split_ranges(mm, threads, split_at) if split_at else [(0, len(mm))]
+
+            def load(r):
+                return module._ingest(mm, r[0], r[1], mode, separators, lowercase)
+
+            if len(ranges) == 1:
+                shards = [load(ranges[0])]
+            else:
+                with ThreadPoolExecutor(len(ranges)) as pool:
+                    shards = list(pool.map(load, ranges))
+
+    largest = max(range(len(shards)), key=lambda i: len(shards[i]))
+    result = shards[largest]
+    if mode == "tokens":
+        module._merge_shards(result, shards[:largest] + shards[largest + 1:], "sum")
+    else:
+        # later parts overwrite the largest, and earlier ones only fill in keys it doesn't have,
+        # latest first, so each key ends up with its last value in the file
+        module._merge_shards(result, shards[largest + 1:], "replace")
+        module._merge_shards(result, shards[largest - 1::-1] if largest else [], "keep")
+    return result
@@ -1,5 +1,6 @@
+import os
 from enum import Enum
-from typing import Literal, MutableMapping, Type, TypeVar, overload
+from typing import Any, Callable, List, Literal, Mapping, MutableMapping, Sequence, Tuple, Type, TypeVar, overload
 
 class dtype(Enum):
     int32 = ...
@@ -7,12 +8,26 @@ class dtype(Enum):
     float32 = ...
     float64 = ...
     string = ...
+    bytes = ...
+    bytes16 = ...
+    bytes20 = ...
+    bytes32 = ...
+    int64_pair = ...
+    compact_int64 = ...
+    object = ...
 
 int32_ = dtype.int32
 int64_ = dtype.int64
 float32_ = dtype.float32
 float64_ = dtype.float64
 string_ = dtype.string
+bytes_ = dtype.bytes
+bytes16_ = dtype.bytes16
+bytes20_ = dtype.bytes20
+bytes32_ = dtype.bytes32
+int64_pair_ = dtype.int64_pair
+compact_int64_ = dtype.compact_int64
+object_ = dtype.object
 
 _K = TypeVar("_K")
 _V = TypeVar("_V")
@@ -20,11 +35,187 @@ _V = TypeVar("_V")
 class _Map(MutableMapping[_K, _V]):
     def copy(self) -> "_Map[_K, _V]":
         ...
+    def __or__(self, other: "_Map[_K, _V]") -> "_Map[_K, _V]":
+        """values from other for keys in both"""
+        ...
+    def __ior__(self, other: "_Map[_K, _V]" | Mapping[_K, _V]) -> "_Map[_K, _V]":
+        ...
+    def __and__(self, other: "_Map[_K, _V]") -> "_Map[_K, _V]":
+        """the entries of self whose keys are in other"""
+        ...
+    def __sub__(self, other: "_Map[_K, _V]") -> "_Map[_K, _V]":
+        """the entries of self whose keys aren't in other"""
+        ...
+    def __xor__(self, other: "_Map[_K, _V]") -> "_Map[_K, _V]":
+        """the entries whose keys are in only one of the maps"""
+        ...
+    def keys_list(self) -> List[_K]:
+        ...
+    def items_list(self) -> List[Tuple[_K, _V]]:
+        ...
+    def retain(self, predicate: Callable[[_K, _V], Any]) -> int:
+        """deletes the entries for which predicate(key, value) is false, and returns how many"""
+        ...
+    def merge(self, other: "_Map[_K, _V]", op: Literal["sum", "min", "max", "replace", "keep"] = ...) -> None:
+        """"sum", "min" and "max" need numeric values"""
+        ...
+    def merge_many(
+        self, maps: Sequence["_Map[_K, _V]"], op: Literal["sum", "min", "max", "replace", "keep"] = ...
+    ) -> None:
+        ...
+    def get_many(self, keys: Any, default: Any = ...) -> Any:
+        ...
+    def set_many(self, keys: Any, values: Any) -> None:
+        ...
+    def delete_many(self, keys: Any) -> int:
+        """deletes each of keys that is present, and returns how many"""
+        ...
+    def accumulate(
+        self, keys: Any, values: Any = None, op: Literal["sum", "min", "max", "count"] = "sum"
+    ) -> None:
+        """numeric values only"""
+        ...
+    def most_common(self, k: int | None = None) -> List[Tuple[_K, _V]]:
+        """numeric values only"""
+        ...
+    def least_common(self, k: int | None = None) -> List[Tuple[_K, _V]]:
+        """numeric values only"""
+        ...
+    def sorted_items(
+        self,
+        by: Literal["key", "value"] = "key",
+        reverse: bool = False,
+        path: str | os.PathLike[str] | None = None,
+        sep: str = "\t",
+    ) -> Tuple[Any, Any] | None:
+        """columns of keys and values: numpy arrays for int keys and numeric values, lists otherwise.
+        path: write them to a file like dump_tsv instead (str, bytes and int keys with numeric values only)"""
+        ...
+    def values_sum(self) -> Any:
+        """numeric values only; int sums are exact"""
+        ...
+    def values_min(self) -> Any:
+        """numeric values only"""
+        ...
+    def values_max(self) -> Any:
+        """numeric values only"""
+        ...
+    def values_mean(self) -> float:
+        """numeric values only"""
+        ...
+    def values_histogram(
+        self, bins: int | Sequence[float] | Any = 10, range: Tuple[float, float] | None = None
+    ) -> Tuple[Any, Any]:
+        """numeric values only; (counts, edges) as numpy arrays, like numpy.histogram"""
+        ...
+    def transform_values(self, op: Literal["mul", "add", "clamp", "floor"], operand: Any = None) -> None:
+        """numeric values only; clamp takes a (low, high) operand, floor a positive step (1 by default)"""
+        ...
+    def decay_and_prune(self, factor: float, threshold: float) -> int:
+        """numeric values only"""
+        ...
+    def retain_where(self, op: Literal["<", "<=", ">", ">=", "==", "!="], threshold: Any) -> int:
+        """numeric values only; keeps the entries where `value op threshold` holds"""
+        ...
+    def count_tokens(self, text: str | bytes | Any, delimiters: bytes = b" \t\n", lowercase: bool = False) -> int:
+        """str and bytes keys with integer values only"""
+        ...
+    def load_tsv(self, path: str | os.PathLike[str], sep: str = "\t") -> None:
+        """str, bytes and int keys with numeric values only"""
+        ...
+    def dump_tsv(self, path: str | os.PathLike[str], sep: str = "\t") -> None:
+        """str, bytes and int keys with numeric values only"""
+        ...
+
+class _RecordMap(MutableMapping[_K, Tuple[Any, ...]]):
+    @property
+    def fields(self) -> List[Tuple[str, str]]:
+        ...
+    def copy(self) -> "_RecordMap[_K]":
+        ...
+    def keys_list(self) -> List[_K]:
+        ...
+    def items_list(self) -> List[Tuple[_K, Tuple[Any, ...]]]:
+        ...
+    def get_field(self, key: _K, field: str | int, default: Any = ...) -> Any:
+        ...
+    def set_field(self, key: _K, field: str | int, value: int | float) -> None:
+        ...
+    def add(self, key: _K, field: str | int, delta: int | float = 1) -> int | float:
+        ...
+    def to_numpy(self, field: str | int = ...) -> Any:
+        ...
+
+class _VectorMap(MutableMapping[_K, Any]):
+    @property
+    def dtype(self) -> str:
+        ...
+    @property
+    def dim(self) -> int:
+        ...
+    def copy(self) -> "_VectorMap[_K]":
+        ...
+    def keys_list(self) -> List[_K]:
+        ...
+    def items_list(self) -> List[Tuple[_K, Any]]:
+        ...
+    def gather(self, keys: Any, default: Any = ...) -> Any:
+        ...
+    def scatter(self, keys: Any, matrix: Any) -> None:
+        ...
+    def to_numpy(self) -> Any:
+        ...
+
+class _PostingsMap(MutableMapping[_K, Any]):
+    @property
+    def dtype(self) -> str:
+        ...
+    @property
+    def frozen(self) -> bool:
+        ...
+    def copy(self) -> "_PostingsMap[_K]":
+        ...
+    def keys_list(self) -> List[_K]:
+        ...
+    def items_list(self) -> List[Tuple[_K, Any]]:
+        ...
+    def append(self, key: _K, id: int) -> None:
+        ...
+    def extend_many(self, keys: Any, ids: Any) -> None:
+        ...
+    def view(self, key: _K) -> Any:
+        ...
+    def freeze(self) -> None:
+        ...
+
+class _Vocab(Mapping[_K, int]):
+    def copy(self) -> "_Vocab[_K]":
+        ...
+    def keys_list(self) -> List[_K]:
+        ...
+    def items_list(self) -> List[Tuple[_K, int]]:
+        ...
+    def add(self, key: _K) -> int:
+        ...
+    def lookup(self, id: int) -> _K:
+        ...
+    def encode(self, keys: Any, add: bool = True) -> Any:
+        ...
+    def decode(self, ids: Any) -> List[_K]:
+        ...
+    def clear(self) -> None:
+        ...
+    def to_arrow(self) -> Tuple[Any, Any]:
+        """str and bytes vocabularies only"""
+        ...
+    def to_numpy(self) -> Any:
+        """int64 vocabularies only"""
+        ...
 
 @overload
 def create(
     key_type: Literal[dtype.int32, dtype.int64] | Type[int],
-    value_type: Literal[dtype.int32, dtype.int64] | Type[int],
+    value_type: Literal[dtype.int32, dtype.int64, dtype.compact_int64] | Type[int],
 ) -> _Map[int, int]: ...
 @overload
 def create(
@@ -37,9 +228,14 @@ def create(
     value_type: Literal[dtype.string] | Type[str],
 ) -> _Map[int, str]: ...
 @overload
+def create(
+    key_type: Literal[dtype.int32, dtype.int64] | Type[int],
+    value_type: Literal[dtype.bytes] | Type[bytes],
+) -> _Map[int, bytes]: ...
+@overload
 def create(
     key_type: Literal[dtype.float32, dtype.float64] | Type[float],
-    value_type: Literal[dtype.int32, dtype.int64] | Type[int],
+    value_type: Literal[dtype.int32, dtype.int64, dtype.compact_int64] | Type[int],
 ) -> _Map[float, int]: ...
 @overload
 def create(
@@ -52,9 +248,14 @@ def create(
     value_type: Literal[dtype.string] | Type[str],
 ) -> _Map[float, str]: ...
 @overload
+def create(
+    key_type: Literal[dtype.float32, dtype.float64] | Type[float],
+    value_type: Literal[dtype.bytes] | Type[bytes],
+) -> _Map[float, bytes]: ...
+@overload
 def create(
     key_type: Literal[dtype.string] | Type[str],
-    value_type: Literal[dtype.int32, dtype.int64] | Type[int],
+    value_type: Literal[dtype.int32, dtype.int64, dtype.compact_int64] | Type[int],
 ) -> _Map[str, int]: ...
 @overload
 def create(
@@ -66,3 +267,106 @@ def create(
     key_type: Literal[dtype.string] | Type[str],
     value_type: Literal[dtype.string] | Type[str],
 ) -> _Map[str, str]: ...
+@overload
+def create(
+    key_type: Literal[dtype.string] | Type[str],
+    value_type: Literal[dtype.bytes] | Type[bytes],
+) -> _Map[str, bytes]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes] | Type[bytes],
+    value_type: Literal[dtype.int32, dtype.int64, dtype.compact_int64] | Type[int],
+) -> _Map[bytes, int]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes] | Type[bytes],
+    value_type: Literal[dtype.float32, dtype.float64] | Type[float],
+) -> _Map[bytes, float]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes] | Type[bytes],
+    value_type: Literal[dtype.string] | Type[str],
+) -> _Map[bytes, str]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes] | Type[bytes],
+    value_type: Literal[dtype.bytes] | Type[bytes],
+) -> _Map[bytes, bytes]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes16, dtype.bytes20, dtype.bytes32],
+    value_type: Literal[dtype.int32, dtype.int64, dtype.compact_int64] | Type[int],
+) -> _Map[bytes, int]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes16, dtype.bytes20, dtype.bytes32],
+    value_type: Literal[dtype.float32, dtype.float64] | Type[float],
+) -> _Map[bytes, float]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes16, dtype.bytes20, dtype.bytes32],
+    value_type: Literal[dtype.string] | Type[str],
+) -> _Map[bytes, str]: ...
+@overload
+def create(
+    key_type: Literal[dtype.bytes16, dtype.bytes20, dtype.bytes32],
+    value_type: Literal[dtype.bytes] | Type[bytes],
+) -> _Map[bytes, bytes]: ...
+@overload
+def create(
+    key_type: Literal[dtype.int64_pair] | Tuple[Type[int], Type[int]],
+    value_type: Literal[dtype.int32, dtype.int64, dtype.compact_int64] | Type[int],
+) -> _Map[Tuple[int, int], int]: ...
+@overload
+def create(
+    key_type: Literal[dtype.int64_pair] | Tuple[Type[int], Type[int]],
+    value_type: Literal[dtype.float32, dtype.float64] | Type[float],
+) -> _Map[Tuple[int, int], float]: ...
+@overload
+def create(
+    key_type: Literal[dtype.int64_pair] | Tuple[Type[int], Type[int]],
+    value_type: Literal[dtype.string] | Type[str],
+) -> _Map[Tuple[int, int], str]: ...
+@overload
+def create(
+    key_type: Literal[dtype.int64_pair] | Tuple[Type[int], Type[int]],
+    value_type: Literal[dtype.bytes] | Type[bytes],
+) -> _Map[Tuple[int, int], bytes]: ...
+@overload
+def create(
+    key_type: Any,
+    value_type: Literal[dtype.object] | Type[object],
+) -> _Map[Any, Any]: ...
+@overload
+def create(
+    key_type: Any,
+    value_type: Sequence[Tuple[str, Any]],
+) -> _RecordMap[Any]: ...
+@overload
+def create(
+    key_type: Any,
+    value_type: Tuple[Any, int],
+) -> _VectorMap[Any]: ...
+@overload
+def create(
+    key_type: Any,
+    value_type: Type[List[Any]] | List[Any],
+) -> _PostingsMap[Any]: ...
+@overload
+def vocab(key_type: Literal[dtype.string] | Type[str] = ...) -> _Vocab[str]: ...
+@overload
+def vocab(key_type: Literal[dtype.bytes] | Type[bytes]) -> _Vocab[bytes]: ...
+@overload
+def vocab(key_type: Literal[dtype.int64] | Type[int]) -> _Vocab[int]: ...
+def factorize(values: Any, size_hint: int | None = None) -> Tuple[Any, Any]: ...
+def unique(values: Any, size_hint: int | None = None) -> Any: ...
+def ingest_file(
+    path: str | os.PathLike[str],
+    mode: Literal["tokens", "tsv"] = ...,
+    threads: int | None = None,
+    key_type: Any = ...,
+    value_type: Any = ...,
+    sep: str | bytes = "\t",
+    delimiters: bytes = b" \t\n",
+    lowercase: bool = False,
+) -> _Map[Any, Any]: ...
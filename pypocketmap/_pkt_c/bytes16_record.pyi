@@ -0,0 +1,6 @@
+from typing import Sequence, Tuple
+
+from .. import _RecordMap
+
+def create(fields: Sequence[Tuple[str, str]], num_buckets: int = 32) -> _RecordMap[bytes]:
+    ...
@@ -0,0 +1,4 @@
+from .. import _Map
+
+def create(num_buckets: int = 32) -> _Map[bytes, bytes]:
+    ...
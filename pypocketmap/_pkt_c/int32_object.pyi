@@ -0,0 +1,6 @@
+from typing import Any
+
+from .. import _Map
+
+def create(num_buckets: int = 32) -> _Map[int, Any]:
+    ...
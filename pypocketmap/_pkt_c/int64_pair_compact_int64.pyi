@@ -0,0 +1,6 @@
+from typing import Tuple
+
+from .. import _Map
+
+def create(num_buckets: int = 32) -> _Map[Tuple[int, int], int]:
+    ...
@@ -0,0 +1,6 @@
+from typing import Any, Tuple
+
+from .. import _Map
+
+def create(num_buckets: int = 32) -> _Map[Tuple[int, int], Any]:
+    ...
@@ -0,0 +1,6 @@
+from typing import Tuple
+
+from .. import _PostingsMap
+
+def create(format: str = "i8", num_buckets: int = 32) -> _PostingsMap[Tuple[int, int]]:
+    ...
@@ -0,0 +1,6 @@
+from typing import Tuple
+
+from .. import _VectorMap
+
+def create(format: str, dim: int, num_buckets: int = 32) -> _VectorMap[Tuple[int, int]]:
+    ...
@@ -0,0 +1,8 @@
+from typing import Any, Optional, Tuple
+
+from .. import _Vocab
+
+def create(num_buckets: int = 32) -> _Vocab[int]:
+    ...
+def factorize(keys: Any, size_hint: int = -1, codes: bool = True) -> Tuple[Optional[Any], _Vocab[int]]:
+    ...
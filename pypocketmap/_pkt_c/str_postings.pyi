@@ -0,0 +1,4 @@
+from .. import _PostingsMap
+
+def create(format: str = "i8", num_buckets: int = 32) -> _PostingsMap[str]:
+    ...
@@ -0,0 +1,4 @@
+from .. import _VectorMap
+
+def create(format: str, dim: int, num_buckets: int = 32) -> _VectorMap[str]:
+    ...
@@ -23,7 +23,16 @@ typedef bool hasher_t;
 #define KEY_GET(arr, idx) packed_get_i32(arr, idx)
 #define KEY_SET(arr, idx, elem) packed_set_i32(arr, idx, elem)
 #define KEY_UNSET(arr, idx) packed_unset_i32(arr, idx)
-static inline uint32_t _hash_func(hasher_t* _, k_t key) { return (uint32_t) key; }
+#define KEY_BUF_KIND 'i'
+#define KEY_DTYPE "int32"
+static inline uint32_t _hash_func(hasher_t* _, k_t key) {
+    // same mixing as the int64 case, see below. The identity function puts dense keys
+    // in the same few groups with nearly identical h2 values
+    uint32_t state = (uint32_t) key;
+    state *= 0x9e3779b9UL;
+    state = (state << 5) ^ ((uint32_t) (key >> 31));
+    return state * 0x9e3779b9UL;
+}
 static inline void _hasher_init() {}
 
 #elif KEY_TYPE_TAG == TYPE_TAG_I64
@@ -34,6 +43,8 @@ typedef bool hasher_t;
 #define KEY_GET(arr, idx) packed_get_i64(arr, idx)
 #define KEY_SET(arr, idx, elem) packed_set_i64(arr, idx, elem)
 #define KEY_UNSET(arr, idx) packed_unset_i64(arr, idx)
+#define KEY_BUF_KIND 'i'
+#define KEY_DTYPE "int64"
 static inline uint32_t _hash_func(hasher_t* _, k_t key) {
     // originally this was just (high bits xor low bits); however we need
     // `entry.h2 == query_h2` to correlate very strongly with `entry == query`,
@@ -58,6 +69,7 @@ typedef bool hasher_t;
 #define KEY_GET(arr, idx) packed_get_f32(arr, idx)
 #define KEY_SET(arr, idx, elem) packed_set_f32(arr, idx, elem)
 #define KEY_UNSET(arr, idx) packed_unset_f32(arr, idx)
+#define KEY_BUF_KIND 'f'
 static inline uint32_t _hash_func(hasher_t* _, k_t key) {
     uint32_t ikey = *((uint32_t*) &key);
     return ikey ^ (ikey >> 16);
@@ -72,6 +84,7 @@ typedef bool hasher_t;
 #define KEY_GET(arr, idx) packed_get_f64(arr, idx)
 #define KEY_SET(arr, idx, elem) packed_set_f64(arr, idx, elem)
 #define KEY_UNSET(arr, idx) packed_unset_f64(arr, idx)
+#define KEY_BUF_KIND 'f'
 static inline uint32_t _hash_func(hasher_t* _, k_t key) {
     uint64_t ikey64 = *((uint64_t*) &key);
     uint32_t ikey = ((uint32_t) ikey) ^ ((uint32_t) (ikey >> 32))
@@ -79,7 +92,7 @@ static inline uint32_t _hash_func(hasher_t* _, k_t key) {
 }
 static inline void _hasher_init() {}
 
-#elif KEY_TYPE_TAG == TYPE_TAG_STR
+#elif KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES
 #include "./polymur-hash.h"
 
 typedef str_t k_t;
@@ -87,7 +100,11 @@ typedef packed_str_t pk_t;
 typedef PolymurHashParams hasher_t;
 #define KEY_EQ(a, b) ((a.len == b.len) && memcmp(a.ptr, b.ptr, a.len) == 0)
 #define KEY_GET(arr, idx) packed_get_str(arr, idx)
+#if KEY_TYPE_TAG == TYPE_TAG_BYTES
+#define KEY_SET(arr, idx, elem) packed_set_bytes(arr, idx, elem)
+#else
 #define KEY_SET(arr, idx, elem) packed_set_str(arr, idx, elem)
+#endif
 #define KEY_UNSET(arr, idx) packed_unset_str(arr, idx)
 #define KEYS_POINT 1
 
@@ -97,6 +114,78 @@ static inline uint32_t _hash_func(hasher_t* hasher, k_t key) {
 static inline void _hasher_init(hasher_t* hasher) {
     polymur_init_params_from_seed(hasher, 0xfedbca9876543210ULL);
 }
+
+#elif KEY_TYPE_TAG == TYPE_TAG_FIXED
+#if !defined(KEY_FIXED_WIDTH) || KEY_FIXED_WIDTH < 8 || KEY_FIXED_WIDTH > 32
+#error "TYPE_TAG_FIXED requires 8 <= KEY_FIXED_WIDTH <= 32"
+#endif
+
+typedef const char* k_t;
+typedef packed_fixed_t pk_t;
+typedef bool hasher_t;
+#define KEY_EQ(a, b) _fixed_eq(a, b)
+#define KEY_GET(arr, idx) packed_get_fixed(arr, idx)
+#define KEY_SET(arr, idx, elem) packed_set_fixed(arr, idx, elem)
+#define KEY_UNSET(arr, idx) packed_unset_fixed(arr, idx)
+
+static inline bool _fixed_eq(const char* a, const char* b) {
+#if KEY_FIXED_WIDTH == 32 && defined(ABSL_INTERNAL_HAVE_AVX2)
+    __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) a), _mm256_loadu_si256((const __m256i*) b));
+    return (uint32_t) _mm256_movemask_epi8(eq) == 0xffffffffU;
+#elif KEY_FIXED_WIDTH >= 16 && defined(ABSL_INTERNAL_HAVE_SSE2)
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) a), _mm_loadu_si128((const __m128i*) b));
+#if KEY_FIXED_WIDTH > 16
+    // the last 16 bytes overlap the first 16 unless the width is 32
+    const int tail = KEY_FIXED_WIDTH - 16;
+    eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + tail)), _mm_loadu_si128((const __m128i*) (b + tail))));
+#endif
+    return _mm_movemask_epi8(eq) == 0xffff;
+#else
+    return memcmp(a, b, KEY_FIXED_WIDTH) == 0;
+#endif
+}
+
+static inline uint32_t _hash_func(hasher_t* _, k_t key) {
+    // the keys are expected to be digests, so instead of hashing all of the bytes,
+    // fold the first and last 8 with the same multiply-rotate as fxhash
+    uint64_t lo, hi;
+    memcpy(&lo, key, 8);
+    memcpy(&hi, key + KEY_FIXED_WIDTH - 8, 8);
+    uint64_t state = lo * 0x517cc1b727220a95ULL;
+    state = ((state << 5) | (state >> 59)) ^ hi;
+    state *= 0x517cc1b727220a95ULL;
+    return (uint32_t) (state >> 32);
+}
+static inline void _hasher_init() {}
+#elif KEY_TYPE_TAG == TYPE_TAG_PAIR
+typedef pair_t k_t;
+typedef pair_t pk_t;
+typedef bool hasher_t;
+#define KEY_EQ(x, y) ((x).a == (y).a && (x).b == (y).b)
+#define KEY_GET(arr, idx) packed_get_pair(arr, idx)
+#define KEY_SET(arr, idx, elem) packed_set_pair(arr, idx, elem)
+#define KEY_UNSET(arr, idx) packed_unset_pair(arr, idx)
+#define KEY_BUF_KIND 'i'
+#define KEY_DTYPE "int64"
+#define KEY_BUF_COLS 2
+static inline uint32_t _hash_func(hasher_t* _, k_t key) {
+    // fxhash over both words, at 64 bits so that every bit of `a` reaches the
+    // upper half. Edge lists are usually dense in both coordinates, and the
+    // int64 hash applied to (a ^ b) would collide on every (a, b), (b, a)
+    uint64_t state = (uint64_t) key.a * 0x517cc1b727220a95ULL;
+    state = ((state << 5) | (state >> 59)) ^ (uint64_t) key.b;
+    state *= 0x517cc1b727220a95ULL;
+    return (uint32_t) (state >> 32);
+}
+static inline void _hasher_init() {}
+#endif
+
+// KEY_BUF_KIND and VAL_BUF_KIND are defined for types that can be read straight out of
+// a buffer (e.g. a numpy array) of signed integers ('i') or floats ('f') of the same size, and
+// KEY_DTYPE and VAL_DTYPE name that numpy dtype.
+// A key spans KEY_BUF_COLS consecutive items
+#ifndef KEY_BUF_COLS
+#define KEY_BUF_COLS 1
 #endif
 
 #if VAL_TYPE_TAG == TYPE_TAG_I32
@@ -106,6 +195,8 @@ typedef int32_t pv_t;
 #define VAL_GET(arr, idx) packed_get_i32(arr, idx)
 #define VAL_SET(arr, idx, elem) packed_set_i32(arr, idx, elem)
 #define VAL_UNSET(arr, idx) packed_unset_i32(arr, idx)
+#define VAL_BUF_KIND 'i'
+#define VAL_DTYPE "int32"
 
 #elif VAL_TYPE_TAG == TYPE_TAG_I64
 typedef int64_t v_t;
@@ -114,6 +205,8 @@ typedef int64_t pv_t;
 #define VAL_GET(arr, idx) packed_get_i64(arr, idx)
 #define VAL_SET(arr, idx, elem) packed_set_i64(arr, idx, elem)
 #define VAL_UNSET(arr, idx) packed_unset_i64(arr, idx)
+#define VAL_BUF_KIND 'i'
+#define VAL_DTYPE "int64"
 
 #elif VAL_TYPE_TAG == TYPE_TAG_F32
 typedef float v_t;
@@ -122,6 +215,8 @@ typedef float pv_t;
 #define VAL_GET(arr, idx) packed_get_f32(arr, idx)
 #define VAL_SET(arr, idx, elem) packed_set_f32(arr, idx, elem)
 #define VAL_UNSET(arr, idx) packed_unset_f32(arr, idx)
+#define VAL_BUF_KIND 'f'
+#define VAL_DTYPE "float32"
 
 #elif VAL_TYPE_TAG == TYPE_TAG_F64
 typedef double v_t;
@@ -130,20 +225,80 @@ typedef double pv_t;
 #define VAL_GET(arr, idx) packed_get_f64(arr, idx)
 #define VAL_SET(arr, idx, elem) packed_set_f64(arr, idx, elem)
 #define VAL_UNSET(arr, idx) packed_unset_f64(arr, idx)
+#define VAL_BUF_KIND 'f'
+#define VAL_DTYPE "float64"
 
-#elif VAL_TYPE_TAG == TYPE_TAG_STR
+#elif VAL_TYPE_TAG == TYPE_TAG_STR || VAL_TYPE_TAG == TYPE_TAG_BYTES
 typedef str_t v_t;
 typedef packed_str_t pv_t;
 #define VAL_EQ(a, b) ((a.len == b.len) && memcmp(a.ptr, b.ptr, a.len) == 0)
 #define VAL_GET(arr, idx) packed_get_str(arr, idx)
+#if VAL_TYPE_TAG == TYPE_TAG_BYTES
+#define VAL_SET(arr, idx, elem) packed_set_bytes(arr, idx, elem)
+#else
 #define VAL_SET(arr, idx, elem) packed_set_str(arr, idx, elem)
+#endif
+#define VAL_UNSET(arr, idx) packed_unset_str(arr, idx)
+#define VALS_POINT 1
+
+#elif VAL_TYPE_TAG == TYPE_TAG_POSTINGS
+// Growable arrays of int32 or int64 ids (see packed_list_append). Like bytes, values are the raw
+// bytes of the array
+typedef str_t v_t;
+typedef packed_str_t pv_t;
+#define VAL_EQ(a, b) ((a.len == b.len) && memcmp(a.ptr, b.ptr, a.len) == 0)
+#define VAL_GET(arr, idx) packed_get_str(arr, idx)
+#define VAL_SET(arr, idx, elem) packed_set_list(arr, idx, elem)
 #define VAL_UNSET(arr, idx) packed_unset_str(arr, idx)
 #define VALS_POINT 1
 
+#elif VAL_TYPE_TAG == TYPE_TAG_RECORD || VAL_TYPE_TAG == TYPE_TAG_VECTOR
+// A record of scalar fields (see record.h) or a fixed-length array of one scalar type,
+// whose width is only known at runtime, so
+// the vals array is indexed in bytes. Values are pointers to `h->val_width` bytes,
+// and the map accessors below are used instead of VAL_GET/VAL_SET/VAL_UNSET
+typedef char* v_t;
+typedef char pv_t;
+#define VALS_DYNAMIC_WIDTH 1
+
+#elif VAL_TYPE_TAG == TYPE_TAG_COMPACT_I64
+// int64 values stored at the smallest width (1, 2, 4 or 8 bytes) that has fit every value
+// so far. The vals array starts at 1 byte per value, and _vals_widen expands it in place the
+// first time a value doesn't fit. pv_t is only used to box a single value (see mdict_set)
+typedef int64_t v_t;
+typedef int64_t pv_t;
+#define VAL_EQ(a, b) ((a) == (b))
+#define VAL_GET(arr, idx) packed_get_i64(arr, idx)
+#define VAL_UNSET(arr, idx) packed_unset_i64(arr, idx)
+#define VAL_BUF_KIND 'i'
+#define VAL_DTYPE "int64"
+#define VALS_DYNAMIC_WIDTH 1
+#define VALS_COMPACT 1
+
+#elif VAL_TYPE_TAG == TYPE_TAG_OBJECT
+// Python objects. The vals array owns a reference to each one, which VAL_UNSET drops
+// (and which can run arbitrary code, so it is done last when removing an item)
+typedef PyObject* v_t;
+typedef PyObject* pv_t;
+static inline bool _obj_eq(PyObject* a, PyObject* b) {
+    Py_INCREF(a);
+    Py_INCREF(b);
+    int cmp = PyObject_RichCompareBool(a, b, Py_EQ);
+    Py_DECREF(a);
+    Py_DECREF(b);
+    return cmp == 1;
+}
+#define VAL_EQ(a, b) _obj_eq(a, b)
+#define VAL_GET(arr, idx) ((arr)[idx])
+#define VAL_SET(arr, idx, elem) (Py_INCREF(elem), (arr)[idx] = (elem), true)
+#define VAL_UNSET(arr, idx) Py_CLEAR((arr)[idx])
+#define VALS_POINT 1
+#define VALS_OBJECT 1
+
 #endif
 
-const double PEAK_LOAD = 0.79;
-const char* const EMPTY_STR = "";
+static const double PEAK_LOAD = 0.79;
+static const char* const EMPTY_STR = "";
 
 typedef struct {
     uint64_t *flags;  // each 8 bits refers to a bucket; see simd constants
@@ -157,8 +312,140 @@ typedef struct {
     int error_code;
     hasher_t hasher;
     bool is_map;
+    uint32_t val_width;  // sizeof(pv_t), unless VALS_DYNAMIC_WIDTH
 } h_t;
 
+#ifdef VALS_DYNAMIC_WIDTH
+#define VAL_WIDTH(h) ((size_t) (h)->val_width)
+#else
+#define VAL_WIDTH(h) sizeof(pv_t)
+#endif
+
+static inline pv_t* _val_slot(h_t* h, uint32_t idx) {
+    return (pv_t*) ((char*) h->vals + (size_t) idx * VAL_WIDTH(h));
+}
+
+#ifdef VALS_COMPACT
+static inline int64_t _compact_read(const char* src, uint32_t width) {
+    switch (width) {
+        case 1: {
+            int8_t v;
+            memcpy(&v, src, 1);
+            return v;
+        }
+        case 2: {
+            int16_t v;
+            memcpy(&v, src, 2);
+            return v;
+        }
+        case 4: {
+            int32_t v;
+            memcpy(&v, src, 4);
+            return v;
+        }
+        default: {
+            int64_t v;
+            memcpy(&v, src, 8);
+            return v;
+        }
+    }
+}
+
+static inline void _compact_write(char* dst, uint32_t width, int64_t val) {
+    switch (width) {
+        case 1: {
+            int8_t v = (int8_t) val;
+            memcpy(dst, &v, 1);
+            break;
+        }
+        case 2: {
+            int16_t v = (int16_t) val;
+            memcpy(dst, &v, 2);
+            break;
+        }
+        case 4: {
+            int32_t v = (int32_t) val;
+            memcpy(dst, &v, 4);
+            break;
+        }
+        default:
+            memcpy(dst, &val, 8);
+    }
+}
+
+static inline uint32_t _compact_width(int64_t val) {
+    if (val == (int8_t) val) {
+        return 1;
+    }
+    if (val == (int16_t) val) {
+        return 2;
+    }
+    return (val == (int32_t) val) ? 4 : 8;
+}
+
+static inline bool _bucket_is_live(const uint64_t *flags, uint32_t i);
+
+// Grows every value to `width` bytes. Like _mdict_resize, this reallocs the vals array, then
+// it moves the values from the last bucket down so that none is overwritten before it is read
+static bool _vals_widen(h_t* h, uint32_t width) {
+    pv_t* new_vals = (pv_t*) realloc((void*) h->vals, (size_t) h->num_buckets * width);
+    if (new_vals == NULL) {
+        return false;
+    }
+    char* vals = (char*) new_vals;
+    uint32_t old_width = h->val_width;
+    for (uint32_t i = h->num_buckets; i-- > 0; ) {
+        if (_bucket_is_live(h->flags, i)) {
+            _compact_write(vals + (size_t) i * width, width, _compact_read(vals + (size_t) i * old_width, old_width));
+        }
+    }
+    h->vals = new_vals;
+    h->val_width = width;
+    return true;
+}
+#endif
+
+static inline v_t _val_get(h_t* h, uint32_t idx) {
+#if defined(VALS_COMPACT)
+    return _compact_read((const char*) h->vals + (size_t) idx * h->val_width, h->val_width);
+#elif defined(VALS_DYNAMIC_WIDTH)
+    return _val_slot(h, idx);
+#else
+    return VAL_GET(h->vals, idx);
+#endif
+}
+
+static inline bool _val_set(h_t* h, uint32_t idx, v_t val) {
+#if defined(VALS_COMPACT)
+    uint32_t width = _compact_width(val);
+    if (width > h->val_width && !_vals_widen(h, width)) {
+        return false;
+    }
+    _compact_write((char*) h->vals + (size_t) idx * h->val_width, h->val_width, val);
+    return true;
+#elif defined(VALS_DYNAMIC_WIDTH)
+    memcpy(_val_slot(h, idx), val, VAL_WIDTH(h));
+    return true;
+#else
+    return VAL_SET(h->vals, idx, val);
+#endif
+}
+
+// Copies the value in bucket `idx` to `box`, e.g. the previous value for mdict_set
+static inline void _val_box(h_t* h, uint32_t idx, pv_t* box) {
+#ifdef VALS_COMPACT
+    *box = _val_get(h, idx);
+#else
+    memcpy(box, _val_slot(h, idx), VAL_WIDTH(h));
+#endif
+}
+
+static inline void _val_unset(h_t* h, uint32_t idx) {
+#ifndef VALS_DYNAMIC_WIDTH
+    VAL_UNSET(h->vals, idx);
+#endif
+}
+
 static inline bool _bucket_is_live(const uint64_t *flags, uint32_t i) {
     return !((flags[i>>3] >> (8*(i&7))) & 128);
 }
@@ -183,13 +470,17 @@ static inline uint32_t _match_index(uint32_t flags_index, uint32_t offset) {
 
 static int _mdict_resize(h_t* h, uint32_t new_num_buckets);
 
-static h_t* mdict_create(uint32_t num_buckets, bool is_map) {
+static h_t* _mdict_create(uint32_t num_buckets, bool is_map, uint32_t val_width) {
     h_t* h = (h_t*)calloc(1, sizeof(h_t));
+    if (h == NULL) {
+        return NULL;
+    }
 
     h->size = 0;
     h->num_deleted = 0;
     h->error_code = 0;
     h->is_map = is_map;
+    h->val_width = val_width;
     _hasher_init(&h->hasher);
     h->flags = NULL;
     h->keys = NULL;
@@ -211,13 +502,27 @@ static h_t* mdict_create(uint32_t num_buckets, bool is_map) {
     return h;
 }
 
+#if defined(VALS_DYNAMIC_WIDTH) && !defined(VALS_COMPACT)
+static h_t* mdict_create(uint32_t num_buckets, uint32_t val_width) {
+    return _mdict_create(num_buckets, true, val_width);
+}
+#elif defined(VALS_COMPACT)
+static h_t* mdict_create(uint32_t num_buckets, bool is_map) {
+    return _mdict_create(num_buckets, is_map, 1);
+}
+#else
+static h_t* mdict_create(uint32_t num_buckets, bool is_map) {
+    return _mdict_create(num_buckets, is_map, sizeof(pv_t));
+}
+#endif
+
 static void mdict_destroy(h_t* h) {
     if (h) {
 #if defined(KEYS_POINT) || defined(VALS_POINT)
         for (uint32_t j = 0; j < h->num_buckets; ++j) {
             if (_bucket_is_live(h->flags, j)) {
                 KEY_UNSET(h->keys, j);
-                VAL_UNSET(h->vals, j);
+                _val_unset(h, j);
             }
         }
 #endif
@@ -228,6 +533,122 @@ static void mdict_destroy(h_t* h) {
     }
 }
 
+#if defined(KEYS_POINT) || defined(VALS_POINT)
+// Gives bucket `idx` of a table made by mdict_copy its own copy of anything the source's bucket
+// points to. Returns false if an allocation failed, in which case the bucket owns nothing
+static inline bool _mdict_copy_owned(h_t* h, h_t* src, uint32_t idx) {
+#ifdef KEYS_POINT
+    if (packed_is_spilled(h->keys, idx) && !KEY_SET(h->keys, idx, KEY_GET(src->keys, idx))) {
+        return false;
+    }
+#endif
+#if defined(VALS_OBJECT)
+    Py_INCREF(h->vals[idx]);
+#elif defined(VALS_POINT)
+    if (h->is_map && packed_is_spilled(h->vals, idx) && !VAL_SET(h->vals, idx, VAL_GET(src->vals, idx))) {
+#ifdef KEYS_POINT
+        KEY_UNSET(h->keys, idx);
+#endif
+        return false;
+    }
+#endif
+    return true;
+}
+#endif
+
+// how many buckets ahead mdict_copy prefetches the spilled keys
+#define MDICT_COPY_PREFETCH 16
+
+// Returns a table with the same buckets and entries as `src`, made by copying its flags, keys and
+// values arrays whole, so nothing is hashed or probed. Only spilled strings and lists are
+// allocated again, and object values get a new reference. Deleted buckets are copied as they are,
+// since emptying them could cut the probe sequence of a key inserted after them. Returns NULL if
+// an allocation failed.
+static h_t* mdict_copy(h_t* src) {
+    h_t* h = (h_t*) malloc(sizeof(h_t));
+    if (h == NULL) {
+        return NULL;
+    }
+    memcpy(h, src, sizeof(h_t));
+    size_t flags_bytes = _flags_size(src->num_buckets) * sizeof(uint64_t);
+    size_t keys_bytes = (size_t) src->num_buckets * sizeof(pk_t);
+    size_t vals_bytes = src->is_map ? (size_t) src->num_buckets * VAL_WIDTH(src) : 0;
+    h->flags = (uint64_t*) malloc(flags_bytes);
+    h->keys = (pk_t*) malloc(keys_bytes);
+    h->vals = src->vals == NULL ? NULL : (pv_t*) malloc(vals_bytes);
+    if (h->flags == NULL || h->keys == NULL || (src->vals != NULL && h->vals == NULL)) {
+        free(h->flags);
+        free((void*) h->keys);
+        free((void*) h->vals);
+        free(h);
+        return NULL;
+    }
+    memcpy(h->flags, src->flags, flags_bytes);
+    memcpy((void*) h->keys, src->keys, keys_bytes);
+    if (src->vals != NULL) {
+        memcpy((void*) h->vals, src->vals, vals_bytes);
+    }
+#if defined(KEYS_POINT) || defined(VALS_POINT)
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+#if defined(KEYS_POINT) && (defined(__GNUC__) || defined(__clang__))
+        // the spilled keys are scattered over the heap, so their cache misses are overlapped
+        if (i + MDICT_COPY_PREFETCH < h->num_buckets && packed_is_spilled(h->keys, i + MDICT_COPY_PREFETCH)) {
+            __builtin_prefetch(h->keys[i + MDICT_COPY_PREFETCH].spilled.ptr);
+        }
+#endif
+        if (_bucket_is_live(h->flags, i) && !_mdict_copy_owned(h, src, i)) {
+            // drop what buckets [0, i) own, then the rest of the arrays, which is shared with src
+            for (uint32_t j = 0; j < i; j++) {
+                if (_bucket_is_live(h->flags, j)) {
+                    KEY_UNSET(h->keys, j);
+                    _val_unset(h, j);
+                }
+            }
+            free(h->flags);
+            free((void*) h->keys);
+            free((void*) h->vals);
+            free(h);
+            return NULL;
+        }
+    }
+#endif
+    return h;
+}
+
+// A position in the table for iterating over its live buckets in order. Start from {0, 0}
+typedef struct {
+    uint32_t next_group;  // the first bucket after the group that `pending` was read from
+    gbits pending;        // the full buckets of that group which haven't been returned yet
+} mdict_cursor_t;
+
+// Sets `*idx` to the next live bucket and returns true, or returns false at the end of the table.
+// Each group's flags are read once, so a run of empty or deleted buckets costs one comparison
+// per group instead of one per bucket. The table may change between calls, e.g. while a Python
+// iterator is suspended, so buckets from a stale `pending` are checked again before use.
+static inline bool mdict_cursor_next(h_t* h, mdict_cursor_t* c, uint32_t* idx) {
+    while (true) {
+        while (_gbits_has_next(c->pending)) {
+            uint32_t i = c->next_group - GROUP_WIDTH + (uint32_t) _gbits_next(&c->pending);
+            if (ABSL_PREDICT_TRUE(i < h->num_buckets && _bucket_is_live(h->flags, i))) {
+                *idx = i;
+                return true;
+            }
+        }
+        if (c->next_group >= h->num_buckets) {
+            return false;
+        }
+        c->pending = _group_mask_full(_group_load(&h->flags[c->next_group >> 3]));
+        c->next_group += GROUP_WIDTH;
+    }
+}
+
+// Returns what _group_mask_full gives for a group whose buckets are all live, so that loops over
+// the table can handle such groups without looking at each bucket's flag
+static inline gbits _group_mask_all_live(void) {
+    const uint64_t flags[GROUP_WIDTH / 8] = {0};
+    return _group_mask_full(_group_load(flags));
+}
+
 static inline int32_t _mdict_read_index(h_t* h, k_t key, uint32_t hash_upper, uint32_t h2) {
     const uint32_t step_basis = GROUP_WIDTH >> 3;
     uint32_t mask = _flags_size(h->num_buckets) - 1;
@@ -278,7 +699,7 @@ static int _mdict_resize(h_t* h, uint32_t new_num_buckets) {
     h->keys = new_keys;
 
     if (h->is_map) {
-        pv_t* new_vals = (pv_t*) realloc((void*) h->vals, new_num_buckets * sizeof(pv_t));
+        pv_t* new_vals = (pv_t*) realloc((void*) h->vals, new_num_buckets * VAL_WIDTH(h));
 
         if (!new_vals) {
             free(new_flags);
@@ -305,6 +726,17 @@ static void _mdict_resize_rehash(h_t* h, uint32_t new_num_buckets) {
     uint32_t new_flags_size = _flags_size(new_num_buckets);
     uint32_t new_mask = new_flags_size - 1;
     new_mask &= ~(step_basis - 1);  // e.g. mask should select 0,2,4,6 if 64 buckets, flags_size 8, num_groups 4
+#ifdef VALS_DYNAMIC_WIDTH
+    pv_t* val = (pv_t*) malloc(VAL_WIDTH(h));
+    if (val == NULL) {
+        h->error_code = -1;
+        return;
+    }
+#else
+    pv_t val_storage;
+    memset(&val_storage, 0, sizeof(pv_t));
+    pv_t* val = &val_storage;
+#endif
     if (_mdict_resize(h, new_num_buckets) == -1) {
         h->error_code = -1;
     }
@@ -319,9 +751,8 @@ static void _mdict_resize_rehash(h_t* h, uint32_t new_num_buckets) {
     while (j < old_num_buckets) {
         if (_bucket_is_deleted(h->flags, j)) {
             pk_t key = h->keys[j];
-            pv_t val;
             if (h->is_map) {
-                val = h->vals[j];
+                memcpy(val, _val_slot(h, j), VAL_WIDTH(h));
             }
             uint32_t hash = _hash_func(&h->hasher, KEY_GET(h->keys, j));
             uint32_t flags_index = (hash >> 7) & new_mask;
@@ -343,19 +774,19 @@ static void _mdict_resize_rehash(h_t* h, uint32_t new_num_buckets) {
                         // swap before writing then repeat on `j`
                         h->keys[j] = h->keys[new_index];
                         if (h->is_map) {
-                            h->vals[j] = h->vals[new_index];
+                            memcpy(_val_slot(h, j), _val_slot(h, new_index), VAL_WIDTH(h));
                         }
                         _bucket_set(h->flags, new_index, h2);
                         h->keys[new_index] = key;
                         if (h->is_map) {
-                            h->vals[new_index] = val;
+                            memcpy(_val_slot(h, new_index), val, VAL_WIDTH(h));
                         }
                     } else {
                         _bucket_set(h->flags, j, FLAGS_EMPTY);
                         _bucket_set(h->flags, new_index, h2);
                         h->keys[new_index] = key;
                         if (h->is_map) {
-                            h->vals[new_index] = val;
+                            memcpy(_val_slot(h, new_index), val, VAL_WIDTH(h));
                         }
                         j += 1;
                     }
@@ -370,30 +801,69 @@ static void _mdict_resize_rehash(h_t* h, uint32_t new_num_buckets) {
             j += 1;
         }
     }
+#ifdef VALS_DYNAMIC_WIDTH
+    free(val);
+#endif
 }
 
 static void mdict_clear(h_t* h) {
+#ifdef VALS_OBJECT
+    // the references are dropped after the map is empty, in case that runs code which uses it
+    pv_t* dropped = (pv_t*) malloc((h->size + 1) * sizeof(pv_t));
+    uint32_t num_dropped = 0;
+#endif
 #if defined(KEYS_POINT) || defined(VALS_POINT)
     for (uint32_t j = 0; j < h->num_buckets; ++j) {
         if (_bucket_is_live(h->flags, j)) {
             KEY_UNSET(h->keys, j);
-            VAL_UNSET(h->vals, j);
+#ifdef VALS_OBJECT
+            if (dropped != NULL) {
+                dropped[num_dropped++] = h->vals[j];
+                h->vals[j] = NULL;
+                continue;
+            }
+#endif
+            _val_unset(h, j);
         }
     }
 #endif
     memset(h->flags, FLAGS_EMPTY, _flags_size(h->num_buckets) * sizeof(uint64_t));
     h->size = 0;
     h->num_deleted = 0;
+#ifdef VALS_OBJECT
+    for (uint32_t j = 0; j < num_dropped; j++) {
+        Py_DECREF(dropped[j]);
+    }
+    free(dropped);
+#endif
 }
 
-// Returns true if the set is an _insert_, false if it is a _replace_ or an error occurred.
-// Caller is responsible for freeing the value placed in val_box if VALS_POINT is defined.
-static inline bool mdict_set(h_t* h, k_t key, v_t val, pv_t* val_box, bool should_replace) {
+// Grows the table so that it can hold `n` keys without resizing again. Returns false if an
+// allocation failed.
+static inline bool mdict_reserve(h_t* h, uint32_t n) {
+    uint64_t want = (uint64_t) (n / PEAK_LOAD) + 1;
+    uint32_t new_num_buckets = h->num_buckets;
+    while (new_num_buckets < want && new_num_buckets < (1u << 31)) {
+        new_num_buckets <<= 1;
+    }
+    if (new_num_buckets == h->num_buckets) {
+        return true;
+    }
+    h->error_code = 0;
+    _mdict_resize_rehash(h, new_num_buckets);
+    return h->error_code == 0;
+}
+
+// Finds the bucket holding `key`, or claims an empty one for it. Returns 1 if the key was
+// inserted, in which case the caller must fill in the value with _val_set; 0 if it was already
+// present; or -1 if an allocation failed (see h->error_code).
+static inline int mdict_find_or_insert(h_t* h, k_t key, uint32_t* idx_box) {
+    h->error_code = 0;
     if (h->size + h->num_deleted >= h->upper_bound) {
         uint32_t new_num_buckets = (h->size >= h->grow_threshold) ? (h->num_buckets << 1) : h->num_buckets;
         _mdict_resize_rehash(h, new_num_buckets);
         if (h->error_code) {
-            return false;
+            return -1;
         }
     }
 
@@ -418,13 +888,8 @@ static inline bool mdict_set(h_t* h, k_t key, v_t val, pv_t* val_box, bool shoul
             offset = _gbits_next(&matches);
             uint32_t index = _match_index(flags_index, offset);
             if (ABSL_PREDICT_TRUE(KEY_EQ(KEY_GET(h->keys, index), key))) {
-                if (val_box != NULL) {
-                    *val_box = h->vals[index];
-                }
-                if (should_replace) {
-                    VAL_SET(h->vals, index, val);
-                }
-                return false;
+                *idx_box = index;
+                return 0;
             }
         }
         gbits empties = _group_mask_empty(group);
@@ -441,13 +906,39 @@ static inline bool mdict_set(h_t* h, k_t key, v_t val, pv_t* val_box, bool shoul
     uint32_t idx = _match_index(flags_index, offset);
     if (!KEY_SET(h->keys, idx, key)) {
         h->error_code = -2;
+        return -1;
+    }
+    h->size++;
+    *idx_box = idx;
+    return 1;
+}
+
+// Returns true if the set is an _insert_, false if it is a _replace_ or an error occurred.
+// Caller is responsible for freeing the value placed in val_box if VALS_POINT is defined.
+static inline bool mdict_set(h_t* h, k_t key, v_t val, pv_t* val_box, bool should_replace) {
+    uint32_t idx;
+    int inserted = mdict_find_or_insert(h, key, &idx);
+    if (inserted == -1) {
         return false;
     }
-    if (!VAL_SET(h->vals, idx, val)) {
+    if (!inserted) {
+        if (val_box != NULL) {
+            _val_box(h, idx, val_box);
+        }
+        if (should_replace && !_val_set(h, idx, val)) {
+            h->error_code = -2;
+        }
+        return false;
+    }
+    if (!_val_set(h, idx, val)) {
+        // the key has no value, so take it back out
+        KEY_UNSET(h->keys, idx);
+        _bucket_set(h->flags, idx, FLAGS_DELETED);
+        h->size--;
+        h->num_deleted++;
         h->error_code = -2;
         return false;
     }
-    h->size++;
     return true;
 }
 
@@ -478,12 +969,82 @@ static inline bool mdict_prepare_remove_item(h_t* h, uint32_t* idx_box) {
     return false;
 }
 
+// Lookups and inserts stop at the first group with an empty bucket, and a bucket only becomes
+// empty again when the table is rehashed, so no probe sequence goes past a group that has one.
+// Removing from such a group can leave an empty bucket instead of a deleted one
 static inline void mdict_remove_item(h_t* h, uint32_t idx) {
     KEY_UNSET(h->keys, idx);
-    VAL_UNSET(h->vals, idx);
-    _bucket_set(h->flags, idx, FLAGS_DELETED);
+    const uint32_t step_basis = GROUP_WIDTH >> 3;
+    if (_group_mask_empty(_group_load(&h->flags[(idx >> 3) & ~(step_basis - 1)]))) {
+        _bucket_set(h->flags, idx, FLAGS_EMPTY);
+    } else {
+        _bucket_set(h->flags, idx, FLAGS_DELETED);
+        h->num_deleted++;
+    }
     h->size--;
-    h->num_deleted++;
+    _val_unset(h, idx);
+}
+
+// Moves the live entries into new arrays with `new_num_buckets` buckets, which must leave room for
+// them, and frees the old arrays. _mdict_resize_rehash works in place, so it can't shrink the table.
+// Returns false if an allocation failed, in which case the table is unchanged.
+static inline bool _mdict_rebuild(h_t* h, uint32_t new_num_buckets) {
+    h_t old = *h;
+    h->flags = NULL;
+    h->keys = NULL;
+    h->vals = NULL;
+    if (_mdict_resize(h, new_num_buckets) == -1) {
+        *h = old;
+        return false;
+    }
+    memset(h->flags, FLAGS_EMPTY, _flags_size(new_num_buckets) * sizeof(uint64_t));
+
+    const uint32_t step_basis = GROUP_WIDTH >> 3;
+    uint32_t mask = (_flags_size(new_num_buckets) - 1) & ~(step_basis - 1);
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t j;
+    while (mdict_cursor_next(&old, &cursor, &j)) {
+        uint32_t hash = _hash_func(&h->hasher, KEY_GET(old.keys, j));
+        uint32_t flags_index = (hash >> 7) & mask;
+        uint32_t step = step_basis;
+        gbits empties;
+        while (!(empties = _group_mask_empty(_group_load(&h->flags[flags_index])))) {
+            flags_index = (flags_index + step) & mask;
+            step += step_basis;
+        }
+        uint32_t idx = _match_index(flags_index, (uint32_t) _gbits_next(&empties));
+        _bucket_set(h->flags, idx, hash & 0x7f);
+        h->keys[idx] = old.keys[j];
+        if (h->is_map) {
+            memcpy(_val_slot(h, idx), _val_slot(&old, j), VAL_WIDTH(h));
+        }
+    }
+    free(old.flags);
+    free(old.keys);
+    free(old.vals);
+    return true;
+}
+
+// Tidies the table after many entries were removed at once: shrinks it if it has become more than
+// twice as large as it needs to be, or else rehashes it in place if the deleted buckets take up more
+// than half of the room left before the next rehash. Returns false if an allocation failed, which
+// leaves the table as it was, and still usable.
+static inline bool mdict_compact(h_t* h) {
+    uint32_t want = 32;
+    while (want < (1u << 31) && h->size >= (uint32_t) (want * PEAK_LOAD * PEAK_LOAD)) {
+        want <<= 1;
+    }
+    if (want < h->num_buckets) {
+        return _mdict_rebuild(h, want);
+    }
+    uint32_t used = h->size + h->num_deleted;
+    uint32_t room = used < h->upper_bound ? h->upper_bound - used : 0;
+    if (h->num_deleted > room / 2) {
+        h->error_code = 0;
+        _mdict_resize_rehash(h, h->num_buckets);
+        return h->error_code == 0;
+    }
+    return true;
 }
 
 static inline bool mdict_get(h_t* h, k_t key, v_t* val_box) {
@@ -493,10 +1054,33 @@ static inline bool mdict_get(h_t* h, k_t key, v_t* val_box) {
         return false;
     }
 
-    *val_box = VAL_GET(h->vals, idx);
+    *val_box = _val_get(h, idx);
     return true;
 }
 
+static inline uint32_t mdict_hash(h_t* h, k_t key) {
+    return _hash_func(&h->hasher, key);
+}
+
+// Like mdict_get, for a key already hashed with mdict_hash. Returns the bucket index, or -1 if
+// the key isn't present
+static inline int32_t mdict_find_hashed(h_t* h, k_t key, uint32_t hash) {
+    int32_t idx = _mdict_read_index(h, key, hash >> 7, hash & 0x7f);
+    return idx < 0 ? -1 : idx;
+}
+
+// Prefetches the first group of flags and keys that a probe for `hash` reads, so that a batch of
+// lookups can overlap their cache misses
+static inline void mdict_prefetch(h_t* h, uint32_t hash) {
+#if defined(__GNUC__) || defined(__clang__)
+    const uint32_t step_basis = GROUP_WIDTH >> 3;
+    uint32_t mask = (_flags_size(h->num_buckets) - 1) & ~(step_basis - 1);
+    uint32_t flags_index = (hash >> 7) & mask;
+    __builtin_prefetch(&h->flags[flags_index]);
+    __builtin_prefetch(&h->keys[_match_index(flags_index, 0)]);
+#endif
+}
+
 static inline bool mdict_contains(h_t* h, k_t key) {
     uint32_t hash = _hash_func(&h->hasher, key);
     return _mdict_read_index(h, key, hash >> 7, hash & 0x7f) >= 0;
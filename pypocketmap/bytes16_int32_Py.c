@@ -0,0 +1,3604 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "flags.h"
+#define KEY_TYPE_TAG TYPE_TAG_FIXED
+#define KEY_FIXED_WIDTH 16
+#define VAL_TYPE_TAG TYPE_TAG_I32
+#include "abstract.h"
+#include "pyconv.h"
+
+typedef struct {
+    PyObject_HEAD
+    h_t* ht;
+    bool valid_ht;
+    bool accumulating;  // accumulate() or another bulk update is running, and may have released the GIL
+} dictObj;
+
+typedef struct {
+    PyObject_HEAD
+    dictObj* owner;
+    mdict_cursor_t cursor;
+    uint32_t yielded;  // for __length_hint__
+    PyObject* item;    // the last tuple from item_iternext, reused if it has been released
+} iterObj;
+
+static void iter_dealloc(iterObj* self);
+static int iter_traverse(iterObj* self, visitproc visit, void* arg);
+static PyObject* key_iternext(iterObj* self);
+static PyObject* value_iternext(iterObj* self);
+static PyObject* item_iternext(iterObj* self);
+static PyObject* iter_length_hint(iterObj* self);
+
+static PyMethodDef iter_methods[] = {
+    {"__length_hint__", (PyCFunction)iter_length_hint, METH_NOARGS, "Returns the number of items left"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject keyIterType_bytes16_int32 = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_keys[bytes16, int32]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) key_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject valueIterType_bytes16_int32 = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_values[bytes16, int32]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) value_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject itemIterType_bytes16_int32 = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_items[bytes16, int32]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) item_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyObject* iter_new(dictObj* owner, PyTypeObject* itertype) {
+    iterObj* iterator = PyObject_GC_New(iterObj, itertype);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    Py_INCREF(owner);
+    iterator->owner = owner;
+    iterator->cursor = (mdict_cursor_t) {0, 0};
+    iterator->yielded = 0;
+    iterator->item = NULL;
+    PyObject_GC_Track(iterator);
+    return (PyObject *)iterator;
+}
+
+static void iter_dealloc(iterObj* self) {
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->owner);
+    Py_XDECREF(self->item);
+    PyObject_GC_Del(self);
+}
+
+static int iter_traverse(iterObj* self, visitproc visit, void* arg) {
+    Py_VISIT(self->owner);
+    Py_VISIT(self->item);
+    return 0;
+}
+
+/**
+ * Returns how many more items the iterator will return if the map isn't changed, so that list()
+ * can allocate the result once.
+ */
+static PyObject* iter_length_hint(iterObj* self) {
+    uint32_t size = self->owner == NULL ? 0 : self->owner->ht->size;
+    return PyLong_FromUnsignedLong(size > self->yielded ? size - self->yielded : 0);
+}
+
+/**
+ * Iterates over the keys when __next__ is called on the iterator. Each time this function is called by __next__, the next key is returned.
+ */
+static PyObject* key_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    return PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+}
+
+/**
+ * Iterates over the values when __next__ is called on the iterator. Each time this function is called by __next__, the next value is returned.
+ */
+static PyObject* value_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    v_t val = _val_get(h, i);
+    return PyLong_FromLong(val);
+}
+
+/**
+ * Iterates over the items when __next__ is called on the iterator. Each time this function is called by __next__, the next item (key, value) is returned.
+ */
+static PyObject* item_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    v_t val = _val_get(h, i);
+    PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+    if (key_obj == NULL) {
+        return NULL;
+    }
+    return pyconv_item(&self->item, key_obj, PyLong_FromLong(val));
+}
+
+/**
+ * Called by the destructor for deleting the hashtable.
+ */
+void _destroy(dictObj* self) {
+    if (self->valid_ht) {
+        mdict_destroy(self->ht);
+        self->valid_ht = false;
+    }
+}
+
+/**
+ * Called by the constructor for allocating and initializing the hashtable.
+ */
+void _create(dictObj* self, uint32_t num_buckets){
+    if (!self->valid_ht) {
+        self->ht = mdict_create(num_buckets, true);
+        self->valid_ht = true;
+    }
+}
+
+/**
+ * The destructor
+ */
+static void custom_dealloc(dictObj* self) {
+#ifdef VALS_OBJECT
+    PyObject_GC_UnTrack(self);
+#endif
+    _destroy(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+#ifdef VALS_OBJECT
+/**
+ * Visits the object values for the cycle collector.
+ */
+static int custom_traverse(dictObj* self, visitproc visit, void* arg) {
+    if (!self->valid_ht) {
+        return 0;
+    }
+    h_t* h = self->ht;
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            Py_VISIT(_val_get(h, i));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Drops the object values to break a reference cycle.
+ */
+static int custom_clear(dictObj* self) {
+    if (self->valid_ht) {
+        mdict_clear(self->ht);
+    }
+    return 0;
+}
+#endif
+
+/**
+ * Allocates the dictObj
+ */
+static PyObject* custom_new(PyTypeObject *type, PyObject *args) {
+    dictObj* self = (dictObj*) type->tp_alloc(type, 0);
+    self->ht = NULL;
+    self->valid_ht = false;
+    self->accumulating = false;
+    return (PyObject*) self;
+}
+
+/**
+ * Constructor for allocating and initializing the hashtable along with the iterators.
+ */
+static int custom_init(dictObj* self, PyObject *args) {
+    unsigned int num_buckets = 32;
+
+    if (!PyArg_ParseTuple(args, "|I", &num_buckets)) {
+        Py_DECREF(self);
+        return -1;
+    }
+
+    _create(self, num_buckets);
+
+    return 0;
+}
+
+/**
+ * Returns false with an exception set if accumulate() or another bulk update is running in another
+ * thread, since they update the table without the GIL.
+ */
+static bool _check_not_accumulating(dictObj* self) {
+    if (self->accumulating) {
+        PyErr_SetString(PyExc_RuntimeError, "cannot modify the map while accumulate() or another bulk update is running");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * This function is invoked when dict.get(k, [default]) is called.
+ */
+static PyObject* get(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        return Py_BuildValue("");
+    }
+    return PyLong_FromLong(val);
+}
+
+/**
+ * dict.pop() invokes this function. If provided, a default is returned when the key is not found;
+ * otherwise a KeyError is raised.
+ */
+static PyObject* pop(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    uint32_t idx;
+    if (!mdict_prepare_remove(self->ht, key, &idx)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    v_t val = _val_get(self->ht, idx);
+    PyObject* res = PyLong_FromLong(val);
+    mdict_remove_item(self->ht, idx);
+    return res;
+}
+
+/**
+ * dict.popitem() invokes this function.
+ */
+static PyObject* popitem(dictObj* self) {
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+    h_t* h = self->ht;
+    uint32_t idx;
+    if (!mdict_prepare_remove_item(h, &idx)) {
+        PyErr_SetString(PyExc_KeyError, "The map is empty");
+        return NULL;
+    }
+    k_t key = KEY_GET(h->keys, idx);
+    v_t val = _val_get(h, idx);
+    PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+    PyObject* val_obj = PyLong_FromLong(val);
+    mdict_remove_item(h, idx);
+    if (key_obj == NULL || val_obj == NULL) {
+        Py_XDECREF(key_obj);
+        Py_XDECREF(val_obj);
+        return NULL;
+    }
+
+    PyObject* item_obj = PyTuple_Pack(2, key_obj, val_obj);
+    Py_DECREF(key_obj);
+    Py_DECREF(val_obj);
+    return item_obj;
+}
+
+/**
+ * This is invoked for the python expression d.setdefault(key, [default]). If no default is passed, zero is used.
+ */
+static PyObject* setdefault(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* val_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &val_obj)) {
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    // convert the key last: a borrowed bytearray key could be resized by Python code run for the default
+    v_t dfault = 0;
+    if (val_obj != NULL) {
+        dfault = pyconv_as_int32(val_obj);
+        if (dfault == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    pv_t previous;
+    if (!mdict_set(self->ht, key, dfault, &previous, false)) {
+        if (self->ht->error_code) {
+            PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+            return NULL;
+        }
+        dfault = VAL_GET(&previous, 0);
+    }
+    return PyLong_FromLong(dfault);
+}
+
+/**
+ * dict.clear() invokes this function.
+ */
+static PyObject* clear(dictObj* self) {
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+    mdict_clear(self->ht);
+    return Py_BuildValue("");
+}
+
+/**
+ * This function updates the hashtable with items from a given Python Dictionary. In case the python
+ * dictionary contains an item with non-matching types, then a TypeError will be raised.
+ */
+int _update_from_Pydict(dictObj* self, PyObject* dict) {
+    PyObject* key_obj;
+    PyObject* value_obj;
+    Py_ssize_t pos = 0;
+    k_t key;
+    v_t val;
+    pv_t previous;
+    while (PyDict_Next(dict, &pos, &key_obj, &value_obj)) {
+        val = pyconv_as_int32(value_obj);
+        if (val == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+
+        if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+            return -1;
+        }
+
+        if (!mdict_set(self->ht, key, val, &previous, true)) {
+            if (self->ht->error_code) {
+                PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+                return -1;
+            }
+
+            VAL_UNSET(&previous, 0);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * This function updates the hashtable with all the items from another dictionary (dict) of the same key, value type.
+ */
+int _update_from_mdict(dictObj* self, dictObj* dict) {
+    h_t* h = self->ht;
+    h_t* other = dict->ht;
+    pv_t previous;
+
+    for (uint32_t i = 0; i < other->num_buckets; i++) {
+        if (_bucket_is_live(other->flags, i)) {
+            if (!mdict_set(h, KEY_GET(other->keys, i), _val_get(other, i), &previous, true)) {
+                if (self->ht->error_code) {
+                    PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+                    return -1;
+                }
+
+                VAL_UNSET(&previous, 0);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * This function is called for the python expression 'k in dict'. k must be of the same type as the hashtable keys.
+ */
+static int _contains_(dictObj* self, PyObject* key_obj) {
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return -1;
+    }
+
+    return mdict_contains(self->ht, key);
+}
+
+/**
+ * This function is called when len(dict) is called. It returns the total number of items present.
+ */
+static int _len_(dictObj* self) {
+    return self->ht->size;
+}
+
+
+/**
+ * This function is invoked when dict[k] is called.
+ */
+static PyObject* _getitem_(dictObj* self, PyObject* key_obj){
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    return PyLong_FromLong(val);
+}
+
+/**
+ * This is invoked for the python expression d[key] = value. Both key and value must be of the hashtable type.
+ * This is also invoke for del d[key], in which case the `val_obj` is NULL
+ */
+static int _setitem_(dictObj* self, PyObject* key_obj, PyObject* value_obj) {
+    if (!_check_not_accumulating(self)) {
+        return -1;
+    }
+    // convert the key last: a borrowed bytearray key could be resized by Python code run for the value
+    v_t val = 0;
+    if (value_obj != NULL) {
+        val = pyconv_as_int32(value_obj);
+        if (val == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return -1;
+    }
+
+    if (value_obj == NULL) {
+        uint32_t idx;
+        if (!mdict_prepare_remove(self->ht, key, &idx)) {
+            pyconv_key_error(key_obj);
+            return -1;
+        }
+        mdict_remove_item(self->ht, idx);
+        return 0;
+    }
+
+    pv_t previous;
+    if (!mdict_set(self->ht, key, val, &previous, true)) {
+        if (self->ht->error_code) {
+            PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+            return -1;
+        }
+
+        VAL_UNSET(&previous, 0);
+    }
+    return 0;
+}
+
+/**
+ * This is invoked for the python expression d BINOP other (BINOP is ==, !=, <, >, <=, or >=).
+ */
+static PyObject* _richcmp_(dictObj* self, PyObject* other, int op) {
+    if (op != Py_EQ && op != Py_NE) {
+        Py_INCREF(Py_NotImplemented);
+        return Py_NotImplemented;
+    }
+    if (!PyMapping_Check(other)) {
+        return PyBool_FromLong(op != Py_EQ);
+    }
+    if (PyMapping_Size(other) != self->ht->size) {
+        return PyBool_FromLong(op != Py_EQ);
+    }
+
+    PyObject* key_obj;
+    v_t other_val;
+    bool is_equal = true;
+    h_t* h = self->ht;
+    for (uint32_t i = 0; is_equal && i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            k_t key = KEY_GET(h->keys, i);
+            key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+            PyObject* other_val_obj = PyObject_GetItem(other, key_obj);
+            Py_CLEAR(key_obj);
+            if (other_val_obj == NULL) {
+                PyErr_Clear();
+                is_equal = false;
+                break;
+            }
+            other_val = pyconv_as_int32(other_val_obj);
+            if (other_val == -1 && PyErr_Occurred()) {
+                PyErr_Clear();
+                Py_DECREF(other_val_obj);
+                is_equal = false;
+                break;
+            }
+            is_equal = VAL_EQ(_val_get(h, i), other_val);
+            Py_DECREF(other_val_obj);
+        }
+    }
+    if (PyErr_Occurred()) {
+        // raised by an object value's __eq__
+        return NULL;
+    }
+    return PyBool_FromLong((op == Py_EQ) == is_equal);
+}
+
+/**
+ * Formats the map as a string
+ */
+static PyObject* _repr_(dictObj* self) {
+    h_t* h = self->ht;
+    if (h->size == 0) {
+        return PyUnicode_FromString("<pypocketmap[bytes16, int32]: {}>");
+    }
+    const int REPR_DICT_POS = 1 + 12 + 7 + 2 + 5 + 3;
+    //               "<pypocketmap["   k ", "  v   "]: "
+    const int REPR_MIN_PAIR = 2 + 19 + 1;
+
+    _PyUnicodeWriter writer;
+    _PyUnicodeWriter_Init(&writer);
+    writer.overallocate = 1;
+    writer.min_length = REPR_DICT_POS + 1 + REPR_MIN_PAIR - 2 + REPR_MIN_PAIR * (h->size - 1) + 2;
+    //            "<pypocketmap[_, _]" "{"  (k ": " v)          (", " k ": " v)*               "}>"
+
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "<pypocketmap[bytes16, int32]: {", REPR_DICT_POS + 1) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+    k_t key;
+    v_t val;
+    PyObject* key_obj = NULL;
+    PyObject* key_repr;
+    char val_repr[48];
+    bool first = true;
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            if (!first) {
+                if (_PyUnicodeWriter_WriteASCIIString(&writer, ", ", 2) < 0) {
+                    _PyUnicodeWriter_Dealloc(&writer);
+                    return NULL;
+                }
+            }
+            first = false;
+            key = KEY_GET(h->keys, i);
+            key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+            if (key_obj == NULL) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+            key_repr = PyObject_Repr(key_obj);
+            if (key_repr == NULL) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                Py_CLEAR(key_obj);
+                return NULL;
+            }
+            if (_PyUnicodeWriter_WriteStr(&writer, key_repr) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                Py_CLEAR(key_obj);
+                return NULL;
+            }
+            Py_CLEAR(key_obj);
+
+            if (_PyUnicodeWriter_WriteASCIIString(&writer, ": ", 2) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+
+            val = _val_get(h, i);
+            size_t val_len = snprintf(val_repr, 47, "%d", val);
+            if (_PyUnicodeWriter_WriteASCIIString(&writer, val_repr, val_len) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+        }
+    }
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "}>", 2) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+
+    return _PyUnicodeWriter_Finish(&writer);
+}
+
+/**
+ * Returns an iterator for keys when __iter__(dict) is called
+ */
+static PyObject* keys(dictObj* self) {
+    return iter_new(self, &keyIterType_bytes16_int32);
+}
+
+/**
+ * Returns the value iterator
+ */
+static PyObject* values(dictObj* self) {
+    return iter_new(self, &valueIterType_bytes16_int32);
+}
+
+/**
+ * Returns the item iterator
+ */
+static PyObject* items(dictObj* self) {
+    return iter_new(self, &itemIterType_bytes16_int32);
+}
+
+/**
+ * Returns the keys as a list, in the same order as keys(). The list is allocated once and filled
+ * in by one scan of the table, without going through an iterator.
+ */
+static PyObject* keys_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, key_obj);
+    }
+    // a garbage collection while converting could run a __del__ that removes items
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns the (key, value) pairs as a list, in the same order as items().
+ */
+static PyObject* items_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        v_t val = _val_get(h, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyObject* item = pyconv_new_item(key_obj, PyLong_FromLong(val));
+        if (item == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, item);
+    }
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Invoked for dict.retain(predicate), which calls predicate(key, value) for each entry and deletes
+ * the entries for which it returns false, in one scan of the table. The table is tidied once at
+ * the end, rather than being left with a deleted bucket for each entry. The map can't be modified
+ * by anything else until this returns. Returns the number of entries deleted.
+ */
+static PyObject* retain(dictObj* self, PyObject* predicate) {
+    if (!PyCallable_Check(predicate)) {
+        PyErr_Format(PyExc_TypeError, "'%s' object is not callable", Py_TYPE(predicate)->tp_name);
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+    h_t* h = self->ht;
+    uint32_t removed = 0;
+    bool ok = true;
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    self->accumulating = true;
+    while (ok && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        v_t val = _val_get(h, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        PyObject* val_obj = PyLong_FromLong(val);
+        PyObject* res = (key_obj == NULL || val_obj == NULL) ? NULL : pyconv_call2(predicate, key_obj, val_obj);
+        Py_XDECREF(key_obj);
+        Py_XDECREF(val_obj);
+        int keep = res == NULL ? -1 : PyObject_IsTrue(res);
+        Py_XDECREF(res);
+        if (keep == 0) {
+            mdict_remove_item(h, i);
+            removed++;
+        }
+        ok = keep != -1;
+    }
+    mdict_compact(h);
+    self->accumulating = false;
+    return ok ? PyLong_FromUnsignedLong(removed) : NULL;
+}
+
+/**
+ * Returns a new pypocketmap containing all items present in this hashtable when dict.copy() is called.
+ * The table is duplicated bucket for bucket (see mdict_copy), so nothing is rehashed.
+ */
+static PyObject* copy(dictObj* self) {
+    dictObj* new_obj = (dictObj *) PyObject_CallObject((PyObject *)((PyObject *) self)->ob_type, NULL);
+    if (new_obj == NULL) {
+        return NULL;
+    }
+    h_t* h = mdict_copy(self->ht);
+    if (h == NULL) {
+        Py_DECREF(new_obj);
+        return PyErr_NoMemory();
+    }
+    mdict_destroy(new_obj->ht);
+    new_obj->ht = h;
+    return (PyObject*) new_obj;
+}
+
+/**
+ * Invoked for copy.deepcopy(dict). The keys and any values other than objects are plain data, so
+ * this is the same as copy(); object values are copied with copy.deepcopy(value, memo).
+ */
+static PyObject* deepcopy(dictObj* self, PyObject* memo) {
+    PyObject* new_obj = copy(self);
+#ifdef VALS_OBJECT
+    if (new_obj == NULL) {
+        return NULL;
+    }
+    PyObject* copy_module = PyImport_ImportModule("copy");
+    PyObject* deepcopy_fn = copy_module == NULL ? NULL : PyObject_GetAttrString(copy_module, "deepcopy");
+    Py_XDECREF(copy_module);
+    if (deepcopy_fn == NULL) {
+        Py_DECREF(new_obj);
+        return NULL;
+    }
+    // registered first, so that a value which refers back to this map gets the copy
+    PyObject* self_id = PyLong_FromVoidPtr(self);
+    if (self_id == NULL || (PyDict_Check(memo) && PyDict_SetItem(memo, self_id, new_obj) == -1)) {
+        Py_XDECREF(self_id);
+        Py_DECREF(deepcopy_fn);
+        Py_DECREF(new_obj);
+        return NULL;
+    }
+    Py_DECREF(self_id);
+    dictObj* d = (dictObj*) new_obj;
+    // the table is looked up again after each call, which can run code that changes the map
+    for (uint32_t i = 0; i < d->ht->num_buckets; i++) {
+        if (!_bucket_is_live(d->ht->flags, i)) {
+            continue;
+        }
+        PyObject* val = PyObject_CallFunctionObjArgs(deepcopy_fn, d->ht->vals[i], memo, NULL);
+        if (val == NULL) {
+            Py_DECREF(deepcopy_fn);
+            Py_DECREF(new_obj);
+            return NULL;
+        }
+        if (i < d->ht->num_buckets && _bucket_is_live(d->ht->flags, i)) {
+            Py_SETREF(d->ht->vals[i], val);
+        } else {
+            Py_DECREF(val);
+        }
+    }
+    Py_DECREF(deepcopy_fn);
+#endif
+    return new_obj;
+}
+
+/**
+ * Converts a single key for the bulk methods. Returns -1 with an exception set on failure.
+ */
+static int _key_from_py(PyObject* key_obj, k_t* out) {
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return -1;
+    }
+
+    *out = key;
+    return 0;
+}
+
+/**
+ * Converts a single value for the bulk methods. Returns -1 with an exception set on failure.
+ */
+static int _val_from_py(PyObject* value_obj, v_t* out) {
+    v_t val;
+    val = pyconv_as_int32(value_obj);
+    if (val == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    *out = val;
+    return 0;
+}
+
+#include "keycol.h"
+
+/**
+ * The values argument of set_many: a buffer for numeric values, as with keycol_t, or a sequence.
+ */
+typedef struct {
+    Py_ssize_t len;
+    PyObject* seq;
+#ifdef VAL_BUF_KIND
+    const v_t* data;
+    Py_buffer view;
+#endif
+} valcol_t;
+
+static int _valcol_init(valcol_t* col, PyObject* obj) {
+    col->seq = NULL;
+#ifdef VAL_BUF_KIND
+    col->data = NULL;
+    if (pyconv_typed_buffer(obj, &col->view, VAL_BUF_KIND, sizeof(v_t), 1)) {
+        col->data = (const v_t*) col->view.buf;
+        col->len = col->view.shape[0];
+        return 0;
+    }
+#endif
+    col->seq = PySequence_Tuple(obj);
+    if (col->seq == NULL) {
+        return -1;
+    }
+    col->len = PyTuple_GET_SIZE(col->seq);
+    return 0;
+}
+
+static inline int _valcol_get(valcol_t* col, Py_ssize_t i, v_t* val) {
+#ifdef VAL_BUF_KIND
+    if (col->data != NULL) {
+        *val = col->data[i];
+        return 0;
+    }
+#endif
+    return _val_from_py(PyTuple_GET_ITEM(col->seq, i), val);
+}
+
+static void _valcol_release(valcol_t* col) {
+    Py_XDECREF(col->seq);
+#ifdef VAL_BUF_KIND
+    if (col->data != NULL) {
+        PyBuffer_Release(&col->view);
+    }
+#endif
+}
+
+/**
+ * Invoked for dict.get_many(keys, [default]). Numeric values are returned as a numpy array, where
+ * missing keys get `default` (or zero). Other values are returned as a list, where missing keys get
+ * `default` (or None).
+ */
+static PyObject* get_many(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"keys", "default", NULL};
+    PyObject* keys_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &keys_obj, &default_obj)) {
+        return NULL;
+    }
+
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        return NULL;
+    }
+    h_t* h = self->ht;
+    k_t key;
+    v_t val;
+#ifdef VAL_BUF_KIND
+    v_t dfault = 0;
+    if (default_obj != NULL && _val_from_py(default_obj, &dfault) == -1) {
+        _keycol_release(&keys);
+        return NULL;
+    }
+    Py_buffer out_view;
+    PyObject* out = pyconv_new_array(VAL_DTYPE, keys.len, &out_view);
+    if (out == NULL) {
+        _keycol_release(&keys);
+        return NULL;
+    }
+    v_t* out_data = (v_t*) out_view.buf;
+    for (Py_ssize_t i = 0; i < keys.len; i++) {
+        if (_keycol_get(&keys, i, &key) == -1) {
+            Py_CLEAR(out);
+            break;
+        }
+        out_data[i] = mdict_get(h, key, &val) ? val : dfault;
+    }
+    PyBuffer_Release(&out_view);
+#else
+    if (default_obj == NULL) {
+        default_obj = Py_None;
+    }
+    PyObject* out = PyList_New(keys.len);
+    for (Py_ssize_t i = 0; out != NULL && i < keys.len; i++) {
+        if (_keycol_get(&keys, i, &key) == -1) {
+            Py_CLEAR(out);
+            break;
+        }
+        PyObject* val_obj = default_obj;
+        if (mdict_get(h, key, &val)) {
+            val_obj = PyLong_FromLong(val);
+            if (val_obj == NULL) {
+                Py_CLEAR(out);
+                break;
+            }
+        } else {
+            Py_INCREF(val_obj);
+        }
+        PyList_SET_ITEM(out, i, val_obj);
+    }
+#endif
+    _keycol_release(&keys);
+    return out;
+}
+
+/**
+ * Invoked for dict.set_many(keys, values), which is equivalent to `dict[k] = v` for each pair.
+ */
+static PyObject* set_many(dictObj* self, PyObject* args) {
+    PyObject* keys_obj;
+    PyObject* values_obj;
+
+    if (!PyArg_ParseTuple(args, "OO", &keys_obj, &values_obj)) {
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        return NULL;
+    }
+    valcol_t vals;
+    if (_valcol_init(&vals, values_obj) == -1) {
+        _keycol_release(&keys);
+        return NULL;
+    }
+    bool ok = true;
+    if (keys.len != vals.len) {
+        PyErr_SetString(PyExc_ValueError, "keys and values must have the same length");
+        ok = false;
+    }
+    h_t* h = self->ht;
+    k_t key;
+    v_t val;
+    pv_t previous;
+    for (Py_ssize_t i = 0; ok && i < keys.len; i++) {
+        // convert the key last: a borrowed bytearray key could be resized by Python code run for the value
+        if (_valcol_get(&vals, i, &val) == -1 || _keycol_get(&keys, i, &key) == -1) {
+            ok = false;
+            break;
+        }
+        if (!mdict_set(h, key, val, &previous, true)) {
+            if (h->error_code) {
+                PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+                ok = false;
+                break;
+            }
+
+            VAL_UNSET(&previous, 0);
+        }
+    }
+    _valcol_release(&vals);
+    _keycol_release(&keys);
+    if (!ok) {
+        return NULL;
+    }
+    return Py_BuildValue("");
+}
+
+// delete_many() converts and deletes this many keys at a time, and prefetches this many ahead
+#define DELETE_CHUNK 4096
+#define DELETE_PREFETCH 8
+
+/**
+ * Looks up keys [0, n) of a chunk, hashing them all first so that the probes can be prefetched,
+ * and stores each one's bucket (or -1) in found. Only reads the table, so it runs without the GIL.
+ */
+static void _find_chunk(h_t* h, const k_t* keys, Py_ssize_t n, uint32_t* hashes, int32_t* found) {
+    for (Py_ssize_t i = 0; i < n; i++) {
+        hashes[i] = mdict_hash(h, keys[i]);
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (i + DELETE_PREFETCH < n) {
+            mdict_prefetch(h, hashes[i + DELETE_PREFETCH]);
+        }
+        found[i] = mdict_find_hashed(h, keys[i], hashes[i]);
+    }
+}
+
+/**
+ * Invoked for dict.delete_many(keys), which deletes each of `keys` that is present. The keys are
+ * taken in the same forms as get_many, and missing ones are skipped. Each chunk is converted with
+ * the GIL held and looked up with it released, then its buckets are removed once the GIL is back,
+ * since removing frees keys and values that other threads could be reading. Keys are only removed,
+ * never moved, so the buckets found stay valid, and one already removed (a repeated key) is no
+ * longer live. The table is tidied once at the end with mdict_compact. If a key can't be
+ * converted, the keys before it have been deleted. Returns the number of keys deleted.
+ */
+static PyObject* delete_many(dictObj* self, PyObject* keys_obj) {
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        return NULL;
+    }
+    k_t* key_buf = PyMem_Malloc(DELETE_CHUNK * sizeof(k_t));
+    uint32_t* hashes = PyMem_Malloc(DELETE_CHUNK * sizeof(uint32_t));
+    int32_t* found = PyMem_Malloc(DELETE_CHUNK * sizeof(int32_t));
+    if (key_buf == NULL || hashes == NULL || found == NULL) {
+        PyMem_Free(key_buf);
+        PyMem_Free(hashes);
+        PyMem_Free(found);
+        _keycol_release(&keys);
+        return PyErr_NoMemory();
+    }
+
+    h_t* h = self->ht;
+    uint64_t removed = 0;
+    self->accumulating = true;
+    for (Py_ssize_t start = 0; start < keys.len && !PyErr_Occurred(); start += DELETE_CHUNK) {
+        Py_ssize_t n = keys.len - start < DELETE_CHUNK ? keys.len - start : DELETE_CHUNK;
+        const k_t* chunk_keys = key_buf;
+#ifdef KEY_BUF_KIND
+        if (keys.data != NULL) {
+            chunk_keys = keys.data + start;
+        }
+#endif
+        for (Py_ssize_t i = 0; chunk_keys == key_buf && i < n; i++) {
+            if (_keycol_get(&keys, start + i, &key_buf[i]) == -1) {
+                n = i;
+                break;
+            }
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        _find_chunk(h, chunk_keys, n, hashes, found);
+        Py_END_ALLOW_THREADS
+        for (Py_ssize_t i = 0; i < n; i++) {
+            if (found[i] >= 0 && _bucket_is_live(h->flags, found[i])) {
+                mdict_remove_item(h, found[i]);
+                removed++;
+            }
+        }
+    }
+    if (removed > 0) {
+        mdict_compact(h);
+    }
+    self->accumulating = false;
+    PyMem_Free(key_buf);
+    PyMem_Free(hashes);
+    PyMem_Free(found);
+    _keycol_release(&keys);
+    return PyErr_Occurred() ? NULL : PyLong_FromUnsignedLongLong(removed);
+}
+
+// how accumulate() and the merges combine a new value with an existing one. Only REPLACE and KEEP
+// apply to values that aren't numeric
+enum { COMBINE_SUM, COMBINE_MIN, COMBINE_MAX, COMBINE_COUNT, COMBINE_REPLACE, COMBINE_KEEP };
+
+static const char* const COMBINE_NAMES[] = {"sum", "min", "max", "count", "replace", "keep"};
+
+/**
+ * Returns the COMBINE_ op called `name`, or -1 if there is none.
+ */
+static int _combine_from_name(const char* name) {
+    for (int op = COMBINE_SUM; op <= COMBINE_KEEP; op++) {
+        if (strcmp(name, COMBINE_NAMES[op]) == 0) {
+            return op;
+        }
+    }
+    return -1;
+}
+
+#ifdef VAL_BUF_KIND
+// accumulate() converts and probes this many rows at a time, which bounds its scratch space
+#define ACCUMULATE_CHUNK 4096
+// how many rows ahead accumulate() prefetches the table's flags and keys
+#define ACCUMULATE_PREFETCH 8
+
+#if VAL_BUF_KIND == 'f'
+#define COMBINE_IS_NAN(v) ((v) != (v))
+#else
+#define COMBINE_IS_NAN(v) false
+#endif
+
+static inline v_t _combine(int op, v_t acc, v_t val) {
+    switch (op) {
+        case COMBINE_REPLACE:
+            return val;
+        case COMBINE_KEEP:
+            return acc;
+        case COMBINE_MIN:
+            // NaNs are skipped, as in numpy.fmin
+            return (val < acc || COMBINE_IS_NAN(acc)) ? val : acc;
+        case COMBINE_MAX:
+            return (val > acc || COMBINE_IS_NAN(acc)) ? val : acc;
+        default:
+#if VAL_BUF_KIND == 'i'
+            // wraps around on overflow, like numpy
+            return (v_t) ((uint64_t) acc + (uint64_t) val);
+#else
+            return acc + val;
+#endif
+    }
+}
+
+/**
+ * Sets the entry for `key` to combine(op, old value, val), or to val if the key is missing. Returns
+ * false if memory runs out.
+ */
+static inline bool _upsert(h_t* h, int op, k_t key, v_t val) {
+    uint32_t idx;
+    int inserted = mdict_find_or_insert(h, key, &idx);
+    if (inserted != -1 && !_val_set(h, idx, inserted ? val : _combine(op, _val_get(h, idx), val))) {
+        if (inserted) {
+            // the key has no value, so take it back out
+            mdict_remove_item(h, idx);
+        }
+        inserted = -1;
+    }
+    return inserted != -1;
+}
+
+/**
+ * Applies rows [0, n) of a chunk to the keys that are already in the table, and returns the number of
+ * rows left over in `deferred`: those whose key is missing, or (for compact values) whose result
+ * doesn't fit the current width. This doesn't add keys or move any, so it runs without the GIL.
+ */
+static Py_ssize_t _accumulate_present(h_t* h, int op, const k_t* keys, const v_t* vals, Py_ssize_t n,
+                                      uint32_t* hashes, uint32_t* deferred) {
+    for (Py_ssize_t i = 0; i < n; i++) {
+        hashes[i] = mdict_hash(h, keys[i]);
+    }
+    Py_ssize_t num_deferred = 0;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (i + ACCUMULATE_PREFETCH < n) {
+            mdict_prefetch(h, hashes[i + ACCUMULATE_PREFETCH]);
+        }
+        int32_t idx = mdict_find_hashed(h, keys[i], hashes[i]);
+        if (idx < 0) {
+            deferred[num_deferred++] = (uint32_t) i;
+            continue;
+        }
+        v_t result = _combine(op, _val_get(h, idx), vals == NULL ? 1 : vals[i]);
+#ifdef VALS_COMPACT
+        if (_compact_width(result) > h->val_width) {
+            deferred[num_deferred++] = (uint32_t) i;
+            continue;
+        }
+#endif
+        _val_set(h, idx, result);
+    }
+    return num_deferred;
+}
+
+/**
+ * Invoked for dict.accumulate(keys, values, op="sum"), which combines each value into the entry for
+ * its key. Missing keys are inserted with the first value (or 1, for "count"). `op` is one of "sum",
+ * "min", "max" or "count", and `values` is ignored for "count". Each chunk of rows is converted with
+ * the GIL held, then applied to the keys already present with it released; the rest are inserted
+ * once it is reacquired. If a key or value can't be converted, the rows before it have been applied.
+ */
+static PyObject* accumulate(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"keys", "values", "op", NULL};
+    PyObject* keys_obj;
+    PyObject* values_obj = Py_None;
+    const char* op_name = "sum";
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Os", kwlist, &keys_obj, &values_obj, &op_name)) {
+        return NULL;
+    }
+    int op = _combine_from_name(op_name);
+    if (op == -1 || op > COMBINE_COUNT) {
+        PyErr_Format(PyExc_ValueError, "unknown op '%s', expected 'sum', 'min', 'max' or 'count'", op_name);
+        return NULL;
+    }
+    bool has_values = op != COMBINE_COUNT;
+    if (has_values && values_obj == Py_None) {
+        PyErr_SetString(PyExc_TypeError, "accumulate() needs values unless op is 'count'");
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        return NULL;
+    }
+    valcol_t vals;
+    if (has_values && _valcol_init(&vals, values_obj) == -1) {
+        _keycol_release(&keys);
+        return NULL;
+    }
+    bool ok = false;
+    k_t* key_buf = PyMem_Malloc(ACCUMULATE_CHUNK * sizeof(k_t));
+    v_t* val_buf = PyMem_Malloc(ACCUMULATE_CHUNK * sizeof(v_t));
+    uint32_t* hashes = PyMem_Malloc(ACCUMULATE_CHUNK * sizeof(uint32_t));
+    uint32_t* deferred = PyMem_Malloc(ACCUMULATE_CHUNK * sizeof(uint32_t));
+    if (key_buf == NULL || val_buf == NULL || hashes == NULL || deferred == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (has_values && keys.len != vals.len) {
+        PyErr_SetString(PyExc_ValueError, "keys and values must have the same length");
+        goto done;
+    }
+
+    h_t* h = self->ht;
+    self->accumulating = true;
+    for (Py_ssize_t start = 0; start < keys.len; start += ACCUMULATE_CHUNK) {
+        Py_ssize_t n = keys.len - start < ACCUMULATE_CHUNK ? keys.len - start : ACCUMULATE_CHUNK;
+        const k_t* chunk_keys = key_buf;
+        const v_t* chunk_vals = has_values ? val_buf : NULL;
+#ifdef KEY_BUF_KIND
+        if (keys.data != NULL) {
+            chunk_keys = keys.data + start;
+        }
+#endif
+        if (has_values && vals.data != NULL) {
+            chunk_vals = vals.data + start;
+        }
+        for (Py_ssize_t i = 0; i < n; i++) {
+            if ((chunk_vals == val_buf && _valcol_get(&vals, start + i, &val_buf[i]) == -1)
+                    || (chunk_keys == key_buf && _keycol_get(&keys, start + i, &key_buf[i]) == -1)) {
+                n = i;
+                break;
+            }
+        }
+
+        Py_ssize_t num_deferred;
+        Py_BEGIN_ALLOW_THREADS
+        num_deferred = _accumulate_present(h, op, chunk_keys, chunk_vals, n, hashes, deferred);
+        Py_END_ALLOW_THREADS
+
+        for (Py_ssize_t j = 0; j < num_deferred; j++) {
+            uint32_t i = deferred[j];
+            if (!_upsert(h, op, chunk_keys[i], chunk_vals == NULL ? 1 : chunk_vals[i])) {
+                PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+                self->accumulating = false;
+                goto done;
+            }
+        }
+        if (PyErr_Occurred()) {
+            self->accumulating = false;
+            goto done;
+        }
+    }
+    self->accumulating = false;
+    ok = true;
+
+done:
+    PyMem_Free(key_buf);
+    PyMem_Free(val_buf);
+    PyMem_Free(hashes);
+    PyMem_Free(deferred);
+    if (has_values) {
+        _valcol_release(&vals);
+    }
+    _keycol_release(&keys);
+    return ok ? Py_BuildValue("") : NULL;
+}
+
+/**
+ * True if value `a` comes strictly before `b` in most_common() order, or least_common() order if
+ * `most` is false. NaNs come after every other value either way, like numpy.sort puts them last.
+ */
+static inline bool _value_ranks_before(bool most, v_t a, v_t b) {
+    if (COMBINE_IS_NAN(a) || COMBINE_IS_NAN(b)) {
+        return !COMBINE_IS_NAN(a);
+    }
+    return most ? a > b : a < b;
+}
+
+/**
+ * Like _value_ranks_before for the values in two buckets, with ties going to the bucket that
+ * items() reaches first, so the ranking is the same as a stable sort of items().
+ */
+static inline bool _bucket_ranks_before(h_t* h, bool most, uint32_t a, uint32_t b) {
+    v_t va = _val_get(h, a);
+    v_t vb = _val_get(h, b);
+    if (_value_ranks_before(most, va, vb)) {
+        return true;
+    }
+    return !_value_ranks_before(most, vb, va) && a < b;
+}
+
+/**
+ * Moves heap[pos] down until it ranks before both of its children, in a heap of n buckets whose root
+ * is the one that ranks last.
+ */
+static void _rank_sift_down(h_t* h, bool most, uint32_t* heap, Py_ssize_t n, Py_ssize_t pos) {
+    while (2 * pos + 1 < n) {
+        Py_ssize_t child = 2 * pos + 1;
+        if (child + 1 < n && _bucket_ranks_before(h, most, heap[child], heap[child + 1])) {
+            child++;
+        }
+        if (!_bucket_ranks_before(h, most, heap[pos], heap[child])) {
+            return;
+        }
+        uint32_t tmp = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = tmp;
+        pos = child;
+    }
+}
+
+/**
+ * Selects the k buckets that rank first into heap[0, k), in order, and returns k (which is at
+ * most the size). The table is scanned once, keeping a heap of the best k buckets so far whose
+ * root is the worst of them; most buckets are rejected by comparing with the root's value.
+ */
+static Py_ssize_t _select_ranked(h_t* h, bool most, uint32_t* heap, Py_ssize_t k) {
+    Py_ssize_t n = 0;
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    v_t worst = 0;
+    while (mdict_cursor_next(h, &cursor, &i)) {
+        if (n < k) {
+            // sift up
+            Py_ssize_t pos = n++;
+            while (pos > 0 && _bucket_ranks_before(h, most, heap[(pos - 1) / 2], i)) {
+                heap[pos] = heap[(pos - 1) / 2];
+                pos = (pos - 1) / 2;
+            }
+            heap[pos] = i;
+            worst = _val_get(h, heap[0]);
+        } else if (_value_ranks_before(most, _val_get(h, i), worst)) {
+            // a tie with the root isn't enough, since the root was reached first
+            heap[0] = i;
+            _rank_sift_down(h, most, heap, n, 0);
+            worst = _val_get(h, heap[0]);
+        }
+    }
+    // heapsort: the root is the last of the remaining buckets
+    for (Py_ssize_t end = n - 1; end > 0; end--) {
+        uint32_t tmp = heap[0];
+        heap[0] = heap[end];
+        heap[end] = tmp;
+        _rank_sift_down(h, most, heap, end, 0);
+    }
+    return n;
+}
+
+static PyObject* _most_or_least_common(dictObj* self, PyObject* args, PyObject* kwargs, bool most) {
+    static char* kwlist[] = {"k", NULL};
+    PyObject* k_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &k_obj)) {
+        return NULL;
+    }
+    h_t* h = self->ht;
+    Py_ssize_t k = (Py_ssize_t) h->size;
+    if (k_obj != Py_None) {
+        Py_ssize_t requested = PyLong_AsSsize_t(k_obj);
+        if (requested == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        // a negative k gives an empty list, like Counter.most_common
+        k = requested < 0 ? 0 : (requested < k ? requested : k);
+    }
+    uint32_t* heap = (uint32_t*) PyMem_Malloc((k > 0 ? k : 1) * sizeof(uint32_t));
+    if (heap == NULL) {
+        return PyErr_NoMemory();
+    }
+    Py_ssize_t n = k > 0 ? _select_ranked(h, most, heap, k) : 0;
+    PyObject* res = PyList_New(n);
+    for (Py_ssize_t j = 0; res != NULL && j < n; j++) {
+        k_t key = KEY_GET(h->keys, heap[j]);
+        v_t val = _val_get(h, heap[j]);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        PyObject* item = key_obj == NULL ? NULL : pyconv_new_item(key_obj, PyLong_FromLong(val));
+        if (item == NULL) {
+            Py_CLEAR(res);
+            break;
+        }
+        PyList_SET_ITEM(res, j, item);
+    }
+    PyMem_Free(heap);
+    return res;
+}
+
+/**
+ * Returns the k entries with the largest values (or all of them if k is None) as (key, value)
+ * pairs, largest first. Only the winners are converted to Python objects.
+ */
+static PyObject* most_common(dictObj* self, PyObject* args, PyObject* kwargs) {
+    return _most_or_least_common(self, args, kwargs, true);
+}
+
+/**
+ * Like most_common(), with the smallest values first.
+ */
+static PyObject* least_common(dictObj* self, PyObject* args, PyObject* kwargs) {
+    return _most_or_least_common(self, args, kwargs, false);
+}
+
+// values_sum() and the other aggregations read the values a group of buckets at a time, into
+// GROUP_WIDTH lanes that are combined at the end. A group whose buckets are all live is a plain
+// loop over the lanes, which the compiler can vectorize; other groups add their live buckets one
+// at a time. Integer sums are exact: each lane counts the times it wrapped around in `sum_carry`.
+typedef struct {
+#if VAL_BUF_KIND == 'f'
+    double sum[GROUP_WIDTH];
+#else
+    int64_t sum[GROUP_WIDTH];
+    int64_t sum_carry[GROUP_WIDTH];
+#endif
+    v_t min[GROUP_WIDTH];
+    v_t max[GROUP_WIDTH];
+} value_lanes_t;
+
+typedef struct {
+#if VAL_BUF_KIND == 'f'
+    double sum;
+#else
+    int64_t sum;
+    int64_t sum_carry;  // the exact sum is sum_carry * 2**64 + sum
+#endif
+    v_t min;  // NaNs are skipped, as by accumulate(op="min")
+    v_t max;
+} value_stats_t;
+
+#if VAL_BUF_KIND == 'i'
+// Adds `v` to the 128-bit sum `*carry * 2**64 + *sum`
+static inline void _sum_add(int64_t* sum, int64_t* carry, int64_t v) {
+    int64_t s = (int64_t) ((uint64_t) *sum + (uint64_t) v);
+    // it wrapped around if `v` and the old sum have the same sign, and `s` has the other one
+    *carry += ((*sum ^ s) & (v ^ s)) < 0 ? (v < 0 ? -1 : 1) : 0;
+    *sum = s;
+}
+#endif
+
+static inline void _value_lanes_add(value_lanes_t* lanes, int j, v_t v) {
+#if VAL_BUF_KIND == 'f'
+    lanes->sum[j] += v;
+#else
+    _sum_add(&lanes->sum[j], &lanes->sum_carry[j], v);
+#endif
+    lanes->min[j] = _combine(COMBINE_MIN, lanes->min[j], v);
+    lanes->max[j] = _combine(COMBINE_MAX, lanes->max[j], v);
+}
+
+/**
+ * Computes the sum, min and max of the map's values in one pass.
+ */
+static void _value_stats(h_t* h, value_stats_t* out) {
+    value_lanes_t lanes;
+    for (int j = 0; j < GROUP_WIDTH; j++) {
+        lanes.sum[j] = 0;
+#if VAL_BUF_KIND == 'f'
+        lanes.min[j] = lanes.max[j] = NAN;
+#else
+        lanes.sum_carry[j] = 0;
+        lanes.min[j] = sizeof(v_t) == 4 ? INT32_MAX : INT64_MAX;
+        lanes.max[j] = sizeof(v_t) == 4 ? INT32_MIN : INT64_MIN;
+#endif
+    }
+    const gbits all_live = _group_mask_all_live();
+    for (uint32_t base = 0; base < h->num_buckets; base += GROUP_WIDTH) {
+        gbits live = _group_mask_full(_group_load(&h->flags[base >> 3]));
+        if (live == all_live) {
+            for (int j = 0; j < GROUP_WIDTH; j++) {
+                _value_lanes_add(&lanes, j, _val_get(h, base + j));
+            }
+        } else {
+            while (_gbits_has_next(live)) {
+                int j = _gbits_next(&live);
+                _value_lanes_add(&lanes, j, _val_get(h, base + j));
+            }
+        }
+    }
+    out->sum = lanes.sum[0];
+#if VAL_BUF_KIND == 'i'
+    out->sum_carry = lanes.sum_carry[0];
+#endif
+    out->min = lanes.min[0];
+    out->max = lanes.max[0];
+    for (int j = 1; j < GROUP_WIDTH; j++) {
+#if VAL_BUF_KIND == 'f'
+        out->sum += lanes.sum[j];
+#else
+        _sum_add(&out->sum, &out->sum_carry, lanes.sum[j]);
+        out->sum_carry += lanes.sum_carry[j];
+#endif
+        out->min = _combine(COMBINE_MIN, out->min, lanes.min[j]);
+        out->max = _combine(COMBINE_MAX, out->max, lanes.max[j]);
+    }
+}
+
+static PyObject* _value_sum_to_py(const value_stats_t* stats) {
+#if VAL_BUF_KIND == 'f'
+    return PyFloat_FromDouble(stats->sum);
+#else
+    if (stats->sum_carry == 0) {
+        return PyLong_FromLongLong(stats->sum);
+    }
+    PyObject* high = PyLong_FromLongLong(stats->sum_carry);
+    PyObject* low = PyLong_FromLongLong(stats->sum);
+    PyObject* shift = PyLong_FromLong(64);
+    PyObject* shifted = (high == NULL || shift == NULL) ? NULL : PyNumber_Lshift(high, shift);
+    PyObject* res = (shifted == NULL || low == NULL) ? NULL : PyNumber_Add(shifted, low);
+    Py_XDECREF(high);
+    Py_XDECREF(low);
+    Py_XDECREF(shift);
+    Py_XDECREF(shifted);
+    return res;
+#endif
+}
+
+/**
+ * Returns the sum of the values, like sum(dict.values()) but without a Python object per value.
+ * Integer sums are exact; float sums are added up in a different order, so the last bits may differ.
+ */
+static PyObject* values_sum(dictObj* self) {
+    value_stats_t stats;
+    _value_stats(self->ht, &stats);
+    return _value_sum_to_py(&stats);
+}
+
+static PyObject* _values_min_or_max(dictObj* self, bool is_max) {
+    if (self->ht->size == 0) {
+        PyErr_Format(PyExc_ValueError, "values_%s() of an empty map", is_max ? "max" : "min");
+        return NULL;
+    }
+    value_stats_t stats;
+    _value_stats(self->ht, &stats);
+    v_t val = is_max ? stats.max : stats.min;
+    return PyLong_FromLong(val);
+}
+
+/**
+ * Returns the smallest value, skipping NaNs (which are only returned if every value is NaN).
+ */
+static PyObject* values_min(dictObj* self) {
+    return _values_min_or_max(self, false);
+}
+
+/**
+ * Returns the largest value, skipping NaNs like values_min().
+ */
+static PyObject* values_max(dictObj* self) {
+    return _values_min_or_max(self, true);
+}
+
+/**
+ * Returns the mean of the values as a float. For integers this is the exact sum divided by the
+ * size, rounded once.
+ */
+static PyObject* values_mean(dictObj* self) {
+    h_t* h = self->ht;
+    if (h->size == 0) {
+        PyErr_SetString(PyExc_ValueError, "values_mean() of an empty map");
+        return NULL;
+    }
+    value_stats_t stats;
+    _value_stats(h, &stats);
+#if VAL_BUF_KIND == 'f'
+    return PyFloat_FromDouble(stats.sum / h->size);
+#else
+    PyObject* sum = _value_sum_to_py(&stats);
+    PyObject* size = PyLong_FromUnsignedLong(h->size);
+    PyObject* res = (sum == NULL || size == NULL) ? NULL : PyNumber_TrueDivide(sum, size);
+    Py_XDECREF(sum);
+    Py_XDECREF(size);
+    return res;
+#endif
+}
+
+/**
+ * Returns the bin of `x` among the `n` equal-width bins between edges[0] and edges[n], or -1 if
+ * it is outside of them. This follows numpy.histogram, including its fix-ups for rounding.
+ */
+static inline Py_ssize_t _histogram_bin_uniform(const double* edges, Py_ssize_t n, double x) {
+    double first = edges[0];
+    double last = edges[n];
+    if (!(x >= first && x <= last)) {
+        return -1;
+    }
+    Py_ssize_t bin = (Py_ssize_t) ((x - first) / (last - first) * n);
+    if (bin == n) {
+        bin--;
+    }
+    if (x < edges[bin]) {
+        bin--;
+    } else if (x >= edges[bin + 1] && bin != n - 1) {
+        bin++;
+    }
+    return bin;
+}
+
+/**
+ * Like _histogram_bin_uniform, for bins whose edges are only known to be increasing.
+ */
+static inline Py_ssize_t _histogram_bin_search(const double* edges, Py_ssize_t n, double x) {
+    if (!(x >= edges[0] && x <= edges[n])) {
+        return -1;
+    }
+    // the last edge that is <= x; the last bin also includes its right edge
+    Py_ssize_t lo = 0;
+    Py_ssize_t hi = n;
+    while (lo < hi) {
+        Py_ssize_t mid = lo + (hi - lo + 1) / 2;
+        if (edges[mid] <= x) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo == n ? n - 1 : lo;
+}
+
+/**
+ * Invoked for dict.values_histogram(bins=10, range=None), which returns (counts, edges) as
+ * numpy.histogram does for the values. `bins` is a number of equal-width bins between the range
+ * (by default, the smallest and largest values), or an increasing sequence of edges. Every bin
+ * includes its left edge, and the last one also includes its right edge. NaNs are not counted.
+ */
+static PyObject* values_histogram(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"bins", "range", NULL};
+    PyObject* bins_obj = NULL;
+    PyObject* range_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO", kwlist, &bins_obj, &range_obj)) {
+        return NULL;
+    }
+    h_t* h = self->ht;
+    Py_ssize_t n = 10;
+    bool uniform = bins_obj == NULL || PyIndex_Check(bins_obj);
+    PyObject* edges_arr;
+    Py_buffer edges_view;
+    if (uniform) {
+        if (bins_obj != NULL && (n = PyNumber_AsSsize_t(bins_obj, PyExc_OverflowError)) == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (n < 1) {
+            PyErr_SetString(PyExc_ValueError, "bins must be positive");
+            return NULL;
+        }
+        double first = 0;
+        double last = 1;
+        if (range_obj != Py_None) {
+            if (!PyArg_ParseTuple(range_obj, "dd", &first, &last)) {
+                return NULL;
+            }
+            if (first > last) {
+                PyErr_SetString(PyExc_ValueError, "max must be larger than min in range parameter");
+                return NULL;
+            }
+        } else if (h->size != 0) {
+            value_stats_t stats;
+            _value_stats(h, &stats);
+            first = stats.min;
+            last = stats.max;
+        }
+        if (!isfinite(first) || !isfinite(last)) {
+            PyErr_SetString(PyExc_ValueError, "the range of the bins must be finite");
+            return NULL;
+        }
+        if (first == last) {
+            first -= 0.5;
+            last += 0.5;
+        }
+        edges_arr = pyconv_new_array("float64", n + 1, &edges_view);
+        if (edges_arr == NULL) {
+            return NULL;
+        }
+        // the same edges as numpy.linspace(first, last, n + 1)
+        double* edges = (double*) edges_view.buf;
+        double step = (last - first) / n;
+        for (Py_ssize_t k = 0; k < n; k++) {
+            edges[k] = k * step + first;
+        }
+        edges[n] = last;
+        for (Py_ssize_t k = 0; k < n; k++) {
+            if (!(edges[k] < edges[k + 1])) {
+                PyBuffer_Release(&edges_view);
+                Py_DECREF(edges_arr);
+                PyErr_Format(PyExc_ValueError, "too many bins for the range of the data, can't make %zd of them", n);
+                return NULL;
+            }
+        }
+    } else {
+        if (range_obj != Py_None) {
+            PyErr_SetString(PyExc_TypeError, "range can only be given with a number of bins");
+            return NULL;
+        }
+        PyObject* dtype = PyUnicode_FromString("float64");
+        if (dtype == NULL) {
+            return NULL;
+        }
+        Py_buffer view;
+        bool ok = pyconv_typed_array(bins_obj, dtype, &view, 'f', sizeof(double), 1);
+        Py_DECREF(dtype);
+        if (!ok) {
+            return NULL;
+        }
+        n = view.len / (Py_ssize_t) sizeof(double) - 1;
+        const double* given = (const double*) view.buf;
+        ok = n >= 1;
+        for (Py_ssize_t k = 0; ok && k < n; k++) {
+            ok = given[k] <= given[k + 1];
+        }
+        if (!ok) {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "bins must be a positive number or at least 2 increasing edges");
+            return NULL;
+        }
+        edges_arr = pyconv_new_array("float64", n + 1, &edges_view);
+        if (edges_arr != NULL) {
+            memcpy(edges_view.buf, given, (n + 1) * sizeof(double));
+        }
+        PyBuffer_Release(&view);
+        if (edges_arr == NULL) {
+            return NULL;
+        }
+    }
+
+    Py_buffer counts_view;
+    PyObject* counts_arr = pyconv_new_array("int64", n, &counts_view);
+    if (counts_arr == NULL) {
+        PyBuffer_Release(&edges_view);
+        Py_DECREF(edges_arr);
+        return NULL;
+    }
+    const double* edges = (const double*) edges_view.buf;
+    int64_t* counts = (int64_t*) counts_view.buf;
+    memset(counts, 0, n * sizeof(int64_t));
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    while (mdict_cursor_next(h, &cursor, &i)) {
+        double x = (double) _val_get(h, i);
+        Py_ssize_t bin = uniform ? _histogram_bin_uniform(edges, n, x) : _histogram_bin_search(edges, n, x);
+        if (bin >= 0) {
+            counts[bin]++;
+        }
+    }
+    PyBuffer_Release(&edges_view);
+    PyBuffer_Release(&counts_view);
+    return pyconv_new_item(counts_arr, edges_arr);
+}
+
+enum { TRANSFORM_MUL, TRANSFORM_ADD, TRANSFORM_CLAMP, TRANSFORM_FLOOR };
+
+static const char* const TRANSFORM_NAMES[] = {"mul", "add", "clamp", "floor"};
+
+// An operation of transform_values(), with its operand: `a` for mul, add and floor (the step),
+// or the bounds `a` and `b` for clamp
+typedef struct {
+    int op;
+    v_t a;
+    v_t b;
+} transform_t;
+
+static inline v_t _transform_one(int op, transform_t t, v_t v) {
+    switch (op) {
+        case TRANSFORM_MUL:
+#if VAL_BUF_KIND == 'f'
+            return v * t.a;
+#else
+            // wraps around on overflow, like numpy
+            return (v_t) ((uint64_t) v * (uint64_t) t.a);
+#endif
+        case TRANSFORM_ADD:
+#if VAL_BUF_KIND == 'f'
+            return v + t.a;
+#else
+            return (v_t) ((uint64_t) v + (uint64_t) t.a);
+#endif
+        case TRANSFORM_CLAMP:
+            // NaNs compare false, so they stay NaN as in numpy.clip
+            return v < t.a ? t.a : (v > t.b ? t.b : v);
+        default: {
+#if VAL_BUF_KIND == 'f'
+            return floor(v / t.a) * t.a;
+#else
+            // the step is positive, so this is v - v % step with Python's sign rule for %
+            v_t rem = v % t.a;
+            return (v_t) ((uint64_t) v - (uint64_t) (rem < 0 ? rem + t.a : rem));
+#endif
+        }
+    }
+}
+
+/**
+ * Applies `op` to every value, a group of buckets at a time like _value_stats. This is inlined into
+ * _transform_values once per op, so that the loop over a whole group doesn't branch on it. `t` is
+ * passed by value, so the compiler can tell that storing a value doesn't change it. Returns false
+ * if memory runs out while widening compact values.
+ */
+static inline bool _transform_groups(h_t* h, int op, transform_t t) {
+#ifndef VALS_COMPACT
+    const gbits all_live = _group_mask_all_live();
+#endif
+    for (uint32_t base = 0; base < h->num_buckets; base += GROUP_WIDTH) {
+        gbits live = _group_mask_full(_group_load(&h->flags[base >> 3]));
+#ifndef VALS_COMPACT
+        if (live == all_live) {
+            v_t* vals = (v_t*) h->vals + base;
+            for (int j = 0; j < GROUP_WIDTH; j++) {
+                vals[j] = _transform_one(op, t, vals[j]);
+            }
+            continue;
+        }
+#endif
+        while (_gbits_has_next(live)) {
+            uint32_t i = base + (uint32_t) _gbits_next(&live);
+            if (!_val_set(h, i, _transform_one(op, t, _val_get(h, i)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool _transform_values(h_t* h, transform_t t) {
+    switch (t.op) {
+        case TRANSFORM_MUL:
+            return _transform_groups(h, TRANSFORM_MUL, t);
+        case TRANSFORM_ADD:
+            return _transform_groups(h, TRANSFORM_ADD, t);
+        case TRANSFORM_CLAMP:
+            return _transform_groups(h, TRANSFORM_CLAMP, t);
+        default:
+            return _transform_groups(h, TRANSFORM_FLOOR, t);
+    }
+}
+
+/**
+ * Converts an operand of transform_values() or retain_where() to a value. None gives `dfault`. Returns false with an
+ * exception set if it isn't a number of the map's value type, or doesn't fit it.
+ */
+static bool _value_operand(PyObject* obj, v_t dfault, v_t* out) {
+    if (obj == Py_None) {
+        *out = dfault;
+        return true;
+    }
+#if VAL_BUF_KIND == 'f'
+    double x = PyFloat_AsDouble(obj);
+    if (x == -1 && PyErr_Occurred()) {
+        return false;
+    }
+#else
+    if (!PyLong_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "expected an int operand for " VAL_DTYPE " values, not %s", Py_TYPE(obj)->tp_name);
+        return false;
+    }
+    long long x = PyLong_AsLongLong(obj);
+    if (x == -1 && PyErr_Occurred()) {
+        return false;
+    }
+    if ((long long) (v_t) x != x) {
+        PyErr_SetString(PyExc_OverflowError, "operand does not fit in " VAL_DTYPE);
+        return false;
+    }
+#endif
+    *out = (v_t) x;
+    return true;
+}
+
+/**
+ * Invoked for dict.transform_values(op, operand=None), which updates every value in place:
+ * "mul" and "add" multiply by or add the operand, "clamp" limits the values to the operand's
+ * (low, high) bounds (either of which may be None), and "floor" rounds them down to a multiple of
+ * the operand (1 by default). Integers wrap around on overflow, like numpy. The values are updated
+ * without the GIL, except compact ones, which may need widening.
+ */
+static PyObject* transform_values(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"op", "operand", NULL};
+    const char* op_name;
+    PyObject* operand = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|O", kwlist, &op_name, &operand)) {
+        return NULL;
+    }
+    transform_t t;
+    t.op = -1;
+    for (int op = TRANSFORM_MUL; op <= TRANSFORM_FLOOR; op++) {
+        if (strcmp(op_name, TRANSFORM_NAMES[op]) == 0) {
+            t.op = op;
+        }
+    }
+    if (t.op == -1) {
+        PyErr_Format(PyExc_ValueError, "unknown op '%s', expected 'mul', 'add', 'clamp' or 'floor'", op_name);
+        return NULL;
+    }
+    if (operand == Py_None && (t.op == TRANSFORM_MUL || t.op == TRANSFORM_ADD)) {
+        PyErr_Format(PyExc_TypeError, "transform_values() needs an operand for '%s'", op_name);
+        return NULL;
+    }
+    if (t.op == TRANSFORM_CLAMP) {
+        if (!PyTuple_Check(operand) || PyTuple_GET_SIZE(operand) != 2) {
+            PyErr_SetString(PyExc_TypeError, "clamp needs a (low, high) operand");
+            return NULL;
+        }
+        PyObject* low = PyTuple_GET_ITEM(operand, 0);
+        PyObject* high = PyTuple_GET_ITEM(operand, 1);
+#if VAL_BUF_KIND == 'f'
+        v_t lowest = -INFINITY;
+        v_t highest = INFINITY;
+#else
+        v_t lowest = sizeof(v_t) == 4 ? INT32_MIN : INT64_MIN;
+        v_t highest = sizeof(v_t) == 4 ? INT32_MAX : INT64_MAX;
+#endif
+        if (!_value_operand(low, lowest, &t.a) || !_value_operand(high, highest, &t.b)) {
+            return NULL;
+        }
+        if (!(t.a <= t.b)) {
+            PyErr_SetString(PyExc_ValueError, "clamp needs low <= high");
+            return NULL;
+        }
+    } else if (!_value_operand(operand, 1, &t.a)) {
+        return NULL;
+    }
+    if (t.op == TRANSFORM_FLOOR && !(t.a > 0)) {
+        PyErr_SetString(PyExc_ValueError, "floor needs a positive step");
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    bool ok;
+    self->accumulating = true;
+#ifdef VALS_COMPACT
+    // widening reallocates the values array, which other threads could be reading
+    ok = _transform_values(self->ht, t);
+#else
+    Py_BEGIN_ALLOW_THREADS
+    ok = _transform_values(self->ht, t);
+    Py_END_ALLOW_THREADS
+#endif
+    self->accumulating = false;
+    if (!ok) {
+        return PyErr_NoMemory();
+    }
+    return Py_BuildValue("");
+}
+
+/**
+ * Multiplies every value by `factor` (rounding toward zero for integers), and deletes the entries
+ * whose value is then below `threshold`, tidying the table once at the end. Returns how many were
+ * deleted.
+ */
+static uint32_t _decay_and_prune(h_t* h, double factor, double threshold) {
+    uint32_t removed = 0;
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    while (mdict_cursor_next(h, &cursor, &i)) {
+        // a factor in [0, 1] keeps the product in range, and compact values never need widening
+        v_t val = _val_get(h, i);
+        if (factor != 1) {
+            // (double) INT64_MAX rounds up, so a factor of 1 could overflow
+            val = (v_t) (val * factor);
+        }
+        if (val < threshold) {
+            mdict_remove_item(h, i);
+            removed++;
+        } else {
+            _val_set(h, i, val);
+        }
+    }
+    mdict_compact(h);
+    return removed;
+}
+
+/**
+ * Invoked for dict.decay_and_prune(factor, threshold), which multiplies every value by `factor`
+ * (between 0 and 1; integers are rounded toward zero) and deletes the entries that end up below
+ * `threshold`, in one pass. Returns the number of entries deleted.
+ */
+static PyObject* decay_and_prune(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"factor", "threshold", NULL};
+    double factor;
+    double threshold;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "dd", kwlist, &factor, &threshold)) {
+        return NULL;
+    }
+    if (!(factor >= 0 && factor <= 1)) {
+        PyErr_SetString(PyExc_ValueError, "factor must be between 0 and 1");
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    // the GIL stays held: removing frees keys, and mdict_compact may replace the arrays, while
+    // other threads could be reading them
+    return PyLong_FromUnsignedLong(_decay_and_prune(self->ht, factor, threshold));
+}
+
+enum { COMPARE_LT, COMPARE_LE, COMPARE_GT, COMPARE_GE, COMPARE_EQ, COMPARE_NE };
+
+static const char* const COMPARE_NAMES[] = {"<", "<=", ">", ">=", "==", "!="};
+
+static inline bool _compare_values(int op, v_t a, v_t b) {
+    switch (op) {
+        case COMPARE_LT:
+            return a < b;
+        case COMPARE_LE:
+            return a <= b;
+        case COMPARE_GT:
+            return a > b;
+        case COMPARE_GE:
+            return a >= b;
+        case COMPARE_EQ:
+            return a == b;
+        default:
+            return a != b;
+    }
+}
+
+/**
+ * Deletes the entries whose value isn't `op` threshold, then tidies the table once with
+ * mdict_compact. Returns how many were deleted.
+ */
+static uint32_t _retain_where(h_t* h, int op, v_t threshold) {
+    uint32_t removed = 0;
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    while (mdict_cursor_next(h, &cursor, &i)) {
+        if (!_compare_values(op, _val_get(h, i), threshold)) {
+            mdict_remove_item(h, i);
+            removed++;
+        }
+    }
+    mdict_compact(h);
+    return removed;
+}
+
+/**
+ * Invoked for dict.retain_where(op, threshold), which keeps the entries whose value compares to
+ * `threshold` with `op` ("<", "<=", ">", ">=", "==" or "!=") and deletes the rest. As in Python,
+ * NaNs only satisfy "!=". Returns the number of entries deleted.
+ */
+static PyObject* retain_where(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"op", "threshold", NULL};
+    const char* op_name;
+    PyObject* threshold_obj;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO", kwlist, &op_name, &threshold_obj)) {
+        return NULL;
+    }
+    int op = -1;
+    for (int candidate = COMPARE_LT; candidate <= COMPARE_NE; candidate++) {
+        if (strcmp(op_name, COMPARE_NAMES[candidate]) == 0) {
+            op = candidate;
+        }
+    }
+    if (op == -1) {
+        PyErr_Format(PyExc_ValueError, "unknown op '%s', expected '<', '<=', '>', '>=', '==' or '!='", op_name);
+        return NULL;
+    }
+    v_t threshold;
+    if (threshold_obj == Py_None) {
+        PyErr_SetString(PyExc_TypeError, "retain_where() needs a threshold");
+        return NULL;
+    }
+    if (!_value_operand(threshold_obj, 0, &threshold) || !_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    // the GIL stays held: removing frees keys and values, and mdict_compact may replace the arrays,
+    // while other threads could be reading them
+    return PyLong_FromUnsignedLong(_retain_where(self->ht, op, threshold));
+}
+
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES || KEY_TYPE_TAG == TYPE_TAG_I64 || KEY_TYPE_TAG == TYPE_TAG_I32
+#define KEYS_TEXT
+#endif
+
+#ifdef KEYS_TEXT
+#include "tokenize.h"
+#include "tsv.h"
+#include "utf8.h"
+
+// Results of the text loaders below. They run without the GIL, so they can't raise; on failure,
+// the span of the text that caused it is stored for _raise_load_error
+enum { LOAD_OK, LOAD_NO_MEMORY, LOAD_BAD_UTF8, LOAD_BAD_LINE };
+
+typedef struct {
+    size_t offset;
+    size_t len;
+} load_error_t;
+
+/**
+ * Sets the exception for a failed text loader. `base` is the offset of `text` in the input.
+ */
+static void _raise_load_error(int status, const char* text, size_t base, const load_error_t* err) {
+    if (status == LOAD_NO_MEMORY) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+    } else if (status == LOAD_BAD_UTF8) {
+        // decoded again for the standard error message
+        PyObject* decoded = PyUnicode_DecodeUTF8(text + err->offset, err->len, NULL);
+        if (decoded != NULL) {
+            Py_DECREF(decoded);
+            PyErr_Format(PyExc_ValueError, "invalid UTF-8 at byte %zu", base + err->offset);
+        }
+    } else {
+        PyObject* line = PyBytes_FromStringAndSize(text + err->offset, err->len < 80 ? err->len : 80);
+        if (line != NULL) {
+            PyErr_Format(PyExc_ValueError, "malformed line at byte %zu: %R", base + err->offset, line);
+            Py_DECREF(line);
+        }
+    }
+}
+
+#if (KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES) && VAL_BUF_KIND == 'i'
+/**
+ * Sets up the tokenizer for a delimiters argument, which is released here, or the default
+ * b" \t\n" if it wasn't given. Returns false with an exception set if it can't be used.
+ */
+static bool _tokenizer_from_py(tokenizer_t* tokenizer, Py_buffer* delims_view) {
+    if (delims_view->obj != NULL) {
+        tokenizer_init(tokenizer, (const uint8_t*) delims_view->buf, delims_view->len);
+        PyBuffer_Release(delims_view);
+    } else {
+        tokenizer_init(tokenizer, (const uint8_t*) " \t\n", 3);
+    }
+#if KEY_TYPE_TAG == TYPE_TAG_STR
+    for (int c = 0x80; c < 256; c++) {
+        if (tokenizer->is_delim[c]) {
+            PyErr_SetString(PyExc_ValueError, "the delimiters must be ASCII, so that tokens are valid UTF-8");
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+/**
+ * Stores the span of the first token in buf[0:len] that isn't valid UTF-8 in `err`, and returns
+ * false, or returns true if there is none. The delimiters are ASCII, so that is the case exactly
+ * when the whole buffer is valid, which is checked first.
+ */
+static bool _tokens_are_utf8(const tokenizer_t* tokenizer, const uint8_t* buf, size_t len, load_error_t* err) {
+    if (utf8_is_valid(buf, len)) {
+        return true;
+    }
+    size_t pos = tokenizer_skip_delims(tokenizer, buf, 0, len);
+    while (pos < len) {
+        size_t end = tokenizer_find_delim(tokenizer, buf, pos, len);
+        if (!utf8_is_valid(buf + pos, end - pos)) {
+            err->offset = pos;
+            err->len = end - pos;
+            return false;
+        }
+        pos = tokenizer_skip_delims(tokenizer, buf, end, len);
+    }
+    err->offset = 0;
+    err->len = len;
+    return false;
+}
+
+/**
+ * Adds 1 to the count of each token in buf[0:len], and adds the number of tokens to *num_tokens.
+ * With `check_utf8` (for str keys), the buffer is validated before anything is counted, so that a
+ * failed call leaves the map unchanged.
+ */
+static int _count_tokens_into(h_t* h, const tokenizer_t* tokenizer, const uint8_t* buf, size_t len,
+                              bool lowercase, bool check_utf8, Py_ssize_t* num_tokens, load_error_t* err) {
+    if (check_utf8 && !_tokens_are_utf8(tokenizer, buf, len, err)) {
+        return LOAD_BAD_UTF8;
+    }
+    char* folded = NULL;
+    size_t folded_cap = 0;
+    int status = LOAD_OK;
+    size_t pos = tokenizer_skip_delims(tokenizer, buf, 0, len);
+    while (pos < len) {
+        size_t end = tokenizer_find_delim(tokenizer, buf, pos, len);
+        k_t key;
+        key.ptr = (const char*) buf + pos;
+        key.len = end - pos;
+        if (lowercase) {
+            if (key.len > folded_cap) {
+                folded_cap = key.len > 2 * folded_cap ? key.len : 2 * folded_cap;
+                free(folded);
+                folded = malloc(folded_cap);
+                if (folded == NULL) {
+                    status = LOAD_NO_MEMORY;
+                    break;
+                }
+            }
+            for (size_t i = 0; i < key.len; i++) {
+                char c = key.ptr[i];
+                folded[i] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+            }
+            key.ptr = folded;
+        }
+        if (!_upsert(h, COMBINE_SUM, key, 1)) {
+            status = LOAD_NO_MEMORY;
+            break;
+        }
+        (*num_tokens)++;
+        pos = tokenizer_skip_delims(tokenizer, buf, end, len);
+    }
+    free(folded);
+    return status;
+}
+
+/**
+ * Invoked for dict.count_tokens(text, delimiters=b" \t\n", lowercase=False), which adds 1 to the
+ * count of each token in `text`, a str or bytes-like object. The tokens are the non-empty runs of
+ * bytes between delimiters, and each one is counted straight from the buffer, without creating a
+ * Python object. `lowercase` only folds ASCII letters. For str keys, a bytes-like `text` must be
+ * UTF-8, and the delimiters ASCII. Returns the number of tokens.
+ */
+static PyObject* count_tokens(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"text", "delimiters", "lowercase", NULL};
+    PyObject* text_obj;
+    Py_buffer delims_view = {0};
+    int lowercase = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|y*p", kwlist, &text_obj, &delims_view, &lowercase)) {
+        return NULL;
+    }
+    tokenizer_t tokenizer;
+    if (!_tokenizer_from_py(&tokenizer, &delims_view)) {
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+
+    Py_buffer text_view = {0};
+    const uint8_t* buf;
+    size_t len;
+    bool check_utf8 = false;
+    if (PyUnicode_Check(text_obj)) {
+        Py_ssize_t text_len;
+        buf = (const uint8_t*) PyUnicode_AsUTF8AndSize(text_obj, &text_len);
+        if (buf == NULL) {
+            return NULL;
+        }
+        len = text_len;
+    } else {
+        if (PyObject_GetBuffer(text_obj, &text_view, PyBUF_SIMPLE) == -1) {
+            return NULL;
+        }
+        buf = (const uint8_t*) text_view.buf;
+        len = text_view.len;
+        check_utf8 = KEY_TYPE_TAG == TYPE_TAG_STR;
+    }
+
+    Py_ssize_t num_tokens = 0;
+    load_error_t err = {0, 0};
+    int status = _count_tokens_into(self->ht, &tokenizer, buf, len, lowercase, check_utf8, &num_tokens, &err);
+    if (status != LOAD_OK) {
+        _raise_load_error(status, (const char*) buf, 0, &err);
+    }
+    if (text_view.obj != NULL) {
+        PyBuffer_Release(&text_view);
+    }
+    return status == LOAD_OK ? PyLong_FromSsize_t(num_tokens) : NULL;
+}
+#endif
+
+/**
+ * Parses a value field for the text loaders, which must hold exactly one number in range.
+ */
+static inline bool _val_from_text(const char* buf, size_t len, v_t* out) {
+#if VAL_BUF_KIND == 'f'
+    double d;
+    if (!tsv_parse_double(buf, len, &d)) {
+        return false;
+    }
+    *out = (v_t) d;
+#else
+    int64_t i;
+    if (!tsv_parse_int64(buf, len, &i) || (int64_t) (v_t) i != i) {
+        return false;
+    }
+    *out = (v_t) i;
+#endif
+    return true;
+}
+
+/**
+ * Parses a key field for the text loaders: str keys must be UTF-8, and int keys one number in range.
+ * Returns LOAD_OK or the reason it can't be used.
+ */
+static inline int _key_from_text(const char* buf, size_t len, k_t* out) {
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES
+#if KEY_TYPE_TAG == TYPE_TAG_STR
+    if (!utf8_is_valid((const uint8_t*) buf, len)) {
+        return LOAD_BAD_UTF8;
+    }
+#endif
+    out->ptr = buf;
+    out->len = len;
+#else
+    int64_t i;
+    if (!tsv_parse_int64(buf, len, &i) || (int64_t) (k_t) i != i) {
+        return LOAD_BAD_LINE;
+    }
+    *out = (k_t) i;
+#endif
+    return LOAD_OK;
+}
+
+/**
+ * Sets an entry for each line "key<sep>value" of buf[0:len], where a later line for the same key
+ * replaces an earlier one. Lines end at '\n', with an optional '\r' before it, and empty lines are
+ * skipped. The key is everything before the first `sep`.
+ */
+static int _load_tsv_into(h_t* h, const char* buf, size_t len, char sep, load_error_t* err) {
+    size_t pos = 0;
+    while (pos < len) {
+        const char* newline = memchr(buf + pos, '\n', len - pos);
+        size_t next = newline == NULL ? len : (size_t) (newline - buf) + 1;
+        size_t end = newline == NULL ? len : next - 1;
+        if (end > pos && buf[end - 1] == '\r') {
+            end--;
+        }
+        if (end == pos) {
+            pos = next;
+            continue;
+        }
+        err->offset = pos;
+        err->len = end - pos;
+        const char* tab = memchr(buf + pos, sep, end - pos);
+        if (tab == NULL) {
+            return LOAD_BAD_LINE;
+        }
+        v_t val;
+        if (!_val_from_text(tab + 1, buf + end - (tab + 1), &val)) {
+            return LOAD_BAD_LINE;
+        }
+        k_t key;
+        int status = _key_from_text(buf + pos, tab - (buf + pos), &key);
+        if (status != LOAD_OK) {
+            err->len = status == LOAD_BAD_UTF8 ? (size_t) (tab - (buf + pos)) : err->len;
+            return status;
+        }
+        if (!_upsert(h, COMBINE_REPLACE, key, val)) {
+            return LOAD_NO_MEMORY;
+        }
+        pos = next;
+    }
+    return LOAD_OK;
+}
+
+
+/**
+ * Checks the sep argument of the TSV methods. Returns false with an exception set if it can't be used.
+ */
+static bool _tsv_sep(const char* sep_str, Py_ssize_t sep_len, char* sep) {
+    if (sep_len != 1 || sep_str[0] == '\n' || sep_str[0] == '\r') {
+        PyErr_SetString(PyExc_ValueError, "sep must be a single ASCII character other than '\\n' or '\\r'");
+        return false;
+    }
+    *sep = sep_str[0];
+    return true;
+}
+
+/**
+ * Parses the path and sep arguments of load_tsv and dump_tsv. Returns false with an exception set if
+ * they can't be used; otherwise *path must be released by the caller.
+ */
+static bool _tsv_args(PyObject* args, PyObject* kwargs, PyObject** path, char* sep) {
+    static char* kwlist[] = {"path", "sep", NULL};
+    const char* sep_str = "\t";
+    Py_ssize_t sep_len = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O&|s#", kwlist, PyUnicode_FSConverter, path, &sep_str, &sep_len)) {
+        return false;
+    }
+    if (!_tsv_sep(sep_str, sep_len, sep)) {
+        Py_DECREF(*path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Invoked for dict.load_tsv(path, sep="\t"), which sets an entry for each "key<sep>value" line of
+ * the file, with the same rules as ingest_file(mode="tsv"). The file is read TSV_CHUNK bytes at a
+ * time, and before the first chunk is parsed, the table is grown for the number of lines in the
+ * file, estimated from that chunk. If a line can't be used, the ValueError gives its byte offset,
+ * and the lines before it have been loaded.
+ */
+static PyObject* load_tsv(dictObj* self, PyObject* args, PyObject* kwargs) {
+    PyObject* path;
+    char sep;
+
+    if (!_tsv_args(args, kwargs, &path, &sep)) {
+        return NULL;
+    }
+    if (!_check_not_accumulating(self)) {
+        Py_DECREF(path);
+        return NULL;
+    }
+    FILE* fp = fopen(PyBytes_AS_STRING(path), "rb");
+    if (fp == NULL) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+        Py_DECREF(path);
+        return NULL;
+    }
+    struct stat st;
+    uint64_t file_size = fstat(fileno(fp), &st) == 0 ? (uint64_t) st.st_size : 0;
+
+    h_t* h = self->ht;
+    size_t cap = TSV_CHUNK;
+    char* buf = malloc(cap);
+    size_t len = 0;  // bytes in buf, which starts at byte `base` of the file
+    size_t base = 0;
+    bool first = true;
+    bool eof = false;
+    bool io_error = false;
+    int status = buf == NULL ? LOAD_NO_MEMORY : LOAD_OK;
+    load_error_t err = {0, 0};
+    while (status == LOAD_OK && !eof) {
+        if (len == cap) {
+            // a line longer than the buffer
+            char* bigger = realloc(buf, 2 * cap);
+            if (bigger == NULL) {
+                status = LOAD_NO_MEMORY;
+                break;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+        size_t n = fread(buf + len, 1, cap - len, fp);
+        if (n < cap - len) {
+            io_error = ferror(fp);
+            eof = true;
+        }
+        len += n;
+        if (io_error) {
+            break;
+        }
+        if (first && len > 0) {
+            first = false;
+            uint64_t lines = 1;
+            for (size_t i = 0; i < len; i++) {
+                lines += buf[i] == '\n';
+            }
+            uint64_t estimate = eof || file_size < len ? lines : lines * (file_size / len) + lines;
+            uint64_t room = UINT32_MAX / 2 - h->size;
+            if (!mdict_reserve(h, h->size + (uint32_t) (estimate < room ? estimate : room))) {
+                status = LOAD_NO_MEMORY;
+                break;
+            }
+        }
+
+        size_t complete = len;
+        if (!eof) {
+            while (complete > 0 && buf[complete - 1] != '\n') {
+                complete--;
+            }
+        }
+        status = _load_tsv_into(h, buf, complete, sep, &err);
+        memmove(buf, buf + complete, len - complete);
+        base += status == LOAD_OK ? complete : 0;
+        len -= status == LOAD_OK ? complete : 0;
+    }
+    fclose(fp);
+
+    if (io_error) {
+        errno = EIO;
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+    } else if (status != LOAD_OK) {
+        _raise_load_error(status, buf, base, &err);
+    }
+    free(buf);
+    Py_DECREF(path);
+    return io_error || status != LOAD_OK ? NULL : Py_BuildValue("");
+}
+
+/**
+ * Writes the entries in buckets order[0, h->size) to `path` as "key<sep>value" lines, or every
+ * entry in iteration order if `order` is NULL. Floats are written with the fewest digits that
+ * round-trip. The lines are built in a TSV_CHUNK buffer, straight from the slot arrays. Returns
+ * false with an exception set on failure.
+ */
+static bool _write_tsv(h_t* h, PyObject* path, char sep, const uint32_t* order) {
+#ifdef KEYS_POINT
+    // checked first, so that a bad key doesn't leave a partial file
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            k_t key = KEY_GET(h->keys, i);
+            if (memchr(key.ptr, sep, key.len) != NULL || memchr(key.ptr, '\n', key.len) != NULL) {
+                PyErr_SetString(PyExc_ValueError, "can't write a key that contains sep or a newline");
+                return false;
+            }
+        }
+    }
+#endif
+    tsv_writer_t w;
+    w.fp = fopen(PyBytes_AS_STRING(path), "wb");
+    if (w.fp == NULL) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+        return false;
+    }
+    w.buf = malloc(TSV_CHUNK);
+    w.len = 0;
+    w.failed = false;
+    if (w.buf == NULL) {
+        fclose(w.fp);
+        PyErr_NoMemory();
+        return false;
+    }
+
+    char number[TSV_NUMBER_MAX];
+    mdict_cursor_t cursor = {0, 0};
+    for (uint32_t n = 0; n < h->size; n++) {
+        uint32_t i = 0;
+        if (order != NULL) {
+            i = order[n];
+        } else {
+            mdict_cursor_next(h, &cursor, &i);
+        }
+#ifdef KEYS_POINT
+        k_t key = KEY_GET(h->keys, i);
+        tsv_write(&w, key.ptr, key.len);
+#else
+        tsv_write(&w, number, tsv_format_int64(number, KEY_GET(h->keys, i)));
+#endif
+        tsv_write(&w, &sep, 1);
+#if VAL_BUF_KIND == 'f'
+        tsv_write(&w, number, tsv_format_double(number, _val_get(h, i), sizeof(v_t) == sizeof(float)));
+#else
+        tsv_write(&w, number, tsv_format_int64(number, _val_get(h, i)));
+#endif
+        tsv_write(&w, "\n", 1);
+    }
+    tsv_flush(&w);
+    if (fclose(w.fp) != 0) {
+        w.failed = true;
+    }
+    free(w.buf);
+    if (w.failed) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+    }
+    return !w.failed;
+}
+
+/**
+ * Invoked for dict.dump_tsv(path, sep="\t"), which writes each entry as a "key<sep>value" line, in
+ * iteration order, so that load_tsv reads it back.
+ */
+static PyObject* dump_tsv(dictObj* self, PyObject* args, PyObject* kwargs) {
+    PyObject* path;
+    char sep;
+
+    if (!_tsv_args(args, kwargs, &path, &sep)) {
+        return NULL;
+    }
+    bool ok = _write_tsv(self->ht, path, sep, NULL);
+    Py_DECREF(path);
+    return ok ? Py_BuildValue("") : NULL;
+}
+#endif
+#endif
+
+#include "sort.h"
+
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES || KEY_TYPE_TAG == TYPE_TAG_FIXED
+#define KEYS_SORT_BYTES
+#endif
+#if VAL_TYPE_TAG == TYPE_TAG_STR || VAL_TYPE_TAG == TYPE_TAG_BYTES
+#define VALS_SORT_BYTES
+#endif
+
+#if defined(KEYS_SORT_BYTES) || defined(VALS_SORT_BYTES)
+/**
+ * Returns the bytes that bucket `i` is sorted by, for keys or values that sort as strings.
+ */
+static inline str_t _sort_bytes_of(h_t* h, bool by_value, uint32_t i) {
+#ifdef VALS_SORT_BYTES
+    if (by_value) {
+        return _val_get(h, i);
+    }
+#endif
+    str_t s = {EMPTY_STR, 0};
+#if KEY_TYPE_TAG == TYPE_TAG_FIXED
+    s.ptr = KEY_GET(h->keys, i);
+    s.len = KEY_FIXED_WIDTH;
+#elif defined(KEYS_SORT_BYTES)
+    s = KEY_GET(h->keys, i);
+#endif
+    return s;
+}
+#endif
+
+/**
+ * Returns the sort key of bucket `i` for keys or values that sort as numbers. Pair keys sort like
+ * tuples, so the first radix pass (word 0) goes by `b` and the second by `a`.
+ */
+static inline uint64_t _sort_number_of(h_t* h, bool by_value, bool reverse, uint32_t i, int word) {
+#ifdef VAL_BUF_KIND
+    if (by_value) {
+#if VAL_BUF_KIND == 'f'
+        return sort_key_double(_val_get(h, i), reverse);
+#else
+        return sort_key_int(_val_get(h, i), reverse);
+#endif
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_PAIR
+    k_t key = KEY_GET(h->keys, i);
+    return sort_key_int(word == 0 ? key.b : key.a, reverse);
+#elif KEY_TYPE_TAG == TYPE_TAG_I64 || KEY_TYPE_TAG == TYPE_TAG_I32
+    return sort_key_int(KEY_GET(h->keys, i), reverse);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Sets order[0, size) to the live buckets, sorted by key or by value. Equal values keep the order of
+ * items() in either direction, as with sorted(). Returns false if memory runs out.
+ */
+static bool _sorted_buckets(h_t* h, bool by_value, bool reverse, uint32_t* order) {
+    size_t n = h->size;
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+#if defined(KEYS_SORT_BYTES) || defined(VALS_SORT_BYTES)
+    bool as_bytes = false;
+#ifdef KEYS_SORT_BYTES
+    as_bytes = as_bytes || !by_value;
+#endif
+#ifdef VALS_SORT_BYTES
+    as_bytes = as_bytes || by_value;
+#endif
+    if (as_bytes) {
+        // contained strings are read in place, from the slot array
+        sort_str_t* strs = (sort_str_t*) malloc(2 * n * sizeof(sort_str_t) + 1);
+        if (strs == NULL) {
+            return false;
+        }
+        for (size_t j = 0; mdict_cursor_next(h, &cursor, &i); j++) {
+            str_t s = _sort_bytes_of(h, by_value, i);
+            strs[j].ptr = (const uint8_t*) s.ptr;
+            strs[j].len = (uint32_t) s.len;
+            strs[j].idx = i;
+        }
+        sort_strings(strs, strs + n, n, 0, reverse);
+        for (size_t j = 0; j < n; j++) {
+            order[j] = strs[j].idx;
+        }
+        free(strs);
+        return true;
+    }
+#endif
+    uint64_t* keys = (uint64_t*) malloc(2 * n * sizeof(uint64_t) + 1);
+    uint32_t* order_tmp = (uint32_t*) malloc(n * sizeof(uint32_t) + 1);
+    if (keys == NULL || order_tmp == NULL) {
+        free(keys);
+        free(order_tmp);
+        return false;
+    }
+    for (size_t j = 0; mdict_cursor_next(h, &cursor, &i); j++) {
+        order[j] = i;
+    }
+    int words = (KEY_TYPE_TAG == TYPE_TAG_PAIR && !by_value) ? 2 : 1;
+    for (int word = 0; word < words; word++) {
+        for (size_t j = 0; j < n; j++) {
+            keys[j] = _sort_number_of(h, by_value, reverse, order[j], word);
+        }
+        sort_u64(keys, order, keys + n, order_tmp, n);
+    }
+    free(keys);
+    free(order_tmp);
+    return true;
+}
+
+/**
+ * Returns the keys of buckets order[0, n) as a numpy array for integer keys (with 2 columns for
+ * pairs), or a list.
+ */
+static PyObject* _keys_column(h_t* h, const uint32_t* order, Py_ssize_t n) {
+#ifdef KEY_DTYPE
+    Py_buffer view;
+#if KEY_BUF_COLS == 1
+    PyObject* res = pyconv_new_array(KEY_DTYPE, n, &view);
+#else
+    PyObject* dtype = PyUnicode_FromString(KEY_DTYPE);
+    PyObject* res = dtype == NULL ? NULL : pyconv_new_matrix_of(dtype, n, KEY_BUF_COLS, &view);
+    Py_XDECREF(dtype);
+#endif
+    if (res == NULL) {
+        return NULL;
+    }
+    k_t* out = (k_t*) view.buf;
+    for (Py_ssize_t j = 0; j < n; j++) {
+        out[j] = KEY_GET(h->keys, order[j]);
+    }
+    PyBuffer_Release(&view);
+    return res;
+#else
+    PyObject* res = PyList_New(n);
+    for (Py_ssize_t j = 0; res != NULL && j < n; j++) {
+        k_t key = KEY_GET(h->keys, order[j]);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        if (key_obj == NULL) {
+            Py_CLEAR(res);
+            break;
+        }
+        PyList_SET_ITEM(res, j, key_obj);
+    }
+    return res;
+#endif
+}
+
+/**
+ * Returns the values of buckets order[0, n) as a numpy array for numeric values, or a list.
+ */
+static PyObject* _values_column(h_t* h, const uint32_t* order, Py_ssize_t n) {
+#ifdef VAL_BUF_KIND
+    Py_buffer view;
+    PyObject* res = pyconv_new_array(VAL_DTYPE, n, &view);
+    if (res == NULL) {
+        return NULL;
+    }
+    v_t* out = (v_t*) view.buf;
+    for (Py_ssize_t j = 0; j < n; j++) {
+        out[j] = _val_get(h, order[j]);
+    }
+    PyBuffer_Release(&view);
+    return res;
+#else
+    PyObject* res = PyList_New(n);
+    for (Py_ssize_t j = 0; res != NULL && j < n; j++) {
+        v_t val = _val_get(h, order[j]);
+        PyObject* val_obj = PyLong_FromLong(val);
+        if (val_obj == NULL) {
+            Py_CLEAR(res);
+            break;
+        }
+        PyList_SET_ITEM(res, j, val_obj);
+    }
+    return res;
+#endif
+}
+
+/**
+ * Invoked for dict.sorted_items(by="key", reverse=False, path=None, sep="\t"), which returns the keys
+ * and values sorted by `by` as two columns: numpy arrays for integer keys and numeric values, and
+ * lists otherwise. The buckets are radix sorted in C (see sort.h), and only the output is converted.
+ * Strings sort by their UTF-8 bytes, which is the same as code point order. If `path` is given, the
+ * entries are written to it as lines like those of dump_tsv instead, and None is returned.
+ */
+static PyObject* sorted_items(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"by", "reverse", "path", "sep", NULL};
+    const char* by = "key";
+    int reverse = 0;
+    PyObject* path_obj = Py_None;
+    const char* sep_str = "\t";
+    Py_ssize_t sep_len = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|spOs#", kwlist, &by, &reverse, &path_obj, &sep_str, &sep_len)) {
+        return NULL;
+    }
+    bool by_value = strcmp(by, "value") == 0;
+    if (!by_value && strcmp(by, "key") != 0) {
+        PyErr_Format(PyExc_ValueError, "unknown sort '%s', expected 'key' or 'value'", by);
+        return NULL;
+    }
+#if !defined(VAL_BUF_KIND) && !defined(VALS_SORT_BYTES)
+    if (by_value) {
+        PyErr_SetString(PyExc_TypeError, "only numeric, str and bytes values can be sorted");
+        return NULL;
+    }
+#endif
+    PyObject* path = NULL;
+#if defined(VAL_BUF_KIND) && defined(KEYS_TEXT)
+    char sep = '\t';
+#endif
+    if (path_obj != Py_None) {
+#if defined(VAL_BUF_KIND) && defined(KEYS_TEXT)
+        if (!_tsv_sep(sep_str, sep_len, &sep) || !PyUnicode_FSConverter(path_obj, &path)) {
+            return NULL;
+        }
+#else
+        PyErr_SetString(PyExc_TypeError, "path needs str, bytes or int keys and numeric values, like dump_tsv");
+        return NULL;
+#endif
+    }
+
+    h_t* h = self->ht;
+    Py_ssize_t n = (Py_ssize_t) h->size;
+    uint32_t* order = (uint32_t*) malloc(n * sizeof(uint32_t) + 1);
+    if (order == NULL || !_sorted_buckets(h, by_value, reverse, order)) {
+        free(order);
+        Py_XDECREF(path);
+        return PyErr_NoMemory();
+    }
+    PyObject* res;
+#if defined(VAL_BUF_KIND) && defined(KEYS_TEXT)
+    if (path != NULL) {
+        res = _write_tsv(h, path, sep, order) ? Py_BuildValue("") : NULL;
+        Py_DECREF(path);
+        free(order);
+        return res;
+    }
+#endif
+    PyObject* keys_col = _keys_column(h, order, n);
+    res = keys_col == NULL ? NULL : pyconv_new_item(keys_col, _values_column(h, order, n));
+    free(order);
+    return res;
+}
+
+// merge() estimates how many of the other map's keys are new from this many of them
+#define MERGE_SAMPLE 256
+
+/**
+ * Estimates how many keys of `src` are also in `dst` from the first MERGE_SAMPLE keys of `src`. The
+ * table is in hash order, so these are a random sample.
+ */
+static uint32_t _estimate_shared(h_t* src, h_t* dst) {
+    uint32_t sampled = 0;
+    uint32_t shared = 0;
+    for (uint32_t i = 0; i < src->num_buckets && sampled < MERGE_SAMPLE; i++) {
+        if (_bucket_is_live(src->flags, i)) {
+            sampled++;
+            shared += mdict_contains(dst, KEY_GET(src->keys, i));
+        }
+    }
+    return sampled == 0 ? 0 : (uint32_t) ((uint64_t) src->size * shared / sampled);
+}
+
+/**
+ * Grows `dst` for the keys of `src` that it doesn't have yet, as estimated by _estimate_shared.
+ */
+static bool _merge_reserve(h_t* dst, h_t* src) {
+    uint32_t shared = _estimate_shared(src, dst);
+    if (shared >= src->size) {
+        return true;
+    }
+    uint64_t estimate = (uint64_t) dst->size + (src->size - shared);
+    return mdict_reserve(dst, estimate < UINT32_MAX / 2 ? (uint32_t) estimate : UINT32_MAX / 2);
+}
+
+/**
+ * Combines every entry of `src` into `dst` with `op`, inserting the keys that `dst` doesn't have.
+ * Numeric values are combined in place with one probe per key. Returns false if memory runs out,
+ * in which case some of the entries have been merged.
+ */
+static bool _merge_into(h_t* dst, h_t* src, int op) {
+    if (!_merge_reserve(dst, src)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < src->num_buckets; i++) {
+        if (!_bucket_is_live(src->flags, i)) {
+            continue;
+        }
+#ifdef VAL_BUF_KIND
+        if (!_upsert(dst, op, KEY_GET(src->keys, i), _val_get(src, i))) {
+            return false;
+        }
+#else
+        bool replace = op == COMBINE_REPLACE;
+        pv_t previous;
+        if (!mdict_set(dst, KEY_GET(src->keys, i), _val_get(src, i), replace ? &previous : NULL, replace)) {
+            if (dst->error_code) {
+                return false;
+            }
+            if (replace) {
+                VAL_UNSET(&previous, 0);
+            }
+        }
+#endif
+    }
+    return true;
+}
+
+/**
+ * Returns the op for merge() called `op_name`, or -1 with an exception set if it doesn't apply to
+ * these values. NULL gives the default: "sum" for numeric values, and "replace" for the others.
+ */
+static int _merge_op(const char* op_name) {
+#ifdef VAL_BUF_KIND
+    int op = op_name == NULL ? COMBINE_SUM : _combine_from_name(op_name);
+    if (op == -1 || op == COMBINE_COUNT) {
+        PyErr_Format(PyExc_ValueError, "unknown op '%s', expected 'sum', 'min', 'max', 'replace' or 'keep'", op_name);
+        return -1;
+    }
+#else
+    int op = op_name == NULL ? COMBINE_REPLACE : _combine_from_name(op_name);
+    if (op != COMBINE_REPLACE && op != COMBINE_KEEP) {
+        PyErr_Format(PyExc_ValueError, "unknown op '%s' for non-numeric values, expected 'replace' or 'keep'", op_name);
+        return -1;
+    }
+#endif
+    return op;
+}
+
+static PyObject* update(dictObj* self, PyObject* args);
+static PyObject* merge(dictObj* self, PyObject* args, PyObject* kwargs);
+static PyObject* merge_many(dictObj* self, PyObject* args, PyObject* kwargs);
+static PyObject* _or_(PyObject* a, PyObject* b);
+static PyObject* _ior_(dictObj* self, PyObject* other);
+static PyObject* _and_(PyObject* a, PyObject* b);
+static PyObject* _sub_(PyObject* a, PyObject* b);
+static PyObject* _xor_(PyObject* a, PyObject* b);
+
+static PyMethodDef methods_bytes16_int32[] = {
+    {"get", (PyCFunction)get, METH_VARARGS, "Return the value for `key` if `key` is in the dictionary, else `default`. If `default` is not given, it defaults to None, so that this method never raises a KeyError."},
+    {"pop", (PyCFunction)pop, METH_VARARGS, "If key is in the dictionary, remove it and return its value, else return `default`. If `default` is not given and `key` is not in the dictionary, a KeyError is raised."},
+    {"popitem", (PyCFunction)popitem, METH_NOARGS, "Remove and return a (key, value) pair from the dictionary."},
+    {"setdefault", (PyCFunction)setdefault, METH_VARARGS, "If `key` is in the dictionary, return its value. If not, insert `key` with a value of `default` and return `default`. default defaults to 0."},
+    {"clear", (PyCFunction)clear, METH_NOARGS, "Remove all items from the dictionary."},
+    {"update", (PyCFunction)update, METH_VARARGS, "Updates the map with all key-value pairs within the given input."},
+    {"merge", (PyCFunction)(void(*)(void))merge, METH_VARARGS | METH_KEYWORDS, "Combines the entries of another map of the same type into this one, with `op` for keys in both."},
+    {"merge_many", (PyCFunction)(void(*)(void))merge_many, METH_VARARGS | METH_KEYWORDS, "Merges each of a sequence of maps into this one, in order."},
+    {"keys", (PyCFunction)keys, METH_NOARGS, "Returns an iterator over the map's keys"},
+    {"values", (PyCFunction)values, METH_NOARGS, "Returns an iterator over the map's values"},
+    {"items", (PyCFunction)items, METH_NOARGS, "Returns an iterator over the map's (key, value) pairs"},
+    {"keys_list", (PyCFunction)keys_list, METH_NOARGS, "Returns a list of the map's keys"},
+    {"items_list", (PyCFunction)items_list, METH_NOARGS, "Returns a list of the map's (key, value) pairs"},
+    {"retain", (PyCFunction)retain, METH_O, "Deletes the entries for which predicate(key, value) is false. Returns the number deleted."},
+    {"sorted_items", (PyCFunction)(void(*)(void))sorted_items, METH_VARARGS | METH_KEYWORDS, "Returns the keys and values sorted by `by` ('key' or 'value') as two columns, or writes them to the TSV file at `path`. Equal values keep their order."},
+    {"copy", (PyCFunction)copy, METH_NOARGS, "Returns a deep copy of the hashtable"},
+    {"__copy__", (PyCFunction)copy, METH_NOARGS, "Returns a copy of the hashtable, as copy() does"},
+    {"__deepcopy__", (PyCFunction)deepcopy, METH_O, "Returns a copy of the hashtable, with object values copied by copy.deepcopy"},
+    {"get_many", (PyCFunction)(void(*)(void))get_many, METH_VARARGS | METH_KEYWORDS, "Looks up every key in `keys`, and returns the values as a numpy array for numeric value types, or a list otherwise. Missing keys get `default`."},
+    {"set_many", (PyCFunction)set_many, METH_VARARGS, "Sets `dict[k] = v` for each pair of `keys` and `values`, which may be sequences or C-contiguous numpy arrays."},
+    {"delete_many", (PyCFunction)delete_many, METH_O, "Deletes each of `keys` that is present, and returns the number deleted. Takes the same key forms as get_many."},
+#ifdef VAL_BUF_KIND
+    {"most_common", (PyCFunction)(void(*)(void))most_common, METH_VARARGS | METH_KEYWORDS, "Returns the `k` entries with the largest values as (key, value) pairs, largest first, or all of them if `k` is None. NaNs come last."},
+    {"least_common", (PyCFunction)(void(*)(void))least_common, METH_VARARGS | METH_KEYWORDS, "Returns the `k` entries with the smallest values as (key, value) pairs, smallest first, or all of them if `k` is None. NaNs come last."},
+    {"values_sum", (PyCFunction)values_sum, METH_NOARGS, "Returns the sum of the values, without converting each one to a Python object"},
+    {"values_min", (PyCFunction)values_min, METH_NOARGS, "Returns the smallest value, skipping NaNs"},
+    {"values_max", (PyCFunction)values_max, METH_NOARGS, "Returns the largest value, skipping NaNs"},
+    {"values_mean", (PyCFunction)values_mean, METH_NOARGS, "Returns the mean of the values as a float"},
+    {"values_histogram", (PyCFunction)(void(*)(void))values_histogram, METH_VARARGS | METH_KEYWORDS, "Returns (counts, edges) for the values, like numpy.histogram. `bins` is a number of equal-width bins over `range`, or a sequence of edges."},
+    {"transform_values", (PyCFunction)(void(*)(void))transform_values, METH_VARARGS | METH_KEYWORDS, "Updates every value in place with `op`: 'mul', 'add', 'clamp' (to the (low, high) operand) or 'floor' (to a multiple of the operand)."},
+    {"decay_and_prune", (PyCFunction)(void(*)(void))decay_and_prune, METH_VARARGS | METH_KEYWORDS, "Multiplies every value by `factor`, and deletes the entries whose value is then below `threshold`. Returns the number deleted."},
+    {"retain_where", (PyCFunction)(void(*)(void))retain_where, METH_VARARGS | METH_KEYWORDS, "Keeps the entries whose value compares to `threshold` with `op` ('<', '<=', '>', '>=', '==' or '!='), and deletes the rest. Returns the number deleted."},
+    {"accumulate", (PyCFunction)(void(*)(void))accumulate, METH_VARARGS | METH_KEYWORDS, "Combines each of `values` into the entry for the matching key with `op`, which is 'sum', 'min', 'max' or 'count'. Missing keys are inserted with the first value."},
+#ifdef KEYS_TEXT
+    {"load_tsv", (PyCFunction)(void(*)(void))load_tsv, METH_VARARGS | METH_KEYWORDS, "Sets an entry for each \"key<sep>value\" line of the file at `path`."},
+    {"dump_tsv", (PyCFunction)(void(*)(void))dump_tsv, METH_VARARGS | METH_KEYWORDS, "Writes each entry to the file at `path` as a \"key<sep>value\" line."},
+#endif
+#if (KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES) && VAL_BUF_KIND == 'i'
+    {"count_tokens", (PyCFunction)(void(*)(void))count_tokens, METH_VARARGS | METH_KEYWORDS, "Adds 1 to the count of each token in `text`, splitting it at any of the bytes in `delimiters`. Returns the number of tokens."},
+#endif
+#endif
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods sequence_bytes16_int32 = {
+    (lenfunc) _len_,                    /* sq_length */
+    0,                                  /* sq_concat */
+    0,                                  /* sq_repeat */
+    0,                                  /* sq_item */
+    0,                                  /* sq_slice */
+    0,                                  /* sq_ass_item */
+    0,                                  /* sq_ass_slice */
+    (objobjproc) _contains_,            /* sq_contains */
+};
+
+static PyMappingMethods mapping_bytes16_int32 = {
+    (lenfunc) _len_, /*mp_length*/
+    (binaryfunc)_getitem_, /*mp_subscript*/
+    (objobjargproc)_setitem_, /*mp_ass_subscript*/
+};
+
+static PyNumberMethods number_bytes16_int32 = {
+    .nb_subtract = (binaryfunc) _sub_,
+    .nb_and = (binaryfunc) _and_,
+    .nb_xor = (binaryfunc) _xor_,
+    .nb_or = (binaryfunc) _or_,
+    .nb_inplace_or = (binaryfunc) _ior_,
+};
+
+static PyTypeObject dictType_bytes16_int32 = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap[bytes16, int32]",
+    .tp_doc = "pypocketmap[bytes16, int32]",
+    .tp_as_number = &number_bytes16_int32,
+    .tp_as_sequence = &sequence_bytes16_int32,
+    .tp_as_mapping = &mapping_bytes16_int32,
+    .tp_methods = methods_bytes16_int32,
+    .tp_basicsize = sizeof(dictObj),
+    .tp_itemsize = 0,
+#ifdef VALS_OBJECT
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc) custom_traverse,
+    .tp_clear = (inquiry) custom_clear,
+#else
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+#endif
+    .tp_new = (newfunc) custom_new,
+    .tp_init = (initproc) custom_init,
+    .tp_dealloc = (destructor) custom_dealloc,
+    .tp_iter = (getiterfunc) keys,
+    .tp_richcompare = (richcmpfunc) _richcmp_,
+    .tp_repr = (reprfunc) _repr_,
+};
+
+/**
+ * Invoked when dict.update() is called. It takes an argument which must be either a Python dictionary or a
+ * pypocketmap of the same type. It adds all the items from the argument dictionary given to its hashtable. See _update_from_Pydict and
+ * _update_from_mdict for further documentation.
+ *
+ * TODO try to get this working for generic mappings
+ */
+static PyObject* update(dictObj* self, PyObject* args) {
+    if (!_check_not_accumulating(self)) {
+        return NULL;
+    }
+    PyObject* other;
+    bool is_pydict = PyArg_ParseTuple(args, "O!", &PyDict_Type, &other);
+
+    if (!is_pydict) {
+        PyErr_Clear();
+        if (!PyArg_ParseTuple(args, "O", &other)) {
+            return NULL;
+        }
+
+        if (PyObject_IsInstance(other, (PyObject *) &dictType_bytes16_int32) != 1) {
+            PyErr_SetString(PyExc_TypeError, "Argument needs to be either a pypocketmap[bytes16, int32] or compatible Python dictionary");
+            return NULL;
+        }
+    }
+
+    if (is_pydict) {
+        if (_update_from_Pydict(self, other) == -1) {
+            return NULL;
+        }
+    } else {
+        dictObj* dict = (dictObj*) other;
+        if (_update_from_mdict(self, dict) == -1) {
+            return NULL;
+        }
+    }
+
+    return Py_BuildValue("");
+}
+
+/**
+ * Merges each of `maps`, a sequence, into self with `op` (see _merge_op), in order. Returns -1 with
+ * an exception set on failure, in which case the maps before the failing one have been merged.
+ */
+static int _merge_maps(dictObj* self, PyObject* maps, const char* op_name) {
+    int op = _merge_op(op_name);
+    if (op == -1 || !_check_not_accumulating(self)) {
+        return -1;
+    }
+    PyObject* seq = PySequence_Fast(maps, "merge_many() takes a sequence of maps");
+    if (seq == NULL) {
+        return -1;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject* other = PySequence_Fast_GET_ITEM(seq, i);
+        if (PyObject_IsInstance(other, (PyObject *) &dictType_bytes16_int32) != 1) {
+            PyErr_SetString(PyExc_TypeError, "Argument needs to be a pypocketmap[bytes16, int32]");
+            Py_DECREF(seq);
+            return -1;
+        }
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        dictObj* other = (dictObj*) PySequence_Fast_GET_ITEM(seq, i);
+        if (other == self && op != COMBINE_SUM) {
+            // every key is present, and keeps its value
+            continue;
+        }
+        if (!_merge_into(self->ht, other->ht, op)) {
+            PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+            Py_DECREF(seq);
+            return -1;
+        }
+    }
+    Py_DECREF(seq);
+    return 0;
+}
+
+/**
+ * Invoked for dict.merge(other, op), which combines each entry of `other`, a map of the same type,
+ * into this one. Keys this map doesn't have are inserted with their value from `other`; for the
+ * rest, the two values are combined with `op`: "sum", "min", "max", "replace" (take the value
+ * from `other`) or "keep". The default is "sum", or "replace" for str, bytes and object values,
+ * which only support "replace" and "keep". The table is grown once for the estimated number of
+ * new keys before merging.
+ */
+static PyObject* merge(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"other", "op", NULL};
+    PyObject* other;
+    const char* op_name = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|s", kwlist, &other, &op_name)) {
+        return NULL;
+    }
+    PyObject* maps = PyTuple_Pack(1, other);
+    if (maps == NULL) {
+        return NULL;
+    }
+    int result = _merge_maps(self, maps, op_name);
+    Py_DECREF(maps);
+    return result == -1 ? NULL : Py_BuildValue("");
+}
+
+/**
+ * Invoked for dict.merge_many(maps, op), which merges each of `maps` into this one in order, as
+ * with merge().
+ */
+static PyObject* merge_many(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"maps", "op", NULL};
+    PyObject* maps;
+    const char* op_name = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|s", kwlist, &maps, &op_name)) {
+        return NULL;
+    }
+    return _merge_maps(self, maps, op_name) == -1 ? NULL : Py_BuildValue("");
+}
+
+/**
+ * True if `a` and `b` are both maps of this type, which the operators below need.
+ */
+static bool _both_maps(PyObject* a, PyObject* b) {
+    return PyObject_TypeCheck(a, &dictType_bytes16_int32) && PyObject_TypeCheck(b, &dictType_bytes16_int32);
+}
+
+/**
+ * Returns a new map of the same type as `like` holding a copy of `h`, or an empty one if `h` is NULL.
+ */
+static dictObj* _operator_result(PyObject* like, h_t* h) {
+    dictObj* out = (dictObj*) PyObject_CallObject((PyObject*) Py_TYPE(like), NULL);
+    if (out == NULL || h == NULL) {
+        return out;
+    }
+    h_t* copied = mdict_copy(h);
+    if (copied == NULL) {
+        Py_DECREF(out);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    mdict_destroy(out->ht);
+    out->ht = copied;
+    return out;
+}
+
+static PyObject* _operator_no_memory(dictObj* out) {
+    Py_DECREF(out);
+    PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+    return NULL;
+}
+
+/**
+ * Invoked for `a | b`, which returns a new map with the entries of both, taking the value from `b`
+ * for keys in both, like dict union. The larger map is copied and the smaller one merged into it.
+ */
+static PyObject* _or_(PyObject* a, PyObject* b) {
+    if (!_both_maps(a, b)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    h_t* left = ((dictObj*) a)->ht;
+    h_t* right = ((dictObj*) b)->ht;
+    bool left_larger = left->size >= right->size;
+    dictObj* out = _operator_result(a, left_larger ? left : right);
+    if (out == NULL) {
+        return NULL;
+    }
+    if (!_merge_into(out->ht, left_larger ? right : left, left_larger ? COMBINE_REPLACE : COMBINE_KEEP)) {
+        return _operator_no_memory(out);
+    }
+    return (PyObject*) out;
+}
+
+/**
+ * Invoked for `self |= other`, which is merge(other, op="replace") for a map of this type, and
+ * update(other) for anything else.
+ */
+static PyObject* _ior_(dictObj* self, PyObject* other) {
+    if (!_both_maps((PyObject*) self, other)) {
+        PyObject* args = PyTuple_Pack(1, other);
+        PyObject* res = args == NULL ? NULL : update(self, args);
+        Py_XDECREF(args);
+        if (res == NULL) {
+            return NULL;
+        }
+        Py_DECREF(res);
+    } else if (other != (PyObject*) self) {
+        if (!_check_not_accumulating(self)) {
+            return NULL;
+        }
+        if (!_merge_into(self->ht, ((dictObj*) other)->ht, COMBINE_REPLACE)) {
+            PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+            return NULL;
+        }
+    }
+    Py_INCREF(self);
+    return (PyObject*) self;
+}
+
+/**
+ * Invoked for `a & b`, which returns a new map with the entries of `a` whose keys are also in `b`.
+ * The smaller map's keys are looked up in the larger one, and the result is presized for the
+ * estimated number of shared keys.
+ */
+static PyObject* _and_(PyObject* a, PyObject* b) {
+    if (!_both_maps(a, b)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    h_t* left = ((dictObj*) a)->ht;
+    h_t* right = ((dictObj*) b)->ht;
+    h_t* small = left->size <= right->size ? left : right;
+    h_t* large = small == left ? right : left;
+    dictObj* out = _operator_result(a, NULL);
+    if (out == NULL) {
+        return NULL;
+    }
+    if (!mdict_reserve(out->ht, _estimate_shared(small, large))) {
+        return _operator_no_memory(out);
+    }
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    while (mdict_cursor_next(small, &cursor, &i)) {
+        k_t key = KEY_GET(small->keys, i);
+        int32_t idx = mdict_find_hashed(large, key, mdict_hash(large, key));
+        if (idx < 0) {
+            continue;
+        }
+        v_t val = small == left ? _val_get(left, i) : _val_get(left, idx);
+        if (!mdict_set(out->ht, key, val, NULL, false) && out->ht->error_code) {
+            return _operator_no_memory(out);
+        }
+    }
+    return (PyObject*) out;
+}
+
+/**
+ * Invoked for `a - b`, which returns a new map with the entries of `a` whose keys aren't in `b`. If
+ * `b` is the smaller map, `a` is copied and the keys of `b` are deleted from the copy, which is then
+ * tidied once (see mdict_compact). Otherwise the keys of `a` are looked up in `b`, and the result is
+ * presized for the estimated number that are missing.
+ */
+static PyObject* _sub_(PyObject* a, PyObject* b) {
+    if (!_both_maps(a, b)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    h_t* left = ((dictObj*) a)->ht;
+    h_t* right = ((dictObj*) b)->ht;
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    if (right->size < left->size) {
+        dictObj* out = _operator_result(a, left);
+        if (out == NULL) {
+            return NULL;
+        }
+        h_t* h = out->ht;
+        while (mdict_cursor_next(right, &cursor, &i)) {
+            k_t key = KEY_GET(right->keys, i);
+            int32_t idx = mdict_find_hashed(h, key, mdict_hash(h, key));
+            if (idx >= 0) {
+                mdict_remove_item(h, idx);
+            }
+        }
+        mdict_compact(h);
+        return (PyObject*) out;
+    }
+
+    dictObj* out = _operator_result(a, NULL);
+    if (out == NULL) {
+        return NULL;
+    }
+    if (!mdict_reserve(out->ht, left->size - _estimate_shared(left, right))) {
+        return _operator_no_memory(out);
+    }
+    while (mdict_cursor_next(left, &cursor, &i)) {
+        k_t key = KEY_GET(left->keys, i);
+        if (!mdict_contains(right, key)
+                && !mdict_set(out->ht, key, _val_get(left, i), NULL, false) && out->ht->error_code) {
+            return _operator_no_memory(out);
+        }
+    }
+    return (PyObject*) out;
+}
+
+/**
+ * Invoked for `a ^ b`, which returns a new map with the entries whose keys are in only one of `a`
+ * and `b`. The larger map is copied, and each key of the smaller one is deleted from the copy if it
+ * is there or inserted if not. The copy is presized for the estimated inserts, and tidied once at
+ * the end (see mdict_compact).
+ */
+static PyObject* _xor_(PyObject* a, PyObject* b) {
+    if (!_both_maps(a, b)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    h_t* left = ((dictObj*) a)->ht;
+    h_t* right = ((dictObj*) b)->ht;
+    h_t* small = left->size < right->size ? left : right;
+    h_t* large = small == left ? right : left;
+    dictObj* out = _operator_result(a, large);
+    if (out == NULL) {
+        return NULL;
+    }
+    h_t* h = out->ht;
+    if (!_merge_reserve(h, small)) {
+        return _operator_no_memory(out);
+    }
+    mdict_cursor_t cursor = {0, 0};
+    uint32_t i;
+    while (mdict_cursor_next(small, &cursor, &i)) {
+        k_t key = KEY_GET(small->keys, i);
+        int32_t idx = mdict_find_hashed(h, key, mdict_hash(h, key));
+        if (idx >= 0) {
+            mdict_remove_item(h, idx);
+        } else if (!mdict_set(h, key, _val_get(small, i), NULL, false) && h->error_code) {
+            return _operator_no_memory(out);
+        }
+    }
+    mdict_compact(h);
+    return (PyObject*) out;
+}
+
+#if (KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES) && defined(VAL_BUF_KIND)
+// _ingest() presizes a tsv map for about one entry per this many bytes of input, with room to spare
+#define INGEST_BYTES_PER_LINE 28
+
+/**
+ * Invoked for _ingest(buffer, start, end, mode, separators, lowercase) on the module, which loads
+ * buffer[start:end] into a new map. With mode "tokens", it counts the tokens between any of the
+ * `separators` bytes, like count_tokens(); with mode "tsv", it splits each line at the single
+ * `separators` byte, like load_tsv(). The map is private until this returns, so the whole load runs
+ * without the GIL. Used by ingest_file().
+ */
+static PyObject* _ingest(PyObject* module, PyObject* args) {
+    PyObject* buffer_obj;
+    Py_ssize_t start, end;
+    const char* mode;
+    Py_buffer seps_view;
+    int lowercase;
+
+    if (!PyArg_ParseTuple(args, "Onnsy*p", &buffer_obj, &start, &end, &mode, &seps_view, &lowercase)) {
+        return NULL;
+    }
+    bool tokens = strcmp(mode, "tokens") == 0;
+    if (!tokens && strcmp(mode, "tsv") != 0) {
+        PyBuffer_Release(&seps_view);
+        PyErr_Format(PyExc_ValueError, "unknown mode '%s', expected 'tokens' or 'tsv'", mode);
+        return NULL;
+    }
+    char sep = '\0';
+#if VAL_BUF_KIND == 'i'
+    tokenizer_t tokenizer;
+    if (tokens && !_tokenizer_from_py(&tokenizer, &seps_view)) {
+        return NULL;
+    }
+#else
+    if (tokens) {
+        PyBuffer_Release(&seps_view);
+        PyErr_SetString(PyExc_TypeError, "mode 'tokens' needs integer values");
+        return NULL;
+    }
+#endif
+    if (!tokens) {
+        Py_ssize_t num_seps = seps_view.len;
+        sep = num_seps == 1 ? ((const char*) seps_view.buf)[0] : '\0';
+        PyBuffer_Release(&seps_view);
+        if (num_seps != 1 || sep == '\n') {
+            PyErr_SetString(PyExc_ValueError, "sep must be a single byte other than '\\n'");
+            return NULL;
+        }
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(buffer_obj, &view, PyBUF_SIMPLE) == -1) {
+        return NULL;
+    }
+    if (start < 0 || start > end || end > view.len) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "start and end must satisfy 0 <= start <= end <= len(buffer)");
+        return NULL;
+    }
+    Py_ssize_t num_buckets = tokens ? 32 : (end - start) / INGEST_BYTES_PER_LINE;
+    dictObj* d = (dictObj*) PyObject_CallFunction((PyObject*) &dictType_bytes16_int32, "I", (unsigned int) (num_buckets < (1 << 30) ? num_buckets : (1 << 30)));
+    if (d == NULL) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    const char* buf = (const char*) view.buf + start;
+    size_t len = end - start;
+    int status;
+    load_error_t err = {0, 0};
+    Py_BEGIN_ALLOW_THREADS
+#if VAL_BUF_KIND == 'i'
+    if (tokens) {
+        Py_ssize_t num_tokens = 0;
+        status = _count_tokens_into(d->ht, &tokenizer, (const uint8_t*) buf, len, lowercase,
+                                    KEY_TYPE_TAG == TYPE_TAG_STR, &num_tokens, &err);
+    } else
+#endif
+    status = _load_tsv_into(d->ht, buf, len, sep, &err);
+    Py_END_ALLOW_THREADS
+
+    if (status != LOAD_OK) {
+        _raise_load_error(status, buf, start, &err);
+        Py_CLEAR(d);
+    }
+    PyBuffer_Release(&view);
+    return (PyObject*) d;
+}
+
+/**
+ * Invoked for _merge_shards(target, shards, op) on the module, which combines each map in `shards`
+ * into `target` in order, with an op as for merge(). The tables are merged with the GIL
+ * released, while `target` and the shards are marked as busy.
+ */
+static PyObject* _merge_shards(PyObject* module, PyObject* args) {
+    dictObj* target;
+    PyObject* shards_obj;
+    const char* op_name;
+
+    if (!PyArg_ParseTuple(args, "O!Os", &dictType_bytes16_int32, &target, &shards_obj, &op_name)) {
+        return NULL;
+    }
+    int op = _merge_op(op_name);
+    if (op == -1) {
+        return NULL;
+    }
+    PyObject* shards = PySequence_Fast(shards_obj, "shards must be a sequence");
+    if (shards == NULL) {
+        return NULL;
+    }
+    Py_ssize_t num_shards = PySequence_Fast_GET_SIZE(shards);
+    for (Py_ssize_t i = 0; i < num_shards; i++) {
+        PyObject* shard = PySequence_Fast_GET_ITEM(shards, i);
+        if (!PyObject_TypeCheck(shard, &dictType_bytes16_int32) || shard == (PyObject*) target) {
+            Py_DECREF(shards);
+            PyErr_SetString(PyExc_TypeError, "shards must be other maps of the same type as target");
+            return NULL;
+        }
+    }
+    if (!_check_not_accumulating(target)) {
+        Py_DECREF(shards);
+        return NULL;
+    }
+
+    bool ok = true;
+    target->accumulating = true;
+    for (Py_ssize_t i = 0; i < num_shards && ok; i++) {
+        dictObj* shard = (dictObj*) PySequence_Fast_GET_ITEM(shards, i);
+        bool was_busy = shard->accumulating;
+        shard->accumulating = true;
+        Py_BEGIN_ALLOW_THREADS
+        ok = _merge_into(target->ht, shard->ht, op);
+        Py_END_ALLOW_THREADS
+        shard->accumulating = was_busy;
+    }
+    target->accumulating = false;
+    Py_DECREF(shards);
+    if (!ok) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+        return NULL;
+    }
+    return Py_BuildValue("");
+}
+#endif
+
+static PyMethodDef moduleMethods_bytes16_int32[] = {
+#if (KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES) && defined(VAL_BUF_KIND)
+    {"_ingest", (PyCFunction) _ingest, METH_VARARGS, "Load part of a buffer into a new map, without the GIL."},
+    {"_merge_shards", (PyCFunction) _merge_shards, METH_VARARGS, "Combine maps into target, without the GIL."},
+#endif
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef moduleDef_bytes16_int32 = {
+    PyModuleDef_HEAD_INIT,
+    "bytes16_int32", // name of module
+    "pypocketmap[bytes16, int32]", // Documentation of the module
+    -1,   // size of per-interpreter state of the module, or -1 if the module keeps state in global variables
+    moduleMethods_bytes16_int32,
+};
+
+PyMODINIT_FUNC PyInit_bytes16_int32(void) {
+    PyObject* obj;
+
+    if (PyType_Ready(&dictType_bytes16_int32) < 0)
+        return NULL;
+
+    if (PyType_Ready(&keyIterType_bytes16_int32) < 0)
+        return NULL;
+
+    if (PyType_Ready(&valueIterType_bytes16_int32) < 0)
+        return NULL;
+
+    if (PyType_Ready(&itemIterType_bytes16_int32) < 0)
+        return NULL;
+
+    obj = PyModule_Create(&moduleDef_bytes16_int32);
+    if (obj == NULL)
+        return NULL;
+
+    Py_INCREF(&dictType_bytes16_int32);
+    if (PyModule_AddObject(obj, "create", (PyObject *) &dictType_bytes16_int32) < 0) {
+        Py_DECREF(&dictType_bytes16_int32);
+        Py_DECREF(obj);
+        return NULL;
+    }
+
+    return obj;
+}
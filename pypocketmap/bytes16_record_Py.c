@@ -0,0 +1,1009 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "flags.h"
+#define KEY_TYPE_TAG TYPE_TAG_FIXED
+#define KEY_FIXED_WIDTH 16
+#define VAL_TYPE_TAG TYPE_TAG_RECORD
+#include "abstract.h"
+#include "pyconv.h"
+
+/*
+ * Maps whose values are fixed-size records of scalar fields, like a row of a numpy structured
+ * array. Unlike the other `*_Py.c` files, this is the template for the `<key>_record_Py.c` files.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    h_t* ht;
+    bool valid_ht;
+    uint32_t num_fields;
+    record_field_t* fields;
+    PyObject* names;  // tuple of str
+    PyObject* descr;  // list of (name, format) tuples, which numpy.dtype accepts
+} dictObj;
+
+typedef struct {
+    PyObject_HEAD
+    dictObj* owner;
+    mdict_cursor_t cursor;
+    uint32_t yielded;  // for __length_hint__
+    PyObject* item;    // the last tuple from item_iternext, reused if it has been released
+} iterObj;
+
+static void iter_dealloc(iterObj* self);
+static int iter_traverse(iterObj* self, visitproc visit, void* arg);
+static PyObject* key_iternext(iterObj* self);
+static PyObject* value_iternext(iterObj* self);
+static PyObject* item_iternext(iterObj* self);
+static PyObject* iter_length_hint(iterObj* self);
+
+static PyMethodDef iter_methods[] = {
+    {"__length_hint__", (PyCFunction)iter_length_hint, METH_NOARGS, "Returns the number of items left"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject keyIterType_bytes16_record = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_keys[bytes16, record]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) key_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject valueIterType_bytes16_record = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_values[bytes16, record]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) value_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject itemIterType_bytes16_record = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_items[bytes16, record]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) item_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyObject* iter_new(dictObj* owner, PyTypeObject* itertype) {
+    iterObj* iterator = PyObject_GC_New(iterObj, itertype);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    Py_INCREF(owner);
+    iterator->owner = owner;
+    iterator->cursor = (mdict_cursor_t) {0, 0};
+    iterator->yielded = 0;
+    iterator->item = NULL;
+    PyObject_GC_Track(iterator);
+    return (PyObject *)iterator;
+}
+
+static void iter_dealloc(iterObj* self) {
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->owner);
+    Py_XDECREF(self->item);
+    PyObject_GC_Del(self);
+}
+
+static int iter_traverse(iterObj* self, visitproc visit, void* arg) {
+    Py_VISIT(self->owner);
+    Py_VISIT(self->item);
+    return 0;
+}
+
+/**
+ * Returns how many more items the iterator will return if the map isn't changed.
+ */
+static PyObject* iter_length_hint(iterObj* self) {
+    uint32_t size = self->owner == NULL ? 0 : self->owner->ht->size;
+    return PyLong_FromUnsignedLong(size > self->yielded ? size - self->yielded : 0);
+}
+
+/**
+ * Converts a record to a tuple with one element per field.
+ */
+static PyObject* _record_to_py(dictObj* self, const char* rec) {
+    PyObject* res = PyTuple_New(self->num_fields);
+    if (res == NULL) {
+        return NULL;
+    }
+    for (uint32_t f = 0; f < self->num_fields; f++) {
+        PyObject* field_obj = pyconv_scalar_to_py(&self->fields[f], record_get(rec, &self->fields[f]));
+        if (field_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(res, f, field_obj);
+    }
+    return res;
+}
+
+/**
+ * Fills in `rec` from a sequence with one number per field.
+ */
+static bool _record_from_py(dictObj* self, PyObject* obj, char* rec) {
+    PyObject* seq = PySequence_Tuple(obj);
+    if (seq == NULL) {
+        return false;
+    }
+    if (PyTuple_GET_SIZE(seq) != self->num_fields) {
+        PyErr_Format(PyExc_ValueError, "expected a sequence of %u fields, got %zd", self->num_fields, PyTuple_GET_SIZE(seq));
+        Py_DECREF(seq);
+        return false;
+    }
+    for (uint32_t f = 0; f < self->num_fields; f++) {
+        record_scalar_t val;
+        if (!pyconv_scalar_from_py(PyTuple_GET_ITEM(seq, f), &self->fields[f], &val)) {
+            Py_DECREF(seq);
+            return false;
+        }
+        record_set(rec, &self->fields[f], val);
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+/**
+ * Iterates over the keys when __next__ is called on the iterator.
+ */
+static PyObject* key_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    return PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+}
+
+/**
+ * Iterates over the values when __next__ is called on the iterator. Each value is a tuple of its fields.
+ */
+static PyObject* value_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    return _record_to_py(self->owner, _val_get(h, i));
+}
+
+/**
+ * Iterates over the items when __next__ is called on the iterator.
+ */
+static PyObject* item_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+    if (key_obj == NULL) {
+        return NULL;
+    }
+    return pyconv_item(&self->item, key_obj, _record_to_py(self->owner, _val_get(h, i)));
+}
+
+/**
+ * Returns the index of a field given by name or position, or -1 with an exception set.
+ */
+static int _field_index(dictObj* self, PyObject* field_obj) {
+    if (PyLong_Check(field_obj)) {
+        Py_ssize_t f = PyLong_AsSsize_t(field_obj);
+        if (f == -1 && PyErr_Occurred()) {
+            return -1;
+        }
+        if (f < 0 || f >= self->num_fields) {
+            PyErr_SetString(PyExc_IndexError, "field index out of range");
+            return -1;
+        }
+        return (int) f;
+    }
+    for (uint32_t f = 0; f < self->num_fields; f++) {
+        int cmp = PyObject_RichCompareBool(PyTuple_GET_ITEM(self->names, f), field_obj, Py_EQ);
+        if (cmp == -1) {
+            return -1;
+        }
+        if (cmp) {
+            return (int) f;
+        }
+    }
+    PyErr_Format(PyExc_KeyError, "no field named %R", field_obj);
+    return -1;
+}
+
+/**
+ * Parses a field format such as "i8", "<f4" or "|u1" (numpy typestrs for native scalars).
+ */
+static bool _parse_format(const char* format, record_field_t* field, uint32_t offset) {
+    if (format[0] == '=' || format[0] == '|' || (PY_LITTLE_ENDIAN && format[0] == '<') || (!PY_LITTLE_ENDIAN && format[0] == '>')) {
+        format++;
+    }
+    if (format[0] == '\0' || format[1] < '1' || format[1] > '8' || format[2] != '\0') {
+        return false;
+    }
+    return record_field_init(field, format[0], (uint8_t) (format[1] - '0'), offset);
+}
+
+/**
+ * Called by the destructor for deleting the hashtable.
+ */
+void _destroy(dictObj* self) {
+    if (self->valid_ht) {
+        mdict_destroy(self->ht);
+        self->valid_ht = false;
+    }
+    PyMem_Free(self->fields);
+    self->fields = NULL;
+    Py_CLEAR(self->names);
+    Py_CLEAR(self->descr);
+}
+
+/**
+ * The destructor
+ */
+static void custom_dealloc(dictObj* self) {
+    _destroy(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * Allocates the dictObj
+ */
+static PyObject* custom_new(PyTypeObject *type, PyObject *args) {
+    dictObj* self = (dictObj*) type->tp_alloc(type, 0);
+    self->ht = NULL;
+    self->valid_ht = false;
+    self->num_fields = 0;
+    self->fields = NULL;
+    self->names = NULL;
+    self->descr = NULL;
+    return (PyObject*) self;
+}
+
+/**
+ * Constructor, which takes the record layout as a sequence of (name, format) pairs.
+ */
+static int custom_init(dictObj* self, PyObject *args) {
+    PyObject* fields_obj;
+    unsigned int num_buckets = 32;
+
+    if (!PyArg_ParseTuple(args, "O|I", &fields_obj, &num_buckets)) {
+        return -1;
+    }
+    if (self->valid_ht) {
+        PyErr_SetString(PyExc_RuntimeError, "the map is already initialized");
+        return -1;
+    }
+
+    PyObject* seq = PySequence_Tuple(fields_obj);
+    if (seq == NULL) {
+        return -1;
+    }
+    Py_ssize_t num_fields = PyTuple_GET_SIZE(seq);
+    if (num_fields == 0 || num_fields > 0xffff) {
+        PyErr_SetString(PyExc_ValueError, "a record needs between 1 and 65535 fields");
+        Py_DECREF(seq);
+        return -1;
+    }
+    self->fields = PyMem_Calloc(num_fields, sizeof(record_field_t));
+    self->names = PyTuple_New(num_fields);
+    self->descr = PyList_New(num_fields);
+    if (self->fields == NULL || self->names == NULL || self->descr == NULL) {
+        Py_DECREF(seq);
+        _destroy(self);
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->num_fields = (uint32_t) num_fields;
+    uint32_t width = 0;
+    for (Py_ssize_t f = 0; f < num_fields; f++) {
+        PyObject* name;
+        const char* format;
+        PyObject* field_obj = PySequence_Tuple(PyTuple_GET_ITEM(seq, f));
+        if (field_obj == NULL || !PyArg_ParseTuple(field_obj, "Us", &name, &format)) {
+            Py_XDECREF(field_obj);
+            Py_DECREF(seq);
+            _destroy(self);
+            return -1;
+        }
+        record_field_t* field = &self->fields[f];
+        if (!_parse_format(format, field, width)) {
+            PyErr_Format(PyExc_TypeError, "unsupported field format '%s', expected one of i1, i2, i4, i8, u1, u2, u4, u8, f4, f8", format);
+            Py_DECREF(field_obj);
+            Py_DECREF(seq);
+            _destroy(self);
+            return -1;
+        }
+        width += field->size;
+        Py_INCREF(name);
+        PyTuple_SET_ITEM(self->names, f, name);
+        Py_DECREF(field_obj);
+        char canonical[3] = { field->kind, (char) ('0' + field->size), '\0' };
+        PyObject* pair = Py_BuildValue("(Os)", name, canonical);
+        if (pair == NULL) {
+            Py_DECREF(seq);
+            _destroy(self);
+            return -1;
+        }
+        PyList_SET_ITEM(self->descr, f, pair);
+    }
+    Py_DECREF(seq);
+
+    self->ht = mdict_create(num_buckets, width);
+    if (self->ht == NULL) {
+        _destroy(self);
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->valid_ht = true;
+    return 0;
+}
+
+/**
+ * Converts a key for methods that need to clean up on failure. Returns -1 with an exception set.
+ */
+static int _key_from_py(PyObject* key_obj, k_t* out) {
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return -1;
+    }
+
+    *out = key;
+    return 0;
+}
+
+/**
+ * This function is invoked when dict.get(k, [default]) is called.
+ */
+static PyObject* get(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        return Py_BuildValue("");
+    }
+    return _record_to_py(self, val);
+}
+
+/**
+ * dict.pop() invokes this function. If provided, a default is returned when the key is not found;
+ * otherwise a KeyError is raised.
+ */
+static PyObject* pop(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    uint32_t idx;
+    if (!mdict_prepare_remove(self->ht, key, &idx)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    PyObject* res = _record_to_py(self, _val_get(self->ht, idx));
+    if (res != NULL) {
+        mdict_remove_item(self->ht, idx);
+    }
+    return res;
+}
+
+/**
+ * dict.clear() invokes this function.
+ */
+static PyObject* clear(dictObj* self) {
+    mdict_clear(self->ht);
+    return Py_BuildValue("");
+}
+
+/**
+ * Invoked for dict.get_field(key, field, [default]). The field can be given by name or position.
+ */
+static PyObject* get_field(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* field_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "OO|O", &key_obj, &field_obj, &default_obj)) {
+        return NULL;
+    }
+    int f = _field_index(self, field_obj);
+    if (f == -1) {
+        return NULL;
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    return pyconv_scalar_to_py(&self->fields[f], record_get(val, &self->fields[f]));
+}
+
+/**
+ * Finds the record for the key, inserting a record of zeros if it is missing. Returns NULL with an
+ * exception set if the table could not grow.
+ */
+static char* _find_or_insert_zero(dictObj* self, k_t key) {
+    h_t* h = self->ht;
+    uint32_t idx;
+    int inserted = mdict_find_or_insert(h, key, &idx);
+    if (inserted == -1) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+        return NULL;
+    }
+    char* rec = _val_slot(h, idx);
+    if (inserted) {
+        memset(rec, 0, VAL_WIDTH(h));
+    }
+    return rec;
+}
+
+/**
+ * Invoked for dict.set_field(key, field, value). If the key is missing, it is inserted and the
+ * other fields are zero.
+ */
+static PyObject* set_field(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* field_obj;
+    PyObject* value_obj;
+
+    if (!PyArg_ParseTuple(args, "OOO", &key_obj, &field_obj, &value_obj)) {
+        return NULL;
+    }
+    int f = _field_index(self, field_obj);
+    if (f == -1) {
+        return NULL;
+    }
+    record_scalar_t val;
+    if (!pyconv_scalar_from_py(value_obj, &self->fields[f], &val)) {
+        return NULL;
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    char* rec = _find_or_insert_zero(self, key);
+    if (rec == NULL) {
+        return NULL;
+    }
+    record_set(rec, &self->fields[f], val);
+    return Py_BuildValue("");
+}
+
+/**
+ * Invoked for dict.add(key, field, [delta]), which adds delta (default 1) to one field and returns
+ * the new value. If the key is missing, it is inserted with all fields zero first. Integer fields
+ * wrap around on overflow.
+ */
+static PyObject* add(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* field_obj;
+    PyObject* delta_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "OO|O", &key_obj, &field_obj, &delta_obj)) {
+        return NULL;
+    }
+    int f = _field_index(self, field_obj);
+    if (f == -1) {
+        return NULL;
+    }
+    record_field_t* field = &self->fields[f];
+    record_scalar_t delta;
+    if (field->kind == 'f') {
+        delta.f = (delta_obj == NULL) ? 1.0 : PyFloat_AsDouble(delta_obj);
+        if (delta.f == -1.0 && PyErr_Occurred()) {
+            return NULL;
+        }
+    } else {
+        delta.i = (delta_obj == NULL) ? 1 : PyLong_AsLongLong(delta_obj);
+        if (delta.i == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    char* rec = _find_or_insert_zero(self, key);
+    if (rec == NULL) {
+        return NULL;
+    }
+    return pyconv_scalar_to_py(field, record_add(rec, field, delta));
+}
+
+/**
+ * Invoked for dict.to_numpy([field]). Copies one field of every record into a new 1-D array, or
+ * with no field, every record into a structured array. The order is the same as keys().
+ */
+static PyObject* to_numpy(dictObj* self, PyObject* args) {
+    PyObject* field_obj = Py_None;
+
+    if (!PyArg_ParseTuple(args, "|O", &field_obj)) {
+        return NULL;
+    }
+    h_t* h = self->ht;
+    Py_buffer view;
+    PyObject* out;
+    if (field_obj == Py_None) {
+        out = pyconv_new_array_of(self->descr, h->size, &view);
+        if (out == NULL) {
+            return NULL;
+        }
+        if ((size_t) view.itemsize != VAL_WIDTH(h)) {
+            PyBuffer_Release(&view);
+            Py_DECREF(out);
+            PyErr_SetString(PyExc_RuntimeError, "numpy did not create a packed structured array");
+            return NULL;
+        }
+        char* dst = (char*) view.buf;
+        for (uint32_t i = 0; i < h->num_buckets; i++) {
+            if (_bucket_is_live(h->flags, i)) {
+                memcpy(dst, _val_slot(h, i), VAL_WIDTH(h));
+                dst += VAL_WIDTH(h);
+            }
+        }
+    } else {
+        int f = _field_index(self, field_obj);
+        if (f == -1) {
+            return NULL;
+        }
+        record_field_t* field = &self->fields[f];
+        out = pyconv_new_array_of(PyTuple_GET_ITEM(PyList_GET_ITEM(self->descr, f), 1), h->size, &view);
+        if (out == NULL) {
+            return NULL;
+        }
+        char* dst = (char*) view.buf;
+        for (uint32_t i = 0; i < h->num_buckets; i++) {
+            if (_bucket_is_live(h->flags, i)) {
+                memcpy(dst, _val_slot(h, i) + field->offset, field->size);
+                dst += field->size;
+            }
+        }
+    }
+    PyBuffer_Release(&view);
+    return out;
+}
+
+/**
+ * This function is called for the python expression 'k in dict'. k must be of the same type as the hashtable keys.
+ */
+static int _contains_(dictObj* self, PyObject* key_obj) {
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return -1;
+    }
+
+    return mdict_contains(self->ht, key);
+}
+
+/**
+ * This function is called when len(dict) is called. It returns the total number of items present.
+ */
+static int _len_(dictObj* self) {
+    return self->ht->size;
+}
+
+/**
+ * This function is invoked when dict[k] is called.
+ */
+static PyObject* _getitem_(dictObj* self, PyObject* key_obj){
+    k_t key;
+    if (!pyconv_fixed_view(key_obj, KEY_FIXED_WIDTH, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    return _record_to_py(self, val);
+}
+
+/**
+ * This is invoked for the python expression d[key] = record, where record is a sequence with one
+ * number per field. This is also invoked for del d[key], in which case the `value_obj` is NULL
+ */
+static int _setitem_(dictObj* self, PyObject* key_obj, PyObject* value_obj) {
+    char* val = NULL;
+    if (value_obj != NULL) {
+        val = PyMem_Malloc(VAL_WIDTH(self->ht));
+        if (val == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        if (!_record_from_py(self, value_obj, val)) {
+            PyMem_Free(val);
+            return -1;
+        }
+    }
+
+    k_t key;
+    if (_key_from_py(key_obj, &key) == -1) {
+        PyMem_Free(val);
+        return -1;
+    }
+
+    if (value_obj == NULL) {
+        uint32_t idx;
+        if (!mdict_prepare_remove(self->ht, key, &idx)) {
+            pyconv_key_error(key_obj);
+            return -1;
+        }
+        mdict_remove_item(self->ht, idx);
+        return 0;
+    }
+
+    bool ok = true;
+    if (!mdict_set(self->ht, key, val, NULL, true) && self->ht->error_code) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+        ok = false;
+    }
+    PyMem_Free(val);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Formats the map as a string
+ */
+static PyObject* _repr_(dictObj* self) {
+    h_t* h = self->ht;
+    _PyUnicodeWriter writer;
+    _PyUnicodeWriter_Init(&writer);
+    writer.overallocate = 1;
+
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "<pypocketmap[bytes16, record]: {", -1) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+    k_t key;
+    PyObject* key_obj = NULL;
+    PyObject* key_repr;
+    bool first = true;
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            if (!first) {
+                if (_PyUnicodeWriter_WriteASCIIString(&writer, ", ", 2) < 0) {
+                    _PyUnicodeWriter_Dealloc(&writer);
+                    return NULL;
+                }
+            }
+            first = false;
+            key = KEY_GET(h->keys, i);
+            key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+            if (key_obj == NULL) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+            key_repr = PyObject_Repr(key_obj);
+            if (key_repr == NULL) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                Py_CLEAR(key_obj);
+                return NULL;
+            }
+            if (_PyUnicodeWriter_WriteStr(&writer, key_repr) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                Py_CLEAR(key_obj);
+                return NULL;
+            }
+            Py_CLEAR(key_obj);
+
+            if (_PyUnicodeWriter_WriteASCIIString(&writer, ": ", 2) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+
+            PyObject* val_obj = _record_to_py(self, _val_get(h, i));
+            PyObject* val_repr = (val_obj == NULL) ? NULL : PyObject_Repr(val_obj);
+            Py_XDECREF(val_obj);
+            if (val_repr == NULL || _PyUnicodeWriter_WriteStr(&writer, val_repr) < 0) {
+                Py_XDECREF(val_repr);
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+            Py_DECREF(val_repr);
+        }
+    }
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "}>", 2) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+
+    return _PyUnicodeWriter_Finish(&writer);
+}
+
+/**
+ * Returns an iterator for keys when __iter__(dict) is called
+ */
+static PyObject* keys(dictObj* self) {
+    return iter_new(self, &keyIterType_bytes16_record);
+}
+
+/**
+ * Returns the value iterator
+ */
+static PyObject* values(dictObj* self) {
+    return iter_new(self, &valueIterType_bytes16_record);
+}
+
+/**
+ * Returns the item iterator
+ */
+static PyObject* items(dictObj* self) {
+    return iter_new(self, &itemIterType_bytes16_record);
+}
+
+/**
+ * Returns the keys as a list, in the same order as keys().
+ */
+static PyObject* keys_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, key_obj);
+    }
+    // a garbage collection while converting could run a __del__ that removes items
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns the (key, record) pairs as a list, in the same order as items().
+ */
+static PyObject* items_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key, KEY_FIXED_WIDTH);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyObject* item = pyconv_new_item(key_obj, _record_to_py(self, _val_get(h, i)));
+        if (item == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, item);
+    }
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns a new map with the same fields and items when dict.copy() is called.
+ * The table is duplicated bucket for bucket (see mdict_copy), so nothing is rehashed.
+ */
+static PyObject* copy(dictObj* self) {
+    h_t* h = self->ht;
+    PyObject* args = Py_BuildValue("(O)", self->descr);
+    if (args == NULL) {
+        return NULL;
+    }
+    dictObj* new_obj = (dictObj *) PyObject_CallObject((PyObject *) Py_TYPE(self), args);
+    Py_DECREF(args);
+    if (new_obj == NULL) {
+        return NULL;
+    }
+    h_t* copied = mdict_copy(h);
+    if (copied == NULL) {
+        Py_DECREF(new_obj);
+        return PyErr_NoMemory();
+    }
+    mdict_destroy(new_obj->ht);
+    new_obj->ht = copied;
+    return (PyObject*) new_obj;
+}
+
+/**
+ * Invoked for copy.deepcopy(dict). The values are plain data, so this is the same as copy().
+ */
+static PyObject* deepcopy(dictObj* self, PyObject* memo) {
+    return copy(self);
+}
+
+/**
+ * The record layout, as a list of (name, format) pairs
+ */
+static PyObject* get_fields(dictObj* self, void* closure) {
+    return PySequence_List(self->descr);
+}
+
+static PyGetSetDef getset_bytes16_record[] = {
+    {"fields", (getter)get_fields, NULL, "The record layout, as a list of (name, format) pairs", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef methods_bytes16_record[] = {
+    {"get", (PyCFunction)get, METH_VARARGS, "Return the record for `key` as a tuple if `key` is in the dictionary, else `default`."},
+    {"pop", (PyCFunction)pop, METH_VARARGS, "If key is in the dictionary, remove it and return its record, else return `default`. If `default` is not given and `key` is not in the dictionary, a KeyError is raised."},
+    {"clear", (PyCFunction)clear, METH_NOARGS, "Remove all items from the dictionary."},
+    {"get_field", (PyCFunction)get_field, METH_VARARGS, "Return one field of the record for `key`, given by name or position. If `key` is missing, return `default` or raise a KeyError."},
+    {"set_field", (PyCFunction)set_field, METH_VARARGS, "Set one field of the record for `key`, inserting a record of zeros first if `key` is missing."},
+    {"add", (PyCFunction)add, METH_VARARGS, "Add `delta` (default 1) to one field of the record for `key` and return the new value, inserting a record of zeros first if `key` is missing."},
+    {"to_numpy", (PyCFunction)to_numpy, METH_VARARGS, "Copy one field of every record to a numpy array, or with no arguments, every record to a structured array. The order matches keys()."},
+    {"keys", (PyCFunction)keys, METH_NOARGS, "Returns an iterator over the map's keys"},
+    {"values", (PyCFunction)values, METH_NOARGS, "Returns an iterator over the map's records"},
+    {"items", (PyCFunction)items, METH_NOARGS, "Returns an iterator over the map's (key, record) pairs"},
+    {"keys_list", (PyCFunction)keys_list, METH_NOARGS, "Returns a list of the map's keys"},
+    {"items_list", (PyCFunction)items_list, METH_NOARGS, "Returns a list of the map's (key, record) pairs"},
+    {"copy", (PyCFunction)copy, METH_NOARGS, "Returns a deep copy of the hashtable"},
+    {"__copy__", (PyCFunction)copy, METH_NOARGS, "Returns a copy of the hashtable, as copy() does"},
+    {"__deepcopy__", (PyCFunction)deepcopy, METH_O, "Returns a copy of the hashtable"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods sequence_bytes16_record = {
+    (lenfunc) _len_,                    /* sq_length */
+    0,                                  /* sq_concat */
+    0,                                  /* sq_repeat */
+    0,                                  /* sq_item */
+    0,                                  /* sq_slice */
+    0,                                  /* sq_ass_item */
+    0,                                  /* sq_ass_slice */
+    (objobjproc) _contains_,            /* sq_contains */
+};
+
+static PyMappingMethods mapping_bytes16_record = {
+    (lenfunc) _len_, /*mp_length*/
+    (binaryfunc)_getitem_, /*mp_subscript*/
+    (objobjargproc)_setitem_, /*mp_ass_subscript*/
+};
+
+static PyTypeObject dictType_bytes16_record = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap[bytes16, record]",
+    .tp_doc = "pypocketmap[bytes16, record]",
+    .tp_as_sequence = &sequence_bytes16_record,
+    .tp_as_mapping = &mapping_bytes16_record,
+    .tp_methods = methods_bytes16_record,
+    .tp_getset = getset_bytes16_record,
+    .tp_basicsize = sizeof(dictObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = (newfunc) custom_new,
+    .tp_init = (initproc) custom_init,
+    .tp_dealloc = (destructor) custom_dealloc,
+    .tp_iter = (getiterfunc) keys,
+    .tp_repr = (reprfunc) _repr_,
+};
+
+static struct PyModuleDef moduleDef_bytes16_record = {
+    PyModuleDef_HEAD_INIT,
+    "bytes16_record", // name of module
+    "pypocketmap[bytes16, record]", // Documentation of the module
+    -1,   // size of per-interpreter state of the module, or -1 if the module keeps state in global variables
+};
+
+PyMODINIT_FUNC PyInit_bytes16_record(void) {
+    PyObject* obj;
+
+    if (PyType_Ready(&dictType_bytes16_record) < 0)
+        return NULL;
+
+    if (PyType_Ready(&keyIterType_bytes16_record) < 0)
+        return NULL;
+
+    if (PyType_Ready(&valueIterType_bytes16_record) < 0)
+        return NULL;
+
+    if (PyType_Ready(&itemIterType_bytes16_record) < 0)
+        return NULL;
+
+    obj = PyModule_Create(&moduleDef_bytes16_record);
+    if (obj == NULL)
+        return NULL;
+
+    Py_INCREF(&dictType_bytes16_record);
+    if (PyModule_AddObject(obj, "create", (PyObject *) &dictType_bytes16_record) < 0) {
+        Py_DECREF(&dictType_bytes16_record);
+        Py_DECREF(obj);
+        return NULL;
+    }
+
+    return obj;
+}
@@ -0,0 +1,961 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "flags.h"
+#define KEY_TYPE_TAG TYPE_TAG_BYTES
+#define VAL_TYPE_TAG TYPE_TAG_VECTOR
+#include "abstract.h"
+#include "pyconv.h"
+
+/*
+ * Maps whose values are fixed-length arrays of one scalar type, e.g. float32 embeddings. This is
+ * the template for the `<key>_vector_Py.c` files. gather() and scatter() copy rows between the map
+ * and a 2-D array with the GIL released.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    h_t* ht;
+    bool valid_ht;
+    char kind;         // 'i', 'u' or 'f', as in numpy's dtype.kind
+    uint8_t itemsize;
+    uint32_t dim;
+    PyObject* format;  // canonical format string, e.g. "f4", which numpy.dtype accepts
+    // number of gather()/scatter() calls running without the GIL. Any method that could move
+    // or free the rows raises BufferError while this is non-zero
+    Py_ssize_t exports;
+} dictObj;
+
+typedef struct {
+    PyObject_HEAD
+    dictObj* owner;
+    mdict_cursor_t cursor;
+    uint32_t yielded;  // for __length_hint__
+    PyObject* item;    // the last tuple from item_iternext, reused if it has been released
+} iterObj;
+
+static void iter_dealloc(iterObj* self);
+static int iter_traverse(iterObj* self, visitproc visit, void* arg);
+static PyObject* key_iternext(iterObj* self);
+static PyObject* value_iternext(iterObj* self);
+static PyObject* item_iternext(iterObj* self);
+static PyObject* iter_length_hint(iterObj* self);
+
+static PyMethodDef iter_methods[] = {
+    {"__length_hint__", (PyCFunction)iter_length_hint, METH_NOARGS, "Returns the number of items left"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject keyIterType_bytes_vector = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_keys[bytes, vector]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) key_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject valueIterType_bytes_vector = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_values[bytes, vector]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) value_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject itemIterType_bytes_vector = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_items[bytes, vector]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) item_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyObject* iter_new(dictObj* owner, PyTypeObject* itertype) {
+    iterObj* iterator = PyObject_GC_New(iterObj, itertype);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    Py_INCREF(owner);
+    iterator->owner = owner;
+    iterator->cursor = (mdict_cursor_t) {0, 0};
+    iterator->yielded = 0;
+    iterator->item = NULL;
+    PyObject_GC_Track(iterator);
+    return (PyObject *)iterator;
+}
+
+static void iter_dealloc(iterObj* self) {
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->owner);
+    Py_XDECREF(self->item);
+    PyObject_GC_Del(self);
+}
+
+static int iter_traverse(iterObj* self, visitproc visit, void* arg) {
+    Py_VISIT(self->owner);
+    Py_VISIT(self->item);
+    return 0;
+}
+
+/**
+ * Returns how many more items the iterator will return if the map isn't changed.
+ */
+static PyObject* iter_length_hint(iterObj* self) {
+    uint32_t size = self->owner == NULL ? 0 : self->owner->ht->size;
+    return PyLong_FromUnsignedLong(size > self->yielded ? size - self->yielded : 0);
+}
+
+
+/**
+ * Copies a vector to a new 1-D numpy array.
+ */
+static PyObject* _vector_to_py(dictObj* self, const char* vec) {
+    Py_buffer view;
+    PyObject* res = pyconv_new_array_of(self->format, self->dim, &view);
+    if (res == NULL) {
+        return NULL;
+    }
+    memcpy(view.buf, vec, VAL_WIDTH(self->ht));
+    PyBuffer_Release(&view);
+    return res;
+}
+
+/**
+ * Acquires a view of `obj` as a C-contiguous array of `ndim` dimensions, whose rows are vectors of
+ * the map's type and length. Other arrays and sequences are converted with numpy.
+ */
+static bool _vectors_view(dictObj* self, PyObject* obj, Py_buffer* view, int ndim) {
+    if (!pyconv_typed_array(obj, self->format, view, self->kind, self->itemsize, ndim)) {
+        return false;
+    }
+    if (view->shape[ndim - 1] != self->dim) {
+        PyErr_Format(PyExc_ValueError, "expected vectors of length %u, got %zd", self->dim, view->shape[ndim - 1]);
+        PyBuffer_Release(view);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns false with an exception set if a gather() or scatter() is running in another thread.
+ */
+static bool _check_not_exported(dictObj* self) {
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "cannot modify the map while gather() or scatter() is running");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Iterates over the keys when __next__ is called on the iterator.
+ */
+static PyObject* key_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    return PyBytes_FromStringAndSize(key.ptr, key.len);
+}
+
+/**
+ * Iterates over the values when __next__ is called on the iterator. Each value is a new numpy array.
+ */
+static PyObject* value_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    return _vector_to_py(self->owner, _val_get(h, i));
+}
+
+/**
+ * Iterates over the items when __next__ is called on the iterator.
+ */
+static PyObject* item_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    PyObject* key_obj = PyBytes_FromStringAndSize(key.ptr, key.len);
+    if (key_obj == NULL) {
+        return NULL;
+    }
+    return pyconv_item(&self->item, key_obj, _vector_to_py(self->owner, _val_get(h, i)));
+}
+
+/**
+ * Called by the destructor for deleting the hashtable.
+ */
+void _destroy(dictObj* self) {
+    if (self->valid_ht) {
+        mdict_destroy(self->ht);
+        self->valid_ht = false;
+    }
+    Py_CLEAR(self->format);
+}
+
+/**
+ * The destructor
+ */
+static void custom_dealloc(dictObj* self) {
+    _destroy(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * Allocates the dictObj
+ */
+static PyObject* custom_new(PyTypeObject *type, PyObject *args) {
+    dictObj* self = (dictObj*) type->tp_alloc(type, 0);
+    self->ht = NULL;
+    self->valid_ht = false;
+    self->kind = 0;
+    self->itemsize = 0;
+    self->dim = 0;
+    self->format = NULL;
+    self->exports = 0;
+    return (PyObject*) self;
+}
+
+/**
+ * Constructor, which takes the element format (a numpy typestr such as "f4", "<f2" or "i1") and
+ * the vector length.
+ */
+static int custom_init(dictObj* self, PyObject *args) {
+    const char* format;
+    unsigned int dim;
+    unsigned int num_buckets = 32;
+
+    if (!PyArg_ParseTuple(args, "sI|I", &format, &dim, &num_buckets)) {
+        return -1;
+    }
+    if (self->valid_ht) {
+        PyErr_SetString(PyExc_RuntimeError, "the map is already initialized");
+        return -1;
+    }
+
+    const char* spec = format;
+    if (spec[0] == '=' || spec[0] == '|' || (PY_LITTLE_ENDIAN && spec[0] == '<') || (!PY_LITTLE_ENDIAN && spec[0] == '>')) {
+        spec++;
+    }
+    char kind = spec[0];
+    int size = (spec[0] != '\0' && spec[2] == '\0') ? spec[1] - '0' : 0;
+    bool valid = (kind == 'f') ? (size == 2 || size == 4 || size == 8)
+        : ((kind == 'i' || kind == 'u') && (size == 1 || size == 2 || size == 4 || size == 8));
+    if (!valid) {
+        PyErr_Format(PyExc_TypeError, "unsupported vector format '%s', expected one of i1, i2, i4, i8, u1, u2, u4, u8, f2, f4, f8", format);
+        return -1;
+    }
+    if (dim == 0 || (uint64_t) dim * size > 0x7fffffff) {
+        PyErr_SetString(PyExc_ValueError, "vector length out of range");
+        return -1;
+    }
+    char canonical[3] = { kind, (char) ('0' + size), '\0' };
+    self->format = PyUnicode_FromString(canonical);
+    if (self->format == NULL) {
+        return -1;
+    }
+    self->kind = kind;
+    self->itemsize = (uint8_t) size;
+    self->dim = dim;
+
+    self->ht = mdict_create(num_buckets, dim * size);
+    if (self->ht == NULL) {
+        _destroy(self);
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->valid_ht = true;
+    return 0;
+}
+
+/**
+ * Converts a key for methods that need to clean up on failure. Returns -1 with an exception set.
+ */
+static int _key_from_py(PyObject* key_obj, k_t* out) {
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return -1;
+    }
+
+    *out = key;
+    return 0;
+}
+
+#include "keycol.h"
+
+/**
+ * This function is invoked when dict.get(k, [default]) is called.
+ */
+static PyObject* get(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        return Py_BuildValue("");
+    }
+    return _vector_to_py(self, val);
+}
+
+/**
+ * dict.pop() invokes this function. If provided, a default is returned when the key is not found;
+ * otherwise a KeyError is raised.
+ */
+static PyObject* pop(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    if (!_check_not_exported(self)) {
+        return NULL;
+    }
+
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return NULL;
+    }
+
+    uint32_t idx;
+    if (!mdict_prepare_remove(self->ht, key, &idx)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    PyObject* res = _vector_to_py(self, _val_get(self->ht, idx));
+    if (res != NULL) {
+        mdict_remove_item(self->ht, idx);
+    }
+    return res;
+}
+
+/**
+ * dict.clear() invokes this function.
+ */
+static PyObject* clear(dictObj* self) {
+    if (!_check_not_exported(self)) {
+        return NULL;
+    }
+    mdict_clear(self->ht);
+    return Py_BuildValue("");
+}
+
+/**
+ * Invoked for dict.gather(keys, [default]), which returns the vectors for `keys` as the rows of a new
+ * 2-D array. Missing keys get the `default` vector if given, otherwise they raise a KeyError. The keys
+ * are converted with the GIL held, then the table is probed and rows copied with it released.
+ */
+static PyObject* gather(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"keys", "default", NULL};
+    PyObject* keys_obj;
+    PyObject* default_obj = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", kwlist, &keys_obj, &default_obj)) {
+        return NULL;
+    }
+    Py_buffer default_view;
+    const char* default_row = NULL;
+    if (default_obj != Py_None) {
+        if (!_vectors_view(self, default_obj, &default_view, 1)) {
+            return NULL;
+        }
+        default_row = (const char*) default_view.buf;
+    }
+
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        if (default_row != NULL) {
+            PyBuffer_Release(&default_view);
+        }
+        return NULL;
+    }
+    k_t* key_arr = PyMem_Malloc((keys.len + 1) * sizeof(k_t));
+    PyObject* out = NULL;
+    Py_buffer out_view;
+    if (key_arr == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < keys.len; i++) {
+        if (_keycol_get(&keys, i, &key_arr[i]) == -1) {
+            goto done;
+        }
+    }
+    out = pyconv_new_matrix_of(self->format, keys.len, self->dim, &out_view);
+    if (out == NULL) {
+        goto done;
+    }
+
+    h_t* h = self->ht;
+    size_t width = VAL_WIDTH(h);
+    Py_ssize_t missing = -1;
+    self->exports++;
+    Py_BEGIN_ALLOW_THREADS
+    char* dst = (char*) out_view.buf;
+    for (Py_ssize_t i = 0; i < keys.len; i++, dst += width) {
+        v_t val;
+        if (mdict_get(h, key_arr[i], &val)) {
+            memcpy(dst, val, width);
+        } else if (default_row != NULL) {
+            memcpy(dst, default_row, width);
+        } else {
+            missing = i;
+            break;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    self->exports--;
+    PyBuffer_Release(&out_view);
+    if (missing >= 0) {
+        k_t key = key_arr[missing];
+        PyObject* key_obj = PyBytes_FromStringAndSize(key.ptr, key.len);
+        if (key_obj != NULL) {
+            // not key_error, since `key` may not be NUL-terminated (see keycol_t)
+            pyconv_key_error(key_obj);
+            Py_DECREF(key_obj);
+        }
+        Py_CLEAR(out);
+    }
+
+done:
+    PyMem_Free(key_arr);
+    _keycol_release(&keys);
+    if (default_row != NULL) {
+        PyBuffer_Release(&default_view);
+    }
+    return out;
+}
+
+/**
+ * Invoked for dict.scatter(keys, matrix), which is equivalent to `dict[keys[i]] = matrix[i]` for each
+ * row. Missing keys are inserted with the GIL held, then the rows are copied with it released.
+ */
+static PyObject* scatter(dictObj* self, PyObject* args) {
+    PyObject* keys_obj;
+    PyObject* rows_obj;
+
+    if (!PyArg_ParseTuple(args, "OO", &keys_obj, &rows_obj)) {
+        return NULL;
+    }
+    if (!_check_not_exported(self)) {
+        return NULL;
+    }
+    Py_buffer rows;
+    if (!_vectors_view(self, rows_obj, &rows, 2)) {
+        return NULL;
+    }
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        PyBuffer_Release(&rows);
+        return NULL;
+    }
+    if (keys.len != rows.shape[0]) {
+        PyErr_Format(PyExc_ValueError, "got %zd keys and %zd rows", keys.len, rows.shape[0]);
+        _keycol_release(&keys);
+        PyBuffer_Release(&rows);
+        return NULL;
+    }
+
+    bool ok = false;
+    k_t* key_arr = PyMem_Malloc((keys.len + 1) * sizeof(k_t));
+    uint32_t* idx_arr = PyMem_Malloc((keys.len + 1) * sizeof(uint32_t));
+    if (key_arr == NULL || idx_arr == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < keys.len; i++) {
+        if (_keycol_get(&keys, i, &key_arr[i]) == -1) {
+            goto done;
+        }
+    }
+    h_t* h = self->ht;
+    size_t width = VAL_WIDTH(h);
+    // a rehash moves every entry, so the indices before the last one are looked up again
+    Py_ssize_t stale = 0;
+    for (Py_ssize_t i = 0; i < keys.len; i++) {
+        if (h->size + h->num_deleted >= h->upper_bound) {
+            stale = i;
+        }
+        int inserted = mdict_find_or_insert(h, key_arr[i], &idx_arr[i]);
+        if (inserted == -1) {
+            PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+            goto done;
+        }
+        if (inserted) {
+            memset(_val_slot(h, idx_arr[i]), 0, width);
+        }
+    }
+
+    self->exports++;
+    Py_BEGIN_ALLOW_THREADS
+    const char* src = (const char*) rows.buf;
+    for (Py_ssize_t i = 0; i < keys.len; i++, src += width) {
+        v_t dst = _val_slot(h, idx_arr[i]);
+        if (i < stale) {
+            mdict_get(h, key_arr[i], &dst);
+        }
+        memcpy(dst, src, width);
+    }
+    Py_END_ALLOW_THREADS
+    self->exports--;
+    ok = true;
+
+done:
+    PyMem_Free(key_arr);
+    PyMem_Free(idx_arr);
+    _keycol_release(&keys);
+    PyBuffer_Release(&rows);
+    return ok ? Py_BuildValue("") : NULL;
+}
+
+/**
+ * Invoked for dict.to_numpy(), which copies every vector into the rows of a new 2-D array. The
+ * order is the same as keys().
+ */
+static PyObject* to_numpy(dictObj* self) {
+    h_t* h = self->ht;
+    Py_buffer view;
+    PyObject* out = pyconv_new_matrix_of(self->format, h->size, self->dim, &view);
+    if (out == NULL) {
+        return NULL;
+    }
+    char* dst = (char*) view.buf;
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            memcpy(dst, _val_slot(h, i), VAL_WIDTH(h));
+            dst += VAL_WIDTH(h);
+        }
+    }
+    PyBuffer_Release(&view);
+    return out;
+}
+
+/**
+ * This function is called for the python expression 'k in dict'. k must be of the same type as the hashtable keys.
+ */
+static int _contains_(dictObj* self, PyObject* key_obj) {
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return -1;
+    }
+
+    return mdict_contains(self->ht, key);
+}
+
+/**
+ * This function is called when len(dict) is called. It returns the total number of items present.
+ */
+static int _len_(dictObj* self) {
+    return self->ht->size;
+}
+
+/**
+ * This function is invoked when dict[k] is called.
+ */
+static PyObject* _getitem_(dictObj* self, PyObject* key_obj){
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    return _vector_to_py(self, val);
+}
+
+/**
+ * This is invoked for the python expression d[key] = vector, where vector is a 1-D array or sequence
+ * of the map's length. This is also invoked for del d[key], in which case the `value_obj` is NULL
+ */
+static int _setitem_(dictObj* self, PyObject* key_obj, PyObject* value_obj) {
+    if (!_check_not_exported(self)) {
+        return -1;
+    }
+    Py_buffer view;
+    if (value_obj != NULL && !_vectors_view(self, value_obj, &view, 1)) {
+        return -1;
+    }
+
+    k_t key;
+    if (_key_from_py(key_obj, &key) == -1) {
+        if (value_obj != NULL) {
+            PyBuffer_Release(&view);
+        }
+        return -1;
+    }
+
+    if (value_obj == NULL) {
+        uint32_t idx;
+        if (!mdict_prepare_remove(self->ht, key, &idx)) {
+            pyconv_key_error(key_obj);
+            return -1;
+        }
+        mdict_remove_item(self->ht, idx);
+        return 0;
+    }
+
+    bool ok = true;
+    if (!mdict_set(self->ht, key, (v_t) view.buf, NULL, true) && self->ht->error_code) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+        ok = false;
+    }
+    PyBuffer_Release(&view);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Formats the map as a string
+ */
+static PyObject* _repr_(dictObj* self) {
+    h_t* h = self->ht;
+    _PyUnicodeWriter writer;
+    _PyUnicodeWriter_Init(&writer);
+    writer.overallocate = 1;
+
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "<pypocketmap[bytes, vector]: {", -1) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+    k_t key;
+    PyObject* key_obj = NULL;
+    PyObject* key_repr;
+    bool first = true;
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            if (!first) {
+                if (_PyUnicodeWriter_WriteASCIIString(&writer, ", ", 2) < 0) {
+                    _PyUnicodeWriter_Dealloc(&writer);
+                    return NULL;
+                }
+            }
+            first = false;
+            key = KEY_GET(h->keys, i);
+            key_obj = PyBytes_FromStringAndSize(key.ptr, key.len);
+            if (key_obj == NULL) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+            key_repr = PyObject_Repr(key_obj);
+            if (key_repr == NULL) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                Py_CLEAR(key_obj);
+                return NULL;
+            }
+            if (_PyUnicodeWriter_WriteStr(&writer, key_repr) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                Py_CLEAR(key_obj);
+                return NULL;
+            }
+            Py_CLEAR(key_obj);
+
+            if (_PyUnicodeWriter_WriteASCIIString(&writer, ": ", 2) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+
+            PyObject* val_obj = _vector_to_py(self, _val_get(h, i));
+            PyObject* val_repr = (val_obj == NULL) ? NULL : PyObject_Repr(val_obj);
+            Py_XDECREF(val_obj);
+            if (val_repr == NULL || _PyUnicodeWriter_WriteStr(&writer, val_repr) < 0) {
+                Py_XDECREF(val_repr);
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+            Py_DECREF(val_repr);
+        }
+    }
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "}>", 2) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+
+    return _PyUnicodeWriter_Finish(&writer);
+}
+
+/**
+ * Returns an iterator for keys when __iter__(dict) is called
+ */
+static PyObject* keys(dictObj* self) {
+    return iter_new(self, &keyIterType_bytes_vector);
+}
+
+/**
+ * Returns the value iterator
+ */
+static PyObject* values(dictObj* self) {
+    return iter_new(self, &valueIterType_bytes_vector);
+}
+
+/**
+ * Returns the item iterator
+ */
+static PyObject* items(dictObj* self) {
+    return iter_new(self, &itemIterType_bytes_vector);
+}
+
+/**
+ * Returns the keys as a list, in the same order as keys().
+ */
+static PyObject* keys_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key.ptr, key.len);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, key_obj);
+    }
+    // a garbage collection while converting could run a __del__ that removes items
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns the (key, vector) pairs as a list, in the same order as items().
+ */
+static PyObject* items_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyBytes_FromStringAndSize(key.ptr, key.len);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyObject* item = pyconv_new_item(key_obj, _vector_to_py(self, _val_get(h, i)));
+        if (item == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, item);
+    }
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns a new map with the same vector type and items when dict.copy() is called.
+ * The table is duplicated bucket for bucket (see mdict_copy), so nothing is rehashed.
+ */
+static PyObject* copy(dictObj* self) {
+    h_t* h = self->ht;
+    PyObject* args = Py_BuildValue("(OI)", self->format, self->dim);
+    if (args == NULL) {
+        return NULL;
+    }
+    dictObj* new_obj = (dictObj *) PyObject_CallObject((PyObject *) Py_TYPE(self), args);
+    Py_DECREF(args);
+    if (new_obj == NULL) {
+        return NULL;
+    }
+    h_t* copied = mdict_copy(h);
+    if (copied == NULL) {
+        Py_DECREF(new_obj);
+        return PyErr_NoMemory();
+    }
+    mdict_destroy(new_obj->ht);
+    new_obj->ht = copied;
+    return (PyObject*) new_obj;
+}
+
+/**
+ * Invoked for copy.deepcopy(dict). The values are plain data, so this is the same as copy().
+ */
+static PyObject* deepcopy(dictObj* self, PyObject* memo) {
+    return copy(self);
+}
+
+/**
+ * The element format, e.g. "f4"
+ */
+static PyObject* get_dtype(dictObj* self, void* closure) {
+    Py_INCREF(self->format);
+    return self->format;
+}
+
+/**
+ * The vector length
+ */
+static PyObject* get_dim(dictObj* self, void* closure) {
+    return PyLong_FromUnsignedLong(self->dim);
+}
+
+static PyGetSetDef getset_bytes_vector[] = {
+    {"dtype", (getter)get_dtype, NULL, "The element format, e.g. 'f4'", NULL},
+    {"dim", (getter)get_dim, NULL, "The vector length", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef methods_bytes_vector[] = {
+    {"get", (PyCFunction)get, METH_VARARGS, "Return a copy of the vector for `key` if `key` is in the dictionary, else `default`."},
+    {"pop", (PyCFunction)pop, METH_VARARGS, "If key is in the dictionary, remove it and return its vector, else return `default`. If `default` is not given and `key` is not in the dictionary, a KeyError is raised."},
+    {"clear", (PyCFunction)clear, METH_NOARGS, "Remove all items from the dictionary."},
+    {"gather", (PyCFunction)(void(*)(void))gather, METH_VARARGS | METH_KEYWORDS, "Return the vectors for `keys` as the rows of a new 2-D array. Missing keys get the `default` vector, or raise a KeyError if it is not given."},
+    {"scatter", (PyCFunction)scatter, METH_VARARGS, "Set the vector for each of `keys` to the matching row of a 2-D array."},
+    {"to_numpy", (PyCFunction)to_numpy, METH_NOARGS, "Copy every vector to the rows of a new 2-D array. The order matches keys()."},
+    {"keys", (PyCFunction)keys, METH_NOARGS, "Returns an iterator over the map's keys"},
+    {"values", (PyCFunction)values, METH_NOARGS, "Returns an iterator over the map's vectors"},
+    {"items", (PyCFunction)items, METH_NOARGS, "Returns an iterator over the map's (key, vector) pairs"},
+    {"keys_list", (PyCFunction)keys_list, METH_NOARGS, "Returns a list of the map's keys"},
+    {"items_list", (PyCFunction)items_list, METH_NOARGS, "Returns a list of the map's (key, vector) pairs"},
+    {"copy", (PyCFunction)copy, METH_NOARGS, "Returns a deep copy of the hashtable"},
+    {"__copy__", (PyCFunction)copy, METH_NOARGS, "Returns a copy of the hashtable, as copy() does"},
+    {"__deepcopy__", (PyCFunction)deepcopy, METH_O, "Returns a copy of the hashtable"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods sequence_bytes_vector = {
+    (lenfunc) _len_,                    /* sq_length */
+    0,                                  /* sq_concat */
+    0,                                  /* sq_repeat */
+    0,                                  /* sq_item */
+    0,                                  /* sq_slice */
+    0,                                  /* sq_ass_item */
+    0,                                  /* sq_ass_slice */
+    (objobjproc) _contains_,            /* sq_contains */
+};
+
+static PyMappingMethods mapping_bytes_vector = {
+    (lenfunc) _len_, /*mp_length*/
+    (binaryfunc)_getitem_, /*mp_subscript*/
+    (objobjargproc)_setitem_, /*mp_ass_subscript*/
+};
+
+static PyTypeObject dictType_bytes_vector = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap[bytes, vector]",
+    .tp_doc = "pypocketmap[bytes, vector]",
+    .tp_as_sequence = &sequence_bytes_vector,
+    .tp_as_mapping = &mapping_bytes_vector,
+    .tp_methods = methods_bytes_vector,
+    .tp_getset = getset_bytes_vector,
+    .tp_basicsize = sizeof(dictObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = (newfunc) custom_new,
+    .tp_init = (initproc) custom_init,
+    .tp_dealloc = (destructor) custom_dealloc,
+    .tp_iter = (getiterfunc) keys,
+    .tp_repr = (reprfunc) _repr_,
+};
+
+static struct PyModuleDef moduleDef_bytes_vector = {
+    PyModuleDef_HEAD_INIT,
+    "bytes_vector", // name of module
+    "pypocketmap[bytes, vector]", // Documentation of the module
+    -1,   // size of per-interpreter state of the module, or -1 if the module keeps state in global variables
+};
+
+PyMODINIT_FUNC PyInit_bytes_vector(void) {
+    PyObject* obj;
+
+    if (PyType_Ready(&dictType_bytes_vector) < 0)
+        return NULL;
+
+    if (PyType_Ready(&keyIterType_bytes_vector) < 0)
+        return NULL;
+
+    if (PyType_Ready(&valueIterType_bytes_vector) < 0)
+        return NULL;
+
+    if (PyType_Ready(&itemIterType_bytes_vector) < 0)
+        return NULL;
+
+    obj = PyModule_Create(&moduleDef_bytes_vector);
+    if (obj == NULL)
+        return NULL;
+
+    Py_INCREF(&dictType_bytes_vector);
+    if (PyModule_AddObject(obj, "create", (PyObject *) &dictType_bytes_vector) < 0) {
+        Py_DECREF(&dictType_bytes_vector);
+        Py_DECREF(obj);
+        return NULL;
+    }
+
+    return obj;
+}
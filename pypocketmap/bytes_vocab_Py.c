@@ -0,0 +1,940 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "flags.h"
+#define KEY_TYPE_TAG TYPE_TAG_BYTES
+#define VAL_TYPE_TAG TYPE_TAG_I32
+#include "abstract.h"
+#include "pyconv.h"
+
+/*
+ * Vocabularies, which assign the ids 0, 1, 2, ... to keys in the order they are first added. This
+ * is the template for the `<key>_vocab_Py.c` files. The hashtable maps each key to its id, and the
+ * keys are also appended to an arena in id order, which is the reverse index. Keys can't be
+ * removed, so the ids stay dense. For str and bytes keys, the arena holds the keys' bytes and
+ * `offsets` locates each one; otherwise it is an array of k_t.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    h_t* ht;
+    bool valid_ht;
+    char* arena;        // the keys, in id order
+    uint64_t arena_len;
+    uint64_t arena_cap;
+    uint64_t* offsets;  // key i is arena[offsets[i]:offsets[i+1]], or NULL without KEYS_POINT
+    uint32_t offsets_cap;
+} dictObj;
+
+typedef struct {
+    PyObject_HEAD
+    dictObj* owner;
+    uint32_t iter_idx;
+    PyObject* item;  // the last tuple from item_iternext, reused if it has been released
+} iterObj;
+
+static void iter_dealloc(iterObj* self);
+static int iter_traverse(iterObj* self, visitproc visit, void* arg);
+static PyObject* key_iternext(iterObj* self);
+static PyObject* value_iternext(iterObj* self);
+static PyObject* item_iternext(iterObj* self);
+static PyObject* iter_length_hint(iterObj* self);
+
+static PyMethodDef iter_methods[] = {
+    {"__length_hint__", (PyCFunction)iter_length_hint, METH_NOARGS, "Returns the number of items left"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject keyIterType_bytes_vocab = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_keys[bytes, vocab]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) key_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject valueIterType_bytes_vocab = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_values[bytes, vocab]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) value_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject itemIterType_bytes_vocab = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_items[bytes, vocab]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) item_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyObject* iter_new(dictObj* owner, PyTypeObject* itertype) {
+    iterObj* iterator = PyObject_GC_New(iterObj, itertype);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    Py_INCREF(owner);
+    iterator->owner = owner;
+    iterator->iter_idx = 0;
+    iterator->item = NULL;
+    PyObject_GC_Track(iterator);
+    return (PyObject *)iterator;
+}
+
+static void iter_dealloc(iterObj* self) {
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->owner);
+    Py_XDECREF(self->item);
+    PyObject_GC_Del(self);
+}
+
+static int iter_traverse(iterObj* self, visitproc visit, void* arg) {
+    Py_VISIT(self->owner);
+    Py_VISIT(self->item);
+    return 0;
+}
+
+/**
+ * Returns how many more ids the iterator will return if no keys are added.
+ */
+static PyObject* iter_length_hint(iterObj* self) {
+    uint32_t size = self->owner == NULL ? 0 : self->owner->ht->size;
+    return PyLong_FromUnsignedLong(size > self->iter_idx ? size - self->iter_idx : 0);
+}
+
+/**
+ * Returns the key with the given id, which must be less than the size.
+ */
+static inline k_t _key_of(dictObj* self, uint32_t id) {
+#ifdef KEYS_POINT
+    k_t key;
+    key.ptr = self->arena + self->offsets[id];
+    key.len = self->offsets[id + 1] - self->offsets[id];
+    return key;
+#else
+    return ((k_t*) self->arena)[id];
+#endif
+}
+
+/**
+ * Converts the key with the given id to a new Python object.
+ */
+static PyObject* _key_to_py(dictObj* self, uint32_t id) {
+    k_t key = _key_of(self, id);
+    return PyBytes_FromStringAndSize(key.ptr, key.len);
+}
+
+/**
+ * Appends the key with the given id, which must be the number of keys in the arena. Returns false
+ * if out of memory.
+ */
+static bool _arena_push(dictObj* self, uint32_t id, k_t key) {
+#ifdef KEYS_POINT
+    if (id + 1 >= self->offsets_cap) {
+        uint32_t new_cap = self->offsets_cap * 2;
+        uint64_t* new_offsets = (uint64_t*) realloc(self->offsets, (size_t) new_cap * sizeof(uint64_t));
+        if (new_offsets == NULL) {
+            return false;
+        }
+        self->offsets = new_offsets;
+        self->offsets_cap = new_cap;
+    }
+    if (self->arena_len + key.len > self->arena_cap) {
+        uint64_t new_cap = self->arena_cap * 2;
+        while (new_cap < self->arena_len + key.len) {
+            new_cap *= 2;
+        }
+        char* new_arena = (char*) realloc(self->arena, new_cap);
+        if (new_arena == NULL) {
+            return false;
+        }
+        self->arena = new_arena;
+        self->arena_cap = new_cap;
+    }
+    memcpy(self->arena + self->arena_len, key.ptr, key.len);
+    self->arena_len += key.len;
+    self->offsets[id + 1] = self->arena_len;
+#else
+    if (self->arena_len + sizeof(k_t) > self->arena_cap) {
+        char* new_arena = (char*) realloc(self->arena, self->arena_cap * 2);
+        if (new_arena == NULL) {
+            return false;
+        }
+        self->arena = new_arena;
+        self->arena_cap *= 2;
+    }
+    ((k_t*) self->arena)[id] = key;
+    self->arena_len += sizeof(k_t);
+#endif
+    return true;
+}
+
+/**
+ * Looks up the id of `key`, assigning the next one if it is new, with a single probe. Returns false
+ * with an exception set on failure.
+ */
+static bool _intern(dictObj* self, k_t key, int32_t* id) {
+    h_t* h = self->ht;
+    uint32_t idx;
+    int inserted = mdict_find_or_insert(h, key, &idx);
+    if (inserted == -1) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+        return false;
+    }
+    if (!inserted) {
+        *id = _val_get(h, idx);
+        return true;
+    }
+    uint32_t next_id = h->size - 1;
+    if (next_id > INT32_MAX || !_arena_push(self, next_id, key)) {
+        mdict_remove_item(h, idx);
+        if (next_id > INT32_MAX) {
+            PyErr_SetString(PyExc_OverflowError, "the vocabulary is full");
+        } else {
+            PyErr_NoMemory();
+        }
+        return false;
+    }
+    _val_set(h, idx, (int32_t) next_id);
+    *id = (int32_t) next_id;
+    return true;
+}
+
+/**
+ * Iterates over the keys in id order when __next__ is called on the iterator.
+ */
+static PyObject* key_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    if (self->iter_idx < self->owner->ht->size) {
+        return _key_to_py(self->owner, self->iter_idx++);
+    }
+    PyErr_SetNone(PyExc_StopIteration);
+    return NULL;
+}
+
+/**
+ * Iterates over the ids when __next__ is called on the iterator.
+ */
+static PyObject* value_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    if (self->iter_idx < self->owner->ht->size) {
+        return PyLong_FromUnsignedLong(self->iter_idx++);
+    }
+    PyErr_SetNone(PyExc_StopIteration);
+    return NULL;
+}
+
+/**
+ * Iterates over the (key, id) items in id order when __next__ is called on the iterator.
+ */
+static PyObject* item_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    if (self->iter_idx < self->owner->ht->size) {
+        uint32_t id = self->iter_idx++;
+        PyObject* key_obj = _key_to_py(self->owner, id);
+        if (key_obj == NULL) {
+            return NULL;
+        }
+        return pyconv_item(&self->item, key_obj, PyLong_FromUnsignedLong(id));
+    }
+    PyErr_SetNone(PyExc_StopIteration);
+    return NULL;
+}
+
+/**
+ * Called by the destructor for deleting the hashtable and arena.
+ */
+void _destroy(dictObj* self) {
+    if (self->valid_ht) {
+        mdict_destroy(self->ht);
+        self->valid_ht = false;
+    }
+    free(self->arena);
+    self->arena = NULL;
+    free(self->offsets);
+    self->offsets = NULL;
+}
+
+/**
+ * The destructor
+ */
+static void custom_dealloc(dictObj* self) {
+    _destroy(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * Allocates the dictObj
+ */
+static PyObject* custom_new(PyTypeObject *type, PyObject *args) {
+    dictObj* self = (dictObj*) type->tp_alloc(type, 0);
+    self->ht = NULL;
+    self->valid_ht = false;
+    self->arena = NULL;
+    self->arena_len = 0;
+    self->arena_cap = 0;
+    self->offsets = NULL;
+    self->offsets_cap = 0;
+    return (PyObject*) self;
+}
+
+/**
+ * Constructor for allocating and initializing the hashtable and arena.
+ */
+static int custom_init(dictObj* self, PyObject *args) {
+    unsigned int num_buckets = 32;
+
+    if (!PyArg_ParseTuple(args, "|I", &num_buckets)) {
+        return -1;
+    }
+    if (self->valid_ht) {
+        PyErr_SetString(PyExc_RuntimeError, "the map is already initialized");
+        return -1;
+    }
+    self->arena_cap = 256;
+    self->arena = (char*) malloc(self->arena_cap);
+    bool ok = self->arena != NULL;
+#ifdef KEYS_POINT
+    self->offsets_cap = 32;
+    self->offsets = (uint64_t*) malloc(self->offsets_cap * sizeof(uint64_t));
+    ok = ok && self->offsets != NULL;
+#endif
+    self->ht = mdict_create(num_buckets, true);
+    if (!ok || self->ht == NULL) {
+        if (self->ht != NULL) {
+            mdict_destroy(self->ht);
+        }
+        _destroy(self);
+        PyErr_NoMemory();
+        return -1;
+    }
+#ifdef KEYS_POINT
+    self->offsets[0] = 0;
+#endif
+    self->valid_ht = true;
+    return 0;
+}
+
+/**
+ * Converts one key for the bulk methods. Returns -1 with an exception set on failure.
+ */
+static int _key_from_py(PyObject* key_obj, k_t* out) {
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return -1;
+    }
+
+    *out = key;
+    return 0;
+}
+
+#include "keycol.h"
+
+/**
+ * Invoked for vocab.add(key), which returns the id of `key`, assigning the next one if it is new.
+ */
+static PyObject* add(dictObj* self, PyObject* key_obj) {
+    k_t key;
+    if (_key_from_py(key_obj, &key) == -1) {
+        return NULL;
+    }
+    int32_t id;
+    if (!_intern(self, key, &id)) {
+        return NULL;
+    }
+    return PyLong_FromLong(id);
+}
+
+/**
+ * This function is invoked when vocab.get(k, [default]) is called.
+ */
+static PyObject* get(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    k_t key;
+    if (_key_from_py(key_obj, &key) == -1) {
+        return NULL;
+    }
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        Py_INCREF(default_obj);
+        return default_obj;
+    }
+    return PyLong_FromLong(val);
+}
+
+/**
+ * vocab.clear() invokes this function. Ids are assigned from 0 again afterwards.
+ */
+static PyObject* clear(dictObj* self) {
+    mdict_clear(self->ht);
+    self->arena_len = 0;
+    return Py_BuildValue("");
+}
+
+/**
+ * Invoked for vocab.lookup(id), which returns the key with that id.
+ */
+static PyObject* lookup(dictObj* self, PyObject* id_obj) {
+    Py_ssize_t id = PyNumber_AsSsize_t(id_obj, PyExc_IndexError);
+    if (id == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    if (id < 0 || id >= (Py_ssize_t) self->ht->size) {
+        PyErr_SetString(PyExc_IndexError, "id out of range");
+        return NULL;
+    }
+    return _key_to_py(self, (uint32_t) id);
+}
+
+/**
+ * Invoked for vocab.encode(keys, add=True), which returns the ids of `keys` as a new int32 array.
+ * New keys are added, or get -1 if `add` is false. The keys can be anything that the bulk methods
+ * of the other maps take, including the (offsets, data) form of an Arrow string array.
+ */
+static PyObject* encode(dictObj* self, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"keys", "add", NULL};
+    PyObject* keys_obj;
+    int add = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p", kwlist, &keys_obj, &add)) {
+        return NULL;
+    }
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        return NULL;
+    }
+    Py_buffer out_view;
+    PyObject* out = pyconv_new_array("int32", keys.len, &out_view);
+    if (out == NULL) {
+        _keycol_release(&keys);
+        return NULL;
+    }
+    int32_t* ids = (int32_t*) out_view.buf;
+    for (Py_ssize_t i = 0; i < keys.len; i++) {
+        k_t key;
+        if (_keycol_get(&keys, i, &key) == -1) {
+            Py_CLEAR(out);
+            break;
+        }
+        if (add) {
+            if (!_intern(self, key, &ids[i])) {
+                Py_CLEAR(out);
+                break;
+            }
+        } else {
+            v_t val;
+            ids[i] = mdict_get(self->ht, key, &val) ? val : -1;
+        }
+    }
+    PyBuffer_Release(&out_view);
+    _keycol_release(&keys);
+    return out;
+}
+
+/**
+ * Invoked for vocab.decode(ids), which returns a list of the keys with the given ids. The ids can be
+ * an int32 or int64 array, or any sequence of ints.
+ */
+static PyObject* decode(dictObj* self, PyObject* ids_obj) {
+    Py_buffer view;
+    PyObject* seq = NULL;
+    Py_ssize_t len;
+    Py_ssize_t itemsize = 0;
+    if (pyconv_typed_buffer(ids_obj, &view, 'i', 4, 1) || pyconv_typed_buffer(ids_obj, &view, 'i', 8, 1)) {
+        itemsize = view.itemsize;
+        len = view.shape[0];
+    } else {
+        seq = PySequence_Fast(ids_obj, "expected an array or sequence of ids");
+        if (seq == NULL) {
+            return NULL;
+        }
+        len = PySequence_Fast_GET_SIZE(seq);
+    }
+
+    PyObject* out = PyList_New(len);
+    for (Py_ssize_t i = 0; out != NULL && i < len; i++) {
+        int64_t id;
+        if (itemsize == 4) {
+            id = ((const int32_t*) view.buf)[i];
+        } else if (itemsize == 8) {
+            id = ((const int64_t*) view.buf)[i];
+        } else {
+            id = PyLong_AsLongLong(PySequence_Fast_GET_ITEM(seq, i));
+            if (id == -1 && PyErr_Occurred()) {
+                Py_CLEAR(out);
+                break;
+            }
+        }
+        if (id < 0 || id >= self->ht->size) {
+            PyErr_Format(PyExc_IndexError, "id %lld out of range", (long long) id);
+            Py_CLEAR(out);
+            break;
+        }
+        PyObject* key_obj = _key_to_py(self, (uint32_t) id);
+        if (key_obj == NULL) {
+            Py_CLEAR(out);
+            break;
+        }
+        PyList_SET_ITEM(out, i, key_obj);
+    }
+    if (itemsize != 0) {
+        PyBuffer_Release(&view);
+    }
+    Py_XDECREF(seq);
+    return out;
+}
+
+/**
+ * This function is called for the python expression 'k in vocab'.
+ */
+static int _contains_(dictObj* self, PyObject* key_obj) {
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return -1;
+    }
+
+    return mdict_contains(self->ht, key);
+}
+
+/**
+ * This function is called when len(vocab) is called. It returns the number of keys.
+ */
+static int _len_(dictObj* self) {
+    return self->ht->size;
+}
+
+/**
+ * This function is invoked when vocab[k] is called, which returns the id of k without adding it.
+ */
+static PyObject* _getitem_(dictObj* self, PyObject* key_obj){
+    k_t key;
+    if (!pyconv_bytes_view(key_obj, &key)) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        pyconv_key_error(key_obj);
+        return NULL;
+    }
+    return PyLong_FromLong(val);
+}
+
+/**
+ * Formats the vocabulary as a string, in id order
+ */
+static PyObject* _repr_(dictObj* self) {
+    _PyUnicodeWriter writer;
+    _PyUnicodeWriter_Init(&writer);
+    writer.overallocate = 1;
+
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "<pypocketmap[bytes, vocab]: {", -1) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+    for (uint32_t id = 0; id < self->ht->size; id++) {
+        PyObject* key_obj = _key_to_py(self, id);
+        PyObject* key_repr = (key_obj == NULL) ? NULL : PyObject_Repr(key_obj);
+        Py_XDECREF(key_obj);
+        if (key_repr == NULL
+                || (id > 0 && _PyUnicodeWriter_WriteASCIIString(&writer, ", ", 2) < 0)
+                || _PyUnicodeWriter_WriteStr(&writer, key_repr) < 0) {
+            Py_XDECREF(key_repr);
+            _PyUnicodeWriter_Dealloc(&writer);
+            return NULL;
+        }
+        Py_DECREF(key_repr);
+        char buf[16];
+        snprintf(buf, sizeof(buf), ": %u", id);
+        if (_PyUnicodeWriter_WriteASCIIString(&writer, buf, -1) < 0) {
+            _PyUnicodeWriter_Dealloc(&writer);
+            return NULL;
+        }
+    }
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "}>", 2) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+
+    return _PyUnicodeWriter_Finish(&writer);
+}
+
+/**
+ * Returns an iterator for keys when __iter__(vocab) is called
+ */
+static PyObject* keys(dictObj* self) {
+    return iter_new(self, &keyIterType_bytes_vocab);
+}
+
+/**
+ * Returns the id iterator
+ */
+static PyObject* values(dictObj* self) {
+    return iter_new(self, &valueIterType_bytes_vocab);
+}
+
+/**
+ * Returns the item iterator
+ */
+static PyObject* items(dictObj* self) {
+    return iter_new(self, &itemIterType_bytes_vocab);
+}
+
+/**
+ * Returns the keys as a list, in id order, like decode(range(len(vocab))).
+ */
+static PyObject* keys_list(dictObj* self) {
+    uint32_t size = self->ht->size;
+    PyObject* res = PyList_New((Py_ssize_t) size);
+    if (res == NULL) {
+        return NULL;
+    }
+    for (uint32_t id = 0; id < size; id++) {
+        PyObject* key_obj = _key_to_py(self, id);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, id, key_obj);
+    }
+    return res;
+}
+
+/**
+ * Returns the (key, id) pairs as a list, in id order.
+ */
+static PyObject* items_list(dictObj* self) {
+    uint32_t size = self->ht->size;
+    PyObject* res = PyList_New((Py_ssize_t) size);
+    if (res == NULL) {
+        return NULL;
+    }
+    for (uint32_t id = 0; id < size; id++) {
+        PyObject* key_obj = _key_to_py(self, id);
+        PyObject* item = key_obj == NULL ? NULL : pyconv_new_item(key_obj, PyLong_FromUnsignedLong(id));
+        if (item == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, id, item);
+    }
+    return res;
+}
+
+/**
+ * Returns a new vocabulary with the same ids when vocab.copy() is called. The table is duplicated
+ * bucket for bucket (see mdict_copy), and the arena and offsets are copied whole.
+ */
+static PyObject* copy(dictObj* self) {
+    dictObj* new_obj = (dictObj *) PyObject_CallObject((PyObject *) Py_TYPE(self), NULL);
+    if (new_obj == NULL) {
+        return NULL;
+    }
+    h_t* h = mdict_copy(self->ht);
+    char* arena = (char*) malloc(self->arena_cap);
+#ifdef KEYS_POINT
+    uint64_t* offsets = (uint64_t*) malloc(self->offsets_cap * sizeof(uint64_t));
+#else
+    uint64_t* offsets = NULL;
+#endif
+    if (h == NULL || arena == NULL || (self->offsets != NULL && offsets == NULL)) {
+        if (h != NULL) {
+            mdict_destroy(h);
+        }
+        free(arena);
+        free(offsets);
+        Py_DECREF(new_obj);
+        return PyErr_NoMemory();
+    }
+    memcpy(arena, self->arena, self->arena_len);
+    if (offsets != NULL) {
+        memcpy(offsets, self->offsets, ((size_t) self->ht->size + 1) * sizeof(uint64_t));
+    }
+    mdict_destroy(new_obj->ht);
+    free(new_obj->arena);
+    free(new_obj->offsets);
+    new_obj->ht = h;
+    new_obj->arena = arena;
+    new_obj->arena_len = self->arena_len;
+    new_obj->arena_cap = self->arena_cap;
+    new_obj->offsets = offsets;
+    new_obj->offsets_cap = self->offsets_cap;
+    return (PyObject*) new_obj;
+}
+
+/**
+ * Invoked for copy.deepcopy(vocab). The keys are plain data, so this is the same as copy().
+ */
+static PyObject* deepcopy(dictObj* self, PyObject* memo) {
+    return copy(self);
+}
+
+#ifdef KEYS_POINT
+/**
+ * Invoked for vocab.to_arrow(), which returns the keys in id order as new (offsets, data) arrays,
+ * the form of an Arrow string array with int64 offsets.
+ */
+static PyObject* to_arrow(dictObj* self) {
+    uint32_t size = self->ht->size;
+    Py_buffer offsets_view;
+    PyObject* offsets = pyconv_new_array("int64", (Py_ssize_t) size + 1, &offsets_view);
+    if (offsets == NULL) {
+        return NULL;
+    }
+    memcpy(offsets_view.buf, self->offsets, ((size_t) size + 1) * sizeof(uint64_t));
+    PyBuffer_Release(&offsets_view);
+    Py_buffer data_view;
+    PyObject* data = pyconv_new_array("uint8", (Py_ssize_t) self->arena_len, &data_view);
+    if (data == NULL) {
+        Py_DECREF(offsets);
+        return NULL;
+    }
+    memcpy(data_view.buf, self->arena, self->arena_len);
+    PyBuffer_Release(&data_view);
+    return Py_BuildValue("(NN)", offsets, data);
+}
+#else
+/**
+ * Invoked for vocab.to_numpy(), which returns the keys in id order as a new array.
+ */
+static PyObject* to_numpy(dictObj* self) {
+    Py_buffer view;
+    PyObject* out = pyconv_new_array("bytes", self->ht->size, &view);
+    if (out == NULL) {
+        return NULL;
+    }
+    memcpy(view.buf, self->arena, self->arena_len);
+    PyBuffer_Release(&view);
+    return out;
+}
+#endif
+
+static PyMethodDef methods_bytes_vocab[] = {
+    {"add", (PyCFunction)add, METH_O, "Return the id of `key`, assigning the next one if it is new."},
+    {"get", (PyCFunction)get, METH_VARARGS, "Return the id of `key` if it is in the vocabulary, else `default`."},
+    {"lookup", (PyCFunction)lookup, METH_O, "Return the key with the given id."},
+    {"encode", (PyCFunction)(void(*)(void))encode, METH_VARARGS | METH_KEYWORDS, "Return the ids of `keys` as an int32 array. New keys are added, or get -1 if `add` is false."},
+    {"decode", (PyCFunction)decode, METH_O, "Return a list of the keys with the given ids."},
+#ifdef KEYS_POINT
+    {"to_arrow", (PyCFunction)to_arrow, METH_NOARGS, "Return the keys in id order as (int64 offsets, uint8 data) arrays."},
+#else
+    {"to_numpy", (PyCFunction)to_numpy, METH_NOARGS, "Return the keys in id order as an array."},
+#endif
+    {"keys", (PyCFunction)keys, METH_NOARGS, "Returns an iterator over the keys, in id order"},
+    {"values", (PyCFunction)values, METH_NOARGS, "Returns an iterator over the ids"},
+    {"items", (PyCFunction)items, METH_NOARGS, "Returns an iterator over the (key, id) pairs, in id order"},
+    {"keys_list", (PyCFunction)keys_list, METH_NOARGS, "Returns a list of the keys, in id order"},
+    {"items_list", (PyCFunction)items_list, METH_NOARGS, "Returns a list of the (key, id) pairs, in id order"},
+    {"clear", (PyCFunction)clear, METH_NOARGS, "Remove all keys from the vocabulary."},
+    {"copy", (PyCFunction)copy, METH_NOARGS, "Returns a copy of the vocabulary"},
+    {"__copy__", (PyCFunction)copy, METH_NOARGS, "Returns a copy of the vocabulary, as copy() does"},
+    {"__deepcopy__", (PyCFunction)deepcopy, METH_O, "Returns a copy of the vocabulary"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods sequence_bytes_vocab = {
+    (lenfunc) _len_,                    /* sq_length */
+    0,                                  /* sq_concat */
+    0,                                  /* sq_repeat */
+    0,                                  /* sq_item */
+    0,                                  /* sq_slice */
+    0,                                  /* sq_ass_item */
+    0,                                  /* sq_ass_slice */
+    (objobjproc) _contains_,            /* sq_contains */
+};
+
+static PyMappingMethods mapping_bytes_vocab = {
+    (lenfunc) _len_, /*mp_length*/
+    (binaryfunc)_getitem_, /*mp_subscript*/
+    0, /*mp_ass_subscript*/
+};
+
+static PyTypeObject dictType_bytes_vocab = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap[bytes, vocab]",
+    .tp_doc = "pypocketmap[bytes, vocab]",
+    .tp_as_sequence = &sequence_bytes_vocab,
+    .tp_as_mapping = &mapping_bytes_vocab,
+    .tp_methods = methods_bytes_vocab,
+    .tp_basicsize = sizeof(dictObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = (newfunc) custom_new,
+    .tp_init = (initproc) custom_init,
+    .tp_dealloc = (destructor) custom_dealloc,
+    .tp_iter = (getiterfunc) keys,
+    .tp_repr = (reprfunc) _repr_,
+};
+
+// factorize() presizes its vocabulary for at most this many keys when not given a size hint, so
+// that a long column of few distinct keys doesn't allocate a table as large as itself
+#define FACTORIZE_MAX_PRESIZE (1 << 22)
+
+/**
+ * Invoked for factorize(keys, size_hint=-1, codes=True) on the module. The keys are interned into a
+ * new vocabulary with room for `size_hint` keys (default: the number of keys, up to
+ * FACTORIZE_MAX_PRESIZE), so it doesn't rehash while they are added. Returns (codes, vocab), where
+ * `codes` is an int32 array of the ids, or None if not requested. An int64 vocabulary also takes
+ * float64 arrays, whose values are interned by bit pattern after mapping -0.0 to 0.0; NaNs get
+ * the code -1 and aren't added.
+ */
+static PyObject* factorize(PyObject* module, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = {"keys", "size_hint", "codes", NULL};
+    PyObject* keys_obj;
+    Py_ssize_t size_hint = -1;
+    int want_codes = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|np", kwlist, &keys_obj, &size_hint, &want_codes)) {
+        return NULL;
+    }
+    keycol_t keys;
+    Py_buffer floats;
+    bool is_float = false;
+    Py_ssize_t len;
+#if KEY_TYPE_TAG == TYPE_TAG_I64
+    is_float = pyconv_typed_buffer(keys_obj, &floats, 'f', 8, 1);
+#endif
+    if (is_float) {
+        len = floats.shape[0];
+    } else {
+        if (_keycol_init(&keys, keys_obj) == -1) {
+            return NULL;
+        }
+        len = keys.len;
+    }
+    if (size_hint < 0) {
+        size_hint = len < FACTORIZE_MAX_PRESIZE ? len : FACTORIZE_MAX_PRESIZE;
+    }
+    uint64_t num_buckets = (uint64_t) ((double) size_hint / PEAK_LOAD) + 1;
+    dictObj* vocab = (dictObj*) PyObject_CallFunction((PyObject*) &dictType_bytes_vocab, "(I)",
+        (unsigned int) (num_buckets < (1u << 31) ? num_buckets : (1u << 31)));
+    PyObject* codes = NULL;
+    Py_buffer codes_view;
+    if (vocab != NULL && want_codes) {
+        codes = pyconv_new_array("int32", len, &codes_view);
+        if (codes == NULL) {
+            Py_CLEAR(vocab);
+        }
+    }
+    for (Py_ssize_t i = 0; vocab != NULL && i < len; i++) {
+        k_t key;
+        int32_t id;
+        if (is_float) {
+#if KEY_TYPE_TAG == TYPE_TAG_I64
+            double d = ((const double*) floats.buf)[i];
+            if (d != d) {
+                if (codes != NULL) {
+                    ((int32_t*) codes_view.buf)[i] = -1;
+                }
+                continue;
+            }
+            d += 0.0;  // -0.0 + 0.0 == +0.0
+            memcpy(&key, &d, sizeof(key));
+#endif
+        } else if (_keycol_get(&keys, i, &key) == -1) {
+            Py_CLEAR(vocab);
+            break;
+        }
+        if (!_intern(vocab, key, &id)) {
+            Py_CLEAR(vocab);
+            break;
+        }
+        if (codes != NULL) {
+            ((int32_t*) codes_view.buf)[i] = id;
+        }
+    }
+    if (codes != NULL) {
+        PyBuffer_Release(&codes_view);
+    }
+    if (is_float) {
+        PyBuffer_Release(&floats);
+    } else {
+        _keycol_release(&keys);
+    }
+    if (vocab == NULL) {
+        Py_XDECREF(codes);
+        return NULL;
+    }
+    if (codes == NULL) {
+        codes = Py_None;
+        Py_INCREF(codes);
+    }
+    return Py_BuildValue("(NN)", codes, vocab);
+}
+
+static PyMethodDef moduleMethods_bytes_vocab[] = {
+    {"factorize", (PyCFunction)(void(*)(void))factorize, METH_VARARGS | METH_KEYWORDS, "Return (codes, vocab) for the keys, with a presized vocabulary."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef moduleDef_bytes_vocab = {
+    PyModuleDef_HEAD_INIT,
+    "bytes_vocab", // name of module
+    "pypocketmap[bytes, vocab]", // Documentation of the module
+    -1,   // size of per-interpreter state of the module, or -1 if the module keeps state in global variables
+    moduleMethods_bytes_vocab,
+};
+
+PyMODINIT_FUNC PyInit_bytes_vocab(void) {
+    PyObject* obj;
+
+    if (PyType_Ready(&dictType_bytes_vocab) < 0)
+        return NULL;
+
+    if (PyType_Ready(&keyIterType_bytes_vocab) < 0)
+        return NULL;
+
+    if (PyType_Ready(&valueIterType_bytes_vocab) < 0)
+        return NULL;
+
+    if (PyType_Ready(&itemIterType_bytes_vocab) < 0)
+        return NULL;
+
+    obj = PyModule_Create(&moduleDef_bytes_vocab);
+    if (obj == NULL)
+        return NULL;
+
+    Py_INCREF(&dictType_bytes_vocab);
+    if (PyModule_AddObject(obj, "create", (PyObject *) &dictType_bytes_vocab) < 0) {
+        Py_DECREF(&dictType_bytes_vocab);
+        Py_DECREF(obj);
+        return NULL;
+    }
+
+    return obj;
+}
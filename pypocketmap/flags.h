@@ -5,3 +5,11 @@
 #define TYPE_TAG_F32 3
 #define TYPE_TAG_F64 4
 #define TYPE_TAG_STR 5
+#define TYPE_TAG_BYTES 6
+#define TYPE_TAG_FIXED 7
+#define TYPE_TAG_PAIR 8
+#define TYPE_TAG_RECORD 9
+#define TYPE_TAG_VECTOR 10
+#define TYPE_TAG_COMPACT_I64 11
+#define TYPE_TAG_OBJECT 12
+#define TYPE_TAG_POSTINGS 13
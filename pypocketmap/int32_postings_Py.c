@@ -0,0 +1,1020 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "flags.h"
+#define KEY_TYPE_TAG TYPE_TAG_I32
+#define VAL_TYPE_TAG TYPE_TAG_POSTINGS
+#include "abstract.h"
+#include "pyconv.h"
+#include "postings.h"
+
+/*
+ * Maps whose values are growable arrays of int32 or int64 ids, e.g. the posting lists of an
+ * inverted index. This is the template for the `<key>_postings_Py.c` files. freeze() compresses
+ * every list with postings_encode, after which the lists can no longer be changed.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    h_t* ht;
+    bool valid_ht;
+    uint8_t itemsize;  // 4 or 8
+    bool frozen;
+    PyObject* format;  // "i4" or "i8"
+    // number of buffers exported by view(). Any method that could move or free the lists raises
+    // BufferError while this is non-zero
+    Py_ssize_t exports;
+} dictObj;
+
+typedef struct {
+    PyObject_HEAD
+    dictObj* owner;
+    mdict_cursor_t cursor;
+    uint32_t yielded;  // for __length_hint__
+    PyObject* item;    // the last tuple from item_iternext, reused if it has been released
+} iterObj;
+
+// The object that view() passes to numpy.frombuffer, which exports one list read-only
+typedef struct {
+    PyObject_HEAD
+    dictObj* owner;
+    const char* buf;
+    Py_ssize_t len;
+} listViewObj;
+
+static void iter_dealloc(iterObj* self);
+static int iter_traverse(iterObj* self, visitproc visit, void* arg);
+static PyObject* key_iternext(iterObj* self);
+static PyObject* value_iternext(iterObj* self);
+static PyObject* item_iternext(iterObj* self);
+static PyObject* iter_length_hint(iterObj* self);
+
+static PyMethodDef iter_methods[] = {
+    {"__length_hint__", (PyCFunction)iter_length_hint, METH_NOARGS, "Returns the number of items left"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject keyIterType_int32_postings = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_keys[int32, postings]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) key_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject valueIterType_int32_postings = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_values[int32, postings]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) value_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyTypeObject itemIterType_int32_postings = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_items[int32, postings]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(iterObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_dealloc = (destructor) iter_dealloc,
+    .tp_traverse = (traverseproc) iter_traverse,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc) item_iternext,
+    .tp_methods = iter_methods,
+};
+
+static PyObject* iter_new(dictObj* owner, PyTypeObject* itertype) {
+    iterObj* iterator = PyObject_GC_New(iterObj, itertype);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    Py_INCREF(owner);
+    iterator->owner = owner;
+    iterator->cursor = (mdict_cursor_t) {0, 0};
+    iterator->yielded = 0;
+    iterator->item = NULL;
+    PyObject_GC_Track(iterator);
+    return (PyObject *)iterator;
+}
+
+static void iter_dealloc(iterObj* self) {
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(self->owner);
+    Py_XDECREF(self->item);
+    PyObject_GC_Del(self);
+}
+
+static int iter_traverse(iterObj* self, visitproc visit, void* arg) {
+    Py_VISIT(self->owner);
+    Py_VISIT(self->item);
+    return 0;
+}
+
+/**
+ * Returns how many more items the iterator will return if the map isn't changed.
+ */
+static PyObject* iter_length_hint(iterObj* self) {
+    uint32_t size = self->owner == NULL ? 0 : self->owner->ht->size;
+    return PyLong_FromUnsignedLong(size > self->yielded ? size - self->yielded : 0);
+}
+
+static int list_view_getbuffer(listViewObj* self, Py_buffer* view, int flags) {
+    if (PyBuffer_FillInfo(view, (PyObject*) self, (void*) self->buf, self->len, 1, flags) == -1) {
+        return -1;
+    }
+    self->owner->exports++;
+    return 0;
+}
+
+static void list_view_releasebuffer(listViewObj* self, Py_buffer* view) {
+    self->owner->exports--;
+}
+
+static void list_view_dealloc(listViewObj* self) {
+    Py_XDECREF(self->owner);
+    PyObject_Del(self);
+}
+
+static PyBufferProcs list_view_buffer = {
+    (getbufferproc) list_view_getbuffer,
+    (releasebufferproc) list_view_releasebuffer,
+};
+
+static PyTypeObject listViewType_int32_postings = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap_list_view[int32, postings]",
+    .tp_doc = "",
+    .tp_basicsize = sizeof(listViewObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) list_view_dealloc,
+    .tp_as_buffer = &list_view_buffer,
+};
+
+/**
+ * Copies a list to a new 1-D numpy array, decoding it if the map is frozen.
+ */
+static PyObject* _list_to_py(dictObj* self, str_t val) {
+    const uint8_t* src = (const uint8_t*) val.ptr;
+    Py_ssize_t len = self->frozen ? (Py_ssize_t) postings_count(src, val.len) : (Py_ssize_t) (val.len / self->itemsize);
+    Py_buffer view;
+    PyObject* res = pyconv_new_array_of(self->format, len, &view);
+    if (res == NULL) {
+        return NULL;
+    }
+    if (self->frozen) {
+        postings_decode(src, val.len, self->itemsize, (char*) view.buf);
+    } else {
+        memcpy(view.buf, val.ptr, val.len);
+    }
+    PyBuffer_Release(&view);
+    return res;
+}
+
+/**
+ * Acquires a view of `obj` as a C-contiguous 1-D array of the map's id type. Other arrays and
+ * sequences are converted with numpy.
+ */
+static bool _ids_view(dictObj* self, PyObject* obj, Py_buffer* view) {
+    return pyconv_typed_array(obj, self->format, view, 'i', self->itemsize, 1);
+}
+
+/**
+ * Returns false with an exception set if an array returned by view() is still alive.
+ */
+static bool _check_not_exported(dictObj* self) {
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "cannot modify the map while a view of one of its lists exists");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns false with an exception set if the lists can't be changed, because the map is frozen
+ * or exported.
+ */
+static bool _check_appendable(dictObj* self) {
+    if (self->frozen) {
+        PyErr_SetString(PyExc_TypeError, "cannot change the lists of a frozen map");
+        return false;
+    }
+    return _check_not_exported(self);
+}
+
+/**
+ * Iterates over the keys when __next__ is called on the iterator.
+ */
+static PyObject* key_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    return PyLong_FromLong(key);
+}
+
+/**
+ * Iterates over the values when __next__ is called on the iterator. Each value is a new numpy array.
+ */
+static PyObject* value_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    return _list_to_py(self->owner, _val_get(h, i));
+}
+
+/**
+ * Iterates over the items when __next__ is called on the iterator.
+ */
+static PyObject* item_iternext(iterObj* self) {
+    if (self->owner == NULL) {
+        return NULL;
+    }
+    h_t* h = self->owner->ht;
+    uint32_t i;
+    if (!mdict_cursor_next(h, &self->cursor, &i)) {
+        return NULL;
+    }
+    self->yielded++;
+    k_t key = KEY_GET(h->keys, i);
+    PyObject* key_obj = PyLong_FromLong(key);
+    if (key_obj == NULL) {
+        return NULL;
+    }
+    return pyconv_item(&self->item, key_obj, _list_to_py(self->owner, _val_get(h, i)));
+}
+
+/**
+ * Called by the destructor for deleting the hashtable.
+ */
+void _destroy(dictObj* self) {
+    if (self->valid_ht) {
+        mdict_destroy(self->ht);
+        self->valid_ht = false;
+    }
+    Py_CLEAR(self->format);
+}
+
+/**
+ * The destructor
+ */
+static void custom_dealloc(dictObj* self) {
+    _destroy(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * Allocates the dictObj
+ */
+static PyObject* custom_new(PyTypeObject *type, PyObject *args) {
+    dictObj* self = (dictObj*) type->tp_alloc(type, 0);
+    self->ht = NULL;
+    self->valid_ht = false;
+    self->itemsize = 0;
+    self->frozen = false;
+    self->format = NULL;
+    self->exports = 0;
+    return (PyObject*) self;
+}
+
+/**
+ * Constructor, which takes the id format ("i4" or "i8", optionally with a native byte order prefix).
+ */
+static int custom_init(dictObj* self, PyObject *args) {
+    const char* format = "i8";
+    unsigned int num_buckets = 32;
+
+    if (!PyArg_ParseTuple(args, "|sI", &format, &num_buckets)) {
+        return -1;
+    }
+    if (self->valid_ht) {
+        PyErr_SetString(PyExc_RuntimeError, "the map is already initialized");
+        return -1;
+    }
+
+    const char* spec = format;
+    if (spec[0] == '=' || (PY_LITTLE_ENDIAN && spec[0] == '<') || (!PY_LITTLE_ENDIAN && spec[0] == '>')) {
+        spec++;
+    }
+    if (strcmp(spec, "i4") != 0 && strcmp(spec, "i8") != 0) {
+        PyErr_Format(PyExc_TypeError, "unsupported id format '%s', expected i4 or i8", format);
+        return -1;
+    }
+    self->format = PyUnicode_FromString(spec);
+    if (self->format == NULL) {
+        return -1;
+    }
+    self->itemsize = (uint8_t) (spec[1] - '0');
+
+    self->ht = mdict_create(num_buckets, true);
+    if (self->ht == NULL) {
+        _destroy(self);
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->valid_ht = true;
+    return 0;
+}
+
+/**
+ * Converts a key for methods that need to clean up on failure. Returns -1 with an exception set.
+ */
+static int _key_from_py(PyObject* key_obj, k_t* out) {
+    k_t key;
+    key = pyconv_as_int32(key_obj);
+    if (key == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    *out = key;
+    return 0;
+}
+
+#include "keycol.h"
+
+/**
+ * Finds the list for `key`, inserting an empty one if it is missing. Returns false with an
+ * exception set on failure.
+ */
+static bool _find_or_insert_list(h_t* h, k_t key, uint32_t* idx) {
+    int inserted = mdict_find_or_insert(h, key, idx);
+    if (inserted == -1) {
+        PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+        return false;
+    }
+    if (inserted) {
+        str_t empty = { EMPTY_STR, 0 };
+        packed_set_list(h->vals, *idx, empty);
+    }
+    return true;
+}
+
+/**
+ * This function is invoked when dict.get(k, [default]) is called.
+ */
+static PyObject* get(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    k_t key;
+    key = pyconv_as_int32(key_obj);
+    if (key == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        return Py_BuildValue("");
+    }
+    return _list_to_py(self, val);
+}
+
+/**
+ * dict.pop() invokes this function. If provided, a default is returned when the key is not found;
+ * otherwise a KeyError is raised.
+ */
+static PyObject* pop(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* default_obj = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|O", &key_obj, &default_obj)) {
+        return NULL;
+    }
+    if (!_check_not_exported(self)) {
+        return NULL;
+    }
+
+    k_t key;
+    key = pyconv_as_int32(key_obj);
+    if (key == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    uint32_t idx;
+    if (!mdict_prepare_remove(self->ht, key, &idx)) {
+        if (default_obj != NULL) {
+            Py_INCREF(default_obj);
+            return default_obj;
+        }
+        char msg[48];
+        snprintf(msg, 47, "%d", key);
+        PyErr_SetString(PyExc_KeyError, msg);;
+        return NULL;
+    }
+    PyObject* res = _list_to_py(self, _val_get(self->ht, idx));
+    if (res != NULL) {
+        mdict_remove_item(self->ht, idx);
+    }
+    return res;
+}
+
+/**
+ * dict.clear() invokes this function.
+ */
+static PyObject* clear(dictObj* self) {
+    if (!_check_not_exported(self)) {
+        return NULL;
+    }
+    mdict_clear(self->ht);
+    return Py_BuildValue("");
+}
+
+/**
+ * Invoked for dict.append(key, id), which adds `id` to the end of the list for `key`, starting a
+ * new list if the key is missing.
+ */
+static PyObject* append(dictObj* self, PyObject* args) {
+    PyObject* key_obj;
+    PyObject* id_obj;
+
+    if (!PyArg_ParseTuple(args, "OO", &key_obj, &id_obj)) {
+        return NULL;
+    }
+    if (!_check_appendable(self)) {
+        return NULL;
+    }
+    k_t key;
+    if (_key_from_py(key_obj, &key) == -1) {
+        return NULL;
+    }
+    int64_t id = PyLong_AsLongLong(id_obj);
+    if (id == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    int32_t id32 = (int32_t) id;
+    if (self->itemsize == 4 && id32 != id) {
+        PyErr_SetString(PyExc_OverflowError, "id does not fit in int32");
+        return NULL;
+    }
+
+    h_t* h = self->ht;
+    uint32_t idx;
+    if (!_find_or_insert_list(h, key, &idx)) {
+        return NULL;
+    }
+    const char* src = (self->itemsize == 4) ? (const char*) &id32 : (const char*) &id;
+    if (!packed_list_append(h->vals, idx, src, self->itemsize)) {
+        return PyErr_NoMemory();
+    }
+    return Py_BuildValue("");
+}
+
+/**
+ * Invoked for dict.extend_many(keys, ids), which is equivalent to `dict.append(keys[i], ids[i])`
+ * for each pair, with one probe per pair.
+ */
+static PyObject* extend_many(dictObj* self, PyObject* args) {
+    PyObject* keys_obj;
+    PyObject* ids_obj;
+
+    if (!PyArg_ParseTuple(args, "OO", &keys_obj, &ids_obj)) {
+        return NULL;
+    }
+    if (!_check_appendable(self)) {
+        return NULL;
+    }
+    Py_buffer ids;
+    if (!_ids_view(self, ids_obj, &ids)) {
+        return NULL;
+    }
+    keycol_t keys;
+    if (_keycol_init(&keys, keys_obj) == -1) {
+        PyBuffer_Release(&ids);
+        return NULL;
+    }
+    if (keys.len != ids.shape[0]) {
+        PyErr_Format(PyExc_ValueError, "got %zd keys and %zd ids", keys.len, ids.shape[0]);
+        _keycol_release(&keys);
+        PyBuffer_Release(&ids);
+        return NULL;
+    }
+
+    bool ok = true;
+    h_t* h = self->ht;
+    const char* src = (const char*) ids.buf;
+    for (Py_ssize_t i = 0; i < keys.len; i++, src += self->itemsize) {
+        k_t key;
+        uint32_t idx;
+        if (_keycol_get(&keys, i, &key) == -1 || !_find_or_insert_list(h, key, &idx)) {
+            ok = false;
+            break;
+        }
+        if (!packed_list_append(h->vals, idx, src, self->itemsize)) {
+            PyErr_NoMemory();
+            ok = false;
+            break;
+        }
+    }
+    _keycol_release(&keys);
+    PyBuffer_Release(&ids);
+    return ok ? Py_BuildValue("") : NULL;
+}
+
+/**
+ * Invoked for dict.view(key), which returns a read-only numpy array backed by the list for `key`.
+ * Until the array is freed, the methods that change the map raise BufferError.
+ */
+static PyObject* view(dictObj* self, PyObject* key_obj) {
+    if (self->frozen) {
+        PyErr_SetString(PyExc_TypeError, "the lists of a frozen map are compressed, use get() to decode one");
+        return NULL;
+    }
+    k_t key;
+    key = pyconv_as_int32(key_obj);
+    if (key == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        char msg[48];
+        snprintf(msg, 47, "%d", key);
+        PyErr_SetString(PyExc_KeyError, msg);;
+        return NULL;
+    }
+    listViewObj* exporter = PyObject_New(listViewObj, &listViewType_int32_postings);
+    if (exporter == NULL) {
+        return NULL;
+    }
+    Py_INCREF(self);
+    exporter->owner = self;
+    exporter->buf = val.ptr;
+    exporter->len = (Py_ssize_t) val.len;
+
+    Py_buffer tmp;
+    PyObject* res = _pyconv_numpy_call("frombuffer", (PyObject*) exporter, self->format, &tmp, 0);
+    Py_DECREF(exporter);
+    if (res != NULL) {
+        PyBuffer_Release(&tmp);
+    }
+    return res;
+}
+
+/**
+ * Invoked for dict.freeze(), which compresses every list (see postings.h). The lists of a frozen
+ * map are decoded whenever they are read, and can't be changed.
+ */
+static PyObject* freeze(dictObj* self) {
+    if (!_check_not_exported(self)) {
+        return NULL;
+    }
+    if (self->frozen) {
+        return Py_BuildValue("");
+    }
+    h_t* h = self->ht;
+    // the encoded lists are built in a new array, so that the map is unchanged if one fails
+    pv_t* new_vals = (pv_t*) calloc(h->num_buckets, sizeof(pv_t));
+    uint8_t* buf = NULL;
+    uint64_t buf_cap = 0;
+    uint32_t done = 0;
+    if (new_vals == NULL) {
+        return PyErr_NoMemory();
+    }
+    for (; done < h->num_buckets; done++) {
+        if (!_bucket_is_live(h->flags, done)) {
+            continue;
+        }
+        str_t val = _val_get(h, done);
+        uint64_t needed = postings_max_encoded_len(val.len / self->itemsize) + 1;
+        if (needed > buf_cap) {
+            uint8_t* new_buf = (uint8_t*) realloc(buf, needed);
+            if (new_buf == NULL) {
+                break;
+            }
+            buf = new_buf;
+            buf_cap = needed;
+        }
+        str_t enc = { (const char*) buf, postings_encode(val.ptr, val.len / self->itemsize, self->itemsize, buf) };
+        if (!packed_set_bytes(new_vals, done, enc)) {
+            break;
+        }
+    }
+    free(buf);
+    bool ok = (done == h->num_buckets);
+    for (uint32_t i = 0; i < done; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            packed_unset_str(ok ? h->vals : new_vals, i);
+        }
+    }
+    if (!ok) {
+        free(new_vals);
+        return PyErr_NoMemory();
+    }
+    free(h->vals);
+    h->vals = new_vals;
+    self->frozen = true;
+    return Py_BuildValue("");
+}
+
+/**
+ * This function is called for the python expression 'k in dict'. k must be of the same type as the hashtable keys.
+ */
+static int _contains_(dictObj* self, PyObject* key_obj) {
+    k_t key;
+    key = pyconv_as_int32(key_obj);
+    if (key == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+
+    return mdict_contains(self->ht, key);
+}
+
+/**
+ * This function is called when len(dict) is called. It returns the total number of items present.
+ */
+static int _len_(dictObj* self) {
+    return self->ht->size;
+}
+
+/**
+ * This function is invoked when dict[k] is called.
+ */
+static PyObject* _getitem_(dictObj* self, PyObject* key_obj){
+    k_t key;
+    key = pyconv_as_int32(key_obj);
+    if (key == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+
+    v_t val;
+    if (!mdict_get(self->ht, key, &val)) {
+        char msg[48];
+        snprintf(msg, 47, "%d", key);
+        PyErr_SetString(PyExc_KeyError, msg);;
+        return NULL;
+    }
+    return _list_to_py(self, val);
+}
+
+/**
+ * This is invoked for the python expression d[key] = ids, where ids is a 1-D array or sequence of
+ * integers. This is also invoked for del d[key], in which case the `value_obj` is NULL
+ */
+static int _setitem_(dictObj* self, PyObject* key_obj, PyObject* value_obj) {
+    if (!(value_obj == NULL ? _check_not_exported(self) : _check_appendable(self))) {
+        return -1;
+    }
+    Py_buffer view;
+    if (value_obj != NULL && !_ids_view(self, value_obj, &view)) {
+        return -1;
+    }
+
+    k_t key;
+    if (_key_from_py(key_obj, &key) == -1) {
+        if (value_obj != NULL) {
+            PyBuffer_Release(&view);
+        }
+        return -1;
+    }
+
+    if (value_obj == NULL) {
+        uint32_t idx;
+        if (!mdict_prepare_remove(self->ht, key, &idx)) {
+            char msg[48];
+            snprintf(msg, 47, "%d", key);
+            PyErr_SetString(PyExc_KeyError, msg);;
+            return -1;
+        }
+        mdict_remove_item(self->ht, idx);
+        return 0;
+    }
+
+    bool ok = true;
+    pv_t previous;
+    str_t val = { (const char*) view.buf, (uint64_t) view.len };
+    if (!mdict_set(self->ht, key, val, &previous, true)) {
+        if (self->ht->error_code) {
+            PyErr_SetString(PyExc_MemoryError, "Insufficient memory to reserve space");
+            ok = false;
+        } else {
+            VAL_UNSET(&previous, 0);
+        }
+    }
+    PyBuffer_Release(&view);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Formats the map as a string
+ */
+static PyObject* _repr_(dictObj* self) {
+    h_t* h = self->ht;
+    _PyUnicodeWriter writer;
+    _PyUnicodeWriter_Init(&writer);
+    writer.overallocate = 1;
+
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "<pypocketmap[int32, postings]: {", -1) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+    k_t key;
+    char key_repr[48];
+    bool first = true;
+    for (uint32_t i = 0; i < h->num_buckets; i++) {
+        if (_bucket_is_live(h->flags, i)) {
+            if (!first) {
+                if (_PyUnicodeWriter_WriteASCIIString(&writer, ", ", 2) < 0) {
+                    _PyUnicodeWriter_Dealloc(&writer);
+                    return NULL;
+                }
+            }
+            first = false;
+            key = KEY_GET(h->keys, i);
+            size_t key_len = snprintf(key_repr, 47, "%d", key);
+            if (_PyUnicodeWriter_WriteASCIIString(&writer, key_repr, key_len) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+
+            if (_PyUnicodeWriter_WriteASCIIString(&writer, ": ", 2) < 0) {
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+
+            PyObject* val_obj = _list_to_py(self, _val_get(h, i));
+            PyObject* val_repr = (val_obj == NULL) ? NULL : PyObject_Repr(val_obj);
+            Py_XDECREF(val_obj);
+            if (val_repr == NULL || _PyUnicodeWriter_WriteStr(&writer, val_repr) < 0) {
+                Py_XDECREF(val_repr);
+                _PyUnicodeWriter_Dealloc(&writer);
+                return NULL;
+            }
+            Py_DECREF(val_repr);
+        }
+    }
+    if (_PyUnicodeWriter_WriteASCIIString(&writer, "}>", 2) < 0) {
+        _PyUnicodeWriter_Dealloc(&writer);
+        return NULL;
+    }
+
+    return _PyUnicodeWriter_Finish(&writer);
+}
+
+/**
+ * Returns an iterator for keys when __iter__(dict) is called
+ */
+static PyObject* keys(dictObj* self) {
+    return iter_new(self, &keyIterType_int32_postings);
+}
+
+/**
+ * Returns the value iterator
+ */
+static PyObject* values(dictObj* self) {
+    return iter_new(self, &valueIterType_int32_postings);
+}
+
+/**
+ * Returns the item iterator
+ */
+static PyObject* items(dictObj* self) {
+    return iter_new(self, &itemIterType_int32_postings);
+}
+
+/**
+ * Returns the keys as a list, in the same order as keys().
+ */
+static PyObject* keys_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyLong_FromLong(key);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, key_obj);
+    }
+    // a garbage collection while converting could run a __del__ that removes items
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns the (key, list) pairs as a list, in the same order as items().
+ */
+static PyObject* items_list(dictObj* self) {
+    h_t* h = self->ht;
+    Py_ssize_t size = (Py_ssize_t) h->size;
+    PyObject* res = PyList_New(size);
+    if (res == NULL) {
+        return NULL;
+    }
+    mdict_cursor_t cursor = {0, 0};
+    Py_ssize_t n = 0;
+    uint32_t i;
+    while (n < size && mdict_cursor_next(h, &cursor, &i)) {
+        k_t key = KEY_GET(h->keys, i);
+        PyObject* key_obj = PyLong_FromLong(key);
+        if (key_obj == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyObject* item = pyconv_new_item(key_obj, _list_to_py(self, _val_get(h, i)));
+        if (item == NULL) {
+            Py_DECREF(res);
+            return NULL;
+        }
+        PyList_SET_ITEM(res, n++, item);
+    }
+    if (n < size && PyList_SetSlice(res, n, size, NULL) == -1) {
+        Py_DECREF(res);
+        return NULL;
+    }
+    return res;
+}
+
+/**
+ * Returns a new map with the same id type, frozen state and items when dict.copy() is called.
+ * The table is duplicated bucket for bucket (see mdict_copy), so nothing is rehashed.
+ */
+static PyObject* copy(dictObj* self) {
+    h_t* h = self->ht;
+    PyObject* args = Py_BuildValue("(O)", self->format);
+    if (args == NULL) {
+        return NULL;
+    }
+    dictObj* new_obj = (dictObj *) PyObject_CallObject((PyObject *) Py_TYPE(self), args);
+    Py_DECREF(args);
+    if (new_obj == NULL) {
+        return NULL;
+    }
+    new_obj->frozen = self->frozen;
+    h_t* copied = mdict_copy(h);
+    if (copied == NULL) {
+        Py_DECREF(new_obj);
+        return PyErr_NoMemory();
+    }
+    mdict_destroy(new_obj->ht);
+    new_obj->ht = copied;
+    return (PyObject*) new_obj;
+}
+
+/**
+ * Invoked for copy.deepcopy(dict). The values are plain data, so this is the same as copy().
+ */
+static PyObject* deepcopy(dictObj* self, PyObject* memo) {
+    return copy(self);
+}
+
+/**
+ * The id format, "i4" or "i8"
+ */
+static PyObject* get_dtype(dictObj* self, void* closure) {
+    Py_INCREF(self->format);
+    return self->format;
+}
+
+/**
+ * Whether freeze() has been called
+ */
+static PyObject* get_frozen(dictObj* self, void* closure) {
+    return PyBool_FromLong(self->frozen);
+}
+
+static PyGetSetDef getset_int32_postings[] = {
+    {"dtype", (getter)get_dtype, NULL, "The id format, 'i4' or 'i8'", NULL},
+    {"frozen", (getter)get_frozen, NULL, "Whether the lists are compressed and read-only", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef methods_int32_postings[] = {
+    {"get", (PyCFunction)get, METH_VARARGS, "Return a copy of the list for `key` if `key` is in the dictionary, else `default`."},
+    {"pop", (PyCFunction)pop, METH_VARARGS, "If key is in the dictionary, remove it and return its list, else return `default`. If `default` is not given and `key` is not in the dictionary, a KeyError is raised."},
+    {"clear", (PyCFunction)clear, METH_NOARGS, "Remove all items from the dictionary."},
+    {"append", (PyCFunction)append, METH_VARARGS, "Add `id` to the end of the list for `key`, starting a new list if `key` is missing."},
+    {"extend_many", (PyCFunction)extend_many, METH_VARARGS, "Append `ids[i]` to the list for `keys[i]`, for each i."},
+    {"view", (PyCFunction)view, METH_O, "Return a read-only array backed by the list for `key`. The map can't be changed until the array is freed."},
+    {"freeze", (PyCFunction)freeze, METH_NOARGS, "Compress every list. The lists of a frozen map are decoded when read, and can't be changed."},
+    {"keys", (PyCFunction)keys, METH_NOARGS, "Returns an iterator over the map's keys"},
+    {"values", (PyCFunction)values, METH_NOARGS, "Returns an iterator over the map's lists"},
+    {"items", (PyCFunction)items, METH_NOARGS, "Returns an iterator over the map's (key, list) pairs"},
+    {"keys_list", (PyCFunction)keys_list, METH_NOARGS, "Returns a list of the map's keys"},
+    {"items_list", (PyCFunction)items_list, METH_NOARGS, "Returns a list of the map's (key, list) pairs"},
+    {"copy", (PyCFunction)copy, METH_NOARGS, "Returns a deep copy of the hashtable"},
+    {"__copy__", (PyCFunction)copy, METH_NOARGS, "Returns a copy of the hashtable, as copy() does"},
+    {"__deepcopy__", (PyCFunction)deepcopy, METH_O, "Returns a copy of the hashtable"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods sequence_int32_postings = {
+    (lenfunc) _len_,                    /* sq_length */
+    0,                                  /* sq_concat */
+    0,                                  /* sq_repeat */
+    0,                                  /* sq_item */
+    0,                                  /* sq_slice */
+    0,                                  /* sq_ass_item */
+    0,                                  /* sq_ass_slice */
+    (objobjproc) _contains_,            /* sq_contains */
+};
+
+static PyMappingMethods mapping_int32_postings = {
+    (lenfunc) _len_, /*mp_length*/
+    (binaryfunc)_getitem_, /*mp_subscript*/
+    (objobjargproc)_setitem_, /*mp_ass_subscript*/
+};
+
+static PyTypeObject dictType_int32_postings = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "pypocketmap[int32, postings]",
+    .tp_doc = "pypocketmap[int32, postings]",
+    .tp_as_sequence = &sequence_int32_postings,
+    .tp_as_mapping = &mapping_int32_postings,
+    .tp_methods = methods_int32_postings,
+    .tp_getset = getset_int32_postings,
+    .tp_basicsize = sizeof(dictObj),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = (newfunc) custom_new,
+    .tp_init = (initproc) custom_init,
+    .tp_dealloc = (destructor) custom_dealloc,
+    .tp_iter = (getiterfunc) keys,
+    .tp_repr = (reprfunc) _repr_,
+};
+
+static struct PyModuleDef moduleDef_int32_postings = {
+    PyModuleDef_HEAD_INIT,
+    "int32_postings", // name of module
+    "pypocketmap[int32, postings]", // Documentation of the module
+    -1,   // size of per-interpreter state of the module, or -1 if the module keeps state in global variables
+};
+
+PyMODINIT_FUNC PyInit_int32_postings(void) {
+    PyObject* obj;
+
+    if (PyType_Ready(&dictType_int32_postings) < 0)
+        return NULL;
+
+    if (PyType_Ready(&keyIterType_int32_postings) < 0)
+        return NULL;
+
+    if (PyType_Ready(&valueIterType_int32_postings) < 0)
+        return NULL;
+
+    if (PyType_Ready(&itemIterType_int32_postings) < 0)
+        return NULL;
+
+    if (PyType_Ready(&listViewType_int32_postings) < 0)
+        return NULL;
+
+    obj = PyModule_Create(&moduleDef_int32_postings);
+    if (obj == NULL)
+        return NULL;
+
+    Py_INCREF(&dictType_int32_postings);
+    if (PyModule_AddObject(obj, "create", (PyObject *) &dictType_int32_postings) < 0) {
+        Py_DECREF(&dictType_int32_postings);
+        Py_DECREF(obj);
+        return NULL;
+    }
+
+    return obj;
+}
@@ -0,0 +1,178 @@
+#ifndef PYPOCKETMAP_KEYCOL_H_
+#define PYPOCKETMAP_KEYCOL_H_
+
+// Included by the module templates after they define k_t and `_key_from_py`, which converts
+// one key object.
+
+#include "utf8.h"
+
+/**
+ * The keys argument of a bulk method. When the key type allows it, they are read straight from a
+ * C-contiguous buffer with a matching item type (e.g. a numpy array). Pair keys also accept an
+ * (n, 2) array, or a tuple of two 1-D arrays. String keys also accept the (offsets, data) form used
+ * by Arrow: key i is data[offsets[i]:offsets[i+1]], where offsets is an int32 or int64 array of n+1
+ * items and data is a bytes-like object (UTF-8 for str keys, which is checked key by key, since
+ * the offsets can split a character). Anything else is copied to a tuple and converted one key at
+ * a time.
+ */
+typedef struct {
+    Py_ssize_t len;
+    PyObject* seq;
+#ifdef KEY_BUF_KIND
+    const k_t* data;
+    Py_buffer view;
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_PAIR
+    const int64_t* a;
+    const int64_t* b;
+    Py_buffer view_a;
+    Py_buffer view_b;
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES
+    const char* offsets;
+    Py_ssize_t offset_size;  // 4 or 8
+    Py_buffer view_offsets;
+    Py_buffer view_chars;
+#endif
+} keycol_t;
+
+static int _keycol_init(keycol_t* col, PyObject* obj) {
+    col->seq = NULL;
+#if KEY_TYPE_TAG == TYPE_TAG_PAIR
+    col->a = NULL;
+#endif
+#ifdef KEY_BUF_KIND
+    col->data = NULL;
+    if (pyconv_typed_buffer(obj, &col->view, KEY_BUF_KIND, sizeof(k_t) / KEY_BUF_COLS, KEY_BUF_COLS == 1 ? 1 : 2)) {
+        if (KEY_BUF_COLS > 1 && col->view.shape[1] != KEY_BUF_COLS) {
+            PyBuffer_Release(&col->view);
+            PyErr_Format(PyExc_ValueError, "expected an array of shape (n, %d)", KEY_BUF_COLS);
+            return -1;
+        }
+        col->data = (const k_t*) col->view.buf;
+        col->len = col->view.shape[0];
+        return 0;
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_PAIR
+    if (PyTuple_Check(obj) && PyTuple_GET_SIZE(obj) == 2
+            && PyObject_CheckBuffer(PyTuple_GET_ITEM(obj, 0)) && PyObject_CheckBuffer(PyTuple_GET_ITEM(obj, 1))) {
+        if (!pyconv_typed_buffer(PyTuple_GET_ITEM(obj, 0), &col->view_a, 'i', sizeof(int64_t), 1)) {
+            PyErr_SetString(PyExc_TypeError, "expected a pair of C-contiguous int64 arrays");
+            return -1;
+        }
+        if (!pyconv_typed_buffer(PyTuple_GET_ITEM(obj, 1), &col->view_b, 'i', sizeof(int64_t), 1)) {
+            PyBuffer_Release(&col->view_a);
+            PyErr_SetString(PyExc_TypeError, "expected a pair of C-contiguous int64 arrays");
+            return -1;
+        }
+        if (col->view_a.shape[0] != col->view_b.shape[0]) {
+            PyBuffer_Release(&col->view_a);
+            PyBuffer_Release(&col->view_b);
+            PyErr_SetString(PyExc_ValueError, "the key arrays must have the same length");
+            return -1;
+        }
+        col->a = (const int64_t*) col->view_a.buf;
+        col->b = (const int64_t*) col->view_b.buf;
+        col->len = col->view_a.shape[0];
+        return 0;
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES
+    col->offsets = NULL;
+    if (PyTuple_Check(obj) && PyTuple_GET_SIZE(obj) == 2) {
+        PyObject* offsets_obj = PyTuple_GET_ITEM(obj, 0);
+        if (pyconv_typed_buffer(offsets_obj, &col->view_offsets, 'i', 4, 1)
+                || pyconv_typed_buffer(offsets_obj, &col->view_offsets, 'i', 8, 1)) {
+            if (col->view_offsets.shape[0] == 0) {
+                PyBuffer_Release(&col->view_offsets);
+                PyErr_SetString(PyExc_ValueError, "the offsets array must have n+1 items");
+                return -1;
+            }
+            if (PyObject_GetBuffer(PyTuple_GET_ITEM(obj, 1), &col->view_chars, PyBUF_C_CONTIGUOUS) == -1) {
+                PyBuffer_Release(&col->view_offsets);
+                return -1;
+            }
+            col->offsets = (const char*) col->view_offsets.buf;
+            col->offset_size = col->view_offsets.itemsize;
+            col->len = col->view_offsets.shape[0] - 1;
+            return 0;
+        }
+    }
+#endif
+    col->seq = PySequence_Tuple(obj);
+    if (col->seq == NULL) {
+        return -1;
+    }
+    col->len = PyTuple_GET_SIZE(col->seq);
+    return 0;
+}
+
+static inline int _keycol_get(keycol_t* col, Py_ssize_t i, k_t* key) {
+#ifdef KEY_BUF_KIND
+    if (col->data != NULL) {
+        *key = col->data[i];
+        return 0;
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_PAIR
+    if (col->a != NULL) {
+        key->a = col->a[i];
+        key->b = col->b[i];
+        return 0;
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES
+    if (col->offsets != NULL) {
+        int64_t start, end;
+        if (col->offset_size == 4) {
+            int32_t bounds[2];
+            memcpy(bounds, col->offsets + i * 4, 8);
+            start = bounds[0];
+            end = bounds[1];
+        } else {
+            int64_t bounds[2];
+            memcpy(bounds, col->offsets + i * 8, 16);
+            start = bounds[0];
+            end = bounds[1];
+        }
+        if (start < 0 || start > end || end > col->view_chars.len) {
+            PyErr_Format(PyExc_ValueError, "string offsets out of range at index %zd", i);
+            return -1;
+        }
+        key->ptr = (const char*) col->view_chars.buf + start;
+        key->len = (uint64_t) (end - start);
+#if KEY_TYPE_TAG == TYPE_TAG_STR
+        if (!utf8_is_valid((const uint8_t*) key->ptr, key->len)) {
+            PyErr_Format(PyExc_ValueError, "the key at index %zd is not valid UTF-8", i);
+            return -1;
+        }
+#endif
+        return 0;
+    }
+#endif
+    return _key_from_py(PyTuple_GET_ITEM(col->seq, i), key);
+}
+
+static void _keycol_release(keycol_t* col) {
+    Py_XDECREF(col->seq);
+#ifdef KEY_BUF_KIND
+    if (col->data != NULL) {
+        PyBuffer_Release(&col->view);
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_PAIR
+    if (col->a != NULL) {
+        PyBuffer_Release(&col->view_a);
+        PyBuffer_Release(&col->view_b);
+    }
+#endif
+#if KEY_TYPE_TAG == TYPE_TAG_STR || KEY_TYPE_TAG == TYPE_TAG_BYTES
+    if (col->offsets != NULL) {
+        PyBuffer_Release(&col->view_offsets);
+        PyBuffer_Release(&col->view_chars);
+    }
+#endif
+}
+
+#endif // PYPOCKETMAP_KEYCOL_H_
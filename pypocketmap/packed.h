@@ -76,21 +76,124 @@ static inline str_t packed_get_str(packed_str_t* arr, uint32_t idx) {
     return res;
 }
 static inline bool packed_set_str(packed_str_t* arr, uint32_t idx, str_t elem) {
+    // elem doesn't have to be NUL-terminated (e.g. a slice of Arrow string data), but the copy is
     if (elem.len < 15) {
-        memcpy(arr[idx].contained.data, elem.ptr, elem.len+1);
+        memcpy(arr[idx].contained.data, elem.ptr, elem.len);
+        arr[idx].contained.data[elem.len] = '\0';
         arr[idx].contained.meta = ((uint8_t) elem.len << 1) | 1;
     } else {
         arr[idx].spilled.ptr = (char*) malloc(elem.len+1);
         if (arr[idx].spilled.ptr == NULL) return false;
-        memcpy(arr[idx].spilled.ptr, elem.ptr, elem.len+1);
+        memcpy(arr[idx].spilled.ptr, elem.ptr, elem.len);
+        arr[idx].spilled.ptr[elem.len] = '\0';
         arr[idx].spilled.meta = elem.len << 1;
     }
     return true;
 }
+// Same layout as packed_str_t, but binary-safe: no trailing NUL is copied, so
+// the contained representation holds up to 15 bytes instead of 14.
+// Use packed_get_str and packed_unset_str to read and free.
+static inline bool packed_set_bytes(packed_str_t* arr, uint32_t idx, str_t elem) {
+    if (elem.len <= 15) {
+        memcpy(arr[idx].contained.data, elem.ptr, elem.len);
+        arr[idx].contained.meta = ((uint8_t) elem.len << 1) | 1;
+    } else {
+        arr[idx].spilled.ptr = (char*) malloc(elem.len);
+        if (arr[idx].spilled.ptr == NULL) return false;
+        memcpy(arr[idx].spilled.ptr, elem.ptr, elem.len);
+        arr[idx].spilled.meta = elem.len << 1;
+    }
+    return true;
+}
+// True if the element is stored in its own allocation, which a copy of the array can't share
+static inline bool packed_is_spilled(packed_str_t* arr, uint32_t idx) {
+    return !(arr[idx].contained.meta & 1);
+}
 static inline void packed_unset_str(packed_str_t* arr, uint32_t idx) {
     if (!(arr[idx].contained.meta & 1)) {
         free(arr[idx].spilled.ptr);
     }
 }
 
+// Growable arrays in the packed_str_t layout, e.g. posting lists. Up to 15 bytes are contained;
+// a spilled array of `len` bytes has room for packed_list_capacity(len), so appending to it only
+// reallocates when the length passes a power of two. Use packed_get_str and packed_unset_str
+// to read and free.
+static inline uint64_t packed_list_capacity(uint64_t len) {
+    uint64_t cap = 16;
+    while (cap < len) {
+        cap <<= 1;
+    }
+    return cap;
+}
+static inline bool packed_set_list(packed_str_t* arr, uint32_t idx, str_t elem) {
+    if (elem.len <= 15) {
+        memcpy(arr[idx].contained.data, elem.ptr, elem.len);
+        arr[idx].contained.meta = ((uint8_t) elem.len << 1) | 1;
+    } else {
+        arr[idx].spilled.ptr = (char*) malloc(packed_list_capacity(elem.len));
+        if (arr[idx].spilled.ptr == NULL) return false;
+        memcpy(arr[idx].spilled.ptr, elem.ptr, elem.len);
+        arr[idx].spilled.meta = elem.len << 1;
+    }
+    return true;
+}
+// Appends `len` bytes to a list set by packed_set_list. On failure, the list is unchanged
+static inline bool packed_list_append(packed_str_t* arr, uint32_t idx, const char* data, uint64_t len) {
+    str_t cur = packed_get_str(arr, idx);
+    uint64_t new_len = cur.len + len;
+    if (arr[idx].contained.meta & 1) {
+        if (new_len <= 15) {
+            memcpy(arr[idx].contained.data + cur.len, data, len);
+            arr[idx].contained.meta = ((uint8_t) new_len << 1) | 1;
+            return true;
+        }
+        char* ptr = (char*) malloc(packed_list_capacity(new_len));
+        if (ptr == NULL) return false;
+        memcpy(ptr, cur.ptr, cur.len);
+        memcpy(ptr + cur.len, data, len);
+        arr[idx].spilled.ptr = ptr;
+        arr[idx].spilled.meta = new_len << 1;
+        return true;
+    }
+    char* ptr = arr[idx].spilled.ptr;
+    if (new_len > packed_list_capacity(cur.len)) {
+        ptr = (char*) realloc(ptr, packed_list_capacity(new_len));
+        if (ptr == NULL) return false;
+        arr[idx].spilled.ptr = ptr;
+    }
+    memcpy(ptr + cur.len, data, len);
+    arr[idx].spilled.meta = new_len << 1;
+    return true;
+}
+
+// Two int64s side by side, e.g. the endpoints of a graph edge. The layout matches
+// a row of a C-contiguous (n, 2) int64 array.
+typedef struct {
+    int64_t a;
+    int64_t b;
+} pair_t;
+
+static inline pair_t packed_get_pair(pair_t* arr, uint32_t idx) { return arr[idx]; }
+static inline bool packed_set_pair(pair_t* arr, uint32_t idx, pair_t elem) {
+    arr[idx] = elem;
+    return true;
+}
+static inline void packed_unset_pair(pair_t* arr, uint32_t idx) {}
+
+#ifdef KEY_FIXED_WIDTH
+// Exactly KEY_FIXED_WIDTH bytes, stored inline with no length or sentinel bits.
+// Meant for keys that are already uniformly distributed, e.g. digests.
+typedef struct {
+    char data[KEY_FIXED_WIDTH];
+} packed_fixed_t;
+
+static inline const char* packed_get_fixed(packed_fixed_t* arr, uint32_t idx) { return arr[idx].data; }
+static inline bool packed_set_fixed(packed_fixed_t* arr, uint32_t idx, const char* elem) {
+    memcpy(arr[idx].data, elem, KEY_FIXED_WIDTH);
+    return true;
+}
+static inline void packed_unset_fixed(packed_fixed_t* arr, uint32_t idx) {}
+#endif
+
 #endif // PYPOCKET_PACKED_H_
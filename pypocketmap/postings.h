@@ -0,0 +1,77 @@
+#ifndef PYPOCKETMAP_POSTINGS_H_
+#define PYPOCKETMAP_POSTINGS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Frozen posting lists are stored as the varint-encoded, zigzagged differences between consecutive
+// ids (the first one is relative to 0). Sorted lists of nearby ids take 1 or 2 bytes per id.
+// `itemsize` is 4 or 8, for lists of int32 or int64 ids
+
+// The most bytes that postings_encode can write for `n` ids
+static inline uint64_t postings_max_encoded_len(uint64_t n) {
+    return n * 10;
+}
+
+static inline int64_t _postings_read_id(const char* src, uint8_t itemsize) {
+    if (itemsize == 4) {
+        int32_t v;
+        memcpy(&v, src, 4);
+        return v;
+    }
+    int64_t v;
+    memcpy(&v, src, 8);
+    return v;
+}
+
+// Encodes `n` ids from `src` and returns the number of bytes written to `dst`
+static inline uint64_t postings_encode(const char* src, uint64_t n, uint8_t itemsize, uint8_t* dst) {
+    uint8_t* out = dst;
+    int64_t prev = 0;
+    for (uint64_t i = 0; i < n; i++, src += itemsize) {
+        int64_t cur = _postings_read_id(src, itemsize);
+        uint64_t delta = (uint64_t) cur - (uint64_t) prev;
+        uint64_t zz = (delta << 1) ^ (uint64_t) -(int64_t) (delta >> 63);
+        while (zz >= 0x80) {
+            *out++ = (uint8_t) (zz | 0x80);
+            zz >>= 7;
+        }
+        *out++ = (uint8_t) zz;
+        prev = cur;
+    }
+    return (uint64_t) (out - dst);
+}
+
+// Returns the number of ids in an encoded list of `len` bytes
+static inline uint64_t postings_count(const uint8_t* src, uint64_t len) {
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < len; i++) {
+        n += (src[i] < 0x80);
+    }
+    return n;
+}
+
+// Decodes an encoded list of `len` bytes into `dst`, which has room for postings_count ids
+static inline void postings_decode(const uint8_t* src, uint64_t len, uint8_t itemsize, char* dst) {
+    const uint8_t* end = src + len;
+    int64_t prev = 0;
+    while (src < end) {
+        uint64_t zz = 0;
+        int shift = 0;
+        while (*src >= 0x80) {
+            zz |= (uint64_t) (*src++ & 0x7f) << shift;
+            shift += 7;
+        }
+        zz |= (uint64_t) *src++ << shift;
+        prev = (int64_t) ((uint64_t) prev + ((zz >> 1) ^ (uint64_t) -(int64_t) (zz & 1)));
+        if (itemsize == 4) {
+            int32_t v = (int32_t) prev;
+            memcpy(dst, &v, 4);
+        } else {
+            memcpy(dst, &prev, 8);
+        }
+        dst += itemsize;
+    }
+}
+
+#endif // PYPOCKETMAP_POSTINGS_H_
@@ -0,0 +1,312 @@
+#ifndef PYPOCKETMAP_PYCONV_H_
+#define PYPOCKETMAP_PYCONV_H_
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "./packed.h"
+#include "./record.h"
+
+// Borrows the contents of a bytes-like object without copying. Accepts bytes,
+// bytearray, and C-contiguous memoryviews (which is how numpy arrays and other
+// buffer exporters can be passed). The result is only valid while `obj` is
+// alive and unmodified, so it should be stored with packed_set_bytes before
+// running any more Python code.
+static inline bool pyconv_bytes_view(PyObject* obj, str_t* out) {
+    if (PyBytes_Check(obj)) {
+        out->ptr = PyBytes_AS_STRING(obj);
+        out->len = PyBytes_GET_SIZE(obj);
+        return true;
+    }
+    if (PyByteArray_Check(obj)) {
+        out->ptr = PyByteArray_AS_STRING(obj);
+        out->len = PyByteArray_GET_SIZE(obj);
+        return true;
+    }
+    if (PyMemoryView_Check(obj)) {
+        Py_buffer* view = PyMemoryView_GET_BUFFER(obj);
+        if (!PyBuffer_IsContiguous(view, 'C')) {
+            PyErr_SetString(PyExc_BufferError, "memoryview is not C-contiguous");
+            return false;
+        }
+        out->ptr = (const char*) view->buf;
+        out->len = view->len;
+        return true;
+    }
+    PyErr_Format(PyExc_TypeError, "a bytes-like object is required, not '%.200s'", Py_TYPE(obj)->tp_name);
+    return false;
+}
+
+// Like pyconv_bytes_view, for keys that must be exactly `width` bytes long.
+static inline bool pyconv_fixed_view(PyObject* obj, uint64_t width, const char** out) {
+    str_t view;
+    if (!pyconv_bytes_view(obj, &view)) {
+        return false;
+    }
+    if (view.len != width) {
+        PyErr_Format(PyExc_ValueError, "expected %llu bytes, got %llu", (unsigned long long) width, (unsigned long long) view.len);
+        return false;
+    }
+    *out = view.ptr;
+    return true;
+}
+
+// Converts a 2-tuple of ints, e.g. `(src, dst)`.
+static inline bool pyconv_pair(PyObject* obj, pair_t* out) {
+    if (!PyTuple_Check(obj) || PyTuple_GET_SIZE(obj) != 2) {
+        PyErr_Format(PyExc_TypeError, "expected a tuple of 2 ints, not '%.200s'", Py_TYPE(obj)->tp_name);
+        return false;
+    }
+    out->a = PyLong_AsLongLong(PyTuple_GET_ITEM(obj, 0));
+    if (out->a == -1 && PyErr_Occurred()) {
+        return false;
+    }
+    out->b = PyLong_AsLongLong(PyTuple_GET_ITEM(obj, 1));
+    if (out->b == -1 && PyErr_Occurred()) {
+        return false;
+    }
+    return true;
+}
+
+// Converts an int that must fit in an int32_t. PyLong_AsLong only checks the range of a C long,
+// which is 64 bits on most platforms. Returns -1 with an exception set on failure.
+static inline int32_t pyconv_as_int32(PyObject* obj) {
+    long v = PyLong_AsLong(obj);
+    if (v == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (v < INT32_MIN || v > INT32_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "Python int too large to convert to int32");
+        return -1;
+    }
+    return (int32_t) v;
+}
+
+// Returns a new reference to `obj`, like Py_NewRef (which needs Python 3.10).
+static inline PyObject* pyconv_new_ref(PyObject* obj) {
+    Py_INCREF(obj);
+    return obj;
+}
+
+// Returns a new (key, value) tuple, stealing the references to both. If either is NULL because it
+// failed to convert, the other is dropped and NULL is returned.
+static inline PyObject* pyconv_new_item(PyObject* key_obj, PyObject* val_obj) {
+    PyObject* item = (key_obj == NULL || val_obj == NULL) ? NULL : PyTuple_New(2);
+    if (item == NULL) {
+        Py_XDECREF(key_obj);
+        Py_XDECREF(val_obj);
+        return NULL;
+    }
+    PyTuple_SET_ITEM(item, 0, key_obj);
+    PyTuple_SET_ITEM(item, 1, val_obj);
+    return item;
+}
+
+// Like pyconv_new_item, but like dict's item iterator, the tuple in `*cache` is filled in again if
+// no one else holds it, so a loop that unpacks each item allocates no tuples.
+static inline PyObject* pyconv_item(PyObject** cache, PyObject* key_obj, PyObject* val_obj) {
+    PyObject* item = *cache;
+    if (item == NULL || Py_REFCNT(item) != 1 || key_obj == NULL || val_obj == NULL) {
+        item = pyconv_new_item(key_obj, val_obj);
+        if (item != NULL) {
+            Py_XDECREF(*cache);
+            Py_INCREF(item);
+            *cache = item;
+        }
+        return item;
+    }
+    PyObject* old_key = PyTuple_GET_ITEM(item, 0);
+    PyObject* old_val = PyTuple_GET_ITEM(item, 1);
+    PyTuple_SET_ITEM(item, 0, key_obj);
+    PyTuple_SET_ITEM(item, 1, val_obj);
+    Py_INCREF(item);
+    Py_DECREF(old_key);
+    Py_DECREF(old_val);
+    // the cycle collector stops tracking tuples that only hold atomic objects like str and int
+#if PY_VERSION_HEX >= 0x03090000
+    if (!PyObject_GC_IsTracked(item)) {
+#else
+    if (!_PyObject_GC_IS_TRACKED(item)) {
+#endif
+        PyObject_GC_Track(item);
+    }
+    return item;
+}
+
+// Calls fn(a, b), with vectorcall where the Python version has it.
+static inline PyObject* pyconv_call2(PyObject* fn, PyObject* a, PyObject* b) {
+#if PY_VERSION_HEX >= 0x03090000
+    PyObject* argv[2] = {a, b};
+    return PyObject_Vectorcall(fn, argv, 2, NULL);
+#else
+    return PyObject_CallFunctionObjArgs(fn, a, b, NULL);
+#endif
+}
+
+// Raises KeyError(key_obj). Unlike PyErr_SetObject, this works when the key is a tuple.
+static inline void pyconv_key_error(PyObject* key_obj) {
+    PyObject* args = PyTuple_Pack(1, key_obj);
+    if (args != NULL) {
+        PyErr_SetObject(PyExc_KeyError, args);
+        Py_DECREF(args);
+    }
+}
+
+// Returns the kind of item described by a struct module format string: 'i' for signed
+// integers, 'u' for unsigned integers, 'f' for floats, or 0 for anything else (including
+// non-native byte order).
+static inline char pyconv_format_kind(const char* format) {
+    if (format == NULL) {
+        return 'u';
+    }
+    if (format[0] == '@' || format[0] == '=' || (PY_LITTLE_ENDIAN && format[0] == '<') || (!PY_LITTLE_ENDIAN && (format[0] == '>' || format[0] == '!'))) {
+        format++;
+    }
+    if (format[0] == '\0' || format[1] != '\0') {
+        return 0;
+    }
+    switch (format[0]) {
+        case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+            return 'i';
+        case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N':
+            return 'u';
+        case 'e': case 'f': case 'd':
+            return 'f';
+        default:
+            return 0;
+    }
+}
+
+// Acquires a C-contiguous buffer with `ndim` dimensions, whose items are `itemsize` bytes
+// of the given kind (see pyconv_format_kind). Returns false with no exception set if `obj`
+// does not export such a buffer, so that callers can fall back to the sequence protocol.
+static inline bool pyconv_typed_buffer(PyObject* obj, Py_buffer* view, char kind, Py_ssize_t itemsize, int ndim) {
+    if (!PyObject_CheckBuffer(obj)) {
+        return false;
+    }
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == -1) {
+        PyErr_Clear();
+        return false;
+    }
+    if (view->ndim != ndim || view->itemsize != itemsize || pyconv_format_kind(view->format) != kind) {
+        PyBuffer_Release(view);
+        return false;
+    }
+    return true;
+}
+
+// Calls numpy.<func>(arg, dtype) and acquires a C-contiguous view of the resulting array's data.
+// numpy is only imported when this is called, so it isn't needed for anything else.
+static inline PyObject* _pyconv_numpy_call(const char* func, PyObject* arg, PyObject* dtype, Py_buffer* view, int flags) {
+    PyObject* numpy = PyImport_ImportModule("numpy");
+    if (numpy == NULL) {
+        return NULL;
+    }
+    PyObject* arr = PyObject_CallMethod(numpy, func, "(OO)", arg, dtype);
+    Py_DECREF(numpy);
+    if (arr == NULL) {
+        return NULL;
+    }
+    if (PyObject_GetBuffer(arr, view, PyBUF_C_CONTIGUOUS | flags) == -1) {
+        Py_DECREF(arr);
+        return NULL;
+    }
+    return arr;
+}
+
+// Allocates a 1-D numpy array with `len` elements of `dtype` (anything numpy.dtype accepts),
+// and acquires a writable view of its data.
+static inline PyObject* pyconv_new_array_of(PyObject* dtype, Py_ssize_t len, Py_buffer* view) {
+    PyObject* shape = PyLong_FromSsize_t(len);
+    if (shape == NULL) {
+        return NULL;
+    }
+    PyObject* arr = _pyconv_numpy_call("empty", shape, dtype, view, PyBUF_WRITABLE);
+    Py_DECREF(shape);
+    return arr;
+}
+
+// Like pyconv_new_array_of, with shape (rows, cols).
+static inline PyObject* pyconv_new_matrix_of(PyObject* dtype, Py_ssize_t rows, Py_ssize_t cols, Py_buffer* view) {
+    PyObject* shape = Py_BuildValue("(nn)", rows, cols);
+    if (shape == NULL) {
+        return NULL;
+    }
+    PyObject* arr = _pyconv_numpy_call("empty", shape, dtype, view, PyBUF_WRITABLE);
+    Py_DECREF(shape);
+    return arr;
+}
+
+// Acquires a C-contiguous view of `obj` with items of `dtype` and the given kind and size (see
+// pyconv_typed_buffer), converting it with numpy.ascontiguousarray if it doesn't export one.
+static inline bool pyconv_typed_array(PyObject* obj, PyObject* dtype, Py_buffer* view, char kind, Py_ssize_t itemsize, int ndim) {
+    if (pyconv_typed_buffer(obj, view, kind, itemsize, ndim)) {
+        return true;
+    }
+    Py_buffer tmp;
+    PyObject* arr = _pyconv_numpy_call("ascontiguousarray", obj, dtype, &tmp, 0);
+    if (arr == NULL) {
+        return false;
+    }
+    PyBuffer_Release(&tmp);
+    bool ok = pyconv_typed_buffer(arr, view, kind, itemsize, ndim);
+    Py_DECREF(arr);
+    if (!ok) {
+        PyErr_Format(PyExc_ValueError, "expected a %d-dimensional array", ndim);
+    }
+    return ok;
+}
+
+static inline PyObject* pyconv_new_array(const char* dtype, Py_ssize_t len, Py_buffer* view) {
+    PyObject* dtype_obj = PyUnicode_FromString(dtype);
+    if (dtype_obj == NULL) {
+        return NULL;
+    }
+    PyObject* arr = pyconv_new_array_of(dtype_obj, len, view);
+    Py_DECREF(dtype_obj);
+    return arr;
+}
+
+static inline PyObject* pyconv_scalar_to_py(const record_field_t* field, record_scalar_t val) {
+    if (field->kind == 'f') {
+        return PyFloat_FromDouble(val.f);
+    }
+    if (field->kind == 'u') {
+        return PyLong_FromUnsignedLongLong(val.u);
+    }
+    return PyLong_FromLongLong(val.i);
+}
+
+// Converts a number to the type of a record field. Unlike record_set, this raises
+// OverflowError instead of truncating integers that don't fit.
+static inline bool pyconv_scalar_from_py(PyObject* obj, const record_field_t* field, record_scalar_t* out) {
+    if (field->kind == 'f') {
+        out->f = PyFloat_AsDouble(obj);
+        return !(out->f == -1.0 && PyErr_Occurred());
+    }
+    PyObject* index = PyNumber_Index(obj);
+    if (index == NULL) {
+        return false;
+    }
+    bool fits;
+    int bits = 8 * field->size;
+    if (field->kind == 'u') {
+        out->u = PyLong_AsUnsignedLongLong(index);
+        fits = !(out->u == (uint64_t) -1 && PyErr_Occurred()) && (bits == 64 || (out->u >> bits) == 0);
+    } else {
+        out->i = PyLong_AsLongLong(index);
+        fits = !(out->i == -1 && PyErr_Occurred())
+            && (bits == 64 || (out->i >= -(INT64_C(1) << (bits - 1)) && out->i < (INT64_C(1) << (bits - 1))));
+    }
+    Py_DECREF(index);
+    if (!fits) {
+        if (!PyErr_Occurred() || PyErr_ExceptionMatches(PyExc_OverflowError)) {
+            PyErr_Clear();
+            PyErr_Format(PyExc_OverflowError, "value does not fit in a %s%d field", field->kind == 'u' ? "uint" : "int", bits);
+        }
+        return false;
+    }
+    return true;
+}
+
+#endif // PYPOCKETMAP_PYCONV_H_
@@ -0,0 +1,119 @@
+#ifndef PYPOCKETMAP_RECORD_H_
+#define PYPOCKETMAP_RECORD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// One scalar field of a record value, `offset` bytes from the start of the record.
+// `kind` is 'i' (signed), 'u' (unsigned) or 'f' (float), as in numpy's dtype.kind.
+// Records are packed, so fields are read and written with memcpy
+typedef struct {
+    char kind;
+    uint8_t size;
+    uint32_t offset;
+} record_field_t;
+
+// A field value, widened to 64 bits
+typedef union {
+    int64_t i;
+    uint64_t u;
+    double f;
+} record_scalar_t;
+
+static inline bool record_field_init(record_field_t* field, char kind, uint8_t size, uint32_t offset) {
+    bool valid = (kind == 'f') ? (size == 4 || size == 8) : (size == 1 || size == 2 || size == 4 || size == 8);
+    if (!valid || (kind != 'i' && kind != 'u' && kind != 'f')) {
+        return false;
+    }
+    field->kind = kind;
+    field->size = size;
+    field->offset = offset;
+    return true;
+}
+
+static inline record_scalar_t record_get(const char* rec, const record_field_t* field) {
+    record_scalar_t res;
+    const char* src = rec + field->offset;
+    if (field->kind == 'f') {
+        if (field->size == 4) {
+            float f;
+            memcpy(&f, src, 4);
+            res.f = f;
+        } else {
+            memcpy(&res.f, src, 8);
+        }
+        return res;
+    }
+    switch (field->size) {
+        case 1: {
+            int8_t v;
+            memcpy(&v, src, 1);
+            res.i = (field->kind == 'i') ? v : (int64_t) (uint8_t) v;
+            break;
+        }
+        case 2: {
+            int16_t v;
+            memcpy(&v, src, 2);
+            res.i = (field->kind == 'i') ? v : (int64_t) (uint16_t) v;
+            break;
+        }
+        case 4: {
+            int32_t v;
+            memcpy(&v, src, 4);
+            res.i = (field->kind == 'i') ? v : (int64_t) (uint32_t) v;
+            break;
+        }
+        default:
+            memcpy(&res.i, src, 8);
+    }
+    return res;
+}
+
+// Integers are truncated to the field width
+static inline void record_set(char* rec, const record_field_t* field, record_scalar_t val) {
+    char* dst = rec + field->offset;
+    if (field->kind == 'f') {
+        if (field->size == 4) {
+            float f = (float) val.f;
+            memcpy(dst, &f, 4);
+        } else {
+            memcpy(dst, &val.f, 8);
+        }
+        return;
+    }
+    switch (field->size) {
+        case 1: {
+            uint8_t v = (uint8_t) val.u;
+            memcpy(dst, &v, 1);
+            break;
+        }
+        case 2: {
+            uint16_t v = (uint16_t) val.u;
+            memcpy(dst, &v, 2);
+            break;
+        }
+        case 4: {
+            uint32_t v = (uint32_t) val.u;
+            memcpy(dst, &v, 4);
+            break;
+        }
+        default:
+            memcpy(dst, &val.u, 8);
+    }
+}
+
+// Adds `delta` to the field in place and returns the new value. Like numpy, integers
+// wrap around at the field width
+static inline record_scalar_t record_add(char* rec, const record_field_t* field, record_scalar_t delta) {
+    record_scalar_t val = record_get(rec, field);
+    if (field->kind == 'f') {
+        val.f += delta.f;
+    } else {
+        val.u += delta.u;
+    }
+    record_set(rec, field, val);
+    return record_get(rec, field);
+}
+
+#endif // PYPOCKETMAP_RECORD_H_
@@ -278,12 +278,12 @@
 #define ABSL_ALIGNED(x)
 #endif
 
-const uint8_t FLAGS_EMPTY = 128;     // 0b10000000 
-const uint8_t FLAGS_DELETED = 254;   // 0b11111110
-const uint8_t FLAGS_SENTINEL = 255;  // 0b11111111
-const int8_t FLAGS_EMPTY_SIGNED = -128;
-const int8_t FLAGS_DELETED_SIGNED = -2;
-const int8_t FLAGS_SENTINEL_SIGNED = -1;
+static const uint8_t FLAGS_EMPTY = 128;     // 0b10000000 
+static const uint8_t FLAGS_DELETED = 254;   // 0b11111110
+static const uint8_t FLAGS_SENTINEL = 255;  // 0b11111111
+static const int8_t FLAGS_EMPTY_SIGNED = -128;
+static const int8_t FLAGS_DELETED_SIGNED = -2;
+static const int8_t FLAGS_SENTINEL_SIGNED = -1;
 // any full entry will be a 0 | (7-bit h2 value), greater than FLAGS_SENTINEL when interpreted as int8_t
 
 #if defined(ABSL_INTERNAL_HAVE_AVX2)
@@ -336,7 +336,7 @@ static inline uint32_t _group_count_leading_empty_or_deleted(g_t ctrl) {
       _mm256_movemask_epi8(_mm256_cmpgt_epi8(special, ctrl)) + 1));
 }
 
-ABSL_ALIGNED(32) const uint32_t __sll_permutations[8][8] = {
+static ABSL_ALIGNED(32) const uint32_t __sll_permutations[8][8] = {
   { 0, 1, 2, 3, 4, 5, 6, 7 }, { 1, 0, 2, 3, 4, 5, 6, 7 },
   { 2, 1, 0, 3, 4, 5, 6, 7 }, { 3, 1, 2, 0, 4, 5, 6, 7 },
   { 4, 1, 2, 3, 0, 5, 6, 7 }, { 5, 1, 2, 3, 4, 0, 6, 7 },
@@ -0,0 +1,159 @@
+#ifndef PYPOCKETMAP_SORT_H_
+#define PYPOCKETMAP_SORT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Stable radix sorts of bucket indices, for sorted_items(). Numbers are mapped to uint64_t keys
+// whose unsigned order is the wanted order, and sorted a byte at a time from the least significant
+// one. Strings are split into 257 buckets (the end of the string, then each byte value) from the
+// first byte on, so most of them are never compared as a whole.
+
+// partitions of at most this many strings are insertion sorted instead of split again
+#define SORT_INSERTION_MAX 32
+
+static inline uint64_t sort_key_int(int64_t v, bool reverse) {
+    uint64_t key = (uint64_t) v ^ (1ULL << 63);
+    return reverse ? ~key : key;
+}
+
+// NaNs get the largest key in both directions, so they come last. -0.0 gets the key of 0.0, since
+// they are equal, and equal values keep their order
+static inline uint64_t sort_key_double(double v, bool reverse) {
+    if (v != v) {
+        return UINT64_MAX;
+    }
+    if (v == 0) {
+        v = 0.0;
+    }
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint64_t key = (bits >> 63) ? ~bits : bits | (1ULL << 63);
+    return reverse ? ~key : key;
+}
+
+// Sorts idx[0, n) by keys[0, n), which are moved along with them, keeping the order of equal keys.
+// A byte that is the same in every key is skipped. The scratch arrays must hold n items.
+static void sort_u64(uint64_t* keys, uint32_t* idx, uint64_t* keys_tmp, uint32_t* idx_tmp, size_t n) {
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        for (int b = 0; b < 8; b++) {
+            counts[b][(k >> (8 * b)) & 0xff]++;
+        }
+    }
+    uint64_t* src_keys = keys;
+    uint32_t* src_idx = idx;
+    uint64_t* dst_keys = keys_tmp;
+    uint32_t* dst_idx = idx_tmp;
+    for (int b = 0; b < 8 && n > 0; b++) {
+        if (counts[b][(keys[0] >> (8 * b)) & 0xff] == n) {
+            continue;
+        }
+        size_t pos = 0;
+        for (int c = 0; c < 256; c++) {
+            size_t count = counts[b][c];
+            counts[b][c] = pos;
+            pos += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t to = counts[b][(src_keys[i] >> (8 * b)) & 0xff]++;
+            dst_keys[to] = src_keys[i];
+            dst_idx[to] = src_idx[i];
+        }
+        uint64_t* swap_keys = src_keys;
+        uint32_t* swap_idx = src_idx;
+        src_keys = dst_keys;
+        src_idx = dst_idx;
+        dst_keys = swap_keys;
+        dst_idx = swap_idx;
+    }
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, n * sizeof(uint64_t));
+        memcpy(idx, src_idx, n * sizeof(uint32_t));
+    }
+}
+
+typedef struct {
+    const uint8_t* ptr;
+    uint32_t len;
+    uint32_t idx;
+} sort_str_t;
+
+// The bucket of `s` when splitting by byte `depth`: 0 if the string ends before it
+static inline uint32_t _sort_str_bucket(const sort_str_t* s, size_t depth) {
+    return depth < s->len ? 1u + s->ptr[depth] : 0;
+}
+
+// Compares two strings that are equal before byte `depth`
+static inline int _sort_str_cmp(const sort_str_t* a, const sort_str_t* b, size_t depth) {
+    size_t len_a = a->len - depth;
+    size_t len_b = b->len - depth;
+    int c = memcmp(a->ptr + depth, b->ptr + depth, len_a < len_b ? len_a : len_b);
+    return c != 0 ? c : (len_a > len_b) - (len_a < len_b);
+}
+
+// Sorts a[0, n), whose strings are all equal before byte `depth`, in byte order (or the reverse),
+// keeping the order of equal strings. `tmp` must hold n items. Each split recurses into all but
+// the largest bucket, which the loop carries on with, so the stack holds O(log n) frames.
+static inline void sort_strings(sort_str_t* a, sort_str_t* tmp, size_t n, size_t depth, bool reverse) {
+    while (n > SORT_INSERTION_MAX) {
+        size_t counts[257];
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < n; i++) {
+            counts[_sort_str_bucket(&a[i], depth)]++;
+        }
+        uint32_t first = _sort_str_bucket(&a[0], depth);
+        if (counts[first] == n) {
+            if (first == 0) {
+                // all of the strings are equal
+                return;
+            }
+            depth++;
+            continue;
+        }
+        // bucket 0 goes first (or last if reversed), since a string sorts before the longer ones
+        // that start with it
+        size_t starts[257];
+        size_t pos = 0;
+        for (int k = 0; k < 257; k++) {
+            int c = reverse ? 256 - k : k;
+            starts[c] = pos;
+            pos += counts[c];
+        }
+        size_t next[257];
+        memcpy(next, starts, sizeof(next));
+        for (size_t i = 0; i < n; i++) {
+            tmp[next[_sort_str_bucket(&a[i], depth)]++] = a[i];
+        }
+        memcpy(a, tmp, n * sizeof(sort_str_t));
+
+        uint32_t largest = 1;
+        for (uint32_t c = 2; c < 257; c++) {
+            if (counts[c] > counts[largest]) {
+                largest = c;
+            }
+        }
+        for (uint32_t c = 1; c < 257; c++) {
+            if (c != largest && counts[c] > 1) {
+                sort_strings(a + starts[c], tmp, counts[c], depth + 1, reverse);
+            }
+        }
+        a += starts[largest];
+        n = counts[largest];
+        depth++;
+    }
+    for (size_t i = 1; i < n; i++) {
+        sort_str_t s = a[i];
+        size_t j = i;
+        while (j > 0 && (reverse ? _sort_str_cmp(&a[j - 1], &s, depth) < 0 : _sort_str_cmp(&a[j - 1], &s, depth) > 0)) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = s;
+    }
+}
+
+#endif // PYPOCKETMAP_SORT_H_
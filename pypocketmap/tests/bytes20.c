@@ -0,0 +1,83 @@
+#include "clar.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../flags.h"
+#define KEY_TYPE_TAG TYPE_TAG_FIXED
+#define KEY_FIXED_WIDTH 20
+#define VAL_TYPE_TAG TYPE_TAG_I64
+#include "../abstract.h"
+
+static h_t* m;
+static char test_key[KEY_FIXED_WIDTH];
+
+// splitmix64, so that keys look like digests
+static uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static k_t make_key(int i, char* mut_key) {
+  for (int j = 0; j < KEY_FIXED_WIDTH; j += 8) {
+    uint64_t word = mix(((uint64_t) i << 8) | j);
+    memcpy(&mut_key[j], &word, (KEY_FIXED_WIDTH - j < 8) ? KEY_FIXED_WIDTH - j : 8);
+  }
+  return mut_key;
+}
+
+#define KEY(i) (make_key(i, test_key))
+
+void test_bytes20__initialize(void) {
+  m = mdict_create(32, true);
+}
+
+void test_bytes20__cleanup(void) {
+  mdict_destroy(m);
+}
+
+void test_bytes20__packed_size(void) {
+  cl_assert_equal_i(sizeof(pk_t), KEY_FIXED_WIDTH);
+}
+
+void test_bytes20__insert_get_remove(void) {
+  v_t v;
+  int count = 5000;
+  for (int i = 0; i < count; i++) {
+    cl_assert(mdict_set(m, KEY(i), (int64_t) i, NULL, true));
+  }
+  cl_assert_equal_i(m->size, count);
+  for (int i = 0; i < count; i++) {
+    cl_assert(mdict_get(m, KEY(i), &v));
+    cl_assert_equal_i(v, i);
+  }
+  for (int i = count; i < 2*count; i++) {
+    cl_assert(!mdict_get(m, KEY(i), &v));
+  }
+  for (int i = 0; i < count; i += 2) {
+    uint32_t idx;
+    cl_assert(mdict_prepare_remove(m, KEY(i), &idx));
+    mdict_remove_item(m, idx);
+  }
+  for (int i = 0; i < count; i++) {
+    cl_assert_equal_b(mdict_get(m, KEY(i), &v), i & 1);
+  }
+}
+
+void test_bytes20__every_byte_compared(void) {
+  char base[KEY_FIXED_WIDTH];
+  char other[KEY_FIXED_WIDTH];
+  memcpy(base, KEY(1), KEY_FIXED_WIDTH);
+  cl_assert(mdict_set(m, base, 1, NULL, true));
+  for (int j = 0; j < KEY_FIXED_WIDTH; j++) {
+    memcpy(other, base, KEY_FIXED_WIDTH);
+    other[j] ^= 0x40;
+    cl_assert(!KEY_EQ(base, other));
+    cl_assert(!mdict_contains(m, other));
+  }
+  memcpy(other, base, KEY_FIXED_WIDTH);
+  cl_assert(KEY_EQ(base, other));
+  cl_assert(mdict_contains(m, other));
+}
@@ -0,0 +1,71 @@
+#ifndef PYPOCKETMAP_TOKENIZE_H_
+#define PYPOCKETMAP_TOKENIZE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "./simd.h"
+
+// Splits a buffer into the runs of bytes between delimiters, for count_tokens(). With SSE2 and
+// up to TOKENIZE_MAX_SPLATS delimiters, the next delimiter is found 16 bytes at a time by
+// comparing against each one; otherwise bytes are looked up in a table one at a time.
+
+#define TOKENIZE_MAX_SPLATS 8
+
+typedef struct {
+    bool is_delim[256];
+    int num_delims;
+    uint8_t delims[TOKENIZE_MAX_SPLATS];
+} tokenizer_t;
+
+static inline void tokenizer_init(tokenizer_t* t, const uint8_t* delims, size_t num_delims) {
+    memset(t->is_delim, 0, sizeof(t->is_delim));
+    t->num_delims = 0;
+    for (size_t i = 0; i < num_delims; i++) {
+        if (!t->is_delim[delims[i]]) {
+            t->is_delim[delims[i]] = true;
+            if (t->num_delims < TOKENIZE_MAX_SPLATS) {
+                t->delims[t->num_delims] = delims[i];
+            }
+            t->num_delims++;
+        }
+    }
+}
+
+// Returns the index of the first delimiter in buf[pos:len], or len if there is none
+static inline size_t tokenizer_find_delim(const tokenizer_t* t, const uint8_t* buf, size_t pos, size_t len) {
+#ifdef ABSL_INTERNAL_HAVE_SSE2
+    if (t->num_delims <= TOKENIZE_MAX_SPLATS) {
+        __m128i splats[TOKENIZE_MAX_SPLATS];
+        for (int k = 0; k < t->num_delims; k++) {
+            splats[k] = _mm_set1_epi8((char) t->delims[k]);
+        }
+        for (; pos + 16 <= len; pos += 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*) (buf + pos));
+            __m128i match = _mm_setzero_si128();
+            for (int k = 0; k < t->num_delims; k++) {
+                match = _mm_or_si128(match, _mm_cmpeq_epi8(chunk, splats[k]));
+            }
+            uint32_t bits = (uint32_t) _mm_movemask_epi8(match);
+            if (bits) {
+                return pos + count_trailing_zeroes_unchecked32(bits);
+            }
+        }
+    }
+#endif
+    while (pos < len && !t->is_delim[buf[pos]]) {
+        pos++;
+    }
+    return pos;
+}
+
+// Returns the index of the first byte in buf[pos:len] that isn't a delimiter, or len
+static inline size_t tokenizer_skip_delims(const tokenizer_t* t, const uint8_t* buf, size_t pos, size_t len) {
+    while (pos < len && t->is_delim[buf[pos]]) {
+        pos++;
+    }
+    return pos;
+}
+
+#endif // PYPOCKETMAP_TOKENIZE_H_
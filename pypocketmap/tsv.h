@@ -0,0 +1,172 @@
+#ifndef PYPOCKETMAP_TSV_H_
+#define PYPOCKETMAP_TSV_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Number parsing and formatting for load_tsv() and dump_tsv(). Each parser takes the whole of a
+// field, which isn't NUL-terminated, and returns false if it isn't exactly one number.
+
+// Bytes read or written at a time by load_tsv() and dump_tsv()
+#define TSV_CHUNK (1 << 20)
+
+static inline bool tsv_parse_int64(const char* buf, size_t len, int64_t* out) {
+    size_t i = 0;
+    bool negative = false;
+    if (len > 0 && (buf[0] == '-' || buf[0] == '+')) {
+        negative = buf[0] == '-';
+        i = 1;
+    }
+    if (i == len || len - i > 20) {
+        return false;
+    }
+    uint64_t acc = 0;
+    for (; i < len; i++) {
+        unsigned digit = (unsigned char) buf[i] - '0';
+        if (digit > 9 || acc > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        acc = acc * 10 + digit;
+    }
+    if (negative) {
+        if (acc > (uint64_t) INT64_MAX + 1) {
+            return false;
+        }
+        *out = acc == 0 ? 0 : -(int64_t) (acc - 1) - 1;
+    } else {
+        if (acc > (uint64_t) INT64_MAX) {
+            return false;
+        }
+        *out = (int64_t) acc;
+    }
+    return true;
+}
+
+static const double TSV_POWERS_OF_10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Plain decimals like "-12.5" or "3e-4" whose digits fit in 53 bits and whose exponent is at most
+// 22 are converted exactly with one multiplication or division (Clinger's fast path). Anything else,
+// including "nan" and "inf", is copied out and converted with strtod.
+static inline bool tsv_parse_double(const char* buf, size_t len, double* out) {
+    size_t i = 0;
+    bool negative = false;
+    if (len > 0 && (buf[0] == '-' || buf[0] == '+')) {
+        negative = buf[0] == '-';
+        i = 1;
+    }
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    size_t digits_start = i;
+    for (; i < len && (unsigned char) (buf[i] - '0') <= 9; i++) {
+        mantissa = mantissa * 10 + (buf[i] - '0');
+        num_digits++;
+    }
+    if (i < len && buf[i] == '.') {
+        for (i++; i < len && (unsigned char) (buf[i] - '0') <= 9; i++) {
+            mantissa = mantissa * 10 + (buf[i] - '0');
+            num_digits++;
+            exponent--;
+        }
+    }
+    bool fast = num_digits > 0 && num_digits <= 19 && i > digits_start;
+    if (fast && i < len && (buf[i] == 'e' || buf[i] == 'E')) {
+        int64_t e;
+        fast = i + 1 < len && len - i - 1 <= 4 && tsv_parse_int64(buf + i + 1, len - i - 1, &e);
+        exponent += fast ? (int) e : 0;
+        i = len;
+    }
+    if (fast && i == len && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double d = (double) mantissa;
+        d = exponent < 0 ? d / TSV_POWERS_OF_10[-exponent] : d * TSV_POWERS_OF_10[exponent];
+        *out = negative ? -d : d;
+        return true;
+    }
+
+    char copy[64];
+    if (len == 0 || len >= sizeof(copy)) {
+        return false;
+    }
+    memcpy(copy, buf, len);
+    copy[len] = '\0';
+    char* end;
+    *out = strtod(copy, &end);
+    return end == copy + len;
+}
+
+// Room for any number written by the functions below
+#define TSV_NUMBER_MAX 32
+
+// Writes `value` in decimal to out, and returns the number of bytes written
+static inline size_t tsv_format_int64(char* out, int64_t value) {
+    char digits[20];
+    size_t n = 0;
+    uint64_t mag = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+    do {
+        digits[n++] = (char) ('0' + mag % 10);
+        mag /= 10;
+    } while (mag != 0);
+    size_t len = 0;
+    if (value < 0) {
+        out[len++] = '-';
+    }
+    while (n > 0) {
+        out[len++] = digits[--n];
+    }
+    return len;
+}
+
+// Writes the shortest of the %.{min_digits}g ... %.{max_digits}g forms of `value` that reads back as
+// the same number (at `is_float32` precision), and returns the number of bytes written
+static inline size_t tsv_format_double(char* out, double value, bool is_float32) {
+    int min_digits = is_float32 ? 6 : 15;
+    int max_digits = is_float32 ? 9 : 17;
+    int len = 0;
+    for (int digits = min_digits; digits <= max_digits; digits++) {
+        len = snprintf(out, TSV_NUMBER_MAX, "%.*g", digits, value);
+        double back = strtod(out, NULL);
+        if (value != value || (is_float32 ? (float) back == (float) value : back == value)) {
+            break;
+        }
+    }
+    return (size_t) len;
+}
+
+// Buffers the output of dump_tsv(), so that it's written TSV_CHUNK bytes at a time
+typedef struct {
+    FILE* fp;
+    char* buf;
+    size_t len;
+    bool failed;
+} tsv_writer_t;
+
+static inline void tsv_flush(tsv_writer_t* w) {
+    if (w->len > 0 && fwrite(w->buf, 1, w->len, w->fp) != w->len) {
+        w->failed = true;
+    }
+    w->len = 0;
+}
+
+static inline void tsv_write(tsv_writer_t* w, const char* data, size_t n) {
+    if (w->len + n > TSV_CHUNK) {
+        tsv_flush(w);
+        if (n > TSV_CHUNK) {
+            if (fwrite(data, 1, n, w->fp) != n) {
+                w->failed = true;
+            }
+            return;
+        }
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+}
+
+#endif // PYPOCKETMAP_TSV_H_
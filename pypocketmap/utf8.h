@@ -0,0 +1,61 @@
+#ifndef PYPOCKETMAP_UTF8_H_
+#define PYPOCKETMAP_UTF8_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Checks the str keys that are read from raw bytes (count_tokens, the text loaders and the
+// (offsets, data) key columns) before they are stored, since they must decode when read back.
+
+// Returns true if buf[0:len] is valid UTF-8, by the same rules as Python's strict decoder (no
+// overlong forms or surrogates). Runs of ASCII are skipped 8 bytes at a time
+static inline bool utf8_is_valid(const uint8_t* buf, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t word;
+            memcpy(&word, buf + i, 8);
+            if ((word & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        uint8_t c = buf[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t extra;
+        uint32_t cp;
+        if (c >= 0xc2 && c <= 0xdf) {
+            extra = 1;
+            cp = c & 0x1f;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            extra = 2;
+            cp = c & 0x0f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            extra = 3;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+        if (len - i <= extra) {
+            return false;
+        }
+        for (size_t k = 1; k <= extra; k++) {
+            uint8_t b = buf[i + k];
+            if ((b & 0xc0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (b & 0x3f);
+        }
+        if ((extra == 2 && (cp < 0x800 || (cp >= 0xd800 && cp <= 0xdfff))) || (extra == 3 && (cp < 0x10000 || cp > 0x10ffff))) {
+            return false;
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+#endif // PYPOCKETMAP_UTF8_H_
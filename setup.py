@@ -1,3 +1,4 @@
+import glob
 import os
 import platform
 import sys
@@ -103,30 +104,15 @@ class MyBuildCommand(BuildCommand):
         super().build_extension(ext)
 
 
-module_int64_int64 = Extension(
-    "int64_int64",
-    sources=[os.path.join(parent_dir, "int64_int64_Py.c")]
-)
-module_str_float32 = Extension(
-    "str_float32",
-    sources=[os.path.join(parent_dir, "str_float32_Py.c")]
-)
-module_str_float64 = Extension(
-    "str_float64",
-    sources=[os.path.join(parent_dir, "str_float64_Py.c")]
-)
-module_str_int32 = Extension(
-    "str_int32",
-    sources=[os.path.join(parent_dir, "str_int32_Py.c")]
-)
-module_str_int64 = Extension(
-    "str_int64",
-    sources=[os.path.join(parent_dir, "str_int64_Py.c")],
-)
-module_str_str = Extension(
-    "str_str",
-    sources=[os.path.join(parent_dir, "str_str_Py.c")],
+# one extension per generated `<key>_<value>_Py.c` (or `<key>_record_Py.c`) file, see gen.py
+module_names = sorted(
+    os.path.basename(path)[: -len("_Py.c")]
+    for path in glob.glob(os.path.join(parent_dir, "*_Py.c"))
 )
+ext_modules = [
+    Extension(name, sources=[os.path.join(parent_dir, f"{name}_Py.c")])
+    for name in module_names
+]
 
 with open("README.md") as fh:
     long_description = fh.read()
@@ -148,29 +134,25 @@ setup(
             "abstract.h",
             "bits.h",
             "flags.h",
+            "keycol.h",
             "optimization.h",
             "packed.h",
             "polymur-hash.h",
+            "postings.h",
+            "pyconv.h",
+            "record.h",
             "simd.h",
+            "sort.h",
+            "tokenize.h",
+            "tsv.h",
+            "utf8.h",
         ],
         "pypocketmap._pkt_c": [
             "__init__.py",
-            "int64_int64.pyi",
-            "str_float32.pyi",
-            "str_float64.pyi",
-            "str_int32.pyi",
-            "str_int64.pyi",
-            "str_str.pyi",
+            *(f"{name}.pyi" for name in module_names),
         ],
     },
-    ext_modules=[
-        module_int64_int64,
-        module_str_float32,
-        module_str_float64,
-        module_str_int32,
-        module_str_int64,
-        module_str_str,
-    ],
+    ext_modules=ext_modules,
     packages=find_packages(),
     classifiers=[
         "Development Status :: 3 - Alpha",
@@ -0,0 +1,37 @@
+import sys
+import time
+
+import numpy as np
+
+
+def run(implementation, keys, values):
+    if implementation == "dict":
+        sums = {}
+        for k, v in zip(keys.tolist(), values.tolist()):
+            sums[k] = sums.get(k, 0.0) + v
+        return sums
+
+    import pypocketmap as pkm
+
+    sums = pkm.create(int, float)
+    if implementation == "loop":
+        for k, v in zip(keys.tolist(), values.tolist()):
+            sums[k] = sums.get(k, 0.0) + v
+    else:
+        sums.accumulate(keys, values)
+    return sums
+
+
+if __name__ == "__main__":
+    # usage: accumulate.py {dict,loop,pkm} [rows] [groups]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 10_000_000
+    groups = int(sys.argv[3]) if len(sys.argv) > 3 else 1_000_000
+    rng = np.random.default_rng(0)
+    keys = rng.integers(0, groups, count)
+    values = rng.random(count)
+
+    start = time.perf_counter()
+    sums = run(implementation, keys, values)
+    elapsed = time.perf_counter() - start
+    print(f"groups: {len(sums)}  sum: {elapsed:.3f}s  ({elapsed / count * 1e9:.1f} ns/row)")
@@ -0,0 +1,32 @@
+import copy
+import sys
+import time
+
+import numpy as np
+
+
+if __name__ == "__main__":
+    # usage: copy_map.py {int,str} [entries]
+    import pypocketmap as pkm
+
+    key_type = sys.argv[1] if len(sys.argv) > 1 else "int"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 10_000_000
+    rng = np.random.default_rng(0)
+    d = pkm.create(int if key_type == "int" else str, int)
+    keys = rng.permutation(count * 4)[:count]
+    if key_type == "str":
+        # about a quarter of the keys are longer than 14 bytes, so they are spilled
+        keys = [f"user:{k:x}" + ("-long-suffix" if k % 4 == 0 else "") for k in keys.tolist()]
+    d.set_many(keys, rng.integers(0, 2**40, count))
+
+    start = time.perf_counter()
+    e = copy.copy(d)
+    copy_s = time.perf_counter() - start
+    del e
+
+    # what copy() used to do: reinsert every entry into a table of the same size
+    start = time.perf_counter()
+    e = type(d)(int(len(d) / 0.79) + 1)
+    e.update(d)
+    update_s = time.perf_counter() - start
+    print(f"entries: {len(d)}  copy: {copy_s:.3f}s  presized update: {update_s:.3f}s")
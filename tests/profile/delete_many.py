@@ -0,0 +1,52 @@
+import sys
+import time
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    res = fn()
+    return time.perf_counter() - start, res
+
+
+def del_loop(d, keys):
+    removed = 0
+    for k in keys:
+        if k in d:
+            del d[k]
+            removed += 1
+    return removed
+
+
+if __name__ == "__main__":
+    # usage: delete_many.py [entries]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 5_000_000
+    rng = np.random.default_rng(0)
+    keys = rng.permutation(count * 4)[:count]
+    d = pkm.create(int, int)
+    d.set_many(keys, np.arange(count))
+    e = d.copy()
+    # an expiry list: 60% of the keys, plus as many that were never inserted
+    expired = np.concatenate([keys[: count * 3 // 5], rng.integers(count * 4, count * 8, count * 3 // 5)])
+    rng.shuffle(expired)
+
+    many_s, removed = timed(lambda: d.delete_many(expired))
+    loop_s, loop_removed = timed(lambda: del_loop(e, expired.tolist()))
+    assert removed == loop_removed == count * 3 // 5 and dict(d.items()) == dict(e.items())
+
+    words = pkm.create(str, int)
+    text = [f"user:{i}" for i in range(count)]
+    words.set_many(text, np.arange(count))
+    data = "".join(text[: count // 2]).encode()
+    offsets = np.zeros(count // 2 + 1, dtype=np.int64)
+    np.cumsum([len(t) for t in text[: count // 2]], out=offsets[1:])
+    str_s, str_removed = timed(lambda: words.delete_many((offsets, data)))
+    assert str_removed == count // 2
+
+    print(
+        f"entries: {count}  keys: {len(expired)}  delete_many: {many_s:.3f}s  del loop: {loop_s:.3f}s  "
+        f"str (offsets, data) delete_many: {str_s:.3f}s for {str_removed}"
+    )
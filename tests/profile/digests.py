@@ -0,0 +1,48 @@
+import hashlib
+import resource
+import sys
+import time
+
+
+def build(implementation, digests):
+    import pypocketmap as pkm
+
+    if implementation == "hex":
+        m = pkm.create(str, int)
+        keys = [d.hex() for d in digests]
+    elif implementation == "bytes":
+        m = pkm.create(bytes, int)
+        keys = digests
+    else:
+        m = pkm.create(pkm.dtype[implementation], int)
+        keys = digests
+    return m, keys
+
+
+if __name__ == "__main__":
+    # usage: digests.py {hex,bytes,bytes16,bytes20,bytes32} [count]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "bytes32"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 2_000_000
+    algo = {"bytes16": hashlib.md5, "bytes20": hashlib.sha1}.get(implementation, hashlib.sha256)
+    digests = [algo(i.to_bytes(8, "little")).digest() for i in range(count)]
+
+    m, keys = build(implementation, digests)
+    # the tables are allocated with plain malloc, so measure the max RSS growth
+    rss_before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    start = time.perf_counter()
+    for i, k in enumerate(keys):
+        m[k] = i
+    insert_s = time.perf_counter() - start
+    rss_after = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss_unit = 1 if sys.platform == "darwin" else 1024
+
+    start = time.perf_counter()
+    for k in keys:
+        m[k]
+    lookup_s = time.perf_counter() - start
+
+    print(m.__class__.__name__, "size:", len(m))
+    print(
+        f"insert: {insert_s:.3f}s  lookup: {lookup_s:.3f}s  "
+        f"max RSS growth: {(rss_after - rss_before) * rss_unit / len(m):.1f} bytes/entry"
+    )
@@ -0,0 +1,47 @@
+import resource
+import sys
+import time
+
+import numpy as np
+
+
+def build(implementation, tokens, matrix):
+    if implementation == "dict":
+        index = {t: i for i, t in enumerate(tokens)}
+        return lambda batch: matrix[[index[t] for t in batch]]
+
+    import pypocketmap as pkm
+
+    m = pkm.create(str, (matrix.dtype, matrix.shape[1]))
+    m.scatter(tokens, matrix)
+    return m.gather
+
+
+if __name__ == "__main__":
+    # usage: embeddings.py {dict,pkm} [count] [dim]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 500_000
+    dim = int(sys.argv[3]) if len(sys.argv) > 3 else 128
+    tokens = [f"token{i}" for i in range(count)]
+    rng = np.random.default_rng(0)
+    matrix = rng.random((count, dim), dtype=np.float32)
+    batches = [[tokens[i] for i in rng.integers(0, count, 1024)] for _ in range(500)]
+
+    rss_before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    start = time.perf_counter()
+    lookup = build(implementation, tokens, matrix)
+    build_s = time.perf_counter() - start
+    rss_after = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss_unit = 1 if sys.platform == "darwin" else 1024
+    if implementation != "dict":
+        del matrix
+
+    start = time.perf_counter()
+    for batch in batches:
+        lookup(batch)
+    gather_s = time.perf_counter() - start
+
+    print(
+        f"build: {build_s:.3f}s  gather 500x1024: {gather_s:.3f}s  "
+        f"max RSS growth: {(rss_after - rss_before) * rss_unit / count:.1f} bytes/entry"
+    )
@@ -0,0 +1,40 @@
+import sys
+import time
+
+import numpy as np
+
+
+def make_column(kind, count, rng):
+    ids = rng.zipf(1.3, count) % 1_000_000
+    if kind == "int64":
+        return ids * 7919
+    if kind == "float64":
+        return ids / 8
+    return [f"tok{i}" for i in ids.tolist()]
+
+
+def run(implementation, values):
+    if implementation == "pkm":
+        import pypocketmap as pkm
+
+        return pkm.factorize(values)
+    if implementation == "pandas":
+        import pandas as pd
+
+        return pd.factorize(np.asarray(values, dtype=object) if isinstance(values, list) else values)
+    # np.unique sorts, so its uniques aren't in order of appearance
+    uniques, codes = np.unique(values, return_inverse=True)
+    return codes, uniques
+
+
+if __name__ == "__main__":
+    # usage: factorize.py {pkm,pandas,numpy} {int64,float64,str} [count]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    kind = sys.argv[2] if len(sys.argv) > 2 else "int64"
+    count = int(sys.argv[3]) if len(sys.argv) > 3 else 10_000_000
+    values = make_column(kind, count, np.random.default_rng(0))
+
+    start = time.perf_counter()
+    codes, uniques = run(implementation, values)
+    elapsed = time.perf_counter() - start
+    print(f"distinct: {len(uniques)}  factorize: {elapsed:.3f}s  ({elapsed / count * 1e9:.1f} ns/value)")
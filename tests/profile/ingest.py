@@ -0,0 +1,43 @@
+import os
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+
+def write_corpus(path, num_tokens):
+    # Zipf-distributed words of 2 to 12 letters, separated by spaces and newlines
+    rng = np.random.default_rng(0)
+    vocab = ["".join(rng.choice(list("etaoinshrdlu"), rng.integers(2, 13))) for _ in range(100_000)]
+    ids = (rng.zipf(1.2, num_tokens) - 1) % len(vocab)
+    seps = rng.choice([" ", " ", " ", "\n"], num_tokens)
+    with open(path, "w") as fp:
+        fp.write("".join(w + s for w, s in zip((vocab[i] for i in ids.tolist()), seps.tolist())))
+
+
+if __name__ == "__main__":
+    # usage: ingest.py [tokens] [max threads]
+    import pypocketmap as pkm
+
+    num_tokens = int(sys.argv[1]) if len(sys.argv) > 1 else 20_000_000
+    max_threads = int(sys.argv[2]) if len(sys.argv) > 2 else os.cpu_count()
+    fd, path = tempfile.mkstemp()
+    os.close(fd)
+    try:
+        write_corpus(path, num_tokens)
+        size = os.path.getsize(path)
+        threads = 1
+        base = None
+        while threads <= max_threads:
+            start = time.perf_counter()
+            counts = pkm.ingest_file(path, threads=threads)
+            elapsed = time.perf_counter() - start
+            base = base or elapsed
+            print(
+                f"threads: {threads:3d}  distinct: {len(counts)}  load: {elapsed:.3f}s  "
+                f"({size / elapsed / 1e6:.0f} MB/s, {base / elapsed:.1f}x)"
+            )
+            threads *= 2
+    finally:
+        os.remove(path)
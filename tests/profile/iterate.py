@@ -0,0 +1,38 @@
+import sys
+import time
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    fn()
+    return time.perf_counter() - start
+
+
+def loop_items(d):
+    for k, v in d.items():
+        pass
+
+
+if __name__ == "__main__":
+    # usage: iterate.py [entries] [fraction deleted]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 10_000_000
+    deleted = float(sys.argv[2]) if len(sys.argv) > 2 else 0.9
+    rng = np.random.default_rng(0)
+    keys = rng.permutation(count * 4)[:count]
+    d = pkm.create(int, int)
+    d.set_many(keys, keys)
+    # deleting leaves the table at its full size, so most groups have no live buckets
+    for k in keys[: int(count * deleted)].tolist():
+        del d[k]
+
+    print(
+        f"entries: {len(d)}  "
+        f"keys: {timed(lambda: sum(1 for _ in d.keys())):.3f}s  "
+        f"items loop: {timed(lambda: loop_items(d)):.3f}s  "
+        f"list(items()): {timed(lambda: list(d.items())):.3f}s  "
+        f"items_list(): {timed(lambda: d.items_list()):.3f}s"
+    )
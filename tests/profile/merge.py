@@ -0,0 +1,39 @@
+import sys
+import time
+
+import numpy as np
+
+
+def merge(implementation, parts):
+    import pypocketmap as pkm
+
+    total = pkm.create(str, int)
+    if implementation == "loop":
+        for part in parts:
+            for k, v in part.items():
+                total[k] = total.get(k, 0) + v
+    else:
+        total.merge_many(parts)
+    return total
+
+
+if __name__ == "__main__":
+    # usage: merge.py {loop,pkm} [partial counters] [keys per counter]
+    import pypocketmap as pkm
+
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    num_parts = int(sys.argv[2]) if len(sys.argv) > 2 else 32
+    size = int(sys.argv[3]) if len(sys.argv) > 3 else 200_000
+    # partial word counts from Zipf-distributed ids, so the counters overlap heavily
+    rng = np.random.default_rng(0)
+    parts = []
+    for _ in range(num_parts):
+        part = pkm.create(str, int)
+        ids = np.unique(rng.zipf(1.3, size * 2) % 2_000_000)[:size]
+        part.set_many([f"w{i}" for i in ids.tolist()], rng.integers(1, 100, len(ids)))
+        parts.append(part)
+
+    start = time.perf_counter()
+    total = merge(implementation, parts)
+    elapsed = time.perf_counter() - start
+    print(f"keys: {len(total)}  merge: {elapsed:.3f}s")
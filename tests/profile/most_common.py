@@ -0,0 +1,28 @@
+import sys
+import time
+from operator import itemgetter
+
+import numpy as np
+
+
+if __name__ == "__main__":
+    # usage: most_common.py [entries] [k]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 10_000_000
+    k = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+    rng = np.random.default_rng(0)
+    d = pkm.create(int, int)
+    # Zipf-distributed counts, as in a word counter
+    d.set_many(rng.permutation(count * 4)[:count], rng.zipf(1.3, count))
+
+    start = time.perf_counter()
+    top = d.most_common(k)
+    most_common_s = time.perf_counter() - start
+
+    start = time.perf_counter()
+    expected = sorted(d.items(), key=itemgetter(1), reverse=True)[:k]
+    sorted_s = time.perf_counter() - start
+    assert top == expected
+
+    print(f"entries: {len(d)}  most_common({k}): {most_common_s:.3f}s  sorted(items())[:k]: {sorted_s:.3f}s")
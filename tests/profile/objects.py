@@ -0,0 +1,43 @@
+import resource
+import sys
+import time
+
+
+def build(implementation, values):
+    # the keys are created here, so that the dict's key objects count towards its size
+    if implementation == "dict":
+        return {f"key{i}": v for i, v in enumerate(values)}
+
+    import pypocketmap as pkm
+
+    m = pkm.create(str, object)
+    for i, v in enumerate(values):
+        m[f"key{i}"] = v
+    return m
+
+
+if __name__ == "__main__":
+    # usage: objects.py {dict,pkm} [count]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 2_000_000
+    # small shared payloads, so the map's own overhead dominates
+    payloads = [(i, None) for i in range(100)]
+    values = [payloads[i % 100] for i in range(count)]
+
+    rss_before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    start = time.perf_counter()
+    m = build(implementation, values)
+    build_s = time.perf_counter() - start
+    rss_after = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss_unit = 1 if sys.platform == "darwin" else 1024
+
+    start = time.perf_counter()
+    total = 0
+    for i in range(count):
+        total += m[f"key{i}"][0]
+    lookup_s = time.perf_counter() - start
+
+    print(
+        f"build: {build_s:.3f}s  lookup: {lookup_s:.3f}s  "
+        f"max RSS growth: {(rss_after - rss_before) * rss_unit / count:.1f} bytes/entry"
+    )
@@ -0,0 +1,48 @@
+import os
+import sys
+import time
+
+import numpy as np
+
+
+def rss():
+    # current resident set size, since the generated input's temporaries raise the peak
+    with open("/proc/self/statm") as fp:
+        return int(fp.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+
+
+def build(implementation, terms, docs):
+    if implementation == "dict":
+        index = {}
+        for t, doc in zip(terms.tolist(), docs.tolist()):
+            index.setdefault(t, []).append(doc)
+        return index
+
+    import pypocketmap as pkm
+
+    index = pkm.create(int, [np.int32])
+    index.extend_many(terms, docs)
+    if implementation == "frozen":
+        index.freeze()
+    return index
+
+
+if __name__ == "__main__":
+    # usage: postings.py {dict,pkm,frozen} [postings] (Linux only)
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 10_000_000
+    # Zipf-distributed term ids, in document order
+    rng = np.random.default_rng(0)
+    terms = rng.zipf(1.3, count) % 1_000_000
+    docs = np.arange(count, dtype=np.int32) // 100
+
+    rss_before = rss()
+    start = time.perf_counter()
+    index = build(implementation, terms, docs)
+    build_s = time.perf_counter() - start
+    rss_after = rss()
+
+    print(
+        f"terms: {len(index)}  build: {build_s:.3f}s  "
+        f"RSS growth: {(rss_after - rss_before) / count:.1f} bytes/posting"
+    )
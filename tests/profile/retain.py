@@ -0,0 +1,43 @@
+import sys
+import time
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    res = fn()
+    return time.perf_counter() - start, res
+
+
+def prune_loop(d, threshold):
+    rare = [k for k, v in d.items() if v < threshold]
+    for k in rare:
+        del d[k]
+    return len(rare)
+
+
+if __name__ == "__main__":
+    # usage: retain.py [entries]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 5_000_000
+    rng = np.random.default_rng(0)
+    d = pkm.create(int, int)
+    # Zipf-distributed counts, so most keys are rare
+    d.set_many(rng.permutation(count * 4)[:count], rng.zipf(1.3, count))
+    e = d.copy()
+    f = d.copy()
+
+    retain_where_s, removed = timed(lambda: d.retain_where(">=", 20))
+    loop_s, loop_removed = timed(lambda: prune_loop(e, 20))
+    retain_s, _ = timed(lambda: f.retain(lambda k, v: v >= 20))
+    assert removed == loop_removed and dict(d.items()) == dict(e.items()) == dict(f.items())
+    # the pruned table was shrunk, so iterating it doesn't visit the buckets that were emptied
+    iter_s, _ = timed(d.keys_list)
+    loop_iter_s, _ = timed(e.keys_list)
+
+    print(
+        f"entries: {count}  removed: {removed}  retain_where: {retain_where_s:.3f}s  retain(lambda): {retain_s:.3f}s  "
+        f"collect + del loop: {loop_s:.3f}s  keys_list() after: {iter_s:.4f}s vs {loop_iter_s:.4f}s"
+    )
@@ -0,0 +1,41 @@
+import sys
+import time
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    res = fn()
+    return time.perf_counter() - start, res
+
+
+if __name__ == "__main__":
+    # usage: set_ops.py [entries]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 2_000_000
+    rng = np.random.default_rng(0)
+    a = pkm.create(int, int)
+    b = pkm.create(int, int)
+    # b is a tenth of the size of a, and half of its keys are also in a
+    a.set_many(rng.permutation(count * 2)[:count], np.arange(count))
+    b_keys = np.concatenate([a.keys_list()[: count // 20], rng.integers(count * 2, count * 4, count // 20)])
+    b.set_many(b_keys, np.arange(len(b_keys)))
+    da = dict(a.items())
+    db = dict(b.items())
+
+    results = []
+    for name, op, py_op in [
+        ("|", lambda: a | b, lambda: da | db),
+        ("&", lambda: a & b, lambda: {k: da[k] for k in db if k in da}),
+        ("-", lambda: a - b, lambda: {k: v for k, v in da.items() if k not in db}),
+        ("^", lambda: a ^ b, lambda: {k: v for k, v in (da | db).items() if (k in da) != (k in db)}),
+        ("b - a", lambda: b - a, lambda: {k: v for k, v in db.items() if k not in da}),
+    ]:
+        op_s, res = timed(op)
+        py_s, expected = timed(py_op)
+        assert dict(res.items()) == expected
+        results.append(f"{name}: {op_s:.3f}s vs dict {py_s:.3f}s")
+
+    print(f"entries: {count} and {len(b)}  " + "  ".join(results))
@@ -0,0 +1,33 @@
+import sys
+import time
+from operator import itemgetter
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    res = fn()
+    return time.perf_counter() - start, res
+
+
+if __name__ == "__main__":
+    # usage: sorted_items.py [entries]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 5_000_000
+    rng = np.random.default_rng(0)
+    ints = pkm.create(int, int)
+    ints.set_many(rng.permutation(count * 4)[:count], rng.zipf(1.3, count))
+    words = pkm.create(str, int)
+    for i, n in enumerate(rng.integers(0, 2**40, count).tolist()):
+        words[f"w{n:x}"] = i
+
+    for name, d, by, key in [
+        ("int by value", ints, "value", itemgetter(1)),
+        ("str by key", words, "key", itemgetter(0)),
+    ]:
+        sorted_items_s, (keys, values) = timed(lambda: d.sorted_items(by=by))
+        sorted_s, expected = timed(lambda: sorted(d.items(), key=key))
+        assert list(keys[:100]) == [k for k, _ in expected[:100]]
+        print(f"{name}: entries: {len(d)}  sorted_items(): {sorted_items_s:.3f}s  sorted(items()): {sorted_s:.3f}s")
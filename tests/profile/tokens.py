@@ -0,0 +1,38 @@
+import collections
+import sys
+import time
+
+import numpy as np
+
+
+def count(implementation, text):
+    if implementation == "counter":
+        return collections.Counter(text.decode("utf-8").split())
+
+    import pypocketmap as pkm
+
+    counts = pkm.create(str, int)
+    if implementation == "loop":
+        for w in text.split():
+            w = w.decode("utf-8")
+            counts[w] = counts.get(w, 0) + 1
+    else:
+        counts.count_tokens(text)
+    return counts
+
+
+if __name__ == "__main__":
+    # usage: tokens.py {counter,loop,pkm} [tokens]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    num_tokens = int(sys.argv[2]) if len(sys.argv) > 2 else 10_000_000
+    # Zipf-distributed words of 2 to 12 letters, separated by spaces and newlines
+    rng = np.random.default_rng(0)
+    vocab = ["".join(rng.choice(list("etaoinshrdlu"), rng.integers(2, 13))) for _ in range(100_000)]
+    ids = (rng.zipf(1.2, num_tokens) - 1) % len(vocab)
+    seps = rng.choice([" ", " ", " ", "\n"], num_tokens)
+    text = "".join(w + s for w, s in zip((vocab[i] for i in ids.tolist()), seps.tolist())).encode("utf-8")
+
+    start = time.perf_counter()
+    counts = count(implementation, text)
+    elapsed = time.perf_counter() - start
+    print(f"distinct: {len(counts)}  count: {elapsed:.3f}s  ({len(text) / elapsed / 1e6:.0f} MB/s)")
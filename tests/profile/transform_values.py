@@ -0,0 +1,36 @@
+import sys
+import time
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    res = fn()
+    return time.perf_counter() - start, res
+
+
+def decay_loop(d, factor):
+    for k in d.keys_list():
+        d[k] *= factor
+
+
+if __name__ == "__main__":
+    # usage: transform_values.py [entries]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 10_000_000
+    rng = np.random.default_rng(0)
+    d = pkm.create(int, float)
+    d.set_many(rng.permutation(count * 4)[:count], rng.exponential(10, count))
+    e = d.copy()
+
+    transform_s, _ = timed(lambda: d.transform_values("mul", 0.9))
+    loop_s, _ = timed(lambda: decay_loop(e, 0.9))
+    assert dict(d.items()) == dict(e.items())
+    prune_s, removed = timed(lambda: d.decay_and_prune(0.9, 1.0))
+
+    print(
+        f"entries: {count}  transform_values('mul'): {transform_s:.3f}s  d[k] *= 0.9 loop: {loop_s:.3f}s  "
+        f"decay_and_prune: {prune_s:.3f}s ({removed} removed)"
+    )
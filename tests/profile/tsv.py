@@ -0,0 +1,53 @@
+import csv
+import os
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+
+def load(implementation, path):
+    if implementation == "csv":
+        with open(path, newline="") as fp:
+            return {k: int(v) for k, v in csv.reader(fp, delimiter="\t")}
+
+    import pypocketmap as pkm
+
+    d = pkm.create(str, int)
+    if implementation == "loop":
+        with open(path, newline="") as fp:
+            for k, v in csv.reader(fp, delimiter="\t"):
+                d[k] = int(v)
+    else:
+        d.load_tsv(path)
+    return d
+
+
+if __name__ == "__main__":
+    # usage: tsv.py {csv,loop,pkm} [rows]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    rows = int(sys.argv[2]) if len(sys.argv) > 2 else 10_000_000
+    import pypocketmap as pkm
+
+    rng = np.random.default_rng(0)
+    source = pkm.create(str, int)
+    source.set_many([f"user:{i:x}" for i in rng.permutation(rows).tolist()], rng.integers(0, 2**40, rows))
+    fd, path = tempfile.mkstemp()
+    os.close(fd)
+    try:
+        start = time.perf_counter()
+        source.dump_tsv(path)
+        dump_s = time.perf_counter() - start
+        del source
+
+        start = time.perf_counter()
+        d = load(implementation, path)
+        load_s = time.perf_counter() - start
+        size = os.path.getsize(path)
+        print(
+            f"rows: {len(d)}  dump: {dump_s:.3f}s  load: {load_s:.3f}s  "
+            f"({size / load_s / 1e6:.0f} MB/s)"
+        )
+    finally:
+        os.remove(path)
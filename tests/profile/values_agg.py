@@ -0,0 +1,33 @@
+import sys
+import time
+
+import numpy as np
+
+
+def timed(fn):
+    start = time.perf_counter()
+    res = fn()
+    return time.perf_counter() - start, res
+
+
+if __name__ == "__main__":
+    # usage: values_agg.py [entries]
+    import pypocketmap as pkm
+
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 10_000_000
+    rng = np.random.default_rng(0)
+    d = pkm.create(int, float)
+    d.set_many(rng.permutation(count * 4)[:count], rng.standard_normal(count))
+
+    sum_s, total = timed(d.values_sum)
+    py_sum_s, expected = timed(lambda: sum(d.values()))
+    assert abs(total - expected) < 1e-6 * count
+    min_s, _ = timed(d.values_min)
+    hist_s, (counts, _) = timed(lambda: d.values_histogram(100))
+    np_hist_s, (expected_counts, _) = timed(lambda: np.histogram(np.fromiter(d.values(), np.float64, len(d)), 100))
+    assert counts.tolist() == expected_counts.tolist()
+
+    print(
+        f"entries: {len(d)}  values_sum(): {sum_s:.3f}s  sum(values()): {py_sum_s:.3f}s  values_min(): {min_s:.3f}s  "
+        f"values_histogram(100): {hist_s:.3f}s  np.histogram(np.fromiter(values())): {np_hist_s:.3f}s"
+    )
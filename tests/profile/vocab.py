@@ -0,0 +1,37 @@
+import sys
+import time
+
+import numpy as np
+
+
+def build(implementation, tokens):
+    if implementation == "dict":
+        ids = {}
+        id_to_token = []
+        encoded = np.empty(len(tokens), dtype=np.int32)
+        for i, t in enumerate(tokens):
+            id_ = ids.setdefault(t, len(ids))
+            if id_ == len(id_to_token):
+                id_to_token.append(t)
+            encoded[i] = id_
+        return ids, encoded
+
+    import pypocketmap as pkm
+
+    vocab = pkm.vocab(str)
+    return vocab, vocab.encode(tokens)
+
+
+if __name__ == "__main__":
+    # usage: vocab.py {dict,pkm} [tokens]
+    implementation = sys.argv[1] if len(sys.argv) > 1 else "pkm"
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 10_000_000
+    # Zipf-distributed tokens
+    rng = np.random.default_rng(0)
+    tokens = [f"tok{i}" for i in (rng.zipf(1.3, count) % 1_000_000).tolist()]
+
+    start = time.perf_counter()
+    vocab, encoded = build(implementation, tokens)
+    build_s = time.perf_counter() - start
+
+    print(f"distinct: {len(vocab)}  encode: {build_s:.3f}s  ({build_s / count * 1e9:.0f} ns/token)")
@@ -1,13 +1,19 @@
 import numpy as np
 import random as random
+import resource
 import sys
 
 
 if __name__ == "__main__":
     implementation = sys.argv[1] if len(sys.argv) > 1 else ""
     iterations = int(sys.argv[2]) if len(sys.argv) > 2 else 5_000_000
+    # the tables are allocated with plain malloc, so measure the max RSS growth
+    rss_before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
     if implementation == "dict":
         m = {}
+    elif implementation == "compact":
+        import pypocketmap
+        m = pypocketmap.create(str, pypocketmap.compact_int64_)
     else:
         import pypocketmap
         m = pypocketmap.create(str, int)
@@ -36,4 +42,7 @@ if __name__ == "__main__":
         vl = lanes.view()
         vl.shape = (10000,)
         rng.shuffle(vl)
+    rss_after = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss_unit = 1 if sys.platform == "darwin" else 1024
     print("Size:", len(m))
+    print(f"max RSS growth: {(rss_after - rss_before) * rss_unit / len(m):.1f} bytes/entry")
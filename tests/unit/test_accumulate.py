@@ -0,0 +1,82 @@
+import threading
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+def reference(initial, keys, values, op):
+    out = dict(initial)
+    for k, v in zip(keys, values):
+        if op == "count":
+            out[k] = out.get(k, 0) + 1
+        elif k not in out:
+            out[k] = v
+        elif op == "sum":
+            out[k] += v
+        else:
+            out[k] = (min if op == "min" else max)(out[k], v)
+    return out
+
+
+class AccumulateTest(unittest.TestCase):
+    def test_ops(self):
+        rng = np.random.default_rng(0)
+        # more rows than one chunk, and keys that repeat within and across chunks
+        keys = rng.integers(0, 3000, 10000)
+        values = rng.integers(-1000, 1000, 10000)
+        for op in ["sum", "min", "max", "count"]:
+            d = pkm.create(int, int)
+            d[5] = 100
+            d.accumulate(keys, values, op=op)
+            expected = reference({5: 100}, keys.tolist(), values.tolist(), op)
+            self.assertEqual(dict(d.items()), expected, op)
+
+    def test_types(self):
+        f = pkm.create(str, float)
+        f.accumulate(["a", "b", "a", "b"], [1.5, np.nan, -2.0, 3.0], op="min")
+        self.assertEqual(f["a"], -2.0)
+        self.assertEqual(f["b"], 3.0)
+        f.accumulate(["c", "c"], [0.25, 0.5])
+        self.assertEqual(f["c"], 0.75)
+
+        i = pkm.create(int, pkm.int32_)
+        i.accumulate([1, 1], np.array([2**31 - 1, 1], dtype=np.int32))
+        self.assertEqual(i[1], -(2**31))
+
+        c = pkm.create(bytes, pkm.compact_int64_)
+        c.accumulate([b"x"] * 300, op="count")
+        c.accumulate([b"y", b"y"], [2**40, 2**40])
+        self.assertEqual(dict(c.items()), {b"x": 300, b"y": 2**41})
+
+        words = ["to", "be", "or", "not", "to", "be"]
+        data = np.frombuffer("".join(words).encode(), dtype=np.uint8)
+        offsets = np.cumsum([0, *map(len, words)])
+        s = pkm.create(str, int)
+        s.accumulate((offsets, data), np.arange(6))
+        self.assertEqual(dict(s.items()), {"to": 4, "be": 6, "or": 2, "not": 3})
+
+    def test_errors(self):
+        d = pkm.create(str, int)
+        with self.assertRaises(ValueError):
+            d.accumulate(["a"], [1, 2])
+        with self.assertRaises(ValueError):
+            d.accumulate(["a"], [1], op="mean")
+        with self.assertRaises(TypeError):
+            d.accumulate(["a"])
+        with self.assertRaises(TypeError):
+            d.accumulate(["a", 2, "b"], [1, 1, 1])
+        self.assertEqual(dict(d.items()), {"a": 1})
+        self.assertFalse(hasattr(pkm.create(str, str), "accumulate"))
+
+    def test_threads(self):
+        keys = np.arange(100000) % 1000
+        maps = [pkm.create(int, int) for _ in range(4)]
+        threads = [threading.Thread(target=m.accumulate, args=(keys, keys)) for m in maps]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for m in maps:
+            self.assertEqual(m[999], 999 * 100)
@@ -0,0 +1,101 @@
+import hashlib
+import unittest
+
+import pypocketmap as pkm
+
+
+class BytesKeyTest(unittest.TestCase):
+    def test_binary_safe(self):
+        d = pkm.create(bytes, int)
+        keys = [b"", b"\x00", b"\x00\x00", b"a\x00b", b"\xff" * 15, b"\x00" * 16, bytes(range(256))]
+        for i, k in enumerate(keys):
+            d[k] = i
+        self.assertEqual(len(d), len(keys))
+        for i, k in enumerate(keys):
+            self.assertEqual(d[k], i)
+        self.assertEqual(sorted(d.keys()), sorted(keys))
+        self.assertNotIn(b"a", d)
+        self.assertNotIn(b"\x00" * 15, d)
+
+    def test_inline_boundary(self):
+        d = pkm.create(bytes, bytes)
+        for n in range(0, 40):
+            d[b"k" * n] = b"\x00" * n
+        for n in range(0, 40):
+            self.assertEqual(d[b"k" * n], b"\x00" * n)
+            self.assertIs(type(d[b"k" * n]), bytes)
+
+    def test_buffer_args(self):
+        d = pkm.create(bytes, int)
+        d[bytearray(b"abc")] = 1
+        d[memoryview(b"xyzw")[1:3]] = 2
+        self.assertEqual(d[b"abc"], 1)
+        self.assertEqual(d[b"yz"], 2)
+        self.assertEqual(d.get(memoryview(b"abc")), 1)
+        self.assertEqual(list(d.items()), [(k, d[k]) for k in d.keys()])
+        with self.assertRaises(BufferError):
+            d[memoryview(b"abcdef")[::2]] = 3
+        with self.assertRaises(TypeError):
+            d["abc"] = 4
+        with self.assertRaises(TypeError):
+            d[b"abc"] = b"not an int"
+
+    def test_key_resized_by_value(self):
+        # the value's __index__/__float__ runs before the bytearray key is read
+        key = bytearray(b"k" * 40)
+
+        class Shrinks:
+            def __index__(self):
+                key[:] = b"x"
+                return 7
+
+            def __float__(self):
+                return float(self.__index__())
+
+        for value_type in [int, float]:
+            d = pkm.create(bytes, value_type)
+            key[:] = b"k" * 40
+            d[key] = Shrinks()
+            self.assertEqual(list(d.items()), [(b"x", 7)])
+            key[:] = b"k" * 40
+            self.assertEqual(d.setdefault(key, Shrinks()), 7)
+            self.assertEqual(sorted(d.keys()), [b"x"])
+
+    def test_key_error(self):
+        d = pkm.create(bytes, float)
+        with self.assertRaises(KeyError) as ctx:
+            d[b"\x00missing"]
+        self.assertEqual(ctx.exception.args, (b"\x00missing",))
+
+    def test_repr(self):
+        d = pkm.create(str, bytes)
+        d["a"] = b"\x00\x01"
+        self.assertEqual(repr(d), "<pypocketmap[str, bytes]: {'a': b'\\x00\\x01'}>")
+
+
+class DigestKeyTest(unittest.TestCase):
+    def test_digests(self):
+        for key_type, algo in [(pkm.bytes16_, hashlib.md5), (pkm.bytes20_, hashlib.sha1), (pkm.bytes32_, hashlib.sha256)]:
+            d = pkm.create(key_type, int)
+            digests = [algo(str(i).encode()).digest() for i in range(1000)]
+            for i, k in enumerate(digests):
+                d[k] = i
+            self.assertEqual(len(d), 1000)
+            for i, k in enumerate(digests):
+                self.assertEqual(d[k], i)
+            self.assertEqual(set(d.keys()), set(digests))
+            self.assertNotIn(algo(b"missing").digest(), d)
+
+    def test_wrong_width(self):
+        d = pkm.create(pkm.bytes20_, float)
+        with self.assertRaises(ValueError):
+            d[b"\x00" * 16] = 1.0
+        with self.assertRaises(ValueError):
+            b"\x00" * 21 in d
+        with self.assertRaises(TypeError):
+            d["\x00" * 20] = 1.0
+        d[bytearray(20)] = 2.0
+        self.assertEqual(d[memoryview(bytes(20))], 2.0)
+        with self.assertRaises(KeyError) as ctx:
+            d[b"\x01" * 20]
+        self.assertEqual(ctx.exception.args, (b"\x01" * 20,))
@@ -0,0 +1,33 @@
+import unittest
+
+import pypocketmap as pkm
+
+
+class CompactInt64Test(unittest.TestCase):
+    def test_widening(self):
+        d = pkm.create(str, pkm.compact_int64_)
+        expected = {}
+        # each batch needs a wider value array than the last
+        for bound in (100, 30000, 2**31 - 1, 2**63 - 1):
+            for i in range(500):
+                k = f"{bound}:{i}"
+                expected[k] = bound - i if i % 2 else -bound + i
+                d[k] = expected[k]
+            for k, v in expected.items():
+                self.assertEqual(d[k], v)
+        self.assertEqual(len(d), 2000)
+        self.assertEqual(dict(d.items()), expected)
+
+    def test_counters(self):
+        d = pkm.create(pkm.int64_, pkm.compact_int64_)
+        for i in range(70000):
+            d[i % 100] = d.get(i % 100, 0) + 1
+        self.assertEqual(set(d.values()), {700})
+        for i in range(0, 100, 2):
+            del d[i]
+        d[1000] = -(2**63)
+        self.assertEqual(len(d), 51)
+        self.assertEqual(d[1000], -(2**63))
+        self.assertEqual(d[1], 700)
+        self.assertEqual(d.setdefault(1, 5), 700)
+        self.assertEqual(repr(pkm.create(str, pkm.compact_int64_)), "<pypocketmap[str, compact_int64]: {}>")
@@ -0,0 +1,83 @@
+import copy
+import sys
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class CopyTest(unittest.TestCase):
+    def test_independent(self):
+        long = "x" * 40
+        for key_type, value_type, make_key, make_value in [
+            (str, int, str, lambda i: i),
+            (str, str, lambda i: f"{i}{long}", lambda i: f"v{i}{long}" if i % 2 else str(i)),
+            (bytes, bytes, lambda i: str(i).encode() * 5, lambda i: bytes(i % 20)),
+            (int, float, lambda i: i, lambda i: i / 2),
+            (pkm.int64_pair_, pkm.compact_int64_, lambda i: (i, -i), lambda i: i * 1000),
+        ]:
+            d = pkm.create(key_type, value_type)
+            for i in range(2000):
+                d[make_key(i)] = make_value(i)
+            # deleted buckets are copied too, and must still be skipped when probing
+            for i in range(0, 2000, 3):
+                del d[make_key(i)]
+            expected = dict(d.items())
+            for e in (d.copy(), copy.copy(d), copy.deepcopy(d)):
+                self.assertIs(type(e), type(d))
+                self.assertEqual(dict(e.items()), expected)
+                for i in range(2000):
+                    self.assertEqual(make_key(i) in e, i % 3 != 0)
+                e[make_key(0)] = make_value(1)
+                del e[make_key(1)]
+                self.assertNotIn(make_key(0), d)
+                self.assertIn(make_key(1), d)
+            d.clear()
+            self.assertEqual(len(e), len(expected))
+            self.assertEqual(e[make_key(2)], make_value(2))
+
+    def test_object(self):
+        v = [1]
+        base = sys.getrefcount(v)
+        d = pkm.create(str, object)
+        d["a"] = v
+        d["b"] = {"v": v}
+        e = copy.copy(d)
+        self.assertIs(e["a"], v)
+        self.assertEqual(sys.getrefcount(v), base + 3)
+        f = copy.deepcopy(d)
+        self.assertEqual(f["a"], [1])
+        self.assertIsNot(f["a"], v)
+        # values shared within the map stay shared in the deep copy
+        self.assertIs(f["b"]["v"], f["a"])
+        del e
+        self.assertEqual(sys.getrefcount(v), base + 2)
+
+        d["self"] = d
+        g = copy.deepcopy(d)
+        self.assertIs(g["self"], g)
+        self.assertEqual(g["a"], [1])
+
+    def test_specialized(self):
+        r = pkm.create(str, [("a", "i4"), ("b", "f8")])
+        r["k"] = (1, 2.5)
+        s = copy.deepcopy(r)
+        r["k"] = (0, 0)
+        self.assertEqual(s["k"], (1, 2.5))
+
+        p = pkm.create(str, [np.int32])
+        for i in range(100):
+            p.append("k", i)
+        p.freeze()
+        q = copy.copy(p)
+        self.assertTrue(q.frozen)
+        self.assertEqual(q["k"].tolist(), list(range(100)))
+
+        v = pkm.vocab()
+        v.encode(["a", "b" * 30, "c"])
+        w = copy.deepcopy(v)
+        v.add("d")
+        self.assertEqual(len(w), 3)
+        self.assertEqual(w.decode([2, 1]), ["c", "b" * 30])
+        self.assertEqual(w.add("e"), 3)
@@ -0,0 +1,55 @@
+import collections
+import re
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+def reference(text, delimiters=b" \t\n", lowercase=False):
+    pattern = b"[" + re.escape(delimiters) + b"]+"
+    tokens = [t for t in re.split(pattern, text) if t]
+    if lowercase:
+        tokens = [t.lower() for t in tokens]
+    return collections.Counter(tokens)
+
+
+class CountTokensTest(unittest.TestCase):
+    def test_random(self):
+        rng = np.random.default_rng(0)
+        # long runs, so that delimiters land at every offset of a 16-byte block
+        text = bytes(rng.choice(list(b"abcAB \t\n,;-"), 20000).tolist())
+        for delimiters in [b" \t\n", b",", b" \t\n,;-.:!?'\"()"]:
+            for lowercase in [False, True]:
+                d = pkm.create(bytes, int)
+                n = d.count_tokens(text, delimiters, lowercase=lowercase)
+                expected = reference(text, delimiters, lowercase)
+                self.assertEqual(n, sum(expected.values()))
+                self.assertEqual(dict(d.items()), expected)
+
+    def test_str(self):
+        d = pkm.create(str, pkm.int32_)
+        self.assertEqual(d.count_tokens("  the Cat the\tcat\n\nTHE mät  ", lowercase=True), 6)
+        self.assertEqual(dict(d.items()), {"the": 3, "cat": 2, "mät": 1})
+        d.count_tokens(bytearray("mät x".encode()))
+        self.assertEqual(d["mät"], 2)
+        self.assertEqual(d.count_tokens(b""), 0)
+        self.assertEqual(d.count_tokens(b" \n "), 0)
+        # the whole buffer is checked first, so nothing before the bad token is counted
+        before = dict(d.items())
+        with self.assertRaises(UnicodeDecodeError):
+            d.count_tokens(b"ok \xff")
+        with self.assertRaises(UnicodeDecodeError):
+            d.count_tokens(b"x y\xff z")
+        self.assertEqual(dict(d.items()), before)
+        with self.assertRaises(ValueError):
+            d.count_tokens(b"a", delimiters=b"\xc3")
+        with self.assertRaises(TypeError):
+            d.count_tokens(1)
+
+        c = pkm.create(str, pkm.compact_int64_)
+        c.count_tokens(" ".join(["w"] * 1000) + " " + "x" * 100)
+        self.assertEqual(dict(c.items()), {"w": 1000, "x" * 100: 1})
+        self.assertFalse(hasattr(pkm.create(str, float), "count_tokens"))
+        self.assertFalse(hasattr(pkm.create(int, int), "count_tokens"))
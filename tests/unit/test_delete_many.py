@@ -0,0 +1,117 @@
+import random
+import threading
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class DeleteManyTest(unittest.TestCase):
+    def test_matches_dict(self):
+        rng = random.Random(1)
+        for key_type, make_key in [
+            (str, lambda i: f"k{i}" + "x" * (i % 30)),
+            (bytes, lambda i: b"b%d" % i),
+            (int, lambda i: i * 7919 - 50000),
+            (pkm.int64_pair_, lambda i: (i, -i)),
+        ]:
+            for value_type in [int, str, object]:
+                d = pkm.create(key_type, value_type)
+                expected = {}
+                for i in range(10000):
+                    d[make_key(i)] = expected[make_key(i)] = value_type(i) if value_type is not object else [i]
+                for _ in range(3):
+                    batch = [make_key(rng.randrange(12000)) for _ in range(5000)]
+                    present = set(batch) & expected.keys()
+                    self.assertEqual(d.delete_many(batch), len(present))
+                    for k in present:
+                        del expected[k]
+                    self.assertEqual(dict(d.items()), expected)
+                    for i in rng.sample(range(12000), 1000):
+                        d[make_key(i)] = expected[make_key(i)] = value_type(1) if value_type is not object else [1]
+                    self.assertEqual(len(d), len(expected))
+                    for k, v in expected.items():
+                        self.assertEqual(d[k], v)
+
+    def test_arrays(self):
+        d = pkm.create(int, float)
+        d.set_many(np.arange(100000), np.ones(100000))
+        # duplicates and missing keys are skipped
+        keys = np.concatenate([np.arange(0, 100000, 2), np.arange(0, 1000, 2), np.arange(100000, 101000)])
+        self.assertEqual(d.delete_many(keys), 50000)
+        self.assertEqual(sorted(d.keys()), list(range(1, 100000, 2)))
+        self.assertEqual(d.delete_many(np.arange(100000, dtype=np.int64)), 50000)
+        self.assertEqual(len(d), 0)
+        d[5] = 2.5
+        self.assertEqual(d.items_list(), [(5, 2.5)])
+        with self.assertRaises(TypeError):
+            d.delete_many(np.arange(3, dtype=np.float64))
+
+        pairs = pkm.create(pkm.int64_pair_, int)
+        pairs.set_many(np.arange(20).reshape(10, 2), np.arange(10))
+        self.assertEqual(pairs.delete_many(np.array([[0, 1], [2, 3], [5, 5]])), 2)
+        self.assertEqual(pairs.delete_many((np.array([4, 6]), np.array([5, 7]))), 2)
+        self.assertEqual(len(pairs), 6)
+
+    def test_offsets(self):
+        words = pkm.create(str, int)
+        words.update({"apple": 1, "ban": 2, "": 3, "héllo": 4})
+        data = "appleheyhéllo".encode()
+        for dtype in [np.int32, np.int64]:
+            d = words.copy()
+            offsets = np.array([0, 5, 5, 8, len(data)], dtype=dtype)
+            self.assertEqual(d.delete_many((offsets, data)), 3)
+            self.assertEqual(d.items_list(), [("ban", 2)])
+        with self.assertRaises(ValueError):
+            words.delete_many((np.array([0, 3, 100], dtype=np.int64), b"apple"))
+
+        b = pkm.create(bytes, int)
+        b.update({b"\x00\xff": 1, b"ab": 2})
+        self.assertEqual(b.delete_many((np.array([0, 2, 4]), bytearray(b"\x00\xffxy"))), 1)
+        self.assertEqual(b.items_list(), [(b"ab", 2)])
+
+    def test_concurrent_reads(self):
+        # long keys and values are allocated separately, and freed while another thread reads them
+        d = pkm.create(str, str)
+        keys = [f"key {i} " + "x" * 40 for i in range(20000)]
+        stop = threading.Event()
+        errors = []
+
+        def read():
+            while not stop.is_set():
+                for k in keys[::97]:
+                    v = d.get(k)
+                    if v is not None and v != k + " value":
+                        errors.append((k, v))
+                list(d.items())
+
+        reader = threading.Thread(target=read)
+        reader.start()
+        try:
+            for _ in range(20):
+                d.update({k: k + " value" for k in keys})
+                self.assertEqual(d.delete_many(keys), len(keys))
+                self.assertEqual(len(d), 0)
+        finally:
+            stop.set()
+            reader.join()
+        self.assertEqual(errors, [])
+
+    def test_errors(self):
+        d = pkm.create(str, int)
+        for i in range(100):
+            d[str(i)] = i
+        # the keys before the one that fails are deleted
+        with self.assertRaises(TypeError):
+            d.delete_many(["1", "2", 3, "4"])
+        self.assertEqual(len(d), 98)
+        self.assertIn("4", d)
+        with self.assertRaises(TypeError):
+            d.delete_many(5)
+        self.assertEqual(d.delete_many(iter(["4", "5"])), 2)
+        self.assertEqual(d.delete_many([]), 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
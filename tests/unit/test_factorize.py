@@ -0,0 +1,82 @@
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+def first_seen(values):
+    """Reference factorize, in order of appearance"""
+    ids = {}
+    codes = [ids.setdefault(v, len(ids)) for v in values]
+    return codes, list(ids)
+
+
+class FactorizeTest(unittest.TestCase):
+    def test_int(self):
+        rng = np.random.default_rng(0)
+        values = rng.integers(-(2**62), 2**62, 300).repeat(3)
+        rng.shuffle(values)
+        codes, uniques = pkm.factorize(values)
+        expected_codes, expected_uniques = first_seen(values.tolist())
+        self.assertEqual(codes.dtype, np.int32)
+        self.assertEqual(codes.tolist(), expected_codes)
+        self.assertEqual(uniques.tolist(), expected_uniques)
+        np.testing.assert_array_equal(uniques[codes], values)
+        np.testing.assert_array_equal(np.sort(pkm.unique(values)), np.unique(values))
+        small = values % 1000
+        np.testing.assert_array_equal(pkm.unique(small.astype(np.int32), size_hint=1), pkm.unique(small))
+        self.assertEqual(pkm.factorize([3, 1, 3])[0].tolist(), [0, 1, 0])
+        codes, uniques = pkm.factorize(np.array([], dtype=np.int64))
+        self.assertEqual((len(codes), len(uniques)), (0, 0))
+
+    def test_int_dtypes(self):
+        # uint64 values past the int64 range keep their value, and uniques keep the input dtype
+        big = np.array([2**63 + 5, 7, 2**64 - 1, 2**63 + 5], dtype=np.uint64)
+        codes, uniques = pkm.factorize(big)
+        self.assertEqual(codes.tolist(), [0, 1, 2, 0])
+        self.assertEqual(uniques.dtype, np.uint64)
+        self.assertEqual(uniques.tolist(), [2**63 + 5, 7, 2**64 - 1])
+        codes, uniques = pkm.factorize(np.array([True, False, True]))
+        self.assertEqual(codes.tolist(), [0, 1, 0])
+        self.assertEqual(uniques.dtype, np.bool_)
+        self.assertEqual(uniques.tolist(), [True, False])
+        for dtype in [np.int8, np.uint16, np.int32, np.uint32, np.float32]:
+            uniques = pkm.unique(np.array([3, 1, 3, 2], dtype=dtype))
+            self.assertEqual(uniques.dtype, dtype)
+            self.assertEqual(uniques.tolist(), [3, 1, 2])
+
+    def test_float(self):
+        values = np.array([1.5, np.nan, -0.0, 0.0, 1.5, np.inf, -np.nan, 2.0**-1074])
+        codes, uniques = pkm.factorize(values)
+        self.assertEqual(codes.tolist(), [0, -1, 1, 1, 0, 2, -1, 3])
+        self.assertEqual(uniques.dtype, np.float64)
+        self.assertEqual(uniques.tolist(), [1.5, 0.0, np.inf, 2.0**-1074])
+        self.assertEqual(pkm.unique(values.astype(np.float32))[:2].tolist(), [1.5, 0.0])
+
+    def test_str(self):
+        words = ["b", "a", "", "b", "ünï", "a" * 30, "a"]
+        codes, uniques = pkm.factorize(words)
+        expected_codes, expected_uniques = first_seen(words)
+        self.assertEqual(codes.tolist(), expected_codes)
+        self.assertEqual(uniques.dtype, object)
+        self.assertEqual(uniques.tolist(), expected_uniques)
+        self.assertEqual(pkm.factorize(np.array(words))[1].tolist(), expected_uniques)
+        self.assertEqual(pkm.unique([b"x", b"y", b"x"]).tolist(), [b"x", b"y"])
+
+        data = "".join(words).encode("utf-8")
+        offsets = np.zeros(len(words) + 1, dtype=np.int32)
+        np.cumsum([len(w.encode("utf-8")) for w in words], out=offsets[1:])
+        codes, (unique_offsets, unique_data) = pkm.factorize((offsets, np.frombuffer(data, dtype=np.uint8)))
+        self.assertEqual(codes.tolist(), expected_codes)
+        self.assertEqual(unique_offsets.dtype, np.int64)
+        self.assertEqual(
+            [unique_data[a:b].tobytes().decode("utf-8") for a, b in zip(unique_offsets, unique_offsets[1:])],
+            expected_uniques,
+        )
+
+    def test_errors(self):
+        with self.assertRaises(TypeError):
+            pkm.factorize(np.zeros(2, dtype=np.complex128))
+        with self.assertRaises(TypeError):
+            pkm.factorize(["a", 1])
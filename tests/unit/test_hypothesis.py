@@ -9,8 +9,8 @@ from hypothesis import given
 import hypothesis.strategies as st
 import pypocketmap as pkm
 
-K = TypeVar("K", int, float, str)
-V = TypeVar("V", int, float, str)
+K = TypeVar("K", int, float, str, bytes, tuple)
+V = TypeVar("V", int, float, str, bytes)
 D = TypeVar("D")
 
 
@@ -77,7 +77,7 @@ def pocketmaps_strategy(
 def type_strategy(dtype: pkm.dtype) -> st.SearchStrategy[Any]:
     if dtype == pkm.int32_:
         return st.integers(min_value=-(2**31), max_value=2**31 - 1)
-    if dtype == pkm.int64_:
+    if dtype in (pkm.int64_, pkm.compact_int64_):
         return st.integers(min_value=-(2**63), max_value=2**63 - 1)
     if dtype == pkm.float32_:
         return st.floats(allow_nan=False, width=32)
@@ -85,6 +85,13 @@ def type_strategy(dtype: pkm.dtype) -> st.SearchStrategy[Any]:
         return st.floats(allow_nan=False)
     if dtype == pkm.string_:
         return st.text()
+    if dtype == pkm.bytes_:
+        return st.binary()
+    if dtype in (pkm.bytes16_, pkm.bytes20_, pkm.bytes32_):
+        width = int(dtype.name[len("bytes"):])
+        return st.binary(min_size=width, max_size=width)
+    if dtype == pkm.int64_pair_:
+        return st.tuples(type_strategy(pkm.int64_), type_strategy(pkm.int64_))
     raise NotImplementedError()
 
 
@@ -260,10 +267,46 @@ class BaseHypothesisTest:
         hypothesis_update_dict()
 
 
+class Int32Int32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int32_, pkm.int32_)
+
+
+class Int32Int64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int32_, pkm.int64_)
+
+
+class Int32Float32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int32_, pkm.float32_)
+
+
+class Int32Float64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int32_, pkm.float64_)
+
+
+class Int32StrHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int32_, pkm.string_)
+
+
+class Int64Int32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_, pkm.int32_)
+
+
 class Int64Int64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
     item_type = (pkm.int64_, pkm.int64_)
 
 
+class Int64Float32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_, pkm.float32_)
+
+
+class Int64Float64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_, pkm.float64_)
+
+
+class Int64StrHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_, pkm.string_)
+
+
 class StrInt32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
     item_type = (pkm.string_, pkm.int32_)
 
@@ -272,6 +315,14 @@ class StrInt64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
     item_type = (pkm.string_, pkm.int64_)
 
 
+class StrCompactInt64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.string_, pkm.compact_int64_)
+
+
+class Int64CompactInt64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_, pkm.compact_int64_)
+
+
 class StrFloat32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
     item_type = (pkm.string_, pkm.float32_)
 
@@ -282,3 +333,97 @@ class StrFloat64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
 
 class StrStrHypothesisTest(BaseHypothesisTest, unittest.TestCase):
     item_type = (pkm.string_, pkm.string_)
+
+
+class StrBytesHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.string_, pkm.bytes_)
+
+
+class Int64BytesHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_, pkm.bytes_)
+
+
+class Int32BytesHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int32_, pkm.bytes_)
+
+
+class BytesInt32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes_, pkm.int32_)
+
+
+class BytesInt64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes_, pkm.int64_)
+
+
+class BytesFloat32HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes_, pkm.float32_)
+
+
+class BytesFloat64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes_, pkm.float64_)
+
+
+class BytesStrHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes_, pkm.string_)
+
+
+class BytesBytesHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes_, pkm.bytes_)
+
+
+class Bytes16Int64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes16_, pkm.int64_)
+
+
+class Bytes20Int64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes20_, pkm.int64_)
+
+
+class Bytes20StrHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes20_, pkm.string_)
+
+
+class Bytes32Int64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes32_, pkm.int64_)
+
+
+class Bytes32BytesHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.bytes32_, pkm.bytes_)
+
+
+class Int64PairInt64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_pair_, pkm.int64_)
+
+
+class Int64PairFloat64HypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_pair_, pkm.float64_)
+
+
+class Int64PairStrHypothesisTest(BaseHypothesisTest, unittest.TestCase):
+    item_type = (pkm.int64_pair_, pkm.string_)
+
+
+class Int32RangeHypothesisTest(unittest.TestCase):
+    def test_out_of_range(self):
+        @given(
+            m=pocketmaps_strategy((pkm.int32_, pkm.int32_)),
+            key=st.one_of(st.integers(max_value=-(2**31) - 1), st.integers(min_value=2**31)),
+        )
+        def hypothesis_out_of_range(m, key):
+            # a key or value that doesn't fit in an int32 is an error, rather than wrapping onto another
+            before = dict(m)
+            for op in [
+                lambda: m.__setitem__(key, 1),
+                lambda: m.__setitem__(0, key),
+                lambda: m.get(key),
+                lambda: m.setdefault(key, 1),
+                lambda: m.set_many([key], [1]),
+            ]:
+                try:
+                    op()
+                    raise AssertionError("expected OverflowError")
+                except OverflowError:
+                    pass
+            assert dict(m) == before
+
+        hypothesis_out_of_range()
@@ -0,0 +1,81 @@
+import collections
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class IngestTest(unittest.TestCase):
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp()
+        os.close(fd)
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def write(self, data):
+        with open(self.path, "wb") as fp:
+            fp.write(data)
+
+    def test_tokens(self):
+        rng = np.random.default_rng(0)
+        words = [str(w) for w in rng.zipf(1.5, 50000) % 3000] + ["Mät", "mät", "x" * 40]
+        seps = rng.choice([" ", "\n", "\t\t"], len(words)).tolist()
+        self.write("".join(w + s for w, s in zip(words, seps)).encode())
+        expected = collections.Counter(words)
+        for threads in [1, 2, 3, 16]:
+            d = pkm.ingest_file(self.path, threads=threads)
+            self.assertEqual(dict(d.items()), expected)
+        d = pkm.ingest_file(self.path, threads=4, key_type=bytes, value_type=pkm.int32_, lowercase=True)
+        self.assertEqual(d["mät".encode()], 2)
+
+        # tokens can't be cut in two when the parts are split at a delimiter other than '\n'
+        self.write(b"a,bb," * 10000)
+        d = pkm.ingest_file(self.path, threads=7, delimiters=b",")
+        self.assertEqual(dict(d.items()), {"a": 10000, "bb": 10000})
+
+        self.write(b"ok \xff\xfe")
+        with self.assertRaises(UnicodeDecodeError):
+            pkm.ingest_file(self.path)
+        with self.assertRaises(TypeError):
+            pkm.ingest_file(self.path, value_type=float)
+
+    def test_tsv(self):
+        rng = np.random.default_rng(1)
+        keys = rng.integers(0, 2000, 30000).tolist()
+        lines = [f"k{k}\t{i - 15000}" for i, k in enumerate(keys)]
+        self.write("\r\n".join(lines).encode() + b"\n\n")
+        expected = {f"k{k}": i - 15000 for i, k in enumerate(keys)}
+        for threads in [1, 2, 5, 16]:
+            d = pkm.ingest_file(self.path, mode="tsv", threads=threads)
+            self.assertEqual(dict(d.items()), expected)
+        d = pkm.ingest_file(self.path, mode="tsv", threads=3, value_type=float)
+        self.assertEqual(dict(d.items()), {k: float(v) for k, v in expected.items()})
+
+        self.write(b"a,1.5\nb,-2e3\nc,nan\nd,0.1\n")
+        d = pkm.ingest_file(self.path, mode="tsv", sep=",", key_type=bytes, value_type=float)
+        self.assertEqual((d[b"a"], d[b"b"], d[b"d"]), (1.5, -2000.0, 0.1))
+        self.assertNotEqual(d[b"c"], d[b"c"])
+
+        self.write(b"a\t1\nb 2\n")
+        with self.assertRaisesRegex(ValueError, "byte 4"):
+            pkm.ingest_file(self.path, mode="tsv")
+        self.write(b"a\t2147483648\n")
+        self.assertEqual(pkm.ingest_file(self.path, mode="tsv")["a"], 2**31)
+        with self.assertRaises(ValueError):
+            pkm.ingest_file(self.path, mode="tsv", value_type=pkm.int32_)
+        self.write(b"a\t1.0\n")
+        with self.assertRaises(ValueError):
+            pkm.ingest_file(self.path, mode="tsv")
+
+    def test_empty(self):
+        self.write(b"")
+        self.assertEqual(len(pkm.ingest_file(self.path)), 0)
+        self.assertEqual(len(pkm.ingest_file(self.path, mode="tsv")), 0)
+        with self.assertRaises(NotImplementedError):
+            pkm.ingest_file(self.path, key_type=int)
+        with self.assertRaises(ValueError):
+            pkm.ingest_file(self.path, mode="csv")
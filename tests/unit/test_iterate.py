@@ -0,0 +1,101 @@
+import gc
+import operator
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class IterateTest(unittest.TestCase):
+    def test_sparse(self):
+        for key_type, make_key in [(str, lambda i: f"key{i}"), (int, lambda i: i * 7919), (bytes, lambda i: b"%d" % i)]:
+            d = pkm.create(key_type, int)
+            for i in range(5000):
+                d[make_key(i)] = i
+            # leaves long runs of deleted buckets, and whole groups without a live one
+            for i in range(5000):
+                if i % 100 != 0:
+                    del d[make_key(i)]
+            expected = {make_key(i): i for i in range(0, 5000, 100)}
+            self.assertEqual(dict(d.items()), expected)
+            self.assertEqual(sorted(d.keys(), key=str), sorted(expected, key=str))
+            self.assertEqual(sorted(d.values()), list(expected.values()))
+            self.assertEqual(d.keys_list(), list(d.keys()))
+            self.assertEqual(d.items_list(), list(d.items()))
+        self.assertEqual(pkm.create(str, int).items_list(), [])
+
+    def test_length_hint(self):
+        d = pkm.create(str, float)
+        d.update({"a": 1.0, "b": 2.0, "c": 3.0})
+        for it in (d.keys(), d.values(), d.items()):
+            self.assertEqual(operator.length_hint(it), 3)
+            next(it)
+            self.assertEqual(operator.length_hint(it), 2)
+            list(it)
+            self.assertEqual(operator.length_hint(it), 0)
+        v = pkm.vocab()
+        v.encode(["x", "y"])
+        it = v.items()
+        next(it)
+        self.assertEqual(operator.length_hint(it), 1)
+        with self.assertRaises(TypeError):
+            next(d)
+
+    def test_item_reuse(self):
+        d = pkm.create(int, str)
+        for i in range(100):
+            d[i] = str(i) * 10
+        kept = list(d.items())
+        self.assertEqual(len(set(map(id, kept))), 100)
+        self.assertEqual(kept, [(k, d[k]) for k in d.keys()])
+        for k, v in d.items():
+            self.assertEqual(v, str(k) * 10)
+
+        o = pkm.create(str, object)
+        o["a"] = None
+        o["b"] = None
+        first, second = o.keys_list()
+        o[first] = 1
+        o[second] = [2]
+        it = o.items()
+        item = next(it)
+        item_id = id(item)
+        # the collector stops tracking a tuple of atomic objects like (str, int)
+        gc.collect()
+        del item
+        item = next(it)
+        self.assertEqual(id(item), item_id)
+        self.assertEqual(item, (second, [2]))
+        self.assertTrue(gc.is_tracked(item))
+
+    def test_changed_during_iteration(self):
+        d = pkm.create(str, int)
+        for i in range(200):
+            d[str(i)] = i
+        seen = 0
+        for k in d.keys():
+            seen += 1
+            if seen == 10:
+                # grows the table, so the iterator's saved group is stale
+                for i in range(200, 2000):
+                    d[str(i)] = i
+            if seen == 20:
+                d.clear()
+        self.assertGreaterEqual(seen, 20)
+        self.assertEqual(list(d.items()), [])
+
+    def test_specialized(self):
+        r = pkm.create(str, [("a", "i4")])
+        r["x"] = (1,)
+        self.assertEqual(r.items_list(), [("x", (1,))])
+        self.assertEqual(r.keys_list(), ["x"])
+        p = pkm.create(str, list)
+        p.append("x", 5)
+        self.assertEqual([(k, v.tolist()) for k, v in p.items_list()], [("x", [5])])
+        v = pkm.vocab(bytes)
+        v.encode([b"b", b"a"])
+        self.assertEqual(v.keys_list(), [b"b", b"a"])
+        self.assertEqual(v.items_list(), [(b"b", 0), (b"a", 1)])
+        it = v.items()
+        self.assertEqual([next(it), next(it)], [(b"b", 0), (b"a", 1)])
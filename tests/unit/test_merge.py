@@ -0,0 +1,74 @@
+import collections
+import math
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class MergeTest(unittest.TestCase):
+    def test_numeric(self):
+        rng = np.random.default_rng(0)
+        parts = []
+        for _ in range(6):
+            keys = rng.integers(0, 3000, 2000)
+            d = pkm.create(str, pkm.compact_int64_)
+            d.accumulate([str(k) for k in keys.tolist()], values=None, op="count")
+            parts.append(d)
+        total = pkm.create(str, pkm.compact_int64_)
+        total.merge_many(parts)
+        expected = collections.Counter()
+        for d in parts:
+            expected.update(dict(d.items()))
+        self.assertEqual(dict(total.items()), expected)
+
+        a, b = parts[0], parts[1]
+        for op, combine in [("min", min), ("max", max), ("replace", lambda x, y: y), ("keep", lambda x, y: x)]:
+            c = a.copy()
+            c.merge(b, op=op)
+            keys = set(a) | set(b)
+            self.assertEqual(
+                dict(c.items()),
+                {k: combine(a[k], b[k]) if k in a and k in b else a.get(k, b.get(k)) for k in keys},
+            )
+        c = b.copy()
+        c.merge(c)
+        self.assertEqual(dict(c.items()), {k: 2 * v for k, v in b.items()})
+        c.merge_many([c, c], op="max")
+        with self.assertRaises(ValueError):
+            c.merge(b, op="count")
+        with self.assertRaises(TypeError):
+            c.merge({"a": 1})
+        with self.assertRaises(TypeError):
+            c.merge_many([b, pkm.create(str, int)])
+
+        f = pkm.create(int, float)
+        f.update({1: math.nan, 2: 1.5})
+        g = pkm.create(int, float)
+        g.update({1: 2.0, 2: math.nan, 3: 0.25})
+        f.merge(g, "min")
+        self.assertEqual(dict(f.items()), {1: 2.0, 2: 1.5, 3: 0.25})
+
+    def test_non_numeric(self):
+        s = pkm.create(str, str)
+        s.update({"a": "x" * 50, "b": "y"})
+        t = pkm.create(str, str)
+        t.update({"a": "z", "c": "w" * 40})
+        u = s.copy()
+        u.merge(t)
+        self.assertEqual(dict(u.items()), {"a": "z", "b": "y", "c": "w" * 40})
+        u = s.copy()
+        u.merge_many([t, u], op="keep")
+        self.assertEqual(dict(u.items()), {"a": "x" * 50, "b": "y", "c": "w" * 40})
+        with self.assertRaises(ValueError):
+            u.merge(t, op="sum")
+
+        x, y = object(), object()
+        o = pkm.create(int, object)
+        o[1] = x
+        p = pkm.create(int, object)
+        p.update({1: y, 2: y})
+        o.merge(p)
+        self.assertIs(o[1], y)
+        self.assertIs(o[2], y)
@@ -0,0 +1,42 @@
+import math
+import unittest
+from operator import itemgetter
+
+import pypocketmap as pkm
+
+
+class MostCommonTest(unittest.TestCase):
+    def test_matches_sorted(self):
+        for key_type, value_type in [(str, int), (int, pkm.compact_int64_), (bytes, pkm.int32_), (int, float)]:
+            d = pkm.create(key_type, value_type)
+            for i in range(2000):
+                key = str(i) if key_type is str else b"%d" % i if key_type is bytes else i * 7919
+                d[key] = (i * 37) % 101 - 50
+                if i % 7 == 0:
+                    del d[key]
+            if value_type is pkm.compact_int64_:
+                d[-1] = 2**40
+            items = list(d.items())
+            # ties keep the order of items(), like a stable sort
+            most = sorted(items, key=itemgetter(1), reverse=True)
+            least = sorted(items, key=itemgetter(1))
+            for k in (1, 3, 50, len(d)):
+                self.assertEqual(d.most_common(k), most[:k])
+                self.assertEqual(d.least_common(k=k), least[:k])
+            self.assertEqual(d.most_common(), most)
+            self.assertEqual(d.most_common(len(d) + 10), most)
+            self.assertEqual(d.most_common(0), [])
+            self.assertEqual(d.least_common(-1), [])
+
+    def test_nan_last(self):
+        d = pkm.create(str, float)
+        d.update({"a": 1.0, "b": math.nan, "c": -2.0, "d": math.inf})
+        self.assertEqual(d.most_common(3), [("d", math.inf), ("a", 1.0), ("c", -2.0)])
+        self.assertEqual(d.least_common(3), [("c", -2.0), ("a", 1.0), ("d", math.inf)])
+        self.assertTrue(math.isnan(d.least_common()[3][1]))
+        self.assertEqual(pkm.create(str, int).most_common(5), [])
+
+    def test_non_numeric(self):
+        self.assertFalse(hasattr(pkm.create(str, str), "most_common"))
+        with self.assertRaises(TypeError):
+            pkm.create(str, int).most_common("5")
@@ -0,0 +1,89 @@
+import gc
+import sys
+import unittest
+import weakref
+
+import pypocketmap as pkm
+
+
+class Payload:
+    pass
+
+
+class ObjectTest(unittest.TestCase):
+    def test_refcounts(self):
+        d = pkm.create(str, object)
+        v = Payload()
+        base = sys.getrefcount(v)
+        d["a"] = v
+        d["b"] = v
+        self.assertIs(d["a"], v)
+        self.assertEqual(sys.getrefcount(v), base + 2)
+        d["b"] = None
+        self.assertEqual(sys.getrefcount(v), base + 1)
+        self.assertIs(d.pop("a"), v)
+        self.assertEqual(sys.getrefcount(v), base)
+        d["c"] = v
+        self.assertEqual(sorted([d.popitem(), d.popitem()], key=repr), [("b", None), ("c", v)])
+        self.assertEqual(sys.getrefcount(v), base)
+        for i in range(1000):
+            d[str(i)] = v if i % 7 else None
+        e = d.copy()
+        self.assertEqual(sys.getrefcount(v), base + 2 * 857)
+        del d
+        e.clear()
+        self.assertEqual(sys.getrefcount(v), base)
+
+    def test_methods(self):
+        d = pkm.create(int, pkm.object_)
+        self.assertIsNone(d.setdefault(1))
+        self.assertEqual(d.setdefault(2, [1]), [1])
+        d[2].append(2)
+        self.assertEqual(d[2], [1, 2])
+        self.assertEqual(d.get(3, "x"), "x")
+        d.update({3: (1, "a"), 4: {"k": 1.5}})
+        self.assertEqual(d, {1: None, 2: [1, 2], 3: (1, "a"), 4: {"k": 1.5}})
+        self.assertNotEqual(d, {1: None, 2: [1, 2], 3: (1, "a"), 4: {}})
+        d.set_many([5, 6], ["five", b"six"])
+        self.assertEqual(d.get_many([5, 6, 7], 0), ["five", b"six", 0])
+        del d[1]
+        self.assertNotIn(1, d)
+        e = pkm.create(str, object)
+        e["a"] = [None]
+        self.assertEqual(repr(e), "<pypocketmap[str, object]: {'a': [None]}>")
+
+    def test_eq_error(self):
+        class Bad:
+            def __eq__(self, other):
+                raise RuntimeError("no")
+
+        d = pkm.create(str, object)
+        d["a"] = Bad()
+        with self.assertRaises(RuntimeError):
+            d == {"a": 1}
+
+    def test_cycles(self):
+        d = pkm.create(str, object)
+        p = Payload()
+        p.owner = d
+        d["self"] = d
+        d["p"] = p
+        ref = weakref.ref(p)
+        del d, p
+        gc.collect()
+        self.assertIsNone(ref())
+
+    def test_reentrant_del(self):
+        d = pkm.create(int, object)
+
+        class Reenter:
+            def __del__(self):
+                # runs while the map is removing this value
+                d[len(d) + 100] = "added"
+
+        d[1] = Reenter()
+        del d[1]
+        self.assertEqual(dict(d.items()), {100: "added"})
+        d[2] = Reenter()
+        d.clear()
+        self.assertEqual(dict(d.items()), {100: "added"})
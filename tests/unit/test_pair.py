@@ -0,0 +1,93 @@
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class PairKeyTest(unittest.TestCase):
+    def test_tuples(self):
+        d = pkm.create((int, int), float)
+        d[(1, 2)] = 0.5
+        d[2, 1] = 1.5
+        d[-(2**63), 2**63 - 1] = 2.5
+        self.assertEqual(len(d), 3)
+        self.assertEqual(d[1, 2], 0.5)
+        self.assertEqual(d[2, 1], 1.5)
+        self.assertEqual(d[-(2**63), 2**63 - 1], 2.5)
+        self.assertNotIn((1, 1), d)
+        self.assertEqual(sorted(d.keys()), [(-(2**63), 2**63 - 1), (1, 2), (2, 1)])
+        self.assertIs(type(next(iter(d))), tuple)
+
+    def test_dense_edges(self):
+        d = pkm.create(pkm.int64_pair_, pkm.int32_)
+        for a in range(100):
+            for b in range(100):
+                d[a, b] = a * 100 + b
+        self.assertEqual(len(d), 10000)
+        for a in range(100):
+            for b in range(100):
+                self.assertEqual(d[a, b], a * 100 + b)
+
+    def test_bad_keys(self):
+        d = pkm.create(pkm.int64_pair_, pkm.int64_)
+        with self.assertRaises(TypeError):
+            d[[1, 2]] = 1
+        with self.assertRaises(TypeError):
+            d[1, 2, 3] = 1
+        with self.assertRaises(TypeError):
+            d[1, "2"] = 1
+        with self.assertRaises(OverflowError):
+            d[1, 2**63] = 1
+        self.assertEqual(len(d), 0)
+
+    def test_key_error(self):
+        d = pkm.create(pkm.int64_pair_, pkm.string_)
+        with self.assertRaises(KeyError) as ctx:
+            d[3, 4]
+        self.assertEqual(ctx.exception.args, ((3, 4),))
+
+    def test_repr(self):
+        d = pkm.create(pkm.int64_pair_, pkm.int64_)
+        d[-1, 2] = 3
+        self.assertEqual(repr(d), "<pypocketmap[int64_pair, int64]: {(-1, 2): 3}>")
+
+
+class BulkTest(unittest.TestCase):
+    def test_pair_arrays(self):
+        d = pkm.create(pkm.int64_pair_, pkm.float64_)
+        edges = np.arange(20, dtype=np.int64).reshape(10, 2)
+        d.set_many(edges, np.linspace(0, 1, 10))
+        self.assertEqual(d[2, 3], d.get_many([(2, 3)])[0])
+        got = d.get_many((edges[:, 0].copy(), edges[:, 1].copy()))
+        self.assertEqual(got.dtype, np.float64)
+        np.testing.assert_array_equal(got, np.linspace(0, 1, 10))
+        np.testing.assert_array_equal(d.get_many(edges[:, ::-1].copy(), -1.0), np.full(10, -1.0))
+        np.testing.assert_array_equal(d.get_many(keys=[(9, 9)], default=-2.0), [-2.0])
+        with self.assertRaises(ValueError):
+            d.get_many(np.zeros((4, 3), dtype=np.int64))
+        with self.assertRaises(TypeError):
+            d.get_many((np.arange(4), np.arange(4.0)))
+        with self.assertRaises(ValueError):
+            d.get_many((np.arange(4), np.arange(5)))
+
+    def test_numeric(self):
+        d = pkm.create(pkm.int32_, pkm.int64_)
+        d.set_many(np.arange(0, 100, 2, dtype=np.int32), range(50))
+        got = d.get_many(np.arange(10, dtype=np.int32), 7)
+        self.assertEqual(got.dtype, np.int64)
+        np.testing.assert_array_equal(got, [0, 7, 1, 7, 2, 7, 3, 7, 4, 7])
+        # other dtypes and plain sequences go through the slow path
+        np.testing.assert_array_equal(d.get_many(np.arange(3, dtype=np.int64)), [0, 0, 1])
+        np.testing.assert_array_equal(d.get_many([4, 5]), [2, 0])
+        with self.assertRaises(ValueError):
+            d.set_many([1, 2], [1])
+
+    def test_str(self):
+        d = pkm.create(str, str)
+        d.set_many(["a", "b", "c"], ("x", "y", "z"))
+        self.assertEqual(d.get_many(["c", "missing", "a"]), ["z", None, "x"])
+        self.assertEqual(d.get_many(iter(["b", "d"]), ""), ["y", ""])
+        with self.assertRaises(TypeError):
+            d.set_many(["e", 1], ["x", "y"])
+        self.assertEqual(d["e"], "x")
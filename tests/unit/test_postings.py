@@ -0,0 +1,99 @@
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class PostingsTest(unittest.TestCase):
+    def test_append(self):
+        d = pkm.create(str, list)
+        self.assertEqual(d.dtype, "i8")
+        for i in range(100):
+            d.append("even" if i % 2 == 0 else "odd", i)
+        d.append("big", 2**62)
+        np.testing.assert_array_equal(d["even"], np.arange(0, 100, 2))
+        np.testing.assert_array_equal(d["odd"], np.arange(1, 100, 2))
+        self.assertEqual(d["big"].tolist(), [2**62])
+        self.assertEqual(d["odd"].dtype, np.int64)
+        self.assertIsNone(d.get("missing"))
+        d["even"] = [5, 6]
+        self.assertEqual(d.pop("even").tolist(), [5, 6])
+        self.assertEqual(len(d), 2)
+        e = pkm.create(int, [np.int32])
+        e.append(1, -(2**31))
+        self.assertEqual(e[1].dtype, np.int32)
+        with self.assertRaises(OverflowError):
+            e.append(1, 2**31)
+        self.assertEqual(repr(e), "<pypocketmap[int64, postings]: {1: array([-2147483648], dtype=int32)}>")
+        with self.assertRaises(TypeError):
+            pkm.create(str, [np.float32])
+
+    def test_extend_many(self):
+        rng = np.random.default_rng(0)
+        terms = rng.integers(0, 500, 20000)
+        docs = np.arange(20000, dtype=np.int32)
+        d = pkm.create(pkm.int64_, ["i4"])
+        d.extend_many(terms, docs)
+        expected = {}
+        for t, doc in zip(terms.tolist(), docs.tolist()):
+            expected.setdefault(t, []).append(doc)
+        self.assertEqual(len(d), len(expected))
+        for t, ids in expected.items():
+            self.assertEqual(d[t].tolist(), ids)
+        d.extend_many([7, 7], [1, 2])
+        self.assertEqual(d[7].tolist()[-2:], [1, 2])
+        with self.assertRaises(ValueError):
+            d.extend_many([1, 2], [1])
+        f = d.copy()
+        d.clear()
+        self.assertEqual(f[7].tolist()[-2:], [1, 2])
+
+    def test_view(self):
+        d = pkm.create(str, list)
+        for i in range(40):
+            d.append("a", i)
+        d.append("b", 1)
+        v = d.view("a")
+        w = d.view("b")
+        np.testing.assert_array_equal(v, np.arange(40))
+        self.assertFalse(v.flags.writeable)
+        with self.assertRaises(BufferError):
+            d.append("a", 40)
+        with self.assertRaises(BufferError):
+            del d["b"]
+        self.assertEqual(w.tolist(), [1])
+        del v, w
+        d.append("a", 40)
+        self.assertEqual(len(d["a"]), 41)
+        with self.assertRaises(KeyError):
+            d.view("c")
+
+    def test_freeze(self):
+        d = pkm.create(str, [np.int32])
+        ids = [3, 1, 2**31 - 1, -(2**31), 0, 7]
+        for i in ids:
+            d.append("x", i)
+        for i in range(1000):
+            d.append("sorted", i * 3)
+        d["empty"] = []
+        before = {k: v.tolist() for k, v in d.items()}
+        d.freeze()
+        self.assertTrue(d.frozen)
+        self.assertEqual({k: v.tolist() for k, v in d.items()}, before)
+        self.assertEqual(d["x"].dtype, np.int32)
+        with self.assertRaises(TypeError):
+            d.append("x", 1)
+        with self.assertRaises(TypeError):
+            d.view("x")
+        e = d.copy()
+        self.assertTrue(e.frozen)
+        self.assertEqual(e["sorted"].tolist(), before["sorted"])
+        del d["x"]
+        self.assertNotIn("x", d)
+
+        big = pkm.create(str, list)
+        for i in [0, 2**63 - 1, -(2**63), 5]:
+            big.append("k", i)
+        big.freeze()
+        self.assertEqual(big["k"].tolist(), [0, 2**63 - 1, -(2**63), 5])
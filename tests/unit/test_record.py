@@ -0,0 +1,80 @@
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class RecordTest(unittest.TestCase):
+    def test_fields(self):
+        d = pkm.create(str, [("count", int), ("total", float), ("flags", "u1")])
+        self.assertEqual(d.fields, [("count", "i8"), ("total", "f8"), ("flags", "u1")])
+        dt = np.dtype([("count", np.int32), ("total", np.float32)])
+        d = pkm.create(int, dt)
+        self.assertEqual(d.fields, [("count", "i4"), ("total", "f4")])
+        d[1] = (2, 0.5)
+        self.assertEqual(d[1], (2, 0.5))
+        with self.assertRaises(TypeError):
+            pkm.create(str, [("name", "U8")])
+        with self.assertRaises(ValueError):
+            pkm.create(str, [])
+
+    def test_field_ops(self):
+        d = pkm.create(str, [("count", "i8"), ("total", "f8"), ("small", "i1")])
+        self.assertEqual(d.add("a", "count"), 1)
+        self.assertEqual(d.add("a", "total", 2.5), 2.5)
+        self.assertEqual(d.add("a", 0, 4), 5)
+        self.assertEqual(d["a"], (5, 2.5, 0))
+        d.set_field("b", "small", -3)
+        self.assertEqual(d["b"], (0, 0.0, -3))
+        self.assertEqual(d.get_field("b", "small"), -3)
+        self.assertEqual(d.get_field("c", "count", None), None)
+        with self.assertRaises(KeyError):
+            d.get_field("c", "count")
+        with self.assertRaises(KeyError):
+            d.add("a", "missing")
+        with self.assertRaises(IndexError):
+            d.set_field("a", 3, 1)
+        # integers wrap around at the field width, like numpy
+        d.set_field("c", "small", 127)
+        self.assertEqual(d.add("c", "small"), -128)
+        with self.assertRaises(OverflowError):
+            d.set_field("c", "small", 128)
+        with self.assertRaises(ValueError):
+            d["d"] = (1, 2.0)
+        self.assertNotIn("d", d)
+
+    def test_growth(self):
+        d = pkm.create(int, [("a", "i4"), ("b", "f8"), ("c", "u2")])
+        for i in range(5000):
+            d[i] = (i, i / 2, i % 65536)
+        for i in range(0, 5000, 2):
+            del d[i]
+        for i in range(5000, 6000):
+            d.add(i, "c", 7)
+        self.assertEqual(len(d), 3500)
+        for i in range(1, 5000, 2):
+            self.assertEqual(d[i], (i, i / 2, i))
+        self.assertEqual(d[5500], (0, 0.0, 7))
+        e = d.copy()
+        d.clear()
+        self.assertEqual(len(e), 3500)
+        self.assertEqual(e.pop(1), (1, 0.5, 1))
+
+    def test_to_numpy(self):
+        d = pkm.create(str, [("n", "i4"), ("mean", "f4")])
+        d["x"] = (1, 1.5)
+        d["y"] = (2, -0.5)
+        arr = d.to_numpy()
+        self.assertEqual(arr.dtype.names, ("n", "mean"))
+        self.assertEqual(arr.dtype.itemsize, 8)
+        self.assertEqual(sorted(arr.tolist()), [(1, 1.5), (2, -0.5)])
+        col = d.to_numpy("n")
+        self.assertEqual(col.dtype, np.int32)
+        np.testing.assert_array_equal(col, arr["n"])
+        self.assertEqual(list(d.keys()), [k for k in d])
+
+    def test_repr(self):
+        d = pkm.create(str, [("n", "i8")])
+        d["a"] = (1,)
+        self.assertEqual(repr(d), "<pypocketmap[str, record]: {'a': (1,)}>")
@@ -0,0 +1,97 @@
+import math
+import random
+import unittest
+
+import pypocketmap as pkm
+
+
+class RetainTest(unittest.TestCase):
+    def test_retain_matches_dict(self):
+        rng = random.Random(0)
+        for key_type, make_key in [
+            (str, lambda i: f"k{i}" + "x" * (i % 30)),
+            (int, lambda i: i * 7919),
+            (pkm.int64_pair_, lambda i: (i, -i)),
+        ]:
+            for value_type, make_value in [(int, lambda i: i % 97), (str, lambda i: str(i % 97)), (object, lambda i: [i % 97])]:
+                d = pkm.create(key_type, value_type)
+                expected = {}
+                for i in range(20000):
+                    d[make_key(i)] = expected[make_key(i)] = make_value(i)
+                for step in range(3):
+                    for i in rng.sample(range(20000), 3000):
+                        if make_key(i) in expected:
+                            del d[make_key(i)]
+                            del expected[make_key(i)]
+
+                    def keep(k, v):
+                        return int(v[0] if isinstance(v, list) else v) % 3 != step
+
+                    before = len(expected)
+                    expected = {k: v for k, v in expected.items() if keep(k, v)}
+                    self.assertEqual(d.retain(keep), before - len(expected))
+                    # the table is still consistent for lookups and inserts
+                    for i in rng.sample(range(20000), 2000):
+                        d[make_key(i)] = expected[make_key(i)] = make_value(1)
+                    self.assertEqual(len(d), len(expected))
+                    self.assertEqual(dict(d.items()), expected)
+                    for k, v in expected.items():
+                        self.assertEqual(d[k], v)
+
+    def test_retain_where(self):
+        d = pkm.create(str, int)
+        for i in range(100000):
+            d[str(i)] = i
+        # shrinks the table, which must still work afterwards
+        self.assertEqual(d.retain_where("<", 10), 99990)
+        self.assertEqual(dict(d.items()), {str(i): i for i in range(10)})
+        for i in range(10, 1000):
+            d[str(i)] = i
+        self.assertEqual(d.retain_where("!=", 500), 1)
+        self.assertEqual(d.retain_where(">=", 990), 989)
+        self.assertEqual(sorted(d.values()), list(range(990, 1000)))
+
+        f = pkm.create(str, float)
+        f.update({"a": float("nan"), "b": 1.0, "c": 7.5})
+        # NaNs only satisfy "!="
+        self.assertEqual(f.retain_where("!=", 5.0), 0)
+        self.assertEqual(f.retain_where("<=", 7.5), 1)
+        self.assertEqual(f.items_list(), [("b", 1.0), ("c", 7.5)] if f.keys_list()[0] == "b" else [("c", 7.5), ("b", 1.0)])
+        self.assertEqual(f.retain_where("==", 1.0), 1)
+        self.assertEqual(f.retain_where(">", 1.0), 1)
+        self.assertEqual(len(f), 0)
+        f["d"] = math.inf
+        self.assertEqual(f["d"], math.inf)
+
+        for args, error in [(("<>", 1), ValueError), (("<", 1.5), TypeError), (("<", None), TypeError)]:
+            with self.assertRaises(error):
+                d.retain_where(*args)
+        self.assertFalse(hasattr(pkm.create(str, str), "retain_where"))
+
+    def test_retain_errors(self):
+        d = pkm.create(str, int)
+        for i in range(100):
+            d[str(i)] = i
+        with self.assertRaises(RuntimeError):
+            d.retain(lambda k, v: d.__setitem__("new", 1))
+        seen = []
+
+        def keep(k, v):
+            seen.append(k)
+            if len(seen) == 50:
+                raise KeyError(k)
+            return False
+
+        with self.assertRaises(KeyError):
+            d.retain(keep)
+        # the entries before the error were deleted, and the map is usable again
+        self.assertEqual(len(d), 51)
+        d["new"] = 1
+        self.assertEqual(d.retain(lambda k, v: k == "new"), 51)
+        self.assertEqual(d.items_list(), [("new", 1)])
+        with self.assertRaises(TypeError):
+            d.retain(5)
+
+
+if __name__ == "__main__":
+    unittest.main()
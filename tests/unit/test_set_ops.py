@@ -0,0 +1,81 @@
+import random
+import unittest
+
+import pypocketmap as pkm
+
+
+class SetOpsTest(unittest.TestCase):
+    def test_matches_dict(self):
+        rng = random.Random(2)
+        for key_type, make_key in [
+            (str, lambda i: f"k{i}" + "x" * (i % 25)),
+            (int, lambda i: i - 5000),
+            (pkm.int64_pair_, lambda i: (i, -i)),
+        ]:
+            for value_type, make_value in [(int, lambda i: i), (float, lambda i: i / 4), (str, lambda i: "v" * (i % 20)), (object, lambda i: [i])]:
+                for na, nb in [(0, 0), (0, 50), (10, 3000), (3000, 10), (2000, 2000)]:
+                    a, b = pkm.create(key_type, value_type), pkm.create(key_type, value_type)
+                    da, db = {}, {}
+                    for i in rng.sample(range(6000), na):
+                        a[make_key(i)] = da[make_key(i)] = make_value(i)
+                    for i in rng.sample(range(6000), nb):
+                        b[make_key(i)] = db[make_key(i)] = make_value(i + 1)
+                    only_a = {k: v for k, v in da.items() if k not in db}
+                    only_b = {k: v for k, v in db.items() if k not in da}
+                    for result, expected in [
+                        (a | b, da | db),
+                        (b | a, db | da),
+                        (a & b, {k: v for k, v in da.items() if k in db}),
+                        (b & a, {k: v for k, v in db.items() if k in da}),
+                        (a - b, only_a),
+                        (b - a, only_b),
+                        (a ^ b, {**only_a, **only_b}),
+                    ]:
+                        self.assertIsInstance(result, type(a))
+                        self.assertEqual(dict(result.items()), expected)
+                        # the result is a separate map, which still works after deletes and inserts
+                        for k in list(expected)[:20]:
+                            del result[k]
+                        result[make_key(7000)] = make_value(1)
+                        self.assertEqual(len(result), len(expected) - min(20, len(expected)) + 1)
+                    self.assertEqual(dict(a.items()), da)
+                    self.assertEqual(dict(b.items()), db)
+
+    def test_same_map(self):
+        a = pkm.create(str, int)
+        a.update({"x": 1, "y": 2})
+        self.assertEqual(dict((a | a).items()), {"x": 1, "y": 2})
+        self.assertEqual(dict((a & a).items()), {"x": 1, "y": 2})
+        self.assertEqual(len(a - a), 0)
+        self.assertEqual(len(a ^ a), 0)
+        a |= a
+        self.assertEqual(dict(a.items()), {"x": 1, "y": 2})
+
+    def test_ior(self):
+        a = pkm.create(str, int)
+        b = pkm.create(str, int)
+        a.update({"x": 1, "y": 2})
+        b.update({"y": 3, "z": 4})
+        before = a
+        a |= b
+        self.assertIs(a, before)
+        self.assertEqual(dict(a.items()), {"x": 1, "y": 3, "z": 4})
+        # anything that update() takes works too
+        a |= {"w": 0}
+        self.assertEqual(a["w"], 0)
+        with self.assertRaises(TypeError):
+            a |= [("v", 1)]
+
+    def test_other_types(self):
+        a = pkm.create(str, int)
+        a["x"] = 1
+        for other in [{"x": 1}, pkm.create(str, float), pkm.create(int, int), 5]:
+            for op in [lambda p, q: p | q, lambda p, q: p & q, lambda p, q: p - q, lambda p, q: p ^ q]:
+                with self.assertRaises(TypeError):
+                    op(a, other)
+                with self.assertRaises(TypeError):
+                    op(other, a)
+
+
+if __name__ == "__main__":
+    unittest.main()
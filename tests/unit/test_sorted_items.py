@@ -0,0 +1,102 @@
+import math
+import os
+import random
+import tempfile
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+def columns(d, **kwargs):
+    keys, values = d.sorted_items(**kwargs)
+    keys = [tuple(k) for k in keys.tolist()] if isinstance(keys, np.ndarray) and keys.ndim == 2 else list(keys)
+    values = values.tolist() if isinstance(values, np.ndarray) else values
+    return list(zip(keys, values))
+
+
+class SortedItemsTest(unittest.TestCase):
+    def test_matches_sorted(self):
+        rng = random.Random(0)
+        chars = "abé中\U0001f600"
+
+        def text(i):
+            # shared prefixes and lengths on both sides of the inline limit
+            return "".join(rng.choice(chars) for _ in range(rng.randint(0, 30))) + str(i % 50)
+
+        for key_type, value_type, make_key, make_value in [
+            (str, int, text, lambda i: rng.randint(-3, 3)),
+            (int, str, lambda i: rng.randint(-(2**63), 2**63 - 1), text),
+            (bytes, bytes, lambda i: bytes(rng.randint(0, 255) for _ in range(rng.randint(0, 20))), lambda i: b"v" * (i % 4)),
+            (pkm.int64_pair_, pkm.compact_int64_, lambda i: (rng.randint(-3, 3), rng.randint(-(2**40), 2**40)), lambda i: i % 5),
+            (int, pkm.float32_, lambda i: i, lambda i: (i % 17) / 4 - 2),
+        ]:
+            d = pkm.create(key_type, value_type)
+            for i in range(3000):
+                d[make_key(i)] = make_value(i)
+            items = d.items_list()
+            for by, index in (("key", 0), ("value", 1)):
+                for reverse in (False, True):
+                    # str sorts by its UTF-8 bytes, which is the same as code point order
+                    expected = sorted(items, key=lambda item: item[index], reverse=reverse)
+                    self.assertEqual(columns(d, by=by, reverse=reverse), expected, (key_type, by, reverse))
+
+    def test_floats(self):
+        d = pkm.create(str, float)
+        d.update({"a": float("nan"), "b": -0.0, "c": 0.0, "d": -math.inf, "e": 1e300, "f": float("nan")})
+        order = [k for k, _ in d.items()]
+        for reverse in (False, True):
+            keys, values = d.sorted_items(by="value", reverse=reverse)
+            zeros = [k for k in order if k in "bc"]
+            nans = [k for k in order if k in "af"]
+            # equal values keep their order in both directions, and NaNs come last
+            expected = ["e", *zeros, "d"] if reverse else ["d", *zeros, "e"]
+            self.assertEqual(keys, expected + nans)
+            self.assertEqual(values.dtype, np.float64)
+
+    def test_columns(self):
+        d = pkm.create(int, str)
+        d.update({3: "c", 1: "a"})
+        keys, values = d.sorted_items()
+        self.assertEqual(keys.dtype, np.int64)
+        self.assertEqual((keys.tolist(), values), ([1, 3], ["a", "c"]))
+        p = pkm.create(pkm.int64_pair_, int)
+        p[(1, 2)] = 5
+        self.assertEqual(p.sorted_items()[0].shape, (1, 2))
+        f = pkm.create(pkm.bytes16_, int)
+        f[b"b" * 16] = 1
+        f[b"a" * 16] = 2
+        self.assertEqual(columns(f), [(b"a" * 16, 2), (b"b" * 16, 1)])
+        empty_keys, empty_values = pkm.create(str, int).sorted_items(by="value")
+        self.assertEqual((empty_keys, empty_values.tolist()), ([], []))
+
+        o = pkm.create(str, object)
+        o["b"] = [1]
+        o["a"] = {}
+        self.assertEqual(o.sorted_items(), (["a", "b"], [{}, [1]]))
+        with self.assertRaises(TypeError):
+            o.sorted_items(by="value")
+        with self.assertRaises(ValueError):
+            d.sorted_items(by="length")
+
+    def test_path(self):
+        d = pkm.create(str, int)
+        d.update({"b": 2, "a": 1, "c": 2})
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "sorted.tsv")
+            self.assertIsNone(d.sorted_items(path=path, sep=","))
+            with open(path) as f:
+                self.assertEqual(f.read(), "a,1\nb,2\nc,2\n")
+            keys, _ = d.sorted_items(by="value", reverse=True)
+            d.sorted_items(by="value", reverse=True, path=path)
+            with open(path) as f:
+                self.assertEqual([line.split("\t")[0] for line in f.read().splitlines()], keys)
+            with self.assertRaises(ValueError):
+                d.sorted_items(path=path, sep="ab")
+            with self.assertRaises(TypeError):
+                pkm.create(str, str).sorted_items(path=path)
+
+
+if __name__ == "__main__":
+    unittest.main()
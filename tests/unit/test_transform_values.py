@@ -0,0 +1,124 @@
+import math
+import random
+import threading
+import unittest
+
+import pypocketmap as pkm
+
+
+def expected_value(op, operand, v):
+    if op == "mul":
+        return v * operand
+    if op == "add":
+        return v + operand
+    if op == "clamp":
+        low, high = operand
+        if low is not None and v < low:
+            return low
+        if high is not None and v > high:
+            return high
+        return v
+    step = 1 if operand is None else operand
+    return v // step * step if isinstance(v, int) else math.floor(v / step) * step
+
+
+class TransformValuesTest(unittest.TestCase):
+    def test_matches_python(self):
+        rng = random.Random(0)
+        for value_type, make_value, ops in [
+            (int, lambda: rng.randint(-(10**6), 10**6), [("mul", 3), ("add", -7), ("clamp", (-100, None)), ("floor", 10), ("floor", None)]),
+            (pkm.int32_, lambda: rng.randint(-(10**6), 10**6), [("mul", -3), ("clamp", (None, 0)), ("floor", 7)]),
+            # widens the compact values as they grow
+            (pkm.compact_int64_, lambda: rng.randint(-100, 100), [("mul", 10**9), ("add", 1), ("floor", 3)]),
+            (float, lambda: rng.uniform(-100, 100), [("mul", 0.9), ("add", 1.5), ("clamp", (-1.0, 2.0)), ("floor", 0.25)]),
+            (pkm.float32_, lambda: rng.randint(-400, 400) / 4, [("mul", 0.5), ("clamp", (0, 10)), ("floor", 2)]),
+        ]:
+            d = pkm.create(str, value_type)
+            for i in range(3000):
+                d[str(i)] = make_value()
+            # leaves groups with only some of their buckets live
+            for i in range(0, 3000, 4):
+                del d[str(i)]
+            for op, operand in ops:
+                expected = {k: expected_value(op, operand, v) for k, v in d.items()}
+                d.transform_values(op, operand)
+                self.assertEqual(dict(d.items()), expected, (value_type, op))
+
+    def test_edge_cases(self):
+        d = pkm.create(int, int)
+        d[1] = 2**62
+        d.transform_values("mul", 4)
+        self.assertEqual(d[1], 0)
+        f = pkm.create(int, float)
+        f[1] = float("nan")
+        f.transform_values("clamp", (0.0, 1.0))
+        self.assertTrue(math.isnan(f[1]))
+
+        for args, error in [
+            (("nope", 1), ValueError),
+            (("mul", None), TypeError),
+            (("mul", 1.5), TypeError),
+            (("floor", 0), ValueError),
+            (("clamp", (3, 1)), ValueError),
+            (("clamp", 5), TypeError),
+        ]:
+            with self.assertRaises(error):
+                d.transform_values(*args)
+        with self.assertRaises(OverflowError):
+            pkm.create(int, pkm.int32_).transform_values("add", 2**40)
+        self.assertFalse(hasattr(pkm.create(str, str), "transform_values"))
+
+    def test_decay_and_prune(self):
+        c = pkm.create(str, int)
+        for i in range(1000):
+            c[str(i)] = i
+        self.assertEqual(c.decay_and_prune(0.5, 100), 200)
+        self.assertEqual(dict(c.items()), {str(i): i // 2 for i in range(200, 1000)})
+        c["new"] = 1
+        self.assertEqual(c["new"], 1)
+
+        f = pkm.create(str, float)
+        f.update({"a": float("nan"), "b": 1.0, "c": 10.0})
+        self.assertEqual(f.decay_and_prune(0.9, 1.0), 1)
+        self.assertEqual(sorted(f.keys()), ["a", "c"])
+        self.assertEqual(f["c"], 9.0)
+
+        m = pkm.create(int, int)
+        m[1] = 2**63 - 1
+        self.assertEqual(m.decay_and_prune(1, 0), 0)
+        self.assertEqual(m[1], 2**63 - 1)
+        with self.assertRaises(ValueError):
+            m.decay_and_prune(1.5, 0)
+
+    def test_concurrent_reads(self):
+        # widening compact values and pruning long keys free memory that the reader could be using
+        d = pkm.create(str, pkm.compact_int64_)
+        keys = [f"key {i} " + "x" * 40 for i in range(20000)]
+        stop = threading.Event()
+        errors = []
+
+        def read():
+            while not stop.is_set():
+                for k in keys[::97]:
+                    v = d.get(k)
+                    if v is not None and v < 0:
+                        errors.append((k, v))
+                list(d.items())
+
+        reader = threading.Thread(target=read)
+        reader.start()
+        try:
+            for _ in range(10):
+                d.update({k: 1 for k in keys})
+                d.transform_values("mul", 2**40)
+                self.assertEqual(d[keys[0]], 2**40)
+                self.assertEqual(d.decay_and_prune(0.5, 2**40), len(keys))
+                self.assertEqual(len(d), 0)
+        finally:
+            stop.set()
+            reader.join()
+        self.assertEqual(errors, [])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,80 @@
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class TsvTest(unittest.TestCase):
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp()
+        os.close(fd)
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def test_round_trip(self):
+        rng = np.random.default_rng(0)
+        cases = [
+            (str, int, [f"kéy{i}" for i in range(5000)], rng.integers(-(2**63), 2**63 - 1, 5000)),
+            (bytes, float, [f"k{i}".encode() for i in range(5000)], rng.standard_normal(5000) * 1e10),
+            (int, pkm.int32_, (rng.permutation(5000) - 2500) * 2**40, rng.integers(-(2**31), 2**31 - 1, 5000)),
+            (pkm.int32_, pkm.float32_, np.arange(-2500, 2500, dtype=np.int32), rng.random(5000, dtype=np.float32)),
+            (str, pkm.compact_int64_, [str(i) for i in range(5000)], rng.integers(-300, 300, 5000)),
+        ]
+        for key_type, value_type, keys, values in cases:
+            d = pkm.create(key_type, value_type)
+            d.set_many(keys, values)
+            d.dump_tsv(self.path)
+            e = pkm.create(key_type, value_type)
+            e.load_tsv(self.path)
+            self.assertEqual(dict(e.items()), dict(d.items()))
+
+        d = pkm.create(str, float)
+        d.update({"a": 0.1, "b": float("-inf"), "c": 1 / 3})
+        d.dump_tsv(self.path, sep=",")
+        with open(self.path) as fp:
+            self.assertEqual(sorted(fp.read().splitlines()), ["a,0.1", "b,-inf", "c,0.3333333333333333"])
+        d["a\tb"] = 1.0
+        d.dump_tsv(self.path, sep=",")
+        with self.assertRaises(ValueError):
+            d.dump_tsv(self.path)
+        del d["a\tb"]
+        d["a\nb"] = 2.0
+        with self.assertRaises(ValueError):
+            d.dump_tsv(self.path, sep=",")
+
+    def test_load(self):
+        with open(self.path, "wb") as fp:
+            fp.write(b"a\t1\r\n\nb\t-2\na\t3\n" + b"x" * 3_000_000 + b"\t4")
+        d = pkm.create(str, int)
+        d["c"] = 5
+        d.load_tsv(self.path)
+        self.assertEqual(dict(d.items()), {"a": 3, "b": -2, "c": 5, "x" * 3_000_000: 4})
+        d.load_tsv(self.path)
+        self.assertEqual(len(d), 4)
+
+        for data in [b"a\t1\nb 2\n", b"a\t1\nb\t2.5\n", b"a\t1\nb\t\n"]:
+            with open(self.path, "wb") as fp:
+                fp.write(data)
+            d = pkm.create(str, int)
+            with self.assertRaisesRegex(ValueError, "byte 4"):
+                d.load_tsv(self.path)
+            self.assertEqual(dict(d.items()), {"a": 1})
+        with open(self.path, "wb") as fp:
+            fp.write(b"\xff\t1\n")
+        with self.assertRaises(UnicodeDecodeError):
+            pkm.create(str, int).load_tsv(self.path)
+        pkm.create(bytes, int).load_tsv(self.path)
+        with open(self.path, "wb") as fp:
+            fp.write(b"2147483648\t1\n")
+        with self.assertRaises(ValueError):
+            pkm.create(pkm.int32_, int).load_tsv(self.path)
+        with self.assertRaises(FileNotFoundError):
+            pkm.create(str, int).load_tsv(self.path + ".missing")
+        with self.assertRaises(ValueError):
+            pkm.create(str, int).load_tsv(self.path, sep="\n")
+        self.assertFalse(hasattr(pkm.create(str, str), "load_tsv"))
+        self.assertFalse(hasattr(pkm.create(pkm.bytes16_, int), "dump_tsv"))
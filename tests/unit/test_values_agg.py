@@ -0,0 +1,92 @@
+import math
+import random
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class ValuesAggTest(unittest.TestCase):
+    def test_matches_python(self):
+        rng = random.Random(0)
+        for value_type, make_value in [
+            (int, lambda: rng.randint(-(2**62), 2**62)),
+            (pkm.int32_, lambda: rng.randint(-(2**31), 2**31 - 1)),
+            (pkm.compact_int64_, lambda: rng.choice([1, 300, -70000, 2**40])),
+            (float, lambda: rng.uniform(-1000, 1000)),
+            (pkm.float32_, lambda: rng.randint(-100, 100) / 4),
+        ]:
+            for count in (1, 7, 5000):
+                d = pkm.create(str, value_type)
+                for i in range(count):
+                    d[str(i)] = make_value()
+                # leaves groups with only some of their buckets live
+                for i in range(0, count, 3):
+                    if count > 1:
+                        del d[str(i)]
+                values = list(d.values())
+                if isinstance(values[0], int):
+                    self.assertEqual(d.values_sum(), sum(values))
+                else:
+                    self.assertAlmostEqual(d.values_sum(), sum(values), delta=1e-9 * count)
+                self.assertEqual(d.values_min(), min(values))
+                self.assertEqual(d.values_max(), max(values))
+                self.assertAlmostEqual(d.values_mean(), sum(values) / len(values), delta=1e-9)
+
+                array = np.array(values, dtype=np.float64)
+                for bins, range_ in [(10, None), (7, (-50, 50)), (1, None), ([-1000, 0, 5, 10, 1e5], None)]:
+                    try:
+                        expected_counts, expected_edges = np.histogram(array, bins, range=range_)
+                    except ValueError:
+                        # the bins are too narrow to tell apart at this magnitude
+                        with self.assertRaises(ValueError):
+                            d.values_histogram(bins, range=range_)
+                        continue
+                    counts, edges = d.values_histogram(bins, range=range_)
+                    self.assertEqual(counts.tolist(), expected_counts.tolist())
+                    self.assertTrue(np.allclose(edges, expected_edges))
+
+    def test_exact_int_sum(self):
+        d = pkm.create(int, int)
+        d.update({1: 2**63 - 1, 2: 2**63 - 1, 3: 5})
+        self.assertEqual(d.values_sum(), 2**64 + 3)
+        self.assertEqual(d.values_mean(), (2**64 + 3) / 3)
+        d.update({i: -(2**63) for i in range(4, 10)})
+        self.assertEqual(d.values_sum(), sum(d.values()))
+
+    def test_nan_and_empty(self):
+        f = pkm.create(int, float)
+        f.update({1: float("nan"), 2: 3.0, 3: -1.0})
+        self.assertTrue(math.isnan(f.values_sum()))
+        self.assertEqual((f.values_min(), f.values_max()), (-1.0, 3.0))
+        # NaNs aren't counted, or used for the range
+        self.assertEqual(f.values_histogram(2)[0].tolist(), [1, 1])
+        f.clear()
+        f[1] = float("nan")
+        self.assertTrue(math.isnan(f.values_min()))
+        with self.assertRaises(ValueError):
+            f.values_histogram()
+
+        e = pkm.create(str, int)
+        self.assertEqual(e.values_sum(), 0)
+        self.assertEqual(pkm.create(str, float).values_sum(), 0.0)
+        for method in (e.values_min, e.values_max, e.values_mean):
+            with self.assertRaises(ValueError):
+                method()
+        counts, edges = e.values_histogram(2)
+        self.assertEqual((counts.tolist(), edges.tolist()), ([0, 0], [0.0, 0.5, 1.0]))
+
+    def test_bad_bins(self):
+        d = pkm.create(str, int)
+        d["a"] = 1
+        for bins, range_ in [(0, None), ([3, 1], None), ([1], None), (2, (3, 1))]:
+            with self.assertRaises(ValueError):
+                d.values_histogram(bins, range=range_)
+        with self.assertRaises(TypeError):
+            d.values_histogram([0, 1], range=(0, 1))
+        self.assertFalse(hasattr(pkm.create(str, str), "values_sum"))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,86 @@
+import threading
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+class VectorTest(unittest.TestCase):
+    def test_values(self):
+        d = pkm.create(str, (np.float32, 4))
+        self.assertEqual((d.dtype, d.dim), ("f4", 4))
+        d["a"] = [1, 2, 3, 4]
+        d["b"] = np.arange(4, dtype=np.float64)
+        self.assertEqual(d["a"].dtype, np.float32)
+        np.testing.assert_array_equal(d["b"], [0, 1, 2, 3])
+        self.assertIsNone(d.get("c"))
+        with self.assertRaises(ValueError):
+            d["c"] = [1, 2, 3]
+        with self.assertRaises(ValueError):
+            d["c"] = np.zeros((2, 4))
+        self.assertNotIn("c", d)
+        np.testing.assert_array_equal(d.pop("a"), [1, 2, 3, 4])
+        self.assertEqual(len(d), 1)
+
+    def test_formats(self):
+        d = pkm.create(int, np.dtype(("f2", 3)))
+        self.assertEqual((d.dtype, d.dim), ("f2", 3))
+        d[1] = [0.5, 1.5, -2]
+        self.assertEqual(d[1].dtype, np.float16)
+        e = pkm.create(bytes, ("i1", 2))
+        e[b"x"] = [-1, 127]
+        self.assertEqual(repr(e), "<pypocketmap[bytes, vector]: {b'x': array([ -1, 127], dtype=int8)}>")
+        with self.assertRaises(TypeError):
+            pkm.create(str, ("U4", 2))
+        with self.assertRaises(ValueError):
+            pkm.create(str, ("f4", 0))
+
+    def test_gather_scatter(self):
+        d = pkm.create(str, ("f4", 16))
+        keys = [f"k{i}" for i in range(2000)]
+        matrix = np.random.default_rng(0).random((2000, 16), dtype=np.float32)
+        d.scatter(keys, matrix)
+        self.assertEqual(len(d), 2000)
+        np.testing.assert_array_equal(d.gather(keys), matrix)
+        np.testing.assert_array_equal(d.gather(keys[::-7]), matrix[::-7])
+        # rows from a float64 array are converted, and a later duplicate key wins
+        d.scatter(["k1", "new", "k1"], np.arange(48.0).reshape(3, 16))
+        np.testing.assert_array_equal(d["k1"], np.arange(32, 48))
+        np.testing.assert_array_equal(d["new"], np.arange(16, 32))
+        got = d.gather(["k2", "missing"], np.full(16, -1))
+        np.testing.assert_array_equal(got[1], np.full(16, -1))
+        np.testing.assert_array_equal(d.gather(keys=["missing"], default=np.full(16, -2))[0], np.full(16, -2))
+        with self.assertRaises(KeyError) as ctx:
+            d.gather(["k2", "missing"])
+        self.assertEqual(ctx.exception.args, ("missing",))
+        with self.assertRaises(ValueError):
+            d.scatter(["a", "b"], np.zeros((3, 16)))
+        self.assertEqual(d.gather([]).shape, (0, 16))
+        self.assertEqual(d.to_numpy().shape, (2001, 16))
+
+    def test_int_keys(self):
+        d = pkm.create(pkm.int32_, ("f4", 8))
+        ids = np.arange(0, 3000, 3, dtype=np.int32)
+        d.scatter(ids, np.repeat(ids[:, None], 8, axis=1))
+        got = d.gather(ids[::10])
+        np.testing.assert_array_equal(got[:, 0], ids[::10])
+        e = d.copy()
+        d.clear()
+        self.assertEqual(len(e), 1000)
+        np.testing.assert_array_equal(e.gather((3, 6))[:, 7], [3, 6])
+
+    def test_threads(self):
+        d = pkm.create(int, ("f4", 64))
+        d.scatter(np.arange(10000), np.ones((10000, 64)))
+        results = []
+
+        def work():
+            results.append(d.gather(np.arange(10000)).sum())
+
+        threads = [threading.Thread(target=work) for _ in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(results, [640000.0] * 4)
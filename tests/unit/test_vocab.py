@@ -0,0 +1,111 @@
+import unittest
+
+import numpy as np
+
+import pypocketmap as pkm
+
+
+def arrow_strings(strings, offset_dtype=np.int32):
+    data = "".join(strings).encode("utf-8")
+    offsets = np.zeros(len(strings) + 1, dtype=offset_dtype)
+    np.cumsum([len(s.encode("utf-8")) for s in strings], out=offsets[1:])
+    return offsets, np.frombuffer(data, dtype=np.uint8)
+
+
+class VocabTest(unittest.TestCase):
+    def test_add(self):
+        v = pkm.vocab()
+        self.assertEqual([v.add(w) for w in ["a", "b", "a", "c" * 40, "b"]], [0, 1, 0, 2, 1])
+        self.assertEqual(len(v), 3)
+        self.assertEqual(v["c" * 40], 2)
+        self.assertEqual(v.lookup(2), "c" * 40)
+        self.assertIsNone(v.get("d"))
+        self.assertEqual(v.get("d", -1), -1)
+        with self.assertRaises(KeyError):
+            v["d"]
+        with self.assertRaises(IndexError):
+            v.lookup(3)
+        with self.assertRaises(IndexError):
+            v.lookup(-1)
+        self.assertEqual(list(v.keys()), ["a", "b", "c" * 40])
+        self.assertEqual(list(v.values()), [0, 1, 2])
+        self.assertEqual(list(v.items())[1], ("b", 1))
+        self.assertEqual(repr(pkm.vocab()), "<pypocketmap[str, vocab]: {}>")
+        with self.assertRaises(TypeError):
+            v.add(1)
+        with self.assertRaises(NotImplementedError):
+            pkm.vocab(float)
+
+    def test_encode_decode(self):
+        words = ["the", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog", "ünï"]
+        v = pkm.vocab()
+        ids = v.encode(words)
+        self.assertEqual(ids.dtype, np.int32)
+        self.assertEqual(ids.tolist(), [0, 1, 2, 3, 4, 5, 0, 6, 7, 8])
+        self.assertEqual(v.decode(ids), words)
+        self.assertEqual(v.decode(ids.astype(np.int64)), words)
+        self.assertEqual(v.decode([8, 0]), ["ünï", "the"])
+        self.assertEqual(v.encode(["fox", "cat"], add=False).tolist(), [3, -1])
+        self.assertNotIn("cat", v)
+        with self.assertRaises(IndexError):
+            v.decode([9])
+
+        for offset_dtype in (np.int32, np.int64):
+            self.assertEqual(v.encode(arrow_strings(words, offset_dtype)).tolist(), ids.tolist())
+        offsets, data = arrow_strings(["zebra", "fox", ""])
+        self.assertEqual(v.encode((offsets, data)).tolist(), [9, 3, 10])
+        self.assertEqual(v.lookup(10), "")
+        offsets[-1] = len(data) + 1
+        with self.assertRaises(ValueError):
+            v.encode((offsets, data))
+        with self.assertRaises(ValueError):
+            v.encode((np.zeros(0, dtype=np.int32), data))
+
+    def test_bytes(self):
+        v = pkm.vocab(bytes)
+        self.assertEqual(v.encode([b"x\x00y", b"z", b"x\x00y"]).tolist(), [0, 1, 0])
+        self.assertEqual(v.lookup(0), b"x\x00y")
+        self.assertEqual(v.decode(np.array([1, 0])), [b"z", b"x\x00y"])
+
+    def test_copy_clear(self):
+        v = pkm.vocab()
+        v.encode([str(i) for i in range(1000)])
+        w = v.copy()
+        v.clear()
+        self.assertEqual(len(v), 0)
+        self.assertEqual(v.add("500"), 0)
+        self.assertEqual(w["500"], 500)
+        self.assertEqual(w.decode(range(998, 1000)), ["998", "999"])
+        self.assertEqual(dict(w.items()), {str(i): i for i in range(1000)})
+
+    def test_arrow_keys(self):
+        d = pkm.create(str, int)
+        d.update({"ab": 1, "cd": 2})
+        offsets, data = arrow_strings(["cd", "ab"])
+        np.testing.assert_array_equal(d.get_many((offsets, data)), [2, 1])
+
+    def test_arrow_keys_invalid_utf8(self):
+        # one bad slice fails the call, including a character split between two keys
+        for offsets, data in [
+            (np.array([0, 2], dtype=np.int32), b"\xff\xfe"),
+            (np.array([0, 1, 3], dtype=np.int64), b"a\xff\xfe"),
+            (np.array([0, 1, 3], dtype=np.int32), "aü".encode("utf-8")[:2] + b"b"),
+        ]:
+            d = pkm.create(str, int)
+            with self.assertRaises(ValueError):
+                d.set_many((offsets, data), np.zeros(len(offsets) - 1, dtype=np.int64))
+            with self.assertRaises(ValueError):
+                d.accumulate((offsets, data), op="count")
+            # the keys before the bad one were stored, and still read back
+            self.assertEqual(len(list(d)), len(d))
+            repr(d)
+            v = pkm.vocab()
+            with self.assertRaises(ValueError):
+                v.encode((offsets, data))
+            self.assertEqual([v.lookup(i) for i in range(len(v))], list(v))
+            with self.assertRaises(ValueError):
+                pkm.factorize((offsets, data))
+        # bytes keys take any bytes
+        b = pkm.create(bytes, int)
+        b.set_many((np.array([0, 2], dtype=np.int32), b"\xff\xfe"), [1])
+        self.assertEqual(b[b"\xff\xfe"], 1)